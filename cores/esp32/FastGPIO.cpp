@@ -0,0 +1,103 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "FastGPIO.h"
+#include "esp32-hal-log.h"
+#include "driver/gpio.h"
+#include <stdlib.h>
+#include <string.h>
+
+PinGroup::PinGroup(const uint8_t *pins, uint8_t count) : _count(0), _shift(-1), _lane_count(0), _mask(0), _lanes(NULL) {
+  if (count > MAX_PINS) {
+    log_e("Too many pins in the group: %u, max %u", count, MAX_PINS);
+    count = MAX_PINS;
+  }
+  memcpy(_pins, pins, count);
+  _count = count;
+}
+
+PinGroup::~PinGroup() {
+  end();
+}
+
+bool PinGroup::begin(uint8_t mode) {
+  end();
+  if (!_count) {
+    log_e("No pins in the group");
+    return false;
+  }
+  uint64_t mask = 0;
+  bool consecutive = true;
+  for (uint8_t i = 0; i < _count; i++) {
+    uint8_t pin = _pins[i];
+    if (pin >= SOC_GPIO_PIN_COUNT || !digitalPinIsValid(pin) || ((mode & OUTPUT) == OUTPUT && !digitalPinCanOutput(pin))) {
+      log_e("Invalid IO %u selected", pin);
+      return false;
+    }
+    if (mask & (1ULL << pin)) {
+      log_e("IO %u is twice in the group", pin);
+      return false;
+    }
+    mask |= 1ULL << pin;
+    consecutive = consecutive && pin == _pins[0] + i;
+  }
+  for (uint8_t i = 0; i < _count; i++) {
+    pinMode(_pins[i], mode);
+  }
+  _mask = mask;
+  if (consecutive) {
+    _shift = _pins[0];
+    return true;
+  }
+
+  _lane_count = (_count + 3) / 4;
+  _lanes = (uint64_t *)malloc(_lane_count * 16 * sizeof(uint64_t));
+  if (!_lanes) {
+    log_e("Failed to allocate the masks of %u pins", _count);
+    _lane_count = 0;
+    return false;
+  }
+  for (uint8_t lane = 0; lane < _lane_count; lane++) {
+    for (uint8_t value = 0; value < 16; value++) {
+      uint64_t levels = 0;
+      for (uint8_t bit = 0; bit < 4 && lane * 4 + bit < _count; bit++) {
+        if (value & (1 << bit)) {
+          levels |= 1ULL << _pins[lane * 4 + bit];
+        }
+      }
+      _lanes[lane * 16 + value] = levels;
+    }
+  }
+  return true;
+}
+
+void PinGroup::end() {
+  free(_lanes);
+  _lanes = NULL;
+  _lane_count = 0;
+  _shift = -1;
+  _mask = 0;
+}
+
+uint32_t PinGroup::read() const {
+  uint64_t levels = FastGPIO::read(_mask);
+  if (_shift >= 0) {
+    return (uint32_t)(levels >> _shift);
+  }
+  uint32_t value = 0;
+  for (uint8_t i = 0; i < _count && _mask; i++) {
+    value |= (uint32_t)((levels >> _pins[i]) & 1) << i;
+  }
+  return value;
+}
@@ -0,0 +1,190 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "soc/soc_caps.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#include "esp32-hal-gpio.h"
+
+#if SOC_GPIO_PIN_COUNT > 64
+#error SOC_GPIO_PIN_COUNT > 64 not implemented
+#endif
+
+#define FAST_GPIO_INLINE inline __attribute__((always_inline))
+
+/*
+ * Direct access to the GPIO output and input registers, for pins set with pinMode() first.
+ *
+ * Pins are given as masks of GPIO numbers, bit <n> for GPIO<n>, built with FastGPIO::mask(), which
+ * is constexpr so that constant masks cost nothing at run time. On boards with remapped pins, use
+ * digitalPinToGPIONumber() to get the GPIO numbers.
+ *
+ * The output registers are written with their W1TS (write 1 to set) and W1TC (write 1 to clear)
+ * aliases: there is no read-modify-write, so pins outside of the mask are not changed, even when
+ * other tasks, the other core or interrupts write them at the same time. The pins of one bank of
+ * 32 GPIOs are set in one store and cleared in the next; on SoCs with more than 32 GPIOs the second
+ * bank (GPIO32 and up) is written after the first one.
+ *
+ * All the functions are inlined, and can be called from interrupts.
+ */
+class FastGPIO {
+public:
+  static constexpr uint64_t mask() {
+    return 0;
+  }
+
+  template<typename... Pins> static constexpr uint64_t mask(uint8_t pin, Pins... pins) {
+    return (1ULL << pin) | mask(pins...);
+  }
+
+  // Drive the pins of <pins> high
+  static FAST_GPIO_INLINE void set(uint64_t pins) {
+    if ((uint32_t)pins) {
+      REG_WRITE(GPIO_OUT_W1TS_REG, (uint32_t)pins);
+    }
+#if SOC_GPIO_PIN_COUNT > 32
+    if (pins >> 32) {
+      REG_WRITE(GPIO_OUT1_W1TS_REG, (uint32_t)(pins >> 32));
+    }
+#endif
+  }
+
+  // Drive the pins of <pins> low
+  static FAST_GPIO_INLINE void clear(uint64_t pins) {
+    if ((uint32_t)pins) {
+      REG_WRITE(GPIO_OUT_W1TC_REG, (uint32_t)pins);
+    }
+#if SOC_GPIO_PIN_COUNT > 32
+    if (pins >> 32) {
+      REG_WRITE(GPIO_OUT1_W1TC_REG, (uint32_t)(pins >> 32));
+    }
+#endif
+  }
+
+  // Drive the pins of <pins> to the matching bits of <value>, other bits of <value> are ignored
+  static FAST_GPIO_INLINE void write(uint64_t pins, uint64_t value) {
+    if ((uint32_t)pins) {
+      REG_WRITE(GPIO_OUT_W1TS_REG, (uint32_t)(value & pins));
+      REG_WRITE(GPIO_OUT_W1TC_REG, (uint32_t)(~value & pins));
+    }
+#if SOC_GPIO_PIN_COUNT > 32
+    if (pins >> 32) {
+      REG_WRITE(GPIO_OUT1_W1TS_REG, (uint32_t)((value & pins) >> 32));
+      REG_WRITE(GPIO_OUT1_W1TC_REG, (uint32_t)((~value & pins) >> 32));
+    }
+#endif
+  }
+
+  // Invert the output of the pins of <pins>. The outputs are read first: a pin written by another
+  // core between the read and the write gets the inverted old level
+  static FAST_GPIO_INLINE void toggle(uint64_t pins) {
+    write(pins, ~outputs(pins));
+  }
+
+  // Get the levels driven on the pins of <pins>
+  static FAST_GPIO_INLINE uint64_t outputs(uint64_t pins) {
+    uint64_t levels = 0;
+    if ((uint32_t)pins) {
+      levels = REG_READ(GPIO_OUT_REG);
+    }
+#if SOC_GPIO_PIN_COUNT > 32
+    if (pins >> 32) {
+      levels |= (uint64_t)REG_READ(GPIO_OUT1_REG) << 32;
+    }
+#endif
+    return levels & pins;
+  }
+
+  // Get the input levels of the pins of <pins>
+  static FAST_GPIO_INLINE uint64_t read(uint64_t pins) {
+    uint64_t levels = 0;
+    if ((uint32_t)pins) {
+      levels = REG_READ(GPIO_IN_REG);
+    }
+#if SOC_GPIO_PIN_COUNT > 32
+    if (pins >> 32) {
+      levels |= (uint64_t)REG_READ(GPIO_IN1_REG) << 32;
+    }
+#endif
+    return levels & pins;
+  }
+};
+
+/*
+ * Group of up to 32 pins written and read as the bits of a value, bit <i> being the <i>th pin
+ * given, e.g. the data lines of a parallel bus.
+ *
+ * begin() sets the pins with pinMode() and resolves them once into masks: when the pins are
+ * consecutive GPIOs, a value is written with a shift, otherwise with tables of the masks of each
+ * group of 4 bits. write() has the atomicity of FastGPIO::write(), and like it can be called from
+ * interrupts.
+ */
+class PinGroup {
+public:
+  static constexpr uint8_t MAX_PINS = 32;
+
+  // <pins> are GPIO numbers, copied
+  PinGroup(const uint8_t *pins, uint8_t count);
+  template<size_t N> PinGroup(const uint8_t (&pins)[N]) : PinGroup(pins, N) {
+    static_assert(N <= MAX_PINS, "Too many pins in the group");
+  }
+  PinGroup(const PinGroup &) = delete;
+  PinGroup &operator=(const PinGroup &) = delete;
+  ~PinGroup();
+
+  // Set the mode of the pins, OUTPUT, INPUT or OUTPUT_OPEN_DRAIN and the like
+  bool begin(uint8_t mode = OUTPUT);
+  void end();
+
+  // Drive the pins to the bits of <value>
+  FAST_GPIO_INLINE void write(uint32_t value) {
+    if (_shift >= 0) {
+      uint64_t levels = (uint64_t)value << _shift;
+      FastGPIO::write(_mask, levels);
+    } else if (_lanes) {
+      uint64_t levels = 0;
+      for (uint8_t i = 0; i < _lane_count; i++, value >>= 4) {
+        levels |= _lanes[i * 16 + (value & 0xF)];
+      }
+      FastGPIO::write(_mask, levels);
+    }
+  }
+
+  // Get the input levels of the pins as the bits of a value
+  uint32_t read() const;
+
+  // Mask of the GPIOs of the group, as used by FastGPIO
+  uint64_t mask() const {
+    return _mask;
+  }
+  uint8_t size() const {
+    return _count;
+  }
+  operator bool() const {
+    return _shift >= 0 || _lanes != NULL;
+  }
+
+private:
+  uint8_t _pins[MAX_PINS];
+  uint8_t _count;
+  int8_t _shift;        // position of the first pin when the pins are consecutive, -1 otherwise
+  uint8_t _lane_count;  // groups of 4 pins
+  uint64_t _mask;
+  uint64_t *_lanes;     // _lane_count * 16 masks of the pins set by each value of a group of 4 bits
+};
@@ -7,6 +7,12 @@
 
 #include "FunctionalInterrupt.h"
 #include "Arduino.h"
+#include "FastGPIO.h"
+#include "esp_heap_caps.h"
+
+#ifndef INTERRUPT_DISPATCHER_STACK_SIZE
+#define INTERRUPT_DISPATCHER_STACK_SIZE 4096
+#endif
 
 typedef void (*voidFuncPtr)(void);
 typedef void (*voidFuncPtrArg)(void *);
@@ -15,6 +21,24 @@ extern "C" {
 extern void __attachInterruptFunctionalArg(uint8_t pin, voidFuncPtrArg userFunc, void *arg, int intr_type, bool functional);
 }
 
+// InterruptFunction of each pin, allocated once at the first attach and reused afterwards
+typedef struct {
+  InterruptFunction<> isr;
+  DeferredInterruptFunction deferred;
+} InterruptSlot;
+
+static InterruptSlot *slots = NULL;
+// the deferred function of a slot is replaced and copied by the dispatcher under this lock
+static portMUX_TYPE slots_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// events written by the GPIO interrupt and read by the dispatcher task, with lock-free indexes
+static InterruptEvent *events = NULL;
+static uint32_t events_mask = 0;
+static uint32_t events_head = 0;  // written by the interrupt only
+static uint32_t events_tail = 0;  // written by the dispatcher only
+static volatile uint32_t events_dropped = 0;
+static TaskHandle_t dispatcher = NULL;
+
 void ARDUINO_ISR_ATTR interruptFunctional(void *arg) {
   InterruptArgStructure *localArg = (InterruptArgStructure *)arg;
   if (localArg->interruptFunction) {
@@ -22,13 +46,143 @@ void ARDUINO_ISR_ATTR interruptFunctional(void *arg) {
   }
 }
 
+static void ARDUINO_ISR_ATTR interruptSlot(void *arg) {
+  ((InterruptSlot *)arg)->isr();
+}
+
+// The GPIO interrupts of all the pins run on one core and do not nest: there is a single writer
+static void ARDUINO_ISR_ATTR interruptDeferred(void *arg) {
+  uint8_t pin = (InterruptSlot *)arg - slots;
+  uint32_t head = events_head;
+  uint32_t tail = __atomic_load_n(&events_tail, __ATOMIC_ACQUIRE);
+  if (head - tail > events_mask) {
+    events_dropped = events_dropped + 1;
+    return;
+  }
+  InterruptEvent *event = &events[head & events_mask];
+  event->time = micros();
+  event->pin = pin;
+  event->level = FastGPIO::read(FastGPIO::mask(pin)) ? HIGH : LOW;
+  __atomic_store_n(&events_head, head + 1, __ATOMIC_RELEASE);
+
+  // the dispatcher blocks only once the queue is empty. Paired with the fence of the dispatcher, either
+  // it sees the new head before blocking, or the tail read here shows it consumed all the previous events.
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&events_tail, __ATOMIC_RELAXED) == head) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(dispatcher, &woken);
+    if (woken) {
+      portYIELD_FROM_ISR();
+    }
+  }
+}
+
+static void interruptDispatcherTask(void *arg) {
+  for (;;) {
+    uint32_t tail = events_tail;
+    while (tail != __atomic_load_n(&events_head, __ATOMIC_ACQUIRE)) {
+      InterruptEvent event = events[tail & events_mask];
+      __atomic_store_n(&events_tail, ++tail, __ATOMIC_RELEASE);
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+      portENTER_CRITICAL(&slots_mux);
+      DeferredInterruptFunction intRoutine = slots[event.pin].deferred;
+      portEXIT_CRITICAL(&slots_mux);
+      if (intRoutine) {
+        intRoutine(event);
+      }
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+}
+
+static InterruptSlot *getSlot(uint8_t pin) {
+  if (pin >= SOC_GPIO_PIN_COUNT) {
+    return NULL;
+  }
+  if (!slots) {
+    InterruptSlot *table = (InterruptSlot *)heap_caps_malloc(SOC_GPIO_PIN_COUNT * sizeof(InterruptSlot), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!table) {
+      log_e("Failed to allocate the interrupt functions");
+      return NULL;
+    }
+    for (uint8_t i = 0; i < SOC_GPIO_PIN_COUNT; i++) {
+      new (&table[i]) InterruptSlot();
+    }
+    slots = table;
+  }
+  // the interrupt may still run the previous function of the slot while it is replaced
+  disableInterrupt(pin);
+  return &slots[pin];
+}
+
 void attachInterrupt(uint8_t pin, std::function<void(void)> intRoutine, int mode) {
   // use the local interrupt routine which takes the ArgStructure as argument
   __attachInterruptFunctionalArg(pin, (voidFuncPtrArg)interruptFunctional, new InterruptArgStructure{intRoutine}, mode, true);
 }
 
+void attachInterrupt(uint8_t pin, const InterruptFunction<> &intRoutine, int mode) {
+  InterruptSlot *slot = getSlot(pin);
+  if (!slot) {
+    return;
+  }
+  slot->isr = intRoutine;
+  portENTER_CRITICAL(&slots_mux);
+  slot->deferred = DeferredInterruptFunction();
+  portEXIT_CRITICAL(&slots_mux);
+  __attachInterruptFunctionalArg(pin, interruptSlot, slot, mode, true);
+}
+
+void attachInterruptDeferred(uint8_t pin, const DeferredInterruptFunction &intRoutine, int mode) {
+  if (!dispatcher && !interruptDispatcherBegin()) {
+    return;
+  }
+  InterruptSlot *slot = getSlot(pin);
+  if (!slot) {
+    return;
+  }
+  slot->isr = InterruptFunction<>();
+  portENTER_CRITICAL(&slots_mux);
+  slot->deferred = intRoutine;
+  portEXIT_CRITICAL(&slots_mux);
+  __attachInterruptFunctionalArg(pin, interruptDeferred, slot, mode, true);
+}
+
+bool interruptDispatcherBegin(size_t queue_len, UBaseType_t priority, BaseType_t core) {
+  if (dispatcher) {
+    log_w("Interrupt dispatcher already started");
+    return true;
+  }
+  size_t size = 2;
+  while (size < queue_len) {
+    size <<= 1;
+  }
+  events = (InterruptEvent *)heap_caps_malloc(size * sizeof(InterruptEvent), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (!events) {
+    log_e("Failed to allocate %u interrupt events", size);
+    return false;
+  }
+  events_mask = size - 1;
+  events_head = events_tail = 0;
+  if (xTaskCreateUniversal(interruptDispatcherTask, "irq_dispatch", INTERRUPT_DISPATCHER_STACK_SIZE, NULL, priority, &dispatcher, core) != pdPASS) {
+    log_e("Failed to start the interrupt dispatcher");
+    free(events);
+    events = NULL;
+    dispatcher = NULL;
+    return false;
+  }
+  return true;
+}
+
+uint32_t interruptDispatcherDropped() {
+  return events_dropped;
+}
+
 extern "C" {
 void cleanupFunctional(void *arg) {
+  // slots are kept for the next attach of their pin
+  if (slots && arg >= (void *)slots && arg < (void *)(slots + SOC_GPIO_PIN_COUNT)) {
+    return;
+  }
   delete (InterruptArgStructure *)arg;
 }
 }
@@ -9,14 +9,92 @@
 #define CORE_CORE_FUNCTIONALINTERRUPT_H_
 
 #include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
 #include <stdint.h>
+#include <stddef.h>
+#include "esp32-hal.h"
 
 struct InterruptArgStructure {
   std::function<void(void)> interruptFunction;
 };
 
+/*
+ * Callable kept in place, without heap allocation, and called through a function placed in IRAM
+ * like the other interrupt handlers (ARDUINO_ISR_ATTR).
+ *
+ * It holds any trivially copyable callable of up to STORAGE_SIZE bytes, e.g. a lambda capturing
+ * a few pointers or integers by value. The body of a small lambda is inlined in the IRAM function;
+ * functions called from it must be ARDUINO_ISR_ATTR too, and the data it uses in RAM.
+ */
+template<typename... Args> class InterruptFunction {
+public:
+  static constexpr size_t STORAGE_SIZE = 16;
+
+  // callable with Args, so that nullptr, NULL or an integer go to the other overloads
+  template<typename F, typename = void> struct callable : std::false_type {};
+  template<typename F> struct callable<F, decltype((void)std::declval<F &>()(std::declval<Args>()...))> : std::true_type {};
+
+  template<typename F> static constexpr bool fits() {
+    return callable<F>::value && sizeof(F) <= STORAGE_SIZE && alignof(F) <= 8 && std::is_trivially_copyable<F>::value
+           && !std::is_same<F, InterruptFunction>::value;
+  }
+
+  InterruptFunction() : _invoke(nullptr) {}
+
+  template<typename F, typename = typename std::enable_if<fits<F>()>::type> InterruptFunction(F fn) : _invoke(call<F>) {
+    new (_storage) F(fn);
+  }
+
+  explicit operator bool() const {
+    return _invoke != nullptr;
+  }
+
+  inline __attribute__((always_inline)) void operator()(Args... args) {
+    _invoke(_storage, args...);
+  }
+
+private:
+  template<typename F> static void ARDUINO_ISR_ATTR call(void *storage, Args... args) {
+    (*static_cast<F *>(storage))(args...);
+  }
+
+  void (*_invoke)(void *, Args...);
+  alignas(8) uint8_t _storage[STORAGE_SIZE];
+};
+
+// Interrupt recorded for attachInterruptDeferred()
+typedef struct {
+  uint32_t time;  // micros() in the interrupt
+  uint8_t pin;
+  uint8_t level;  // level of the pin read in the interrupt, HIGH after a rising edge
+} InterruptEvent;
+
+typedef InterruptFunction<const InterruptEvent &> DeferredInterruptFunction;
+
 // The extra set of parentheses here prevents macros defined
 // in io_pin_remap.h from applying to this declaration.
 void(attachInterrupt)(uint8_t pin, std::function<void(void)> intRoutine, int mode);
 
+// Callables fitting in an InterruptFunction are kept without allocation, others in a std::function
+void(attachInterrupt)(uint8_t pin, const InterruptFunction<> &intRoutine, int mode);
+template<typename F, typename = typename std::enable_if<InterruptFunction<>::fits<F>()>::type> void(attachInterrupt)(uint8_t pin, F intRoutine, int mode) {
+  (attachInterrupt)(pin, InterruptFunction<>(intRoutine), mode);
+}
+
+/*
+ * The interrupt only queues the pin, its level and the time, and <intRoutine> is called with
+ * them by the dispatcher task, so that the time spent in the interrupt is short and bounded
+ * whatever <intRoutine> does. Events are dropped when the queue is full.
+ */
+void(attachInterruptDeferred)(uint8_t pin, const DeferredInterruptFunction &intRoutine, int mode);
+
+// Start the dispatcher task with a queue of <queue_len> events, rounded up to a power of 2.
+// The first attachInterruptDeferred() starts it with the default values when not done before.
+bool interruptDispatcherBegin(size_t queue_len = 64, UBaseType_t priority = configMAX_PRIORITIES - 1, BaseType_t core = tskNO_AFFINITY);
+
+// Events dropped, the queue being full
+uint32_t interruptDispatcherDropped();
+
 #endif /* CORE_CORE_FUNCTIONALINTERRUPT_H_ */
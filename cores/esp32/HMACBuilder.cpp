@@ -0,0 +1,93 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <Arduino.h>
+#include <HMACBuilder.h>
+
+#define HMAC_IPAD 0x36
+#define HMAC_OPAD 0x5c
+
+HMACBuilder::HMACBuilder(HashBuilder &hash) : _hash(hash) {
+  memset(_key, 0x00, sizeof(_key));
+}
+
+HMACBuilder::HMACBuilder(HashBuilder &hash, const uint8_t *key, size_t len) : _hash(hash) {
+  setKey(key, len);
+}
+
+HMACBuilder::~HMACBuilder() {
+  memset(_key, 0x00, sizeof(_key));
+}
+
+void HMACBuilder::setKey(const uint8_t *key, size_t len) {
+  memset(_key, 0x00, sizeof(_key));
+  if (_hash.getBlockSize() > HMAC_MAX_BLOCK_SIZE || _hash.getHashSize() > HMAC_MAX_HASH_SIZE) {
+    log_e("hash sizes not supported");
+    return;
+  }
+  if (len > _hash.getBlockSize()) {
+    // longer keys are replaced by their hash
+    _hash.begin();
+    _hash.add(key, len);
+    _hash.calculate();
+    _hash.getBytes(_key);
+  } else {
+    memcpy(_key, key, len);
+  }
+}
+
+void HMACBuilder::addPaddedKey(uint8_t pad) {
+  uint8_t block[HMAC_MAX_BLOCK_SIZE];
+  size_t len = _hash.getBlockSize();
+  for (size_t i = 0; i < len; i++) {
+    block[i] = _key[i] ^ pad;
+  }
+  _hash.add(block, len);
+  memset(block, 0x00, len);
+}
+
+void HMACBuilder::begin(void) {
+  _hash.begin();
+  addPaddedKey(HMAC_IPAD);
+}
+
+void HMACBuilder::add(const uint8_t *data, size_t len) {
+  _hash.add(data, len);
+}
+
+void HMACBuilder::addHexString(const char *data) {
+  _hash.addHexString(data);
+}
+
+void HMACBuilder::calculate(void) {
+  uint8_t inner[HMAC_MAX_HASH_SIZE];
+  _hash.calculate();
+  _hash.getBytes(inner);
+  _hash.begin();
+  addPaddedKey(HMAC_OPAD);
+  _hash.add(inner, _hash.getHashSize());
+  _hash.calculate();
+}
+
+void HMACBuilder::getBytes(uint8_t *output) {
+  _hash.getBytes(output);
+}
+
+void HMACBuilder::getChars(char *output) {
+  _hash.getChars(output);
+}
+
+String HMACBuilder::toString(void) {
+  return _hash.toString();
+}
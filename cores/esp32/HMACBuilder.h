@@ -0,0 +1,68 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HMACBuilder_h
+#define HMACBuilder_h
+
+#include <WString.h>
+#include <Stream.h>
+
+#include "HashBuilder.h"
+
+#define HMAC_MAX_BLOCK_SIZE 128
+#define HMAC_MAX_HASH_SIZE  64
+
+// HMAC (RFC 2104) of any HashBuilder, e.g. HMACBuilder hmac(sha256, key, keyLen)
+class HMACBuilder : public HashBuilder {
+private:
+  HashBuilder &_hash;
+  uint8_t _key[HMAC_MAX_BLOCK_SIZE]; /* key padded to the block size */
+
+  void addPaddedKey(uint8_t pad);
+
+public:
+  HMACBuilder(HashBuilder &hash);
+  HMACBuilder(HashBuilder &hash, const uint8_t *key, size_t len);
+  ~HMACBuilder();
+
+  void setKey(const uint8_t *key, size_t len);
+  void setKey(const char *key) {
+    setKey((const uint8_t *)key, strlen(key));
+  }
+  void setKey(String key) {
+    setKey(key.c_str());
+  }
+
+  void begin() override;
+
+  using HashBuilder::add;
+  void add(const uint8_t *data, size_t len) override;
+
+  using HashBuilder::addHexString;
+  void addHexString(const char *data) override;
+
+  void calculate() override;
+  void getBytes(uint8_t *output) override;
+  void getChars(char *output) override;
+  String toString() override;
+
+  size_t getHashSize() const override {
+    return _hash.getHashSize();
+  }
+  size_t getBlockSize() const override {
+    return _hash.getBlockSize();
+  }
+};
+
+#endif
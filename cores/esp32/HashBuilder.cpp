@@ -0,0 +1,39 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <Arduino.h>
+#include <HashBuilder.h>
+
+bool HashBuilder::addStream(Stream &stream, const size_t maxLen) {
+  uint8_t buf[HASH_BUILDER_STREAM_BUFFER_SIZE];
+  return addStream(stream, maxLen, buf, sizeof(buf));
+}
+
+bool HashBuilder::addStream(Stream &stream, const size_t maxLen, uint8_t *buf, size_t bufLen) {
+  if (!buf || !bufLen) {
+    return false;
+  }
+
+  size_t maxLengthLeft = maxLen;
+  while (maxLengthLeft > 0) {
+    // readBytes() waits up to the stream timeout for the data
+    size_t numBytesRead = stream.readBytes(buf, (maxLengthLeft < bufLen) ? maxLengthLeft : bufLen);
+    if (numBytesRead == 0) {
+      return false;
+    }
+    add(buf, numBytesRead);
+    maxLengthLeft -= numBytesRead;
+  }
+  return true;
+}
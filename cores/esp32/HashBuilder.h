@@ -20,6 +20,9 @@
 
 #include "HEXBuilder.h"
 
+// stack buffer of addStream() when the caller gives none
+#define HASH_BUILDER_STREAM_BUFFER_SIZE 256
+
 class HashBuilder : public HEXBuilder {
 public:
   virtual ~HashBuilder() {}
@@ -38,11 +41,20 @@ public:
     addHexString(data.c_str());
   }
 
-  virtual bool addStream(Stream &stream, const size_t maxLen) = 0;
+  // reads maxLen bytes, waiting for them up to the stream timeout; false if the stream ended before
+  virtual bool addStream(Stream &stream, const size_t maxLen);
+  bool addStream(Stream &stream, const size_t maxLen, uint8_t *buf, size_t bufLen);
+
   virtual void calculate() = 0;
   virtual void getBytes(uint8_t *output) = 0;
   virtual void getChars(char *output) = 0;
   virtual String toString() = 0;
+
+  // digest and input block sizes in bytes, the block size is used by HMAC
+  virtual size_t getHashSize() const = 0;
+  virtual size_t getBlockSize() const {
+    return 64;
+  }
 };
 
 #endif
@@ -43,11 +43,14 @@ public:
   using HashBuilder::addHexString;
   void addHexString(const char *data) override;
 
-  bool addStream(Stream &stream, const size_t maxLen) override;
   void calculate(void) override;
   void getBytes(uint8_t *output) override;
   void getChars(char *output) override;
   String toString(void) override;
+
+  size_t getHashSize() const override {
+    return ESP_ROM_MD5_DIGEST_LEN;
+  }
 };
 
 #endif
@@ -18,20 +18,23 @@
 #include <WString.h>
 #include <Stream.h>
 
+#include "mbedtls/sha1.h"
+
 #include "HashBuilder.h"
 
 #define SHA1_HASH_SIZE 20
 
 class SHA1Builder : public HashBuilder {
 private:
-  uint32_t total[2];            /* number of bytes processed  */
-  uint32_t state[5];            /* intermediate digest state  */
-  unsigned char buffer[64];     /* data block being processed */
+  mbedtls_sha1_context _ctx;    /* runs on the SHA peripheral */
   uint8_t hash[SHA1_HASH_SIZE]; /* SHA-1 result               */
 
-  void process(const uint8_t *data);
-
 public:
+  SHA1Builder();
+  ~SHA1Builder();
+  SHA1Builder(const SHA1Builder &) = delete;  // the context may hold the SHA peripheral
+  SHA1Builder &operator=(const SHA1Builder &) = delete;
+
   void begin() override;
 
   using HashBuilder::add;
@@ -40,11 +43,14 @@ public:
   using HashBuilder::addHexString;
   void addHexString(const char *data) override;
 
-  bool addStream(Stream &stream, const size_t maxLen) override;
   void calculate() override;
   void getBytes(uint8_t *output) override;
   void getChars(char *output) override;
   String toString() override;
+
+  size_t getHashSize() const override {
+    return SHA1_HASH_SIZE;
+  }
 };
 
 #endif
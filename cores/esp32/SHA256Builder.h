@@ -0,0 +1,56 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SHA256Builder_h
+#define SHA256Builder_h
+
+#include <WString.h>
+#include <Stream.h>
+
+#include "mbedtls/sha256.h"
+
+#include "HashBuilder.h"
+
+#define SHA256_HASH_SIZE 32
+
+class SHA256Builder : public HashBuilder {
+private:
+  mbedtls_sha256_context _ctx;    /* runs on the SHA peripheral */
+  uint8_t hash[SHA256_HASH_SIZE]; /* SHA-256 result             */
+
+public:
+  SHA256Builder();
+  ~SHA256Builder();
+  SHA256Builder(const SHA256Builder &) = delete;  // the context may hold the SHA peripheral
+  SHA256Builder &operator=(const SHA256Builder &) = delete;
+
+  void begin() override;
+
+  using HashBuilder::add;
+  void add(const uint8_t *data, size_t len) override;
+
+  using HashBuilder::addHexString;
+  void addHexString(const char *data) override;
+
+  void calculate() override;
+  void getBytes(uint8_t *output) override;
+  void getChars(char *output) override;
+  String toString() override;
+
+  size_t getHashSize() const override {
+    return SHA256_HASH_SIZE;
+  }
+};
+
+#endif
@@ -82,7 +82,8 @@ static void usb_unplugged_cb(void *arg, esp_event_base_t event_base, int32_t eve
 }
 
 USBCDC::USBCDC(uint8_t itfn)
-  : itf(itfn), bit_rate(0), stop_bits(0), parity(0), data_bits(0), dtr(false), rts(false), connected(false), reboot_enable(true), rx_queue(NULL), tx_lock(NULL),
+  : itf(itfn), bit_rate(0), stop_bits(0), parity(0), data_bits(0), dtr(false), rts(false), connected(false), reboot_enable(true), rx_ring(NULL), rx_ring_size(0), rx_peek(-1),
+    rx_peek_span(0), tx_lock(NULL),
     tx_timeout_ms(250) {
   tinyusb_enable_interface(USB_INTERFACE_CDC, TUD_CDC_DESC_LEN, load_cdc_descriptor);
   if (itf < MAX_USB_CDC_DEVICES) {
@@ -102,40 +103,43 @@ void USBCDC::onEvent(arduino_usb_cdc_event_t event, esp_event_handler_t callback
 }
 
 size_t USBCDC::setRxBufferSize(size_t rx_queue_len) {
-  size_t currentQueueSize = rx_queue ? uxQueueSpacesAvailable(rx_queue) + uxQueueMessagesWaiting(rx_queue) : 0;
-
-  if (rx_queue_len != currentQueueSize) {
-    QueueHandle_t new_rx_queue = NULL;
+  if (rx_queue_len != rx_ring_size) {
+    RingbufHandle_t old_rx_ring = rx_ring;
     if (rx_queue_len) {
-      new_rx_queue = xQueueCreate(rx_queue_len, sizeof(uint8_t));
-      if (!new_rx_queue) {
+      RingbufHandle_t new_rx_ring = xRingbufferCreate(rx_queue_len, RINGBUF_TYPE_BYTEBUF);
+      if (!new_rx_ring) {
         log_e("CDC Queue creation failed.");
         return 0;
       }
-      if (rx_queue) {
-        size_t copySize = uxQueueMessagesWaiting(rx_queue);
-        if (copySize > 0) {
-          for (size_t i = 0; i < copySize; i++) {
-            uint8_t ch = 0;
-            xQueueReceive(rx_queue, &ch, 0);
-            if (!xQueueSend(new_rx_queue, &ch, 0)) {
-              arduino_usb_cdc_event_data_t p;
-              p.rx_overflow.dropped_bytes = copySize - i;
-              arduino_usb_event_post(ARDUINO_USB_CDC_EVENTS, ARDUINO_USB_CDC_RX_OVERFLOW_EVENT, &p, sizeof(arduino_usb_cdc_event_data_t), portMAX_DELAY);
-              log_e("CDC RX Overflow.");
-              break;
-            }
+      if (old_rx_ring) {
+        // keep the received data, in at most two pieces as it may wrap around the end of the ring
+        size_t dropped = 0;
+        size_t len = 0;
+        uint8_t *data;
+        while ((data = (uint8_t *)xRingbufferReceiveUpTo(old_rx_ring, &len, 0, rx_queue_len)) != NULL) {
+          size_t space = xRingbufferGetCurFreeSize(new_rx_ring);
+          size_t copy = len < space ? len : space;
+          if (copy) {
+            xRingbufferSend(new_rx_ring, data, copy, 0);
           }
+          dropped += len - copy;
+          vRingbufferReturnItem(old_rx_ring, data);
+        }
+        if (dropped) {
+          arduino_usb_cdc_event_data_t p;
+          p.rx_overflow.dropped_bytes = dropped;
+          arduino_usb_event_post(ARDUINO_USB_CDC_EVENTS, ARDUINO_USB_CDC_RX_OVERFLOW_EVENT, &p, sizeof(arduino_usb_cdc_event_data_t), portMAX_DELAY);
+          log_e("CDC RX Overflow.");
         }
-        vQueueDelete(rx_queue);
       }
-      rx_queue = new_rx_queue;
-      return rx_queue_len;
+      rx_ring = new_rx_ring;
     } else {
-      if (rx_queue) {
-        vQueueDelete(rx_queue);
-        rx_queue = NULL;
-      }
+      rx_ring = NULL;
+      rx_peek = -1;
+    }
+    rx_ring_size = rx_queue_len;
+    if (old_rx_ring) {
+      vRingbufferDelete(old_rx_ring);
     }
   }
   return rx_queue_len;
@@ -145,8 +149,8 @@ void USBCDC::begin(unsigned long baud) {
   if (tx_lock == NULL) {
     tx_lock = xSemaphoreCreateMutex();
   }
-  // if rx_queue was set before begin(), keep it
-  if (!rx_queue) {
+  // if rx_ring was set before begin(), keep it
+  if (!rx_ring) {
     setRxBufferSize(256);  //default if not preset
   }
   devices[itf] = this;
@@ -270,14 +274,24 @@ void USBCDC::_onRX() {
   arduino_usb_cdc_event_data_t p;
   uint8_t buf[CONFIG_TINYUSB_CDC_RX_BUFSIZE + 1];
   uint32_t count = tud_cdc_n_read(itf, buf, CONFIG_TINYUSB_CDC_RX_BUFSIZE);
-  for (uint32_t i = 0; i < count; i++) {
-    if (rx_queue == NULL || !xQueueSend(rx_queue, buf + i, 10)) {
-      p.rx_overflow.dropped_bytes = count - i;
-      arduino_usb_event_post(ARDUINO_USB_CDC_EVENTS, ARDUINO_USB_CDC_RX_OVERFLOW_EVENT, &p, sizeof(arduino_usb_cdc_event_data_t), portMAX_DELAY);
-      log_e("CDC RX Overflow.");
-      count = i;
+  uint32_t queued = 0;
+  while (rx_ring != NULL && queued < count) {
+    // what fits at once, or wait for the reader to free at least one byte
+    size_t space = xRingbufferGetCurFreeSize(rx_ring);
+    size_t chunk = count - queued;
+    if (chunk > space) {
+      chunk = space ? space : 1;
+    }
+    if (xRingbufferSend(rx_ring, buf + queued, chunk, space ? 0 : 10) != pdTRUE) {
       break;
     }
+    queued += chunk;
+  }
+  if (queued < count) {
+    p.rx_overflow.dropped_bytes = count - queued;
+    arduino_usb_event_post(ARDUINO_USB_CDC_EVENTS, ARDUINO_USB_CDC_RX_OVERFLOW_EVENT, &p, sizeof(arduino_usb_cdc_event_data_t), portMAX_DELAY);
+    log_e("CDC RX Overflow.");
+    count = queued;
   }
   if (count) {
     p.rx.len = count;
@@ -298,42 +312,93 @@ bool USBCDC::rebootEnabled(void) {
 }
 
 int USBCDC::available(void) {
-  if (itf >= MAX_USB_CDC_DEVICES || rx_queue == NULL) {
+  if (itf >= MAX_USB_CDC_DEVICES || rx_ring == NULL) {
     return -1;
   }
-  return uxQueueMessagesWaiting(rx_queue);
+  UBaseType_t waiting = 0;
+  vRingbufferGetInfo(rx_ring, NULL, NULL, NULL, NULL, &waiting);
+  return waiting + (rx_peek >= 0 ? 1 : 0);
 }
 
 int USBCDC::peek(void) {
-  if (itf >= MAX_USB_CDC_DEVICES || rx_queue == NULL) {
+  if (itf >= MAX_USB_CDC_DEVICES || rx_ring == NULL) {
     return -1;
   }
   uint8_t c;
-  if (xQueuePeek(rx_queue, &c, 0)) {
-    return c;
+  if (rx_peek < 0 && _readRx(&c, 1, 0)) {
+    rx_peek = c;
   }
-  return -1;
+  return rx_peek;
 }
 
 int USBCDC::read(void) {
-  if (itf >= MAX_USB_CDC_DEVICES || rx_queue == NULL) {
+  if (itf >= MAX_USB_CDC_DEVICES || rx_ring == NULL) {
     return -1;
   }
   uint8_t c = 0;
-  if (xQueueReceive(rx_queue, &c, 0)) {
+  if (_readRx(&c, 1, 0)) {
     return c;
   }
   return -1;
 }
 
 size_t USBCDC::read(uint8_t *buffer, size_t size) {
-  if (itf >= MAX_USB_CDC_DEVICES || rx_queue == NULL) {
+  if (itf >= MAX_USB_CDC_DEVICES || rx_ring == NULL) {
     return -1;
   }
-  uint8_t c = 0;
+  return _readRx(buffer, size, 0);
+}
+
+size_t USBCDC::readBytes(uint8_t *buffer, size_t length) {
+  if (itf >= MAX_USB_CDC_DEVICES || rx_ring == NULL) {
+    return 0;
+  }
+  return _readRx(buffer, length, getTimeout() / portTICK_PERIOD_MS);
+}
+
+size_t USBCDC::readSpan(const uint8_t **data, size_t size) {
+  if (itf >= MAX_USB_CDC_DEVICES || rx_ring == NULL || data == NULL || size == 0) {
+    return 0;
+  }
+  if (rx_peek >= 0) {
+    rx_peek_span = (uint8_t)rx_peek;
+    *data = &rx_peek_span;
+    return 1;
+  }
+  size_t len = 0;
+  *data = (const uint8_t *)xRingbufferReceiveUpTo(rx_ring, &len, 0, size);
+  return *data ? len : 0;
+}
+
+void USBCDC::releaseRx(const uint8_t *data) {
+  if (data == &rx_peek_span) {
+    rx_peek = -1;
+  } else if (data != NULL && rx_ring != NULL) {
+    vRingbufferReturnItem(rx_ring, (void *)data);
+  }
+}
+
+size_t USBCDC::_readRx(uint8_t *buffer, size_t size, TickType_t ticks) {
+  if (!buffer || !size) {
+    return 0;
+  }
   size_t count = 0;
-  while (count < size && xQueueReceive(rx_queue, &c, 0)) {
-    buffer[count++] = c;
+  if (rx_peek >= 0) {
+    buffer[count++] = (uint8_t)rx_peek;
+    rx_peek = -1;
+  }
+  TickType_t start = xTaskGetTickCount();
+  while (count < size) {
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    size_t len = 0;
+    // at most two pieces when the data wraps around the end of the ring
+    uint8_t *data = (uint8_t *)xRingbufferReceiveUpTo(rx_ring, &len, elapsed < ticks ? ticks - elapsed : 0, size - count);
+    if (!data) {
+      break;
+    }
+    memcpy(buffer + count, data, len);
+    vRingbufferReturnItem(rx_ring, data);
+    count += len;
   }
   return count;
 }
@@ -23,6 +23,7 @@
 #include "esp_event.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/ringbuf.h"
 #include "freertos/semphr.h"
 #include "Stream.h"
 
@@ -77,6 +78,15 @@ public:
   int peek(void);
   int read(void);
   size_t read(uint8_t *buffer, size_t size);
+  // Zero-copy read: points <data> to up to <size> received bytes, contiguous in the RX ring.
+  // The bytes must be given back with releaseRx() before reading again.
+  size_t readSpan(const uint8_t **data, size_t size);
+  void releaseRx(const uint8_t *data);
+  // Overrides Stream::readBytes() to be faster using the RX ring
+  size_t readBytes(uint8_t *buffer, size_t length);
+  size_t readBytes(char *buffer, size_t length) {
+    return readBytes((uint8_t *)buffer, length);
+  }
   size_t write(uint8_t);
   size_t write(const uint8_t *buffer, size_t size);
   void flush(void);
@@ -118,6 +128,8 @@ public:
   void _onUnplugged(void);
 
 protected:
+  size_t _readRx(uint8_t *buffer, size_t size, TickType_t ticks);
+
   uint8_t itf;
   uint32_t bit_rate;
   uint8_t stop_bits;  ///< 0: 1 stop bit - 1: 1.5 stop bits - 2: 2 stop bits
@@ -127,7 +139,10 @@ protected:
   bool rts;
   bool connected;
   bool reboot_enable;
-  QueueHandle_t rx_queue;
+  RingbufHandle_t rx_ring;
+  size_t rx_ring_size;
+  int rx_peek;  // byte taken out of the ring by peek(), -1 if none
+  uint8_t rx_peek_span;  // rx_peek, given by readSpan()
   SemaphoreHandle_t tx_lock;
   uint32_t tx_timeout_ms;
 };
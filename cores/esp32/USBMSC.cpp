@@ -18,6 +18,11 @@
 #if CONFIG_TINYUSB_MSC_ENABLED
 
 #include "esp32-hal-tinyusb.h"
+#include "USBMSCCache.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#define SCSI_CMD_SYNCHRONIZE_CACHE_10 0x35
 
 extern "C" uint16_t tusb_msc_load_descriptor(uint8_t *dst, uint8_t *itf) {
   uint8_t str_index = tinyusb_add_string_descriptor("TinyUSB MSC");
@@ -41,12 +46,46 @@ typedef struct {
   bool (*start_stop)(uint8_t power_condition, bool start, bool load_eject);
   int32_t (*read)(uint32_t lba, uint32_t offset, void *buffer, uint32_t bufsize);
   int32_t (*write)(uint32_t lba, uint32_t offset, uint8_t *buffer, uint32_t bufsize);
+  uint16_t cache_blocks;
+  uint8_t cache_read_ahead;
+  bool cache_write_back;
+  USBMSCCache *cache;
+  SemaphoreHandle_t cache_lock;  // TinyUSB task against flush() and end(), kept as long as the LUN
+  StaticSemaphore_t cache_lock_buf;
 } msc_lun_t;
 
 static const uint8_t MSC_MAX_LUN = 3;
 static uint8_t MSC_ACTIVE_LUN = 0;
 static msc_lun_t msc_luns[MSC_MAX_LUN];
 
+static bool msc_cache_flush(uint8_t lun) {
+  msc_lun_t *l = &msc_luns[lun];
+  xSemaphoreTake(l->cache_lock, portMAX_DELAY);
+  bool ok = !l->cache || l->cache->flush();
+  xSemaphoreGive(l->cache_lock);
+  if (!ok) {
+    log_e("[%u] cache flush failed", lun);
+  }
+  return ok;
+}
+
+// The cache is detached under the lock, with the medium marked not present when it goes away, so that the
+// TinyUSB task is out of the cache and does not take it again when it is deleted.
+static void msc_cache_delete(uint8_t lun, bool media_gone) {
+  msc_lun_t *l = &msc_luns[lun];
+  xSemaphoreTake(l->cache_lock, portMAX_DELAY);
+  USBMSCCache *cache = l->cache;
+  if (cache && !cache->flush()) {
+    log_e("[%u] cache flush failed", lun);
+  }
+  if (media_gone) {
+    l->media_present = false;
+  }
+  l->cache = NULL;
+  xSemaphoreGive(l->cache_lock);
+  delete cache;
+}
+
 static void cplstr(void *dst, const void *src, size_t max_len) {
   if (!src || !dst || !max_len) {
     return;
@@ -99,6 +138,10 @@ void tud_msc_capacity_cb(uint8_t lun, uint32_t *block_count, uint16_t *block_siz
 // - Start = 1 : active mode, if load_eject = 1 : load disk storage
 bool tud_msc_start_stop_cb(uint8_t lun, uint8_t power_condition, bool start, bool load_eject) {
   log_v("[%u] power: %u, start: %u, eject: %u", lun, power_condition, start, load_eject);
+  // the host may power the device off or remove the medium next
+  if (!msc_cache_flush(lun)) {
+    return false;
+  }
   if (msc_luns[lun].start_stop) {
     return msc_luns[lun].start_stop(power_condition, start, load_eject);
   }
@@ -112,6 +155,14 @@ int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void *buff
   if (!msc_luns[lun].media_present) {
     return 0;
   }
+  if (msc_luns[lun].cache) {
+    xSemaphoreTake(msc_luns[lun].cache_lock, portMAX_DELAY);
+    // end() may have detached the cache meanwhile
+    USBMSCCache *cache = msc_luns[lun].media_present ? msc_luns[lun].cache : NULL;
+    int32_t r = cache ? cache->read(lba, offset, buffer, bufsize) : 0;
+    xSemaphoreGive(msc_luns[lun].cache_lock);
+    return r;
+  }
   if (msc_luns[lun].read) {
     return msc_luns[lun].read(lba, offset, buffer, bufsize);
   }
@@ -125,6 +176,14 @@ int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t *
   if (!msc_luns[lun].media_present) {
     return 0;
   }
+  if (msc_luns[lun].cache) {
+    xSemaphoreTake(msc_luns[lun].cache_lock, portMAX_DELAY);
+    // end() may have detached the cache meanwhile
+    USBMSCCache *cache = msc_luns[lun].media_present ? msc_luns[lun].cache : NULL;
+    int32_t r = cache ? cache->write(lba, offset, buffer, bufsize) : 0;
+    xSemaphoreGive(msc_luns[lun].cache_lock);
+    return r;
+  }
   if (msc_luns[lun].write) {
     return msc_luns[lun].write(lba, offset, buffer, bufsize);
   }
@@ -154,6 +213,15 @@ int32_t tud_msc_scsi_cb(uint8_t lun, uint8_t const scsi_cmd[16], void *buffer, u
       resplen = 0;
       break;
 
+    case SCSI_CMD_SYNCHRONIZE_CACHE_10:
+      resplen = 0;
+      if (!msc_cache_flush(lun)) {
+        // Set Sense = Write Error
+        tud_msc_set_sense(lun, SCSI_SENSE_MEDIUM_ERROR, 0x0C, 0x00);
+        resplen = -1;
+      }
+      break;
+
     default:
       // Set Sense = Invalid Command Operation
       tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x20, 0x00);
@@ -192,6 +260,11 @@ USBMSC::USBMSC() {
     msc_luns[_lun].start_stop = NULL;
     msc_luns[_lun].read = NULL;
     msc_luns[_lun].write = NULL;
+    msc_luns[_lun].cache_blocks = 0;
+    msc_luns[_lun].cache_read_ahead = 0;
+    msc_luns[_lun].cache_write_back = false;
+    msc_luns[_lun].cache = NULL;
+    msc_luns[_lun].cache_lock = xSemaphoreCreateMutexStatic(&msc_luns[_lun].cache_lock_buf);
   }
   if (_lun == 0) {
     tinyusb_enable_interface(USB_INTERFACE_MSC, TUD_MSC_DESC_LEN, tusb_msc_load_descriptor);
@@ -208,11 +281,24 @@ bool USBMSC::begin(uint32_t block_count, uint16_t block_size) {
   if (!msc_luns[_lun].block_size || !msc_luns[_lun].block_count || !msc_luns[_lun].read || !msc_luns[_lun].write) {
     return false;
   }
+  msc_cache_delete(_lun, false);
+  if (msc_luns[_lun].cache_blocks) {
+    msc_lun_t *l = &msc_luns[_lun];
+    USBMSCCache *cache = new USBMSCCache();
+    if (!cache->begin(block_count, block_size, l->cache_blocks, l->cache_read_ahead, l->cache_write_back, l->read, l->write)) {
+      log_e("[%u] cache allocation failed", _lun);
+      delete cache;
+      return false;
+    }
+    xSemaphoreTake(l->cache_lock, portMAX_DELAY);
+    l->cache = cache;
+    xSemaphoreGive(l->cache_lock);
+  }
   return true;
 }
 
 void USBMSC::end() {
-  msc_luns[_lun].media_present = false;
+  msc_cache_delete(_lun, true);
   msc_luns[_lun].vendor_id[0] = 0;
   msc_luns[_lun].product_id[0] = 0;
   msc_luns[_lun].product_rev[0] = 0;
@@ -221,6 +307,7 @@ void USBMSC::end() {
   msc_luns[_lun].start_stop = NULL;
   msc_luns[_lun].read = NULL;
   msc_luns[_lun].write = NULL;
+  msc_luns[_lun].cache_blocks = 0;
 }
 
 void USBMSC::vendorID(const char *vid) {
@@ -248,7 +335,28 @@ void USBMSC::onWrite(msc_write_cb cb) {
 }
 
 void USBMSC::mediaPresent(bool media_present) {
+  // written blocks go to the medium before it goes away, and a new medium starts with an empty cache
+  msc_cache_flush(_lun);
+  xSemaphoreTake(msc_luns[_lun].cache_lock, portMAX_DELAY);
+  if (msc_luns[_lun].cache) {
+    msc_luns[_lun].cache->invalidate();
+  }
   msc_luns[_lun].media_present = media_present;
+  xSemaphoreGive(msc_luns[_lun].cache_lock);
+}
+
+bool USBMSC::setCache(uint16_t cache_blocks, uint8_t read_ahead, bool write_back) {
+  if (cache_blocks && (!read_ahead || read_ahead > 32 || cache_blocks < read_ahead)) {
+    return false;
+  }
+  msc_luns[_lun].cache_blocks = cache_blocks;
+  msc_luns[_lun].cache_read_ahead = read_ahead;
+  msc_luns[_lun].cache_write_back = write_back;
+  return true;
+}
+
+bool USBMSC::flush() {
+  return msc_cache_flush(_lun);
 }
 
 #endif /* CONFIG_TINYUSB_MSC_ENABLED */
@@ -48,6 +48,13 @@ public:
   void onRead(msc_read_cb cb);
   void onWrite(msc_write_cb cb);
 
+  // Optional block cache, set before begin(): <cache_blocks> blocks kept in RAM, read from the medium
+  // <read_ahead> (up to 32) at a time. With <write_back>, written blocks are combined and written to
+  // the medium when evicted, on flush(), end(), SYNCHRONIZE CACHE and START STOP UNIT from the host.
+  // 0 cache_blocks disables the cache.
+  bool setCache(uint16_t cache_blocks, uint8_t read_ahead = 8, bool write_back = false);
+  bool flush();
+
 private:
   uint8_t _lun;
 };
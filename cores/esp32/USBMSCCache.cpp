@@ -0,0 +1,337 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "USBMSCCache.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define WINDOW_EMPTY UINT32_MAX
+
+USBMSCCache::USBMSCCache()
+  : _data(NULL), _windows(NULL), _window_count(0), _read_ahead(0), _block_size(0), _block_count(0), _write_back(false), _clock(0), _last(-1), _read(NULL),
+    _write(NULL) {
+  resetStats();
+}
+
+USBMSCCache::~USBMSCCache() {
+  end();
+}
+
+bool USBMSCCache::begin(
+  uint32_t block_count, uint16_t block_size, uint16_t cache_blocks, uint8_t read_ahead, bool write_back, read_cb read, write_cb write
+) {
+  end();
+  if (!block_count || !block_size || !read || !write || !read_ahead || read_ahead > 32 || (cache_blocks && cache_blocks < read_ahead)) {
+    return false;
+  }
+  _read = read;
+  _write = write;
+  if (!cache_blocks) {
+    return true;
+  }
+  _window_count = cache_blocks / read_ahead;
+  _data = (uint8_t *)malloc((size_t)_window_count * read_ahead * block_size);
+  _windows = (window_t *)malloc(_window_count * sizeof(window_t));
+  if (!_data || !_windows) {
+    end();
+    return false;
+  }
+  _read_ahead = read_ahead;
+  _block_size = block_size;
+  _block_count = block_count;
+  _write_back = write_back;
+  invalidate();
+  return true;
+}
+
+void USBMSCCache::end() {
+  free(_data);
+  free(_windows);
+  _data = NULL;
+  _windows = NULL;
+  _window_count = 0;
+}
+
+void USBMSCCache::resetStats() {
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+void USBMSCCache::invalidate() {
+  for (uint16_t w = 0; w < _window_count; w++) {
+    _windows[w].base = WINDOW_EMPTY;
+    _windows[w].valid = 0;
+    _windows[w].dirty = 0;
+    _windows[w].used = 0;
+    _windows[w].hits = 0;
+  }
+  _last = -1;
+}
+
+// forgets the cached copies of the blocks from <first> to <last>
+void USBMSCCache::forget(uint32_t first, uint32_t last) {
+  for (uint32_t b = first; b <= last; b++) {
+    int w = find(b);
+    if (w >= 0) {
+      _windows[w].valid &= ~(1UL << (b - _windows[w].base));
+    }
+  }
+}
+
+uint8_t *USBMSCCache::blockData(int w, uint32_t block) {
+  return _data + ((size_t)w * _read_ahead + block) * _block_size;
+}
+
+int USBMSCCache::find(uint32_t lba) {
+  uint32_t base = lba - lba % _read_ahead;
+  for (uint16_t w = 0; w < _window_count; w++) {
+    if (_windows[w].base == base) {
+      return w;
+    }
+  }
+  return -1;
+}
+
+void USBMSCCache::touch(int w) {
+  window_t *win = &_windows[w];
+  if (w != _last && win->hits < UINT8_MAX) {
+    win->hits++;
+  }
+  win->used = ++_clock;
+  _last = w;
+}
+
+int USBMSCCache::allocate(uint32_t lba) {
+  // an empty window, or the least recently used of the cold ones
+  int victim = -1;
+  bool hot = true;
+  for (uint16_t w = 0; w < _window_count; w++) {
+    window_t *win = &_windows[w];
+    if (win->base == WINDOW_EMPTY) {
+      victim = w;
+      break;
+    }
+    bool winHot = win->hits > 0;
+    if (victim < 0 || (hot && !winHot) || (hot == winHot && (int32_t)(win->used - _windows[victim].used) < 0)) {
+      victim = w;
+      hot = winHot;
+    }
+  }
+  if (_windows[victim].base != WINDOW_EMPTY && hot) {
+    // only hot windows left, age them so that the set of hot windows follows the accesses
+    for (uint16_t w = 0; w < _window_count; w++) {
+      _windows[w].hits >>= 1;
+    }
+  }
+  if (!writeBack(victim)) {
+    return -1;
+  }
+  window_t *win = &_windows[victim];
+  win->base = lba - lba % _read_ahead;
+  win->valid = 0;
+  win->dirty = 0;
+  win->hits = 0;
+  win->used = ++_clock;
+  _last = victim;
+  return victim;
+}
+
+bool USBMSCCache::mediumRead(uint32_t lba, uint8_t *buffer, uint32_t blocks) {
+  uint32_t len = blocks * _block_size;
+  uint32_t done = 0;
+  while (done < len) {
+    _stats.mediumReads++;
+    int32_t r = _read(lba + done / _block_size, done % _block_size, buffer + done, len - done);
+    if (r <= 0) {
+      return false;
+    }
+    done += r;
+  }
+  return true;
+}
+
+bool USBMSCCache::mediumWrite(uint32_t lba, uint8_t *buffer, uint32_t blocks) {
+  uint32_t len = blocks * _block_size;
+  uint32_t done = 0;
+  while (done < len) {
+    _stats.mediumWrites++;
+    int32_t r = _write(lba + done / _block_size, done % _block_size, buffer + done, len - done);
+    if (r <= 0) {
+      return false;
+    }
+    done += r;
+  }
+  return true;
+}
+
+// reads the missing blocks from <first> to the end of the window, in contiguous runs
+bool USBMSCCache::fill(int w, uint32_t first) {
+  window_t *win = &_windows[w];
+  uint32_t end = _read_ahead;
+  if (win->base + end > _block_count) {
+    end = _block_count - win->base;
+  }
+  uint32_t i = first;
+  while (i < end) {
+    if (win->valid & (1UL << i)) {
+      i++;
+      continue;
+    }
+    uint32_t run = 1;
+    while (i + run < end && !(win->valid & (1UL << (i + run)))) {
+      run++;
+    }
+    if (!mediumRead(win->base + i, blockData(w, i), run)) {
+      return false;
+    }
+    _stats.misses += run;
+    win->valid |= ((run == 32 ? 0 : (1UL << run)) - 1) << i;
+    i += run;
+  }
+  return true;
+}
+
+// writes the dirty blocks of the window, in contiguous runs
+bool USBMSCCache::writeBack(int w) {
+  window_t *win = &_windows[w];
+  uint32_t i = 0;
+  while (win->dirty) {
+    if (!(win->dirty & (1UL << i))) {
+      i++;
+      continue;
+    }
+    uint32_t run = 1;
+    while (i + run < _read_ahead && (win->dirty & (1UL << (i + run)))) {
+      run++;
+    }
+    if (!mediumWrite(win->base + i, blockData(w, i), run)) {
+      return false;
+    }
+    win->dirty &= ~(((run == 32 ? 0 : (1UL << run)) - 1) << i);
+    i += run;
+  }
+  return true;
+}
+
+bool USBMSCCache::flush() {
+  bool ok = true;
+  for (uint16_t w = 0; w < _window_count; w++) {
+    ok = writeBack(w) && ok;
+  }
+  return ok;
+}
+
+int32_t USBMSCCache::read(uint32_t lba, uint32_t offset, void *buffer, uint32_t bufsize) {
+  if (!_data) {
+    return _read ? _read(lba, offset, buffer, bufsize) : -1;
+  }
+  uint8_t *out = (uint8_t *)buffer;
+  lba += offset / _block_size;
+  offset %= _block_size;
+  uint32_t done = 0;
+  while (done < bufsize) {
+    if (lba >= _block_count) {
+      return -1;
+    }
+    int w = find(lba);
+    if (w < 0) {
+      w = allocate(lba);
+      if (w < 0) {
+        return -1;
+      }
+    } else {
+      touch(w);
+    }
+    uint32_t block = lba - _windows[w].base;
+    if (_windows[w].valid & (1UL << block)) {
+      _stats.hits++;
+    } else if (!fill(w, block)) {
+      return -1;
+    }
+    uint32_t len = _block_size - offset;
+    if (len > bufsize - done) {
+      len = bufsize - done;
+    }
+    memcpy(out + done, blockData(w, block) + offset, len);
+    done += len;
+    offset = 0;
+    lba++;
+  }
+  return done;
+}
+
+int32_t USBMSCCache::write(uint32_t lba, uint32_t offset, const uint8_t *buffer, uint32_t bufsize) {
+  if (!_data) {
+    return _write ? _write(lba, offset, (uint8_t *)buffer, bufsize) : -1;
+  }
+  uint32_t first = lba + offset / _block_size;
+  uint32_t blockOffset = offset % _block_size;
+  if (!_write_back && bufsize) {
+    // write-through, the cached copies take what the medium took, the others may differ from it and are dropped
+    uint32_t last = first + (blockOffset + bufsize - 1) / _block_size;
+    if (last >= _block_count) {
+      return -1;
+    }
+    _stats.mediumWrites++;
+    int32_t r = _write(lba, offset, (uint8_t *)buffer, bufsize);
+    uint32_t taken = r <= 0 ? 0 : (uint32_t)r < bufsize ? r : bufsize;
+    if (taken < bufsize) {
+      forget(first + (blockOffset + taken) / _block_size, last);
+    }
+    if (!taken) {
+      return r;
+    }
+    bufsize = taken;
+  }
+  uint32_t done = 0;
+  for (uint32_t b = first; done < bufsize; b++) {
+    if (b >= _block_count) {
+      return -1;
+    }
+    uint32_t len = _block_size - blockOffset;
+    if (len > bufsize - done) {
+      len = bufsize - done;
+    }
+    int w = find(b);
+    if (w >= 0) {
+      touch(w);
+    } else if (_write_back) {
+      w = allocate(b);
+      if (w < 0) {
+        return -1;
+      }
+    }
+    if (w >= 0) {
+      uint32_t block = b - _windows[w].base;
+      bool valid = _windows[w].valid & (1UL << block);
+      // a part of a block needs the rest of it from the medium, a part written through is left to the medium
+      if (len < _block_size && !valid && _write_back) {
+        if (!mediumRead(b, blockData(w, block), 1)) {
+          return -1;
+        }
+        _stats.misses++;
+        valid = true;
+      }
+      if (len == _block_size || valid) {
+        memcpy(blockData(w, block) + blockOffset, buffer + done, len);
+        _windows[w].valid |= 1UL << block;
+      }
+      if (_write_back) {
+        _windows[w].dirty |= 1UL << block;
+      }
+    }
+    done += len;
+    blockOffset = 0;
+  }
+  return done;
+}
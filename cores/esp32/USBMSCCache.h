@@ -0,0 +1,94 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Block cache between the USB host and the medium of a USBMSC LUN.
+ *
+ * Blocks are kept in windows of <read_ahead> aligned blocks: a miss reads the rest of the window
+ * from the medium in one call, so that sequential reads cost one medium access per window.
+ * In write-back mode, written blocks stay dirty in the cache and are written in contiguous runs
+ * when their window is evicted or on flush(). Windows used again after others were used become
+ * hot, and are evicted after the cold ones, so that FAT and directory blocks survive the
+ * streaming of large files.
+ *
+ * The cache does no locking and has no dependency on the SoC.
+ */
+class USBMSCCache {
+public:
+  typedef int32_t (*read_cb)(uint32_t lba, uint32_t offset, void *buffer, uint32_t bufsize);
+  typedef int32_t (*write_cb)(uint32_t lba, uint32_t offset, uint8_t *buffer, uint32_t bufsize);
+
+  typedef struct {
+    uint32_t hits;          // blocks found in the cache
+    uint32_t misses;        // blocks read from the medium
+    uint32_t mediumReads;   // read calls to the medium
+    uint32_t mediumWrites;  // write calls to the medium
+  } stats_t;
+
+  USBMSCCache();
+  ~USBMSCCache();
+
+  // <cache_blocks> is rounded down to a multiple of <read_ahead>, which is at most 32.
+  // Without cache_blocks, read() and write() go straight to the medium.
+  bool begin(uint32_t block_count, uint16_t block_size, uint16_t cache_blocks, uint8_t read_ahead, bool write_back, read_cb read, write_cb write);
+  void end();  // drops the cache, call flush() before
+
+  int32_t read(uint32_t lba, uint32_t offset, void *buffer, uint32_t bufsize);
+  int32_t write(uint32_t lba, uint32_t offset, const uint8_t *buffer, uint32_t bufsize);
+  bool flush();
+  void invalidate();  // forgets all blocks, dirty ones included, e.g. when the medium changed
+
+  const stats_t &stats() const {
+    return _stats;
+  }
+  void resetStats();
+
+private:
+  typedef struct {
+    uint32_t base;   // first block of the window, UINT32_MAX when empty
+    uint32_t valid;  // blocks of the window holding data
+    uint32_t dirty;  // blocks of the window to write to the medium
+    uint32_t used;   // _clock value of the last access
+    uint8_t hits;    // accesses after other windows were used
+  } window_t;
+
+  uint8_t *_data;
+  window_t *_windows;
+  uint16_t _window_count;
+  uint8_t _read_ahead;
+  uint16_t _block_size;
+  uint32_t _block_count;
+  bool _write_back;
+  uint32_t _clock;
+  int _last;  // window of the last access
+  read_cb _read;
+  write_cb _write;
+  stats_t _stats;
+
+  uint8_t *blockData(int w, uint32_t block);
+  int find(uint32_t lba);
+  void forget(uint32_t first, uint32_t last);
+  int allocate(uint32_t lba);
+  void touch(int w);
+  bool fill(int w, uint32_t first);
+  bool writeBack(int w);
+  bool mediumRead(uint32_t lba, uint8_t *buffer, uint32_t blocks);
+  bool mediumWrite(uint32_t lba, uint8_t *buffer, uint32_t blocks);
+};
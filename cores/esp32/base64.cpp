@@ -23,39 +23,381 @@
  */
 
 #include "Arduino.h"
-extern "C" {
-#include "libb64/cdecode.h"
-#include "libb64/cencode.h"
-}
+#include "StreamString.h"
 #include "base64.h"
 
+#define BASE64_CHUNK 48  // bytes encoded or decoded per write to the output, a multiple of 3
+
+static const char base64_standard[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char base64_url[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// value of the characters of both alphabets, -1 for the others
+static const int8_t base64_values[256] = {
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, 62, -1, 63,
+  52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+  -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+  15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, 63,
+  -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+  41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+static inline const char *base64_table(base64::alphabet_t alphabet) {
+  return (alphabet == base64::URL) ? base64_url : base64_standard;
+}
+
+static inline void base64_encode_group(const uint8_t *in, char *out, const char *table) {
+  uint32_t v = (in[0] << 16) | (in[1] << 8) | in[2];
+  out[0] = table[v >> 18];
+  out[1] = table[(v >> 12) & 0x3f];
+  out[2] = table[(v >> 6) & 0x3f];
+  out[3] = table[v & 0x3f];
+}
+
+// encodes groups of 3 bytes, four groups per step, returns the characters written
+static size_t base64_encode_groups(const uint8_t *in, size_t groups, char *out, const char *table) {
+  char *start = out;
+  for (; groups >= 4; groups -= 4) {
+    base64_encode_group(in, out, table);
+    base64_encode_group(in + 3, out + 4, table);
+    base64_encode_group(in + 6, out + 8, table);
+    base64_encode_group(in + 9, out + 12, table);
+    in += 12;
+    out += 16;
+  }
+  for (; groups; groups--) {
+    base64_encode_group(in, out, table);
+    in += 3;
+    out += 4;
+  }
+  return out - start;
+}
+
+// encodes the last 1 or 2 bytes
+static size_t base64_encode_tail(const uint8_t *in, size_t len, char *out, base64::alphabet_t alphabet) {
+  if (!len) {
+    return 0;
+  }
+  const char *table = base64_table(alphabet);
+  uint32_t v = (in[0] << 16) | ((len > 1) ? (in[1] << 8) : 0);
+  size_t n = len + 1;
+  out[0] = table[v >> 18];
+  out[1] = table[(v >> 12) & 0x3f];
+  if (len > 1) {
+    out[2] = table[(v >> 6) & 0x3f];
+  }
+  if (alphabet == base64::STANDARD) {
+    for (; n < 4; n++) {
+      out[n] = '=';
+    }
+  }
+  return n;
+}
+
+// encodes the whole groups of data in chunks passed to sink, returns the bytes encoded
+template<typename Sink> static size_t base64_encode_chunks(const uint8_t *data, size_t length, base64::alphabet_t alphabet, Sink sink) {
+  const char *table = base64_table(alphabet);
+  char chunk[BASE64_CHUNK / 3 * 4 + 1];  // String::concat() copies one byte after the characters
+  size_t done = 0;
+  while (length - done >= 3) {
+    size_t groups = (length - done) / 3;
+    if (groups > BASE64_CHUNK / 3) {
+      groups = BASE64_CHUNK / 3;
+    }
+    if (!sink(chunk, base64_encode_groups(data + done, groups, chunk, table))) {
+      break;
+    }
+    done += groups * 3;
+  }
+  return done;
+}
+
+static inline bool base64_decode_group(const uint8_t *in, uint8_t *out) {
+  int32_t a = base64_values[in[0]];
+  int32_t b = base64_values[in[1]];
+  int32_t c = base64_values[in[2]];
+  int32_t d = base64_values[in[3]];
+  if ((a | b | c | d) < 0) {
+    return false;
+  }
+  uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+  out[0] = v >> 16;
+  out[1] = v >> 8;
+  out[2] = v;
+  return true;
+}
+
+// decodes the 2 or 3 values ending unpadded data
+static size_t base64_decode_tail(const uint8_t *values, size_t count, uint8_t *out) {
+  out[0] = (values[0] << 2) | (values[1] >> 4);
+  if (count > 2) {
+    out[1] = (values[1] << 4) | (values[2] >> 2);
+  }
+  return count - 1;
+}
+
 /**
  * convert input data to base64
  * @param data const uint8_t *
  * @param length size_t
+ * @param alphabet alphabet_t
  * @return String
  */
-String base64::encode(const uint8_t *data, size_t length) {
-  size_t size = base64_encode_expected_len(length) + 1;
-  char *buffer = (char *)malloc(size);
-  if (buffer) {
-    base64_encodestate _state;
-    base64_init_encodestate(&_state);
-    int len = base64_encode_block((const char *)&data[0], length, &buffer[0], &_state);
-    len = base64_encode_blockend((buffer + len), &_state);
-
-    String base64 = String(buffer);
-    free(buffer);
-    return base64;
+String base64::encode(const uint8_t *data, size_t length, alphabet_t alphabet) {
+  String base64;
+  if (!encode(data, length, base64, alphabet)) {
+    return String("-FAIL-");
   }
-  return String("-FAIL-");
+  return base64;
 }
 
 /**
  * convert input data to base64
  * @param text const String&
+ * @param alphabet alphabet_t
  * @return String
  */
-String base64::encode(const String &text) {
-  return base64::encode((uint8_t *)text.c_str(), text.length());
+String base64::encode(const String &text, alphabet_t alphabet) {
+  return base64::encode((uint8_t *)text.c_str(), text.length(), alphabet);
+}
+
+size_t base64::encodedLength(size_t length, alphabet_t alphabet) {
+  if (alphabet == STANDARD) {
+    return (length + 2) / 3 * 4;
+  }
+  return length / 3 * 4 + ((length % 3) ? (length % 3) + 1 : 0);
+}
+
+size_t base64::decodedLength(size_t length) {
+  return length / 4 * 3 + ((length % 4) ? (length % 4) - 1 : 0);
+}
+
+size_t base64::encode(const uint8_t *data, size_t length, char *out, size_t outSize, alphabet_t alphabet) {
+  if (outSize <= encodedLength(length, alphabet)) {
+    return 0;
+  }
+  size_t n = base64_encode_groups(data, length / 3, out, base64_table(alphabet));
+  n += base64_encode_tail(data + length - length % 3, length % 3, out + n, alphabet);
+  out[n] = '\0';
+  return n;
+}
+
+bool base64::encode(const uint8_t *data, size_t length, Print &out, alphabet_t alphabet) {
+  size_t done = base64_encode_chunks(data, length, alphabet, [&out](const char *chunk, size_t n) {
+    return out.write((const uint8_t *)chunk, n) == n;
+  });
+  if (length - done >= 3) {
+    return false;
+  }
+  char tail[4];
+  size_t n = base64_encode_tail(data + done, length - done, tail, alphabet);
+  return out.write((const uint8_t *)tail, n) == n;
+}
+
+bool base64::encode(const uint8_t *data, size_t length, String &out, alphabet_t alphabet) {
+  if (!out.reserve(out.length() + encodedLength(length, alphabet))) {
+    return false;
+  }
+  size_t done = base64_encode_chunks(data, length, alphabet, [&out](const char *chunk, size_t n) {
+    return out.concat(chunk, n);
+  });
+  if (length - done >= 3) {
+    return false;
+  }
+  char tail[5];
+  size_t n = base64_encode_tail(data + done, length - done, tail, alphabet);
+  return !n || out.concat(tail, n);
+}
+
+bool base64::encode(const uint8_t *data, size_t length, StreamString &out, alphabet_t alphabet) {
+  return encode(data, length, (Print &)out, alphabet);
+}
+
+int base64::decode(const char *data, size_t length, uint8_t *out, size_t outSize) {
+  const uint8_t *in = (const uint8_t *)data;
+  if (length % 4 == 0 && length && in[length - 1] == '=') {
+    length -= (in[length - 2] == '=') ? 2 : 1;
+  }
+  size_t outLen = decodedLength(length);
+  if (length % 4 == 1 || outLen > outSize) {
+    return -1;
+  }
+
+  size_t groups = length / 4;
+  for (; groups >= 4; groups -= 4) {
+    // 16 characters to 12 bytes per step
+    if (!(base64_decode_group(in, out) & base64_decode_group(in + 4, out + 3) & base64_decode_group(in + 8, out + 6) & base64_decode_group(in + 12, out + 9))) {
+      return -1;
+    }
+    in += 16;
+    out += 12;
+  }
+  for (; groups; groups--) {
+    if (!base64_decode_group(in, out)) {
+      return -1;
+    }
+    in += 4;
+    out += 3;
+  }
+  if (length % 4) {
+    uint8_t values[3];
+    for (size_t i = 0; i < length % 4; i++) {
+      if (base64_values[in[i]] < 0) {
+        return -1;
+      }
+      values[i] = base64_values[in[i]];
+    }
+    base64_decode_tail(values, length % 4, out);
+  }
+  return outLen;
+}
+
+base64::Encoder::Encoder(Print &out, alphabet_t alphabet) : _out(out), _alphabet(alphabet), _tailLen(0) {}
+
+size_t base64::Encoder::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t base64::Encoder::write(const uint8_t *buffer, size_t size) {
+  if (!size) {
+    return 0;
+  }
+  size_t done = 0;
+  if (_tailLen) {
+    if (_tailLen + size < 3) {
+      _tail[_tailLen++] = buffer[0];
+      return size;
+    }
+    uint8_t group[3] = {_tail[0], _tailLen > 1 ? _tail[1] : buffer[0], buffer[2 - _tailLen]};
+    char chunk[4];
+    base64_encode_group(group, chunk, base64_table(_alphabet));
+    if (_out.write((const uint8_t *)chunk, 4) != 4) {
+      setWriteError();
+      return 0;
+    }
+    done = 3 - _tailLen;
+    _tailLen = 0;
+  }
+  done += base64_encode_chunks(buffer + done, size - done, _alphabet, [this](const char *chunk, size_t n) {
+    return _out.write((const uint8_t *)chunk, n) == n;
+  });
+  if (size - done >= 3) {
+    setWriteError();
+    return 0;
+  }
+  for (; done < size; done++) {
+    _tail[_tailLen++] = buffer[done];
+  }
+  return size;
+}
+
+bool base64::Encoder::end() {
+  char tail[4];
+  size_t n = base64_encode_tail(_tail, _tailLen, tail, _alphabet);
+  _tailLen = 0;
+  if (_out.write((const uint8_t *)tail, n) != n) {
+    setWriteError();
+  }
+  return !getWriteError();
+}
+
+base64::Decoder::Decoder(Print &out) : _out(out), _quadLen(0), _padded(false), _error(false) {}
+
+bool base64::Decoder::_flush(const uint8_t *data, size_t len) {
+  if (len && _out.write(data, len) != len) {
+    _error = true;
+  }
+  return !_error;
+}
+
+size_t base64::Decoder::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t base64::Decoder::write(const uint8_t *buffer, size_t size) {
+  uint8_t chunk[BASE64_CHUNK];
+  size_t len = 0;
+  for (size_t i = 0; i < size && !_error; i++) {
+    if (!_quadLen && !_padded) {
+      // whole groups of characters, the common case
+      while (size - i >= 4 && base64_decode_group(buffer + i, chunk + len)) {
+        i += 4;
+        len += 3;
+        if (len == sizeof(chunk)) {
+          if (!_flush(chunk, len)) {
+            break;
+          }
+          len = 0;
+        }
+      }
+      if (i == size || _error) {
+        break;
+      }
+    }
+    uint8_t c = buffer[i];
+    if (c == '\r' || c == '\n' || c == ' ' || c == '\t') {
+      continue;
+    }
+    if (c == '=') {
+      // the padding ends the data, after 2 or 3 characters of a group
+      if (!_padded) {
+        _padded = true;
+        if (_quadLen < 2) {
+          _error = true;
+          break;
+        }
+        len += base64_decode_tail(_quad, _quadLen, chunk + len);
+        _quadLen = 0;
+      }
+      continue;
+    }
+    if (_padded || base64_values[c] < 0) {
+      _error = true;
+      break;
+    }
+    _quad[_quadLen++] = base64_values[c];
+    if (_quadLen == 4) {
+      uint32_t v = (_quad[0] << 18) | (_quad[1] << 12) | (_quad[2] << 6) | _quad[3];
+      chunk[len++] = v >> 16;
+      chunk[len++] = v >> 8;
+      chunk[len++] = v;
+      _quadLen = 0;
+    }
+    if (len > sizeof(chunk) - 3) {
+      if (!_flush(chunk, len)) {
+        break;
+      }
+      len = 0;
+    }
+  }
+  if (_error || !_flush(chunk, len)) {
+    setWriteError();
+    return 0;
+  }
+  return size;
+}
+
+bool base64::Decoder::end() {
+  if (!_error && _quadLen) {
+    uint8_t tail[2];
+    if (_quadLen < 2) {
+      _error = true;
+    } else {
+      _flush(tail, base64_decode_tail(_quad, _quadLen, tail));
+    }
+  }
+  bool ok = !_error;
+  _quadLen = 0;
+  _padded = false;
+  _error = false;
+  return ok;
 }
@@ -1,12 +1,77 @@
 #ifndef CORE_BASE64_H_
 #define CORE_BASE64_H_
 
+#include "WString.h"
+#include "Print.h"
+
+class StreamString;
+
 class base64 {
 public:
-  static String encode(const uint8_t *data, size_t length);
-  static String encode(const String &text);
+  typedef enum {
+    STANDARD,  // RFC 4648 base64, with padding
+    URL,       // RFC 4648 base64url, '-' and '_' and no padding
+  } alphabet_t;
+
+  static String encode(const uint8_t *data, size_t length, alphabet_t alphabet = STANDARD);
+  static String encode(const String &text, alphabet_t alphabet = STANDARD);
+
+  // characters of the encoding of length bytes, without the terminating '\0'
+  static size_t encodedLength(size_t length, alphabet_t alphabet = STANDARD);
+  // bytes decoded from length characters, at most
+  static size_t decodedLength(size_t length);
+
+  // writes the '\0' terminated encoding, returns its length or 0 if outSize is too small
+  static size_t encode(const uint8_t *data, size_t length, char *out, size_t outSize, alphabet_t alphabet = STANDARD);
+  // appends the encoding, returns false on a write error or out of memory
+  static bool encode(const uint8_t *data, size_t length, Print &out, alphabet_t alphabet = STANDARD);
+  static bool encode(const uint8_t *data, size_t length, String &out, alphabet_t alphabet = STANDARD);
+  static bool encode(const uint8_t *data, size_t length, StreamString &out, alphabet_t alphabet = STANDARD);
+
+  // decodes both alphabets, padded or not
+  // returns the decoded length, or -1 if data is not base64 or outSize is too small
+  static int decode(const char *data, size_t length, uint8_t *out, size_t outSize);
+
+  // encodes everything written to it to out, in chunks; end() writes the last characters
+  class Encoder : public Print {
+  public:
+    Encoder(Print &out, alphabet_t alphabet = STANDARD);
+
+    using Print::write;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    bool end();
+
+  private:
+    Print &_out;
+    alphabet_t _alphabet;
+    uint8_t _tail[2];  // bytes waiting for a whole group of 3
+    uint8_t _tailLen;
+  };
+
+  // decodes everything written to it to out, skipping line breaks and spaces
+  // end() decodes the last characters and returns false if the data was not base64
+  class Decoder : public Print {
+  public:
+    Decoder(Print &out);
+
+    using Print::write;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    bool end();
+    bool hasError() const {
+      return _error;
+    }
+
+  private:
+    bool _flush(const uint8_t *data, size_t len);
 
-private:
+    Print &_out;
+    uint8_t _quad[4];  // values waiting for a whole group of 4
+    uint8_t _quadLen;
+    bool _padded;  // padding seen, only more padding may follow
+    bool _error;
+  };
 };
 
 #endif /* CORE_BASE64_H_ */
@@ -362,6 +362,42 @@ static uint8_t __adcContinuousWidth = SOC_ADC_DIGI_MAX_BITWIDTH;
 static uint8_t used_adc_channels = 0;
 adc_continuous_data_t *adc_result = NULL;
 
+/*
+ * ADC Continuous Stream - a task drains the driver conversion frames into one ring buffer per pin.
+ * Each ring has a single producer (the task) and a single consumer (the application), thus it needs no lock.
+ */
+#define ADC_STREAM_TASK_STACK    3072
+#define ADC_STREAM_TASK_PRIORITY (configMAX_PRIORITIES - 2)
+#define ADC_STREAM_LUT_BITS      8  // calibration LUT has 2^8 + 1 points, linearly interpolated
+
+typedef struct {
+  uint16_t *ring;              // raw (or filtered) samples
+  size_t ring_mask;            // ring size - 1, ring size is a power of 2
+  volatile size_t head;        // written by the stream task only
+  volatile size_t tail;        // written by the application only
+  volatile uint32_t overruns;  // samples dropped because the ring was full
+  int16_t *history;            // FIR filter history, <fir_taps> samples
+  uint8_t history_pos;         // FIR filter next history position
+  uint8_t phase;               // decimation phase
+  uint32_t sum;                // decimation by averaging accumulator
+} adc_stream_channel_t;
+
+typedef struct {
+  adc_stream_channel_t *channels;                 // one per used pin, in analogContinuous() pins order
+  int8_t channel_index[SOC_ADC_MAX_CHANNEL_NUM];  // ADC channel to channels[] index, -1 if not used
+  uint8_t decimation;                             // 1 means no decimation
+  const int16_t *fir_coeffs;                      // Q15 FIR coefficients, NULL for averaging
+  uint8_t fir_taps;                               // number of FIR coefficients, 0 for averaging
+  uint8_t *frame;                                 // conversion frame read from the driver
+  TaskHandle_t task;                              // drains the driver frames into the rings
+  EventGroupHandle_t events;                      // one bit per channel, set when new samples are available
+  volatile bool running;                          // cleared to stop the task
+  uint16_t *mv_lut;                               // calibration LUT, built on first use
+} adc_stream_t;
+
+static adc_stream_t *adc_stream = NULL;
+static volatile uint32_t adc_pool_overruns = 0;  // driver pool full events - lost conversion frames
+
 static bool adcContinuousDetachBus(void *adc_unit_number) {
   adc_unit_t adc_unit = (adc_unit_t)adc_unit_number - 1;
 
@@ -417,6 +453,11 @@ bool IRAM_ATTR adcFnWrapper(adc_continuous_handle_t handle, const adc_continuous
   return false;
 }
 
+static bool IRAM_ATTR adcPoolOvfWrapper(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *args) {
+  adc_pool_overruns++;
+  return false;
+}
+
 esp_err_t __analogContinuousInit(adc_channel_t *channel, uint8_t channel_num, adc_unit_t adc_unit, uint32_t sampling_freq_hz) {
   //Create new ADC continuous handle
   adc_continuous_handle_cfg_t adc_config = {
@@ -526,7 +567,7 @@ bool analogContinuous(uint8_t pins[], size_t pins_count, uint32_t conversions_pe
   //Setup callbacks for complete event
   adc_continuous_evt_cbs_t cbs = {
     .on_conv_done = adcFnWrapper,
-    //.on_pool_ovf can be used in future
+    .on_pool_ovf = adcPoolOvfWrapper,
   };
   adc_handle[adc_unit].adc_interrupt_handle.fn = (voidFuncPtr)userFunc;
   err = adc_continuous_register_event_callbacks(adc_handle[adc_unit].adc_continuous_handle, &cbs, &adc_handle[adc_unit].adc_interrupt_handle);
@@ -578,6 +619,11 @@ bool analogContinuous(uint8_t pins[], size_t pins_count, uint32_t conversions_pe
 }
 
 bool analogContinuousRead(adc_continuous_data_t **buffer, uint32_t timeout_ms) {
+  if (adc_stream != NULL) {
+    log_e("ADC Continuous Stream is running. Use analogContinuousStreamRead() instead.");
+    *buffer = NULL;
+    return false;
+  }
   if (adc_handle[ADC_UNIT_1].adc_continuous_handle != NULL) {
     uint32_t bytes_read = 0;
     uint32_t read_raw[used_adc_channels];
@@ -665,6 +711,7 @@ bool analogContinuousStop() {
 
 bool analogContinuousDeinit() {
   if (adc_handle[ADC_UNIT_1].adc_continuous_handle != NULL) {
+    analogContinuousStreamEnd();
     esp_err_t err = adc_continuous_deinit(adc_handle[ADC_UNIT_1].adc_continuous_handle);
     if (err != ESP_OK) {
       return false;
@@ -689,4 +736,269 @@ void analogContinuousSetWidth(uint8_t bits) {
   __adcContinuousWidth = bits;
 }
 
+static void adcStreamPush(adc_stream_channel_t *ch, uint16_t sample) {
+  size_t head = ch->head;
+  if (head - __atomic_load_n(&ch->tail, __ATOMIC_ACQUIRE) > ch->ring_mask) {
+    ch->overruns++;  // ring is full - drops the newest sample
+    return;
+  }
+  ch->ring[head & ch->ring_mask] = sample;
+  // publishes the sample before moving the head
+  __atomic_store_n(&ch->head, head + 1, __ATOMIC_RELEASE);
+}
+
+// returns true when a decimated sample is ready in <out>
+static bool adcStreamFilter(adc_stream_channel_t *ch, uint16_t sample, uint16_t *out) {
+  uint8_t taps = adc_stream->fir_taps;
+  if (taps != 0) {
+    ch->history[ch->history_pos] = sample;
+    ch->history_pos = ch->history_pos + 1 == taps ? 0 : ch->history_pos + 1;
+  } else {
+    ch->sum += sample;
+  }
+  if (++ch->phase < adc_stream->decimation) {
+    return false;
+  }
+  ch->phase = 0;
+
+  if (taps == 0) {
+    *out = ch->sum / adc_stream->decimation;
+    ch->sum = 0;
+    return true;
+  }
+  // history_pos points to the oldest sample
+  int32_t acc = 0;
+  uint8_t pos = ch->history_pos;
+  for (int k = taps - 1; k >= 0; k--) {
+    acc += (int32_t)adc_stream->fir_coeffs[k] * ch->history[pos];
+    pos = pos + 1 == taps ? 0 : pos + 1;
+  }
+  acc >>= 15;
+  int32_t max_value = (1 << __adcContinuousWidth) - 1;
+  *out = acc < 0 ? 0 : (acc > max_value ? max_value : acc);
+  return true;
+}
+
+static void adcStreamTask(void *args) {
+  uint32_t frame_size = adc_handle[ADC_UNIT_1].conversion_frame_size;
+  bool filtering = adc_stream->decimation > 1 || adc_stream->fir_taps != 0;
+
+  while (adc_stream->running) {
+    uint32_t bytes_read = 0;
+    if (adc_continuous_read(adc_handle[ADC_UNIT_1].adc_continuous_handle, adc_stream->frame, frame_size, &bytes_read, 100) != ESP_OK) {
+      continue;  // timeout - ADC Continuous may be stopped
+    }
+    EventBits_t ready = 0;
+    for (uint32_t i = 0; i < bytes_read; i += SOC_ADC_DIGI_RESULT_BYTES) {
+      adc_digi_output_data_t *p = (adc_digi_output_data_t *)&adc_stream->frame[i];
+      uint32_t chan_num = ADC_GET_CHANNEL(p);
+      uint32_t data = ADC_GET_DATA(p);
+      if (chan_num >= SOC_ADC_MAX_CHANNEL_NUM || adc_stream->channel_index[chan_num] < 0) {
+        continue;  // invalid data
+      }
+      int idx = adc_stream->channel_index[chan_num];
+      adc_stream_channel_t *ch = &adc_stream->channels[idx];
+      uint16_t sample = data;
+      if (!filtering || adcStreamFilter(ch, data, &sample)) {
+        adcStreamPush(ch, sample);
+        ready |= 1 << idx;
+      }
+    }
+    if (ready) {
+      xEventGroupSetBits(adc_stream->events, ready);
+    }
+  }
+  // signals analogContinuousStreamEnd() that the task is done
+  adc_stream->task = NULL;
+  vTaskDelete(NULL);
+}
+
+static void adcStreamFree() {
+  if (adc_stream == NULL) {
+    return;
+  }
+  if (adc_stream->channels != NULL) {
+    for (int i = 0; i < used_adc_channels; i++) {
+      free(adc_stream->channels[i].ring);
+      free(adc_stream->channels[i].history);
+    }
+    free(adc_stream->channels);
+  }
+  if (adc_stream->events != NULL) {
+    vEventGroupDelete(adc_stream->events);
+  }
+  free(adc_stream->frame);
+  free(adc_stream->mv_lut);
+  free(adc_stream);
+  adc_stream = NULL;
+}
+
+static adc_stream_channel_t *adcStreamGetChannel(uint8_t pin, int *index) {
+  if (adc_stream == NULL) {
+    log_e("ADC Continuous Stream is not running!");
+    return NULL;
+  }
+  for (int i = 0; i < used_adc_channels; i++) {
+    if (adc_result[i].pin == pin) {
+      if (index != NULL) {
+        *index = i;
+      }
+      return &adc_stream->channels[i];
+    }
+  }
+  log_e("Pin %u is not used by ADC Continuous!", pin);
+  return NULL;
+}
+
+bool analogContinuousStreamBegin(size_t samples_per_pin, uint8_t decimation, const int16_t *fir_coeffs, uint8_t fir_taps) {
+  if (adc_handle[ADC_UNIT_1].adc_continuous_handle == NULL) {
+    log_e("ADC Continuous is not initialized!");
+    return false;
+  }
+  if (adc_stream != NULL) {
+    log_e("ADC Continuous Stream is already running!");
+    return false;
+  }
+  if (samples_per_pin < 2 || decimation == 0 || (fir_taps != 0 && fir_coeffs == NULL)) {
+    log_e("Invalid ADC Continuous Stream parameters!");
+    return false;
+  }
+  // rounds the ring size up to a power of 2
+  size_t ring_size = 2;
+  while (ring_size < samples_per_pin) {
+    ring_size <<= 1;
+  }
+
+  adc_stream = (adc_stream_t *)calloc(1, sizeof(adc_stream_t));
+  if (adc_stream == NULL) {
+    log_e("ADC Continuous Stream memory allocation failed!");
+    return false;
+  }
+  adc_stream->decimation = decimation;
+  adc_stream->fir_coeffs = fir_coeffs;
+  adc_stream->fir_taps = fir_taps;
+  memset(adc_stream->channel_index, -1, sizeof(adc_stream->channel_index));
+  adc_stream->frame = (uint8_t *)malloc(adc_handle[ADC_UNIT_1].conversion_frame_size);
+  adc_stream->channels = (adc_stream_channel_t *)calloc(used_adc_channels, sizeof(adc_stream_channel_t));
+  adc_stream->events = xEventGroupCreate();
+  if (adc_stream->frame == NULL || adc_stream->channels == NULL || adc_stream->events == NULL) {
+    goto err;
+  }
+  for (int i = 0; i < used_adc_channels; i++) {
+    adc_stream_channel_t *ch = &adc_stream->channels[i];
+    ch->ring = (uint16_t *)malloc(ring_size * sizeof(uint16_t));
+    ch->ring_mask = ring_size - 1;
+    if (ch->ring == NULL) {
+      goto err;
+    }
+    if (fir_taps != 0) {
+      ch->history = (int16_t *)calloc(fir_taps, sizeof(int16_t));
+      if (ch->history == NULL) {
+        goto err;
+      }
+    }
+    adc_stream->channel_index[adc_result[i].channel] = i;
+  }
+
+  adc_stream->running = true;
+  if (xTaskCreate(adcStreamTask, "adc_stream", ADC_STREAM_TASK_STACK, NULL, ADC_STREAM_TASK_PRIORITY, &adc_stream->task) != pdPASS) {
+    adc_stream->task = NULL;
+    goto err;
+  }
+  return true;
+
+err:
+  log_e("ADC Continuous Stream memory allocation failed!");
+  adcStreamFree();
+  return false;
+}
+
+bool analogContinuousStreamEnd() {
+  if (adc_stream == NULL) {
+    return true;
+  }
+  adc_stream->running = false;
+  // waits for the task to finish its current driver read (up to 100ms)
+  while (adc_stream->task != NULL) {
+    vTaskDelay(1);
+  }
+  adcStreamFree();
+  return true;
+}
+
+size_t analogContinuousStreamAvailable(uint8_t pin) {
+  adc_stream_channel_t *ch = adcStreamGetChannel(pin, NULL);
+  if (ch == NULL) {
+    return 0;
+  }
+  return __atomic_load_n(&ch->head, __ATOMIC_ACQUIRE) - ch->tail;
+}
+
+size_t analogContinuousStreamRead(uint8_t pin, uint16_t *samples, size_t max_samples, uint32_t timeout_ms) {
+  int index;
+  adc_stream_channel_t *ch = adcStreamGetChannel(pin, &index);
+  if (ch == NULL || samples == NULL) {
+    return 0;
+  }
+  size_t available = __atomic_load_n(&ch->head, __ATOMIC_ACQUIRE) - ch->tail;
+  if (available == 0 && timeout_ms != 0) {
+    xEventGroupClearBits(adc_stream->events, 1 << index);
+    available = __atomic_load_n(&ch->head, __ATOMIC_ACQUIRE) - ch->tail;
+    if (available == 0) {
+      xEventGroupWaitBits(adc_stream->events, 1 << index, pdTRUE, pdFALSE, timeout_ms);
+      available = __atomic_load_n(&ch->head, __ATOMIC_ACQUIRE) - ch->tail;
+    }
+  }
+  size_t count = available < max_samples ? available : max_samples;
+  size_t tail = ch->tail;
+  // copies up to the ring end, then from the ring start
+  size_t first = ch->ring_mask + 1 - (tail & ch->ring_mask);
+  if (first > count) {
+    first = count;
+  }
+  memcpy(samples, &ch->ring[tail & ch->ring_mask], first * sizeof(uint16_t));
+  memcpy(samples + first, ch->ring, (count - first) * sizeof(uint16_t));
+  __atomic_store_n(&ch->tail, tail + count, __ATOMIC_RELEASE);
+  return count;
+}
+
+uint32_t analogContinuousStreamOverruns(uint8_t pin) {
+  adc_stream_channel_t *ch = adcStreamGetChannel(pin, NULL);
+  if (ch == NULL) {
+    return 0;
+  }
+  return ch->overruns + adc_pool_overruns;
+}
+
+bool analogContinuousStreamToMilliVolts(const uint16_t *raw, uint16_t *mvolts, size_t count) {
+  if (adc_stream == NULL || adc_handle[ADC_UNIT_1].adc_cali_handle == NULL) {
+    log_e("ADC Continuous Stream is not running!");
+    return false;
+  }
+  uint8_t shift = __adcContinuousWidth > ADC_STREAM_LUT_BITS ? __adcContinuousWidth - ADC_STREAM_LUT_BITS : 0;
+  if (adc_stream->mv_lut == NULL) {
+    // one adc_cali call per LUT point, instead of one per sample
+    size_t points = (((1 << __adcContinuousWidth) - 1) >> shift) + 2;
+    uint16_t *lut = (uint16_t *)malloc(points * sizeof(uint16_t));
+    if (lut == NULL) {
+      log_e("ADC Continuous Stream LUT memory allocation failed!");
+      return false;
+    }
+    for (size_t i = 0; i < points; i++) {
+      int mv = 0;
+      adc_cali_raw_to_voltage(adc_handle[ADC_UNIT_1].adc_cali_handle, i << shift, &mv);
+      lut[i] = mv;
+    }
+    adc_stream->mv_lut = lut;
+  }
+  const uint16_t *lut = adc_stream->mv_lut;
+  uint32_t frac_mask = (1 << shift) - 1;
+  for (size_t i = 0; i < count; i++) {
+    uint32_t idx = raw[i] >> shift;
+    uint32_t frac = raw[i] & frac_mask;
+    mvolts[i] = lut[idx] + (((int32_t)(lut[idx + 1] - lut[idx]) * (int32_t)frac) >> shift);
+  }
+  return true;
+}
+
 #endif
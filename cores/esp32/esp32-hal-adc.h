@@ -126,6 +126,48 @@ void analogContinuousSetAtten(adc_attenuation_t attenuation);
  * */
 void analogContinuousSetWidth(uint8_t bits);
 
+/*
+ * ADC Continuous Stream mode
+ * Loss-free streaming of raw samples: a task moves each conversion frame into one lock-free
+ * ring buffer per pin, right after the driver completes it.
+ * Call it after analogContinuous() and before analogContinuousStart().
+ * samples_per_pin is the ring size, rounded up to a power of 2.
+ * decimation > 1 outputs one sample every <decimation> conversions of each pin, filtered by the
+ * <fir_taps> Q15 FIR coefficients in fir_coeffs, or averaged when fir_coeffs is NULL.
+ * fir_coeffs must remain valid until analogContinuousStreamEnd().
+ * While the Stream is running, analogContinuousRead() can't be used.
+ * */
+bool analogContinuousStreamBegin(size_t samples_per_pin, uint8_t decimation, const int16_t *fir_coeffs, uint8_t fir_taps);
+
+/*
+ * Stops ADC Continuous Stream and releases its buffers
+ * It is also called by analogContinuousDeinit()
+ * */
+bool analogContinuousStreamEnd();
+
+/*
+ * Get how many samples are available for the pin
+ * */
+size_t analogContinuousStreamAvailable(uint8_t pin);
+
+/*
+ * Read up to max_samples raw samples of the pin, waiting up to timeout_ms when there is none
+ * Returns the number of samples read
+ * */
+size_t analogContinuousStreamRead(uint8_t pin, uint16_t *samples, size_t max_samples, uint32_t timeout_ms);
+
+/*
+ * Get how many samples of the pin have been lost, either because its ring buffer was full or
+ * because the ADC driver dropped conversion frames
+ * */
+uint32_t analogContinuousStreamOverruns(uint8_t pin);
+
+/*
+ * Convert raw samples to millivolts, using a calibration LUT built on the first call
+ * raw and mvolts may be the same buffer
+ * */
+bool analogContinuousStreamToMilliVolts(const uint16_t *raw, uint16_t *mvolts, size_t count);
+
 #ifdef __cplusplus
 }
 #endif
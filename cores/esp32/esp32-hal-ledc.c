@@ -46,12 +46,92 @@ ledc_periph_t ledc_handle = {0};
 
 static bool fade_initialized = false;
 
+// Pin to channel handle cache, so that the write paths skip the peripheral manager lookup
+static ledc_channel_handle_t *ledc_pins[SOC_GPIO_PIN_COUNT] = {NULL};
+// Channels with a duty staged by ledcWriteStage(), waiting for ledcWriteCommit(), under ledc_commit_mux
+static uint32_t ledc_staged_channels = 0;
+static portMUX_TYPE ledc_commit_mux = portMUX_INITIALIZER_UNLOCKED;
+
+typedef struct {
+  uint32_t *duties;   // Curve points, with full on duty already fixed
+  size_t num_duties;  // Number of points in the curve
+  size_t index;       // Point the running segment fades to
+  int step_time_ms;   // Duration of each segment
+  bool loop;          // Restart from the first point when the curve ends
+} ledc_sequence_t;
+
+static ledc_sequence_t *ledc_sequences[LEDC_CHANNELS] = {NULL};
+static TaskHandle_t ledc_sequence_task = NULL;
+static SemaphoreHandle_t ledc_sequence_exited = NULL;
+static portMUX_TYPE ledc_sequence_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Notified to the sequence task along with the channel bits, asking it to exit
+#define LEDC_SEQUENCE_EXIT (1UL << 31)
+
+static inline ledc_channel_handle_t *ledcGetBus(uint8_t pin) {
+  return (pin < SOC_GPIO_PIN_COUNT) ? ledc_pins[pin] : NULL;
+}
+
+static inline uint32_t ledcFixDuty(ledc_channel_handle_t *bus, uint32_t duty) {
+  //Fixing if all bits in resolution is set = LEDC FULL ON
+  uint32_t max_duty = (1 << bus->channel_resolution) - 1;
+
+  if ((duty == max_duty) && (max_duty != 1)) {
+    duty = max_duty + 1;
+  }
+  return duty;
+}
+
+static bool ledcSequenceRunning(uint8_t channel) {
+  bool running = false;
+  portENTER_CRITICAL(&ledc_sequence_mux);
+  ledc_sequence_t *seq = ledc_sequences[channel];
+  if (seq != NULL) {
+    running = seq->loop || seq->index < seq->num_duties;
+  }
+  portEXIT_CRITICAL(&ledc_sequence_mux);
+  return running;
+}
+
+static void ledcSequenceFree(uint8_t channel) {
+  portENTER_CRITICAL(&ledc_sequence_mux);
+  ledc_sequence_t *seq = ledc_sequences[channel];
+  ledc_sequences[channel] = NULL;
+  portEXIT_CRITICAL(&ledc_sequence_mux);
+  if (seq != NULL) {
+#if SOC_LEDC_SUPPORT_FADE_STOP
+    ledc_fade_stop(channel / 8, channel % 8);
+#endif
+    free(seq->duties);
+    free(seq);
+  }
+}
+
+// The task may be starting a fade, holding the mutex of the fade driver, so it exits by itself
+static void ledcSequenceTaskStop(void) {
+  TaskHandle_t task = ledc_sequence_task;
+  if (task == NULL) {
+    return;
+  }
+  ledc_sequence_task = NULL;
+  xTaskNotify(task, LEDC_SEQUENCE_EXIT, eSetBits);
+  xSemaphoreTake(ledc_sequence_exited, portMAX_DELAY);
+}
+
 static bool ledcDetachBus(void *bus) {
   ledc_channel_handle_t *handle = (ledc_channel_handle_t *)bus;
+  ledcSequenceFree(handle->channel);
   ledc_handle.used_channels &= ~(1UL << handle->channel);
+  portENTER_CRITICAL(&ledc_commit_mux);
+  ledc_staged_channels &= ~(1UL << handle->channel);
+  portEXIT_CRITICAL(&ledc_commit_mux);
+  if (handle->pin < SOC_GPIO_PIN_COUNT && ledc_pins[handle->pin] == handle) {
+    ledc_pins[handle->pin] = NULL;
+  }
   pinMatrixOutDetach(handle->pin, false, false);
   free(handle);
   if (ledc_handle.used_channels == 0) {
+    ledcSequenceTaskStop();
     ledc_fade_func_uninstall();
     fade_initialized = false;
   }
@@ -113,6 +193,7 @@ bool ledcAttachChannel(uint8_t pin, uint32_t freq, uint8_t resolution, uint8_t c
     ledcDetachBus((void *)handle);
     return false;
   }
+  ledc_pins[pin] = handle;
 
   log_i("LEDC attached to pin %u (channel %u, resolution %u)", pin, channel, resolution);
   return true;
@@ -130,19 +211,12 @@ bool ledcAttach(uint8_t pin, uint32_t freq, uint8_t resolution) {
 }
 
 bool ledcWrite(uint8_t pin, uint32_t duty) {
-  ledc_channel_handle_t *bus = (ledc_channel_handle_t *)perimanGetPinBus(pin, ESP32_BUS_TYPE_LEDC);
+  ledc_channel_handle_t *bus = ledcGetBus(pin);
   if (bus != NULL) {
 
     uint8_t group = (bus->channel / 8), channel = (bus->channel % 8);
 
-    //Fixing if all bits in resolution is set = LEDC FULL ON
-    uint32_t max_duty = (1 << bus->channel_resolution) - 1;
-
-    if ((duty == max_duty) && (max_duty != 1)) {
-      duty = max_duty + 1;
-    }
-
-    ledc_set_duty(group, channel, duty);
+    ledc_set_duty(group, channel, ledcFixDuty(bus, duty));
     ledc_update_duty(group, channel);
 
     return true;
@@ -150,6 +224,49 @@ bool ledcWrite(uint8_t pin, uint32_t duty) {
   return false;
 }
 
+bool ledcWriteStage(uint8_t pin, uint32_t duty) {
+  ledc_channel_handle_t *bus = ledcGetBus(pin);
+  if (bus == NULL) {
+    log_e("Pin %u is not attached to LEDC. Call ledcAttach first!", pin);
+    return false;
+  }
+  // The duty register is only latched by the hardware on ledc_update_duty()
+  ledc_set_duty(bus->channel / 8, bus->channel % 8, ledcFixDuty(bus, duty));
+  portENTER_CRITICAL(&ledc_commit_mux);
+  ledc_staged_channels |= 1UL << bus->channel;
+  portEXIT_CRITICAL(&ledc_commit_mux);
+  return true;
+}
+
+bool ledcWriteCommit(void) {
+  // Latch all channels back to back, so they pick the new duty on the same PWM cycle
+  portENTER_CRITICAL(&ledc_commit_mux);
+  uint32_t staged = ledc_staged_channels;
+  ledc_staged_channels = 0;
+  if (staged == 0) {
+    portEXIT_CRITICAL(&ledc_commit_mux);
+    return false;
+  }
+  while (staged) {
+    uint8_t channel = __builtin_ctz(staged);
+    staged &= staged - 1;
+    ledc_update_duty(channel / 8, channel % 8);
+  }
+  portEXIT_CRITICAL(&ledc_commit_mux);
+  return true;
+}
+
+bool ledcWriteBatch(const uint8_t *pins, const uint32_t *duties, size_t count) {
+  if (pins == NULL || duties == NULL || count == 0) {
+    return false;
+  }
+  bool ret = true;
+  for (size_t i = 0; i < count; i++) {
+    ret &= ledcWriteStage(pins[i], duties[i]);
+  }
+  return ledcWriteCommit() && ret;
+}
+
 uint32_t ledcRead(uint8_t pin) {
   ledc_channel_handle_t *bus = (ledc_channel_handle_t *)perimanGetPinBus(pin, ESP32_BUS_TYPE_LEDC);
   if (bus != NULL) {
@@ -282,6 +399,12 @@ static bool ledcFadeConfig(uint8_t pin, uint32_t start_duty, uint32_t target_dut
   ledc_channel_handle_t *bus = (ledc_channel_handle_t *)perimanGetPinBus(pin, ESP32_BUS_TYPE_LEDC);
   if (bus != NULL) {
 
+    if (ledcSequenceRunning(bus->channel)) {
+      log_e("LEDC Fade Sequence is running on pin %u! Call ledcFadeSequenceStop first.", pin);
+      return false;
+    }
+    ledcSequenceFree(bus->channel);
+
 #ifndef SOC_LEDC_SUPPORT_FADE_STOP
 #if !CONFIG_DISABLE_HAL_LOCKS
     if (bus->lock == NULL) {
@@ -356,6 +479,155 @@ bool ledcFadeWithInterruptArg(uint8_t pin, uint32_t start_duty, uint32_t target_
   return ledcFadeConfig(pin, start_duty, target_duty, max_fade_time_ms, userFunc, arg);
 }
 
+static IRAM_ATTR bool ledcSequenceFadeEnd(const ledc_cb_param_t *param, void *user_arg) {
+  TaskHandle_t task = ledc_sequence_task;
+  if (param->event == LEDC_FADE_END_EVT && task != NULL) {
+    ledc_channel_handle_t *bus = (ledc_channel_handle_t *)user_arg;
+    BaseType_t xTaskWoken = pdFALSE;
+    xTaskNotifyFromISR(task, 1UL << bus->channel, eSetBits, &xTaskWoken);
+    return xTaskWoken == pdTRUE;
+  }
+  return false;
+}
+
+static void ledcSequenceTask(void *arg) {
+  uint32_t channels = 0;
+  for (;;) {
+    xTaskNotifyWait(0, UINT32_MAX, &channels, portMAX_DELAY);
+    if (channels & LEDC_SEQUENCE_EXIT) {
+      xSemaphoreGive(ledc_sequence_exited);
+      vTaskDelete(NULL);
+    }
+    while (channels) {
+      uint8_t channel = __builtin_ctz(channels);
+      channels &= channels - 1;
+
+      // Only the next point is read under the lock, the fade itself may block on the driver mutex
+      bool start = false;
+      uint32_t duty = 0;
+      int step_time_ms = 0;
+      portENTER_CRITICAL(&ledc_sequence_mux);
+      ledc_sequence_t *seq = ledc_sequences[channel];
+      if (seq != NULL) {
+        if (++seq->index >= seq->num_duties && seq->loop) {
+          seq->index = 0;
+        }
+        if (seq->index < seq->num_duties) {
+          duty = seq->duties[seq->index];
+          step_time_ms = seq->step_time_ms;
+          start = true;
+        }
+      }
+      portEXIT_CRITICAL(&ledc_sequence_mux);
+
+      if (start && ledc_set_fade_time_and_start(channel / 8, channel % 8, duty, step_time_ms, LEDC_FADE_NO_WAIT) != ESP_OK) {
+        log_e("ledc_set_fade_time_and_start failed on channel %u", channel);
+      }
+    }
+  }
+}
+
+bool ledcFadeSequence(uint8_t pin, const uint32_t *duties, size_t num_duties, int step_time_ms, bool loop) {
+  ledc_channel_handle_t *bus = ledcGetBus(pin);
+  if (bus == NULL) {
+    log_e("Pin %u is not attached to LEDC. Call ledcAttach first!", pin);
+    return false;
+  }
+  if (duties == NULL || num_duties < 2 || step_time_ms <= 0) {
+    log_e("LEDC pin %u - a fade sequence needs at least 2 duties and a positive step time.", pin);
+    return false;
+  }
+#ifndef SOC_LEDC_SUPPORT_FADE_STOP
+#if !CONFIG_DISABLE_HAL_LOCKS
+  // A fade started by ledcFade() can't be stopped on this SoC
+  if (bus->lock != NULL && xSemaphoreTake(bus->lock, 0) != pdTRUE) {
+    log_e("LEDC Fade is still running on pin %u! SoC does not support stopping fade.", pin);
+    return false;
+  }
+  if (bus->lock != NULL) {
+    xSemaphoreGive(bus->lock);
+  }
+#endif
+#endif
+
+  ledc_sequence_t *seq = (ledc_sequence_t *)calloc(1, sizeof(ledc_sequence_t));
+  if (seq == NULL) {
+    log_e("LEDC pin %u - fade sequence allocation failed.", pin);
+    return false;
+  }
+  seq->duties = (uint32_t *)malloc(num_duties * sizeof(uint32_t));
+  if (seq->duties == NULL) {
+    log_e("LEDC pin %u - fade sequence allocation failed.", pin);
+    free(seq);
+    return false;
+  }
+  for (size_t i = 0; i < num_duties; i++) {
+    seq->duties[i] = ledcFixDuty(bus, duties[i]);
+  }
+  seq->num_duties = num_duties;
+  seq->step_time_ms = step_time_ms;
+  seq->loop = loop;
+
+  if (ledc_sequence_exited == NULL) {
+    ledc_sequence_exited = xSemaphoreCreateBinary();
+  }
+  if (ledc_sequence_task == NULL && ledc_sequence_exited != NULL) {
+    xTaskCreate(ledcSequenceTask, "ledc_seq", 2048, NULL, configMAX_PRIORITIES - 1, &ledc_sequence_task);
+    if (ledc_sequence_task == NULL) {
+      log_e("LEDC fade sequence task creation failed.");
+      free(seq->duties);
+      free(seq);
+      return false;
+    }
+  }
+
+  // Replaces any sequence already playing on this pin
+  ledcSequenceFree(bus->channel);
+
+  uint8_t group = (bus->channel / 8), channel = (bus->channel % 8);
+
+  if (!fade_initialized) {
+    ledc_fade_func_install(0);
+    fade_initialized = true;
+  }
+
+  ledc_cbs_t callbacks = {.fade_cb = ledcSequenceFadeEnd};
+  ledc_cb_register(group, channel, &callbacks, (void *)bus);
+
+  if (ledc_set_duty_and_update(group, channel, seq->duties[0], 0) != ESP_OK) {
+    log_e("ledc_set_duty_and_update failed");
+    free(seq->duties);
+    free(seq);
+    return false;
+  }
+
+  portENTER_CRITICAL(&ledc_sequence_mux);
+  ledc_sequences[bus->channel] = seq;
+  portEXIT_CRITICAL(&ledc_sequence_mux);
+
+  // The first segment is started here, the following ones from the fade end interrupt
+  xTaskNotify(ledc_sequence_task, 1UL << bus->channel, eSetBits);
+  return true;
+}
+
+bool ledcFadeSequenceRunning(uint8_t pin) {
+  ledc_channel_handle_t *bus = ledcGetBus(pin);
+  if (bus == NULL) {
+    return false;
+  }
+  return ledcSequenceRunning(bus->channel);
+}
+
+bool ledcFadeSequenceStop(uint8_t pin) {
+  ledc_channel_handle_t *bus = ledcGetBus(pin);
+  if (bus == NULL) {
+    log_e("Pin %u is not attached to LEDC.", pin);
+    return false;
+  }
+  ledcSequenceFree(bus->channel);
+  return true;
+}
+
 static uint8_t analog_resolution = 8;
 static int analog_frequency = 1000;
 void analogWrite(uint8_t pin, int value) {
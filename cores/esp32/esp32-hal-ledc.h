@@ -24,6 +24,7 @@ extern "C" {
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 
@@ -203,6 +204,70 @@ bool ledcFadeWithInterrupt(uint8_t pin, uint32_t start_duty, uint32_t target_dut
  */
 bool ledcFadeWithInterruptArg(uint8_t pin, uint32_t start_duty, uint32_t target_duty, int max_fade_time_ms, void (*userFunc)(void *), void *arg);
 
+/**
+ * @brief Stage a new duty for a LEDC pin, without applying it.
+ *        Staged duties are applied together by ledcWriteCommit.
+ *
+ * @param pin GPIO pin
+ * @param duty duty to be staged for the pin
+ *
+ * @return true if duty was successfully staged, false otherwise.
+ */
+bool ledcWriteStage(uint8_t pin, uint32_t duty);
+
+/**
+ * @brief Apply all duties staged by ledcWriteStage at once.
+ *        Channels sharing a timer switch to the new duty on the same PWM cycle.
+ *
+ * @return true if staged duties were applied, false if nothing was staged.
+ */
+bool ledcWriteCommit(void);
+
+/**
+ * @brief Stage and commit duties for several LEDC pins in one call.
+ *
+ * @param pins array of GPIO pins
+ * @param duties array of duties, one for each pin
+ * @param count number of pins
+ *
+ * @return true if all duties were successfully applied, false otherwise.
+ */
+bool ledcWriteBatch(const uint8_t *pins, const uint32_t *duties, size_t count);
+
+/**
+ * @brief Play a precomputed duty curve on a LEDC pin using the hardware fade engine.
+ *        Each pair of consecutive duties is played as a linear hardware fade,
+ *        so the CPU is only involved at the end of each segment.
+ *
+ * @param pin GPIO pin
+ * @param duties array of duty points, copied by the driver
+ * @param num_duties number of duty points (at least 2)
+ * @param step_time_ms duration of each segment between two duty points
+ * @param loop true to restart from the first duty point when the curve ends
+ *
+ * @return true if the sequence was successfully started, false otherwise.
+ */
+bool ledcFadeSequence(uint8_t pin, const uint32_t *duties, size_t num_duties, int step_time_ms, bool loop);
+
+/**
+ * @brief Check if a fade sequence is still playing on a LEDC pin.
+ *
+ * @param pin GPIO pin
+ *
+ * @return true if a fade sequence is playing, false otherwise.
+ */
+bool ledcFadeSequenceRunning(uint8_t pin);
+
+/**
+ * @brief Stop the fade sequence playing on a LEDC pin.
+ *        On SoCs not supporting fade stop, the running segment still completes.
+ *
+ * @param pin GPIO pin
+ *
+ * @return true if the pin is attached to LEDC, false otherwise.
+ */
+bool ledcFadeSequenceStop(uint8_t pin);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,468 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "esp32-hal-log-ring.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Record: [size:16][kind:8][0:8][stamp:32] then
+//   LOG_RING_FORMAT: [format pointer][arguments, in the order of the conversions]
+//   LOG_RING_TEXT:   [length:16][text]
+//   LOG_RING_WRAP:   nothing, the next record is at the start of the ring
+// A string argument is [length:16][characters], or [LOG_RING_STR_STATIC:16][pointer].
+#define LOG_RING_FORMAT     1
+#define LOG_RING_TEXT       2
+#define LOG_RING_WRAP       3
+#define LOG_RING_HEADER     8
+#define LOG_RING_STR_STATIC 0xFFFF
+
+static inline uint32_t logRingAlign(size_t len) {
+  return (len + 3) & ~3U;
+}
+
+void logRingSpec(const char *p, log_spec_t *spec) {
+  const char *s = p + 1;
+  spec->type = LOG_ARG_NONE;
+  spec->stars = 0;
+  spec->conv = 0;
+  spec->precision = -1;
+  if (*s == '%') {
+    spec->len = 2;
+    return;
+  }
+  while (*s && strchr("-+ #0'", *s)) {
+    s++;
+  }
+  if (*s == '*') {
+    spec->stars++;
+    s++;
+  } else {
+    while (*s >= '0' && *s <= '9') {
+      s++;
+    }
+  }
+  if (*s == '.') {
+    s++;
+    if (*s == '*') {
+      spec->stars++;
+      spec->precision = LOG_SPEC_STAR;
+      s++;
+    } else {
+      spec->precision = 0;
+      while (*s >= '0' && *s <= '9') {
+        if (spec->precision < LOG_RING_RECORD_MAX) {
+          spec->precision = spec->precision * 10 + (*s - '0');
+        }
+        s++;
+      }
+    }
+  }
+  log_arg_t integer = LOG_ARG_INT;
+  bool longDouble = false;
+  switch (*s) {
+    case 'h':
+      s++;
+      if (*s == 'h') {
+        s++;
+      }
+      break;
+    case 'l':
+      s++;
+      integer = LOG_ARG_LONG;
+      if (*s == 'l') {
+        s++;
+        integer = LOG_ARG_LLONG;
+      }
+      break;
+    case 'q':
+      s++;
+      integer = LOG_ARG_LLONG;
+      break;
+    case 'z':
+      s++;
+      integer = LOG_ARG_SIZE;
+      break;
+    case 'j':
+      s++;
+      integer = LOG_ARG_INTMAX;
+      break;
+    case 't':
+      s++;
+      integer = LOG_ARG_PTRDIFF;
+      break;
+    case 'L':
+      s++;
+      longDouble = true;
+      break;
+    default: break;
+  }
+  switch (*s) {
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X': spec->type = integer; break;
+    case 'c': spec->type = LOG_ARG_INT; break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A': spec->type = longDouble ? LOG_ARG_LDOUBLE : LOG_ARG_DOUBLE; break;
+    case 's': spec->type = LOG_ARG_STR; break;
+    case 'p': spec->type = LOG_ARG_PTR; break;
+    case 'n': spec->type = LOG_ARG_COUNT; break;
+    default:
+      // unknown conversion or end of the format: printed as it is
+      spec->stars = 0;
+      spec->precision = -1;
+      spec->len = (uint8_t)(s - p);
+      return;
+  }
+  spec->conv = *s;
+  s++;
+  spec->len = (uint8_t)(s - p);
+}
+
+static size_t logRingSizeOf(log_arg_t type) {
+  switch (type) {
+    case LOG_ARG_INT:     return sizeof(int);
+    case LOG_ARG_LONG:    return sizeof(long);
+    case LOG_ARG_LLONG:   return sizeof(long long);
+    case LOG_ARG_SIZE:    return sizeof(size_t);
+    case LOG_ARG_INTMAX:  return sizeof(intmax_t);
+    case LOG_ARG_PTRDIFF: return sizeof(ptrdiff_t);
+    case LOG_ARG_DOUBLE:  return sizeof(double);
+    case LOG_ARG_LDOUBLE: return sizeof(long double);
+    case LOG_ARG_PTR:
+    case LOG_ARG_COUNT:   return sizeof(void *);
+    default:              return 0;
+  }
+}
+
+static size_t logRingEncodeText(uint8_t *rec, const char *format, va_list arg) {
+  int len = vsnprintf((char *)rec + LOG_RING_HEADER + 2, LOG_RING_RECORD_MAX - LOG_RING_HEADER - 2, format, arg);
+  if (len < 0) {
+    len = 0;
+  } else if (len > LOG_RING_RECORD_MAX - LOG_RING_HEADER - 3) {
+    len = LOG_RING_RECORD_MAX - LOG_RING_HEADER - 3;  // without the terminating zero
+  }
+  uint16_t textLen = (uint16_t)len;
+  rec[2] = LOG_RING_TEXT;
+  memcpy(rec + LOG_RING_HEADER, &textLen, 2);
+  return LOG_RING_HEADER + 2 + len;
+}
+
+size_t logRingEncodeData(uint8_t *rec, uint32_t stamp, const void *data, size_t len) {
+  if (len > LOG_RING_RECORD_MAX - LOG_RING_HEADER - 2) {
+    len = LOG_RING_RECORD_MAX - LOG_RING_HEADER - 2;
+  }
+  uint16_t dataLen = (uint16_t)len;
+  memset(rec, 0, 4);
+  rec[2] = LOG_RING_TEXT;
+  memcpy(rec + 4, &stamp, 4);
+  memcpy(rec + LOG_RING_HEADER, &dataLen, 2);
+  memcpy(rec + LOG_RING_HEADER + 2, data, len);
+  return LOG_RING_HEADER + 2 + len;
+}
+
+size_t logRingEncode(uint8_t *rec, uint32_t stamp, const char *format, va_list arg, log_ring_static_cb_t isStatic) {
+  memset(rec, 0, 4);
+  memcpy(rec + 4, &stamp, 4);
+  if (isStatic && !isStatic(format)) {
+    return logRingEncodeText(rec, format, arg);
+  }
+
+  va_list copy;
+  va_copy(copy, arg);
+  rec[2] = LOG_RING_FORMAT;
+  memcpy(rec + LOG_RING_HEADER, &format, sizeof(format));
+  size_t pos = LOG_RING_HEADER + sizeof(format);
+  const char *p = format;
+  log_spec_t spec;
+  while ((p = strchr(p, '%')) != NULL) {
+    logRingSpec(p, &spec);
+    p += spec.len;
+    if (spec.type == LOG_ARG_NONE) {
+      continue;
+    }
+    if (pos + spec.stars * sizeof(int) + logRingSizeOf(spec.type) + 2 > LOG_RING_RECORD_MAX) {
+      goto text;
+    }
+    int star = -1;
+    for (uint8_t i = 0; i < spec.stars; i++) {
+      star = va_arg(arg, int);
+      memcpy(rec + pos, &star, sizeof(star));
+      pos += sizeof(star);
+    }
+    switch (spec.type) {
+#define LOG_RING_COPY(T)            \
+  {                                 \
+    T v = va_arg(arg, T);           \
+    memcpy(rec + pos, &v, sizeof(v)); \
+    pos += sizeof(v);               \
+  }                                 \
+  break
+      case LOG_ARG_INT:     LOG_RING_COPY(int);
+      case LOG_ARG_LONG:    LOG_RING_COPY(long);
+      case LOG_ARG_LLONG:   LOG_RING_COPY(long long);
+      case LOG_ARG_SIZE:    LOG_RING_COPY(size_t);
+      case LOG_ARG_INTMAX:  LOG_RING_COPY(intmax_t);
+      case LOG_ARG_PTRDIFF: LOG_RING_COPY(ptrdiff_t);
+      case LOG_ARG_DOUBLE:  LOG_RING_COPY(double);
+      case LOG_ARG_LDOUBLE: LOG_RING_COPY(long double);
+      case LOG_ARG_PTR:
+      case LOG_ARG_COUNT:   LOG_RING_COPY(void *);
+#undef LOG_RING_COPY
+      case LOG_ARG_STR:
+      {
+        const char *s = va_arg(arg, const char *);
+        uint16_t len;
+        if (s == NULL || !isStatic || isStatic(s)) {
+          if (pos + 2 + sizeof(s) > LOG_RING_RECORD_MAX) {
+            goto text;
+          }
+          len = LOG_RING_STR_STATIC;
+          memcpy(rec + pos, &len, 2);
+          memcpy(rec + pos + 2, &s, sizeof(s));
+          pos += 2 + sizeof(s);
+        } else {
+          // up to the precision, the characters after it may not be readable nor terminated,
+          // and truncated to what is left of the record
+          size_t max = LOG_RING_RECORD_MAX - pos - 2;
+          int precision = spec.precision == LOG_SPEC_STAR ? star : spec.precision;  // a negative '*' is no precision
+          if (precision >= 0 && (size_t)precision < max) {
+            max = precision;
+          }
+          len = (uint16_t)strnlen(s, max);
+          memcpy(rec + pos, &len, 2);
+          memcpy(rec + pos + 2, s, len);
+          pos += 2 + len;
+        }
+        break;
+      }
+      default: break;
+    }
+  }
+  va_end(copy);
+  return pos;
+
+text:
+  pos = logRingEncodeText(rec, format, copy);
+  va_end(copy);
+  return pos;
+}
+
+void logRingInit(log_ring_t *ring, void *buf, size_t size, log_ring_static_cb_t isStatic) {
+  memset(ring, 0, sizeof(log_ring_t));
+  ring->buf = (uint8_t *)buf;
+  ring->size = size & ~3U;
+  ring->isStatic = isStatic;
+}
+
+size_t logRingUsed(log_ring_t *ring) {
+  uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+  return head >= tail ? head - tail : head + ring->size - tail;
+}
+
+bool logRingWrite(log_ring_t *ring, const uint8_t *rec, size_t len) {
+  uint32_t size = logRingAlign(len);
+  uint32_t head = ring->head;
+  uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+  uint32_t used = head >= tail ? head - tail : head + ring->size - tail;
+  uint32_t contiguous = ring->size - head;
+  // 4 bytes are kept free, so that a full ring is not taken as empty
+  uint32_t needed = (contiguous < size ? contiguous + size : size) + 4;
+  if (size > UINT16_MAX || used + needed > ring->size) {
+    ring->dropped++;
+    return false;
+  }
+  if (contiguous < size) {
+    ring->buf[head + 2] = LOG_RING_WRAP;
+    head = 0;
+  }
+  uint16_t size16 = (uint16_t)size;
+  memcpy(ring->buf + head, rec, len);
+  memcpy(ring->buf + head, &size16, 2);
+  head += size;
+  if (head == ring->size) {
+    head = 0;
+  }
+  __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+  ring->queued++;
+  used += needed - 4;
+  if (used > ring->peak) {
+    ring->peak = used;
+  }
+  return true;
+}
+
+/*
+ * Find the oldest record, skipping the end of the ring after a wrap marker.
+ */
+static uint8_t *logRingOldest(log_ring_t *ring) {
+  uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  uint32_t tail = ring->tail;
+  if (tail == head) {
+    return NULL;
+  }
+  if (ring->buf[tail + 2] == LOG_RING_WRAP) {
+    tail = 0;
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    if (tail == head) {
+      return NULL;
+    }
+  }
+  return ring->buf + tail;
+}
+
+bool logRingPeek(log_ring_t *ring, uint32_t *stamp) {
+  uint8_t *rec = logRingOldest(ring);
+  if (!rec) {
+    return false;
+  }
+  memcpy(stamp, rec + 4, 4);
+  return true;
+}
+
+static void logRingFormat(const uint8_t *rec, log_ring_write_cb_t write, void *arg) {
+  const char *format;
+  memcpy(&format, rec + LOG_RING_HEADER, sizeof(format));
+  const uint8_t *values = rec + LOG_RING_HEADER + sizeof(format);
+  char spec_fmt[LOG_RING_SPEC_MAX + 1];
+  char out[LOG_RING_RECORD_MAX + 1];
+  char str[LOG_RING_RECORD_MAX + 1];
+  const char *p = format;
+  const char *q;
+  log_spec_t spec;
+  while ((q = strchr(p, '%')) != NULL) {
+    if (q > p) {
+      write(p, q - p, arg);
+    }
+    logRingSpec(q, &spec);
+    p = q + spec.len;
+    if (spec.type == LOG_ARG_NONE) {
+      // "%%", or an unknown conversion printed as it is
+      if (q[1] == '%') {
+        write(q, 1, arg);
+      } else {
+        write(q, spec.len, arg);
+      }
+      continue;
+    }
+    int star[2] = {0, 0};
+    for (uint8_t i = 0; i < spec.stars; i++) {
+      memcpy(&star[i], values, sizeof(int));
+      values += sizeof(int);
+    }
+    if (spec.type == LOG_ARG_COUNT) {
+      values += sizeof(void *);
+      continue;
+    }
+    if (spec.len > LOG_RING_SPEC_MAX) {
+      // too long to copy, keep the length modifier and the conversion only
+      const char *c = q + spec.len - 1;
+      while (c > q + 1 && strchr("hlqzjtL", c[-1])) {
+        c--;
+      }
+      spec_fmt[0] = '%';
+      memcpy(spec_fmt + 1, c, q + spec.len - c);
+      spec_fmt[1 + (q + spec.len - c)] = 0;
+      spec.stars = 0;
+    } else {
+      memcpy(spec_fmt, q, spec.len);
+      spec_fmt[spec.len] = 0;
+    }
+    int len = 0;
+#define LOG_RING_PRINT(v)                                                    \
+  len = spec.stars == 0   ? snprintf(out, sizeof(out), spec_fmt, v)          \
+        : spec.stars == 1 ? snprintf(out, sizeof(out), spec_fmt, star[0], v) \
+                          : snprintf(out, sizeof(out), spec_fmt, star[0], star[1], v)
+#define LOG_RING_VALUE(T)             \
+  {                                   \
+    T v;                              \
+    memcpy(&v, values, sizeof(v));    \
+    values += sizeof(v);              \
+    LOG_RING_PRINT(v);                \
+  }                                   \
+  break
+    switch (spec.type) {
+      case LOG_ARG_INT:     LOG_RING_VALUE(int);
+      case LOG_ARG_LONG:    LOG_RING_VALUE(long);
+      case LOG_ARG_LLONG:   LOG_RING_VALUE(long long);
+      case LOG_ARG_SIZE:    LOG_RING_VALUE(size_t);
+      case LOG_ARG_INTMAX:  LOG_RING_VALUE(intmax_t);
+      case LOG_ARG_PTRDIFF: LOG_RING_VALUE(ptrdiff_t);
+      case LOG_ARG_DOUBLE:  LOG_RING_VALUE(double);
+      case LOG_ARG_LDOUBLE: LOG_RING_VALUE(long double);
+      case LOG_ARG_PTR:     LOG_RING_VALUE(void *);
+      case LOG_ARG_STR:
+      {
+        uint16_t strLen;
+        const char *s;
+        memcpy(&strLen, values, 2);
+        values += 2;
+        if (strLen == LOG_RING_STR_STATIC) {
+          memcpy(&s, values, sizeof(s));
+          values += sizeof(s);
+        } else {
+          memcpy(str, values, strLen);
+          str[strLen] = 0;
+          values += strLen;
+          s = str;
+        }
+        LOG_RING_PRINT(s);
+        break;
+      }
+      default: break;
+    }
+#undef LOG_RING_VALUE
+#undef LOG_RING_PRINT
+    if (len > 0) {
+      write(out, len < (int)sizeof(out) ? (size_t)len : sizeof(out) - 1, arg);
+    }
+  }
+  if (*p) {
+    write(p, strlen(p), arg);
+  }
+}
+
+bool logRingRead(log_ring_t *ring, log_ring_write_cb_t write, void *arg) {
+  uint8_t *rec = logRingOldest(ring);
+  if (!rec) {
+    return false;
+  }
+  if (rec[2] == LOG_RING_TEXT) {
+    uint16_t len;
+    memcpy(&len, rec + LOG_RING_HEADER, 2);
+    write((const char *)rec + LOG_RING_HEADER + 2, len, arg);
+  } else {
+    logRingFormat(rec, write, arg);
+  }
+  uint16_t size;
+  memcpy(&size, rec, 2);
+  uint32_t tail = (rec - ring->buf) + size;
+  if (tail == ring->size) {
+    tail = 0;
+  }
+  __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+  return true;
+}
@@ -0,0 +1,165 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MAIN_ESP32_HAL_LOG_RING_H_
+#define MAIN_ESP32_HAL_LOG_RING_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+   Ring of log records, formatted when they are read instead of when they are written.
+
+   A record keeps the format pointer and the raw arguments, found by walking the conversions
+   of the format: integers, floating point values and pointers are copied as they are, strings
+   are copied into the record unless the ring owner tells they are static (e.g. in flash).
+   A format that is not static itself is formatted at once and kept as text.
+
+   The ring has a single reader and a single writer at a time, with lock-free head and tail:
+   the owner serializes the writers, as done per core by log_deferred_begin() in esp32-hal-log.h.
+   This file has no dependency on the SoC.
+*/
+
+#define LOG_RING_RECORD_MAX 192  // bytes of one record, longer strings and texts are truncated
+#define LOG_RING_SPEC_MAX   24   // characters of one conversion specification
+#define LOG_SPEC_STAR       -2   // log_spec_t precision given by a '*' argument
+
+typedef enum {
+  LOG_ARG_NONE,  // %%, or an unknown conversion
+  LOG_ARG_INT,
+  LOG_ARG_LONG,
+  LOG_ARG_LLONG,
+  LOG_ARG_SIZE,
+  LOG_ARG_INTMAX,
+  LOG_ARG_PTRDIFF,
+  LOG_ARG_DOUBLE,
+  LOG_ARG_LDOUBLE,
+  LOG_ARG_PTR,
+  LOG_ARG_STR,
+  LOG_ARG_COUNT,  // %n, consumes a pointer and prints nothing
+} log_arg_t;
+
+typedef struct {
+  log_arg_t type;
+  uint8_t stars;  // '*' width and precision, each taking an int argument before the value
+  uint8_t len;    // characters of the conversion specification, '%' included
+  char conv;      // conversion character, 0 for LOG_ARG_NONE
+  int precision;  // -1 without a precision, LOG_SPEC_STAR for the last '*' argument
+} log_spec_t;
+
+typedef bool (*log_ring_static_cb_t)(const void *ptr);
+typedef void (*log_ring_write_cb_t)(const char *data, size_t len, void *arg);
+
+typedef struct {
+  uint8_t *buf;
+  uint32_t size;                  // bytes of <buf>, multiple of 4
+  uint32_t head;                  // written by the writer only
+  uint32_t tail;                  // written by the reader only
+  log_ring_static_cb_t isStatic;  // NULL when every pointer is static
+  uint32_t queued;                // records written
+  uint32_t dropped;               // records lost, the ring being full
+  uint32_t peak;                  // highest usage, in bytes
+} log_ring_t;
+
+/**
+ * @brief Initialize an empty ring.
+ *
+ * @param ring ring
+ * @param buf memory of the ring, 4 bytes aligned
+ * @param size bytes of <buf>, rounded down to a multiple of 4
+ * @param isStatic function telling if a format or a string outlives the record, or NULL if all do
+ */
+void logRingInit(log_ring_t *ring, void *buf, size_t size, log_ring_static_cb_t isStatic);
+
+/**
+ * @brief Encode a record into a buffer, without formatting it when possible.
+ *
+ * @param rec buffer of LOG_RING_RECORD_MAX bytes
+ * @param stamp time stamp of the record, used to order records of several rings
+ * @param format printf() format
+ * @param arg arguments of <format>
+ * @param isStatic as given to logRingInit()
+ *
+ * @return size of the record
+ */
+size_t logRingEncode(uint8_t *rec, uint32_t stamp, const char *format, va_list arg, log_ring_static_cb_t isStatic);
+
+/**
+ * @brief Encode a record of raw data, written as it is when read.
+ *
+ * @param rec buffer of LOG_RING_RECORD_MAX bytes
+ * @param stamp time stamp of the record
+ * @param data data
+ * @param len bytes of <data>, truncated to what fits in a record
+ *
+ * @return size of the record
+ */
+size_t logRingEncodeData(uint8_t *rec, uint32_t stamp, const void *data, size_t len);
+
+/**
+ * @brief Write a record encoded by logRingEncode(). The caller serializes the writers.
+ *
+ * @param ring ring
+ * @param rec record
+ * @param len size of the record
+ *
+ * @return true if written, false if dropped as the ring is full
+ */
+bool logRingWrite(log_ring_t *ring, const uint8_t *rec, size_t len);
+
+/**
+ * @brief Get the time stamp of the oldest record.
+ *
+ * @param ring ring
+ * @param stamp time stamp of the record
+ *
+ * @return false if the ring is empty
+ */
+bool logRingPeek(log_ring_t *ring, uint32_t *stamp);
+
+/**
+ * @brief Format the oldest record and remove it from the ring.
+ *
+ * @param ring ring
+ * @param write function receiving the formatted text, in one or more pieces
+ * @param arg argument passed to <write>
+ *
+ * @return false if the ring is empty
+ */
+bool logRingRead(log_ring_t *ring, log_ring_write_cb_t write, void *arg);
+
+/**
+ * @brief Get the bytes used by the records in the ring.
+ */
+size_t logRingUsed(log_ring_t *ring);
+
+/**
+ * @brief Parse a printf() conversion specification.
+ *
+ * @param p conversion specification, starting with '%'
+ * @param spec type of its argument and length
+ */
+void logRingSpec(const char *p, log_spec_t *spec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_ESP32_HAL_LOG_RING_H_ */
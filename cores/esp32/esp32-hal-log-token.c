@@ -0,0 +1,141 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "esp32-hal-log-token.h"
+#include <string.h>
+
+#define LOG_TOKEN_VARINT_MAX 10
+
+uint32_t logTokenHash(const char *format) {
+  uint32_t hash = 2166136261UL;
+  while (*format) {
+    hash ^= (uint8_t)*format++;
+    hash *= 16777619UL;
+  }
+  return hash ? hash : 1;
+}
+
+static uint8_t *logTokenVarint(uint8_t *p, uint64_t v) {
+  while (v >= 0x80) {
+    *p++ = (uint8_t)v | 0x80;
+    v >>= 7;
+  }
+  *p++ = (uint8_t)v;
+  return p;
+}
+
+static uint8_t *logTokenZigzag(uint8_t *p, int64_t v) {
+  return logTokenVarint(p, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static uint8_t *logTokenInteger(uint8_t *p, log_arg_t type, bool isSigned, va_list *arg) {
+  if (isSigned) {
+    int64_t v;
+    switch (type) {
+      case LOG_ARG_LONG:    v = va_arg(*arg, long); break;
+      case LOG_ARG_LLONG:   v = va_arg(*arg, long long); break;
+      case LOG_ARG_SIZE:    v = (int64_t)va_arg(*arg, size_t); break;
+      case LOG_ARG_INTMAX:  v = va_arg(*arg, intmax_t); break;
+      case LOG_ARG_PTRDIFF: v = va_arg(*arg, ptrdiff_t); break;
+      default:              v = va_arg(*arg, int); break;
+    }
+    return logTokenZigzag(p, v);
+  }
+  uint64_t v;
+  switch (type) {
+    case LOG_ARG_LONG:    v = va_arg(*arg, unsigned long); break;
+    case LOG_ARG_LLONG:   v = va_arg(*arg, unsigned long long); break;
+    case LOG_ARG_SIZE:    v = va_arg(*arg, size_t); break;
+    case LOG_ARG_INTMAX:  v = va_arg(*arg, uintmax_t); break;
+    case LOG_ARG_PTRDIFF: v = (uint64_t)va_arg(*arg, ptrdiff_t); break;
+    default:              v = va_arg(*arg, unsigned int); break;
+  }
+  return logTokenVarint(p, v);
+}
+
+size_t logTokenEncode(uint8_t *frame, uint32_t token, const char *format, va_list arg, log_ring_static_cb_t isStatic) {
+  uint8_t *p = frame + 2;
+  uint8_t *end = frame + LOG_TOKEN_FRAME_MAX;
+  va_list args;
+  va_copy(args, arg);
+
+  memcpy(p, &token, 4);
+  p += 4;
+  for (const char *f = format; *f; f++) {
+    if (*f != '%') {
+      continue;
+    }
+    log_spec_t spec;
+    logRingSpec(f, &spec);
+    f += spec.len - 1;
+    if (spec.type == LOG_ARG_NONE) {
+      continue;
+    }
+    // room for the stars and the largest value, a string needs at least its varint
+    if (end - p < (spec.stars + 1) * LOG_TOKEN_VARINT_MAX) {
+      break;
+    }
+    int star = -1;
+    for (uint8_t i = 0; i < spec.stars; i++) {
+      star = va_arg(args, int);
+      p = logTokenZigzag(p, star);
+    }
+    switch (spec.type) {
+      case LOG_ARG_DOUBLE:
+      case LOG_ARG_LDOUBLE:
+      {
+        double v = spec.type == LOG_ARG_DOUBLE ? va_arg(args, double) : (double)va_arg(args, long double);
+        memcpy(p, &v, 8);
+        p += 8;
+        break;
+      }
+      case LOG_ARG_PTR:
+      {
+        uint32_t v = (uint32_t)(uintptr_t)va_arg(args, void *);
+        memcpy(p, &v, 4);
+        p += 4;
+        break;
+      }
+      case LOG_ARG_STR:
+      {
+        const char *s = va_arg(args, const char *);
+        if (!s) {
+          s = "(null)";
+        }
+        if (isStatic && isStatic(s)) {
+          p = logTokenVarint(p, ((uint64_t)(uintptr_t)s << 1) | 1);
+          break;
+        }
+        // up to the precision, the characters after it may not be readable nor terminated
+        size_t room = end - p - 2;  // two bytes of varint for up to 8191 characters
+        int precision = spec.precision == LOG_SPEC_STAR ? star : spec.precision;  // a negative '*' is no precision
+        if (precision >= 0 && (size_t)precision < room) {
+          room = precision;
+        }
+        size_t len = strnlen(s, room);
+        p = logTokenVarint(p, (uint64_t)len << 1);
+        memcpy(p, s, len);
+        p += len;
+        break;
+      }
+      case LOG_ARG_COUNT: (void)va_arg(args, void *); break;
+      default:            p = logTokenInteger(p, spec.type, spec.conv == 'd' || spec.conv == 'i', &args); break;
+    }
+  }
+  va_end(args);
+
+  frame[0] = LOG_TOKEN_SYNC;
+  frame[1] = (uint8_t)(p - frame - 2);
+  return p - frame;
+}
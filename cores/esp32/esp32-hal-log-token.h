@@ -0,0 +1,65 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MAIN_ESP32_HAL_LOG_TOKEN_H_
+#define MAIN_ESP32_HAL_LOG_TOKEN_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include "esp32-hal-log-ring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+   Tokenized log frames, decoded on the host by tools/log_decoder.py.
+
+   [0x1F][payload length][token, 4 bytes LE][arguments]
+
+   The token is the 32 bit FNV-1a hash of the format, 0 being replaced by 1. The arguments follow
+   the conversions of the format: signed integers and '*' widths are zigzag varints, unsigned ones
+   varints, floating point values 8 bytes doubles and pointers 4 bytes LE. A string is a varint v:
+   when v is odd, v >> 1 is its address in flash, otherwise v >> 1 characters follow.
+   Arguments that do not fit in the frame are left out, and strings are truncated.
+   This file has no dependency on the SoC.
+*/
+
+#define LOG_TOKEN_SYNC      0x1F
+#define LOG_TOKEN_FRAME_MAX (LOG_RING_RECORD_MAX - 12)  // fits in a ring record, for deferred logging
+
+/**
+ * @brief Hash a format into its token.
+ */
+uint32_t logTokenHash(const char *format);
+
+/**
+ * @brief Encode a frame.
+ *
+ * @param frame buffer of LOG_TOKEN_FRAME_MAX bytes
+ * @param token token of <format>
+ * @param format printf() format
+ * @param arg arguments of <format>
+ * @param isStatic function telling if a string is sent by address, or NULL to copy them all
+ *
+ * @return size of the frame
+ */
+size_t logTokenEncode(uint8_t *frame, uint32_t token, const char *format, va_list arg, log_ring_static_cb_t isStatic);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_ESP32_HAL_LOG_TOKEN_H_ */
@@ -18,6 +18,9 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include "sdkconfig.h"
 #include "esp_timer.h"
 
@@ -84,16 +87,71 @@ const char *pathToFileName(const char *path);
 int log_printf(const char *fmt, ...);
 void log_print_buf(const uint8_t *b, size_t len);
 
+/*
+ * Deferred logging
+ *
+ * Once started, log_printf() and the log_x() macros only store the format and the arguments
+ * of the message in a ring of the current core, and a task of the given priority formats them
+ * and writes them to the log output. Strings that are not in flash are copied with the message,
+ * so they may be freed after the call. When a ring is full the message is dropped, and counted.
+ */
+typedef struct {
+  uint32_t queued;   // messages stored
+  uint32_t dropped;  // messages lost, their ring being full
+  uint32_t written;  // bytes written to the log output
+  uint32_t peak;     // highest usage of a ring, in bytes
+} log_deferred_stats_t;
+
+bool log_deferred_begin(size_t ring_size, uint8_t priority);  // ring_size per core, 0 for the default
+void log_deferred_end(void);
+bool log_deferred_flush(uint32_t timeout_ms);
+void log_deferred_stats(log_deferred_stats_t *stats);
+bool log_deferred_active(void);
+// ISR safe, except while the flash cache is disabled. Returns 0 if not started or dropped.
+int log_deferred_printf(const char *fmt, ...);
+// deferred when started, printed at once with ets_printf() otherwise
+#define isr_log_printf(format, ...) (log_deferred_active() ? log_deferred_printf(format, ##__VA_ARGS__) : ets_printf(format, ##__VA_ARGS__))
+
 #define ARDUHAL_SHORT_LOG_FORMAT(letter, format) ARDUHAL_LOG_COLOR_##letter format ARDUHAL_LOG_RESET_COLOR "\r\n"
 #define ARDUHAL_LOG_FORMAT(letter, format)                                                                                                              \
   ARDUHAL_LOG_COLOR_##letter "[%6u][" #letter "][%s:%u] %s(): " format ARDUHAL_LOG_RESET_COLOR "\r\n", (unsigned long)(esp_timer_get_time() / 1000ULL), \
     pathToFileName(__FILE__), __LINE__, __FUNCTION__
 
+/*
+ * Tokenized logging
+ *
+ * Built with ARDUHAL_LOG_TOKENIZED defined to 1 (or CONFIG_ARDUHAL_LOG_TOKENIZED set), the log_x()
+ * macros send a binary frame instead of text: the hash of the format, computed once per call site,
+ * followed by the packed arguments. Strings in flash are sent as their address. tools/log_decoder.py
+ * finds the formats and the strings in the ELF file of the application and prints the messages back.
+ */
+#if defined(CONFIG_ARDUHAL_LOG_TOKENIZED) && !defined(ARDUHAL_LOG_TOKENIZED)
+#define ARDUHAL_LOG_TOKENIZED 1
+#endif
+
+void log_token_printf(uint32_t *token, const char *fmt, ...);
+
+#define ARDUHAL_LOG_STR(x)  #x
+#define ARDUHAL_LOG_XSTR(x) ARDUHAL_LOG_STR(x)
+// file and line are part of the format, so each call site has its own token
+#define ARDUHAL_LOG_TOKEN_FORMAT(letter, format) \
+  ARDUHAL_LOG_COLOR_##letter "[%6u][" #letter "][" __FILE__ ":" ARDUHAL_LOG_XSTR(__LINE__) "] %s(): " format ARDUHAL_LOG_RESET_COLOR "\r\n"
+
+#if ARDUHAL_LOG_TOKENIZED
+#define ARDUHAL_LOG_PRINTF(letter, format, ...)                                                                                                      \
+  do {                                                                                                                                             \
+    static uint32_t _log_token = 0;                                                                                                                \
+    log_token_printf(&_log_token, ARDUHAL_LOG_TOKEN_FORMAT(letter, format), (unsigned)(esp_timer_get_time() / 1000ULL), __FUNCTION__, ##__VA_ARGS__); \
+  } while (0)
+#else
+#define ARDUHAL_LOG_PRINTF(letter, format, ...) log_printf(ARDUHAL_LOG_FORMAT(letter, format), ##__VA_ARGS__)
+#endif
+
 //esp_rom_printf(DRAM_STR("ST:%d\n"), frame_pos);
 
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_VERBOSE
 #ifndef USE_ESP_IDF_LOG
-#define log_v(format, ...)     log_printf(ARDUHAL_LOG_FORMAT(V, format), ##__VA_ARGS__)
+#define log_v(format, ...)     ARDUHAL_LOG_PRINTF(V, format, ##__VA_ARGS__)
 #define isr_log_v(format, ...) ets_printf(ARDUHAL_LOG_FORMAT(V, format), ##__VA_ARGS__)
 #define log_buf_v(b, l)          \
   do {                           \
@@ -129,7 +187,7 @@ void log_print_buf(const uint8_t *b, size_t len);
 
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_DEBUG
 #ifndef USE_ESP_IDF_LOG
-#define log_d(format, ...)     log_printf(ARDUHAL_LOG_FORMAT(D, format), ##__VA_ARGS__)
+#define log_d(format, ...)     ARDUHAL_LOG_PRINTF(D, format, ##__VA_ARGS__)
 #define isr_log_d(format, ...) ets_printf(ARDUHAL_LOG_FORMAT(D, format), ##__VA_ARGS__)
 #define log_buf_d(b, l)          \
   do {                           \
@@ -165,7 +223,7 @@ void log_print_buf(const uint8_t *b, size_t len);
 
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
 #ifndef USE_ESP_IDF_LOG
-#define log_i(format, ...)     log_printf(ARDUHAL_LOG_FORMAT(I, format), ##__VA_ARGS__)
+#define log_i(format, ...)     ARDUHAL_LOG_PRINTF(I, format, ##__VA_ARGS__)
 #define isr_log_i(format, ...) ets_printf(ARDUHAL_LOG_FORMAT(I, format), ##__VA_ARGS__)
 #define log_buf_i(b, l)          \
   do {                           \
@@ -201,7 +259,7 @@ void log_print_buf(const uint8_t *b, size_t len);
 
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_WARN
 #ifndef USE_ESP_IDF_LOG
-#define log_w(format, ...)     log_printf(ARDUHAL_LOG_FORMAT(W, format), ##__VA_ARGS__)
+#define log_w(format, ...)     ARDUHAL_LOG_PRINTF(W, format, ##__VA_ARGS__)
 #define isr_log_w(format, ...) ets_printf(ARDUHAL_LOG_FORMAT(W, format), ##__VA_ARGS__)
 #define log_buf_w(b, l)          \
   do {                           \
@@ -237,7 +295,7 @@ void log_print_buf(const uint8_t *b, size_t len);
 
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_ERROR
 #ifndef USE_ESP_IDF_LOG
-#define log_e(format, ...)     log_printf(ARDUHAL_LOG_FORMAT(E, format), ##__VA_ARGS__)
+#define log_e(format, ...)     ARDUHAL_LOG_PRINTF(E, format, ##__VA_ARGS__)
 #define isr_log_e(format, ...) ets_printf(ARDUHAL_LOG_FORMAT(E, format), ##__VA_ARGS__)
 #define log_buf_e(b, l)          \
   do {                           \
@@ -273,7 +331,7 @@ void log_print_buf(const uint8_t *b, size_t len);
 
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_NONE
 #ifndef USE_ESP_IDF_LOG
-#define log_n(format, ...)     log_printf(ARDUHAL_LOG_FORMAT(E, format), ##__VA_ARGS__)
+#define log_n(format, ...)     ARDUHAL_LOG_PRINTF(E, format, ##__VA_ARGS__)
 #define isr_log_n(format, ...) ets_printf(ARDUHAL_LOG_FORMAT(E, format), ##__VA_ARGS__)
 #define log_buf_n(b, l)          \
   do {                           \
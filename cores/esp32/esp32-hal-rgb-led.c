@@ -2,41 +2,190 @@
 
 #include "esp32-hal-rgb-led.h"
 
-void neopixelWrite(uint8_t pin, uint8_t red_val, uint8_t green_val, uint8_t blue_val) {
 #if SOC_RMT_SUPPORTED
-  rmt_data_t led_data[24];
+// WS2812 timings based on a 10MHz RMT tick (100ns)
+#define NEOPIXEL_RMT_FREQ 10000000
+static const rmt_data_t neopixel_bit0 = {{4, 1, 8, 0}};         // T0H 0.4us | T0L 0.8us
+static const rmt_data_t neopixel_bit1 = {{8, 1, 4, 0}};         // T1H 0.8us | T1L 0.4us
+static const rmt_data_t neopixel_reset = {{1500, 0, 1500, 0}};  // 300us LOW - latches the frame (WS2812B needs > 280us)
 
-  // Verify if the pin used is RGB_BUILTIN and fix GPIO number
+// Verify if the pin used is RGB_BUILTIN and fix GPIO number
+static uint8_t _neopixelPin(uint8_t pin) {
 #ifdef RGB_BUILTIN
   pin = pin == RGB_BUILTIN ? pin - SOC_GPIO_PIN_COUNT : pin;
 #endif
-  if (!rmtInit(pin, RMT_TX_MODE, RMT_MEM_NUM_BLOCKS_1, 10000000)) {
+  return pin;
+}
+
+static bool _neopixelInit(uint8_t pin, rmt_reserve_memsize_t memsize, bool reset_symbol) {
+  static const rmt_data_t no_reset = {0};
+  if (!rmtInit(pin, RMT_TX_MODE, memsize, NEOPIXEL_RMT_FREQ)) {
+    return false;
+  }
+  return rmtSetBytesEncoding(pin, neopixel_bit0, neopixel_bit1, reset_symbol ? neopixel_reset : no_reset, true);
+}
+
+/**
+   NeoPixel Strip: each strip holds two pixel buffers. The front buffer is read by the RMT
+   Bytes Encoder while the frame is sent, and the user draws into the back buffer.
+*/
+typedef struct {
+  uint8_t pin;              // GPIO number, as used by the RMT HAL
+  uint8_t bytes_per_pixel;  // 3 for GRB, 4 for GRBW
+  uint16_t num_pixels;      // number of pixels in the strip
+  uint8_t *buffer[2];       // pixel buffers in wire order (G, R, B [, W])
+  uint8_t back;             // index of the buffer the user draws into
+} neopixel_strip_t;
+
+#define NEOPIXEL_MAX_STRIPS SOC_RMT_TX_CANDIDATES_PER_GROUP
+static neopixel_strip_t *neopixel_strips[NEOPIXEL_MAX_STRIPS] = {NULL};
+
+static neopixel_strip_t *_neopixelStripGet(uint8_t pin, const char *labelFunc) {
+  for (int i = 0; i < NEOPIXEL_MAX_STRIPS; i++) {
+    if (neopixel_strips[i] != NULL && neopixel_strips[i]->pin == pin) {
+      return neopixel_strips[i];
+    }
+  }
+  log_e("==>%s():GPIO %u has no NeoPixel Strip attached.", labelFunc, pin);
+  return NULL;
+}
+#endif /* SOC_RMT_SUPPORTED */
+
+void neopixelWrite(uint8_t pin, uint8_t red_val, uint8_t green_val, uint8_t blue_val) {
+#if SOC_RMT_SUPPORTED
+  pin = _neopixelPin(pin);
+  if (!_neopixelInit(pin, RMT_MEM_NUM_BLOCKS_1, false)) {
     log_e("RGB LED driver initialization failed for GPIO%d!", pin);
     return;
   }
 
-  int color[] = {green_val, red_val, blue_val};  // Color coding is in order GREEN, RED, BLUE
-  int i = 0;
-  for (int col = 0; col < 3; col++) {
-    for (int bit = 0; bit < 8; bit++) {
-      if ((color[col] & (1 << (7 - bit)))) {
-        // HIGH bit
-        led_data[i].level0 = 1;     // T1H
-        led_data[i].duration0 = 8;  // 0.8us
-        led_data[i].level1 = 0;     // T1L
-        led_data[i].duration1 = 4;  // 0.4us
-      } else {
-        // LOW bit
-        led_data[i].level0 = 1;     // T0H
-        led_data[i].duration0 = 4;  // 0.4us
-        led_data[i].level1 = 0;     // T0L
-        led_data[i].duration1 = 8;  // 0.8us
-      }
-      i++;
+  // Color coding is in order GREEN, RED, BLUE - each bit is expanded by the RMT Bytes Encoder
+  uint8_t led_data[] = {green_val, red_val, blue_val};
+  rmtWriteBytes(pin, led_data, sizeof(led_data), RMT_WAIT_FOR_EVER);
+#else
+  log_e("RMT is not supported on " CONFIG_IDF_TARGET);
+#endif /* SOC_RMT_SUPPORTED */
+}
+
+bool neopixelStripBegin(uint8_t pin, uint16_t num_pixels, neopixel_strip_type_t type) {
+#if SOC_RMT_SUPPORTED
+  pin = _neopixelPin(pin);
+  if (num_pixels == 0) {
+    log_e("GPIO %d - NeoPixel Strip must have at least one pixel.", pin);
+    return false;
+  }
+  // releases any previous strip in this pin
+  neopixelStripEnd(pin);
+
+  int slot = -1;
+  for (int i = 0; i < NEOPIXEL_MAX_STRIPS; i++) {
+    if (neopixel_strips[i] == NULL) {
+      slot = i;
+      break;
     }
   }
-  rmtWrite(pin, led_data, RMT_SYMBOLS_OF(led_data), RMT_WAIT_FOR_EVER);
+  if (slot < 0) {
+    log_e("GPIO %d - No free NeoPixel Strip slot. Maximum is %d strips.", pin, NEOPIXEL_MAX_STRIPS);
+    return false;
+  }
+
+  neopixel_strip_t *strip = (neopixel_strip_t *)calloc(1, sizeof(neopixel_strip_t));
+  if (strip == NULL) {
+    log_e("GPIO %d - NeoPixel Strip Memory allocation fault.", pin);
+    return false;
+  }
+  strip->pin = pin;
+  strip->num_pixels = num_pixels;
+  strip->bytes_per_pixel = type == NEOPIXEL_STRIP_GRBW ? 4 : 3;
+  size_t buf_size = (size_t)num_pixels * strip->bytes_per_pixel;
+  // both buffers in a single allocation, all pixels OFF
+  strip->buffer[0] = (uint8_t *)calloc(2, buf_size);
+  if (strip->buffer[0] == NULL) {
+    log_e("GPIO %d - NeoPixel Strip Buffer allocation fault (%u bytes).", pin, 2 * buf_size);
+    free(strip);
+    return false;
+  }
+  strip->buffer[1] = strip->buffer[0] + buf_size;
+
+  if (!_neopixelInit(pin, RMT_MEM_NUM_BLOCKS_1, true)) {
+    log_e("GPIO %d - NeoPixel Strip RMT initialization failed.", pin);
+    free(strip->buffer[0]);
+    free(strip);
+    return false;
+  }
+  neopixel_strips[slot] = strip;
+  return true;
 #else
   log_e("RMT is not supported on " CONFIG_IDF_TARGET);
+  return false;
+#endif /* SOC_RMT_SUPPORTED */
+}
+
+void neopixelStripEnd(uint8_t pin) {
+#if SOC_RMT_SUPPORTED
+  pin = _neopixelPin(pin);
+  for (int i = 0; i < NEOPIXEL_MAX_STRIPS; i++) {
+    neopixel_strip_t *strip = neopixel_strips[i];
+    if (strip != NULL && strip->pin == pin) {
+      // the RMT driver may still be reading the front buffer
+      rmtWaitTransmitCompleted(pin, RMT_WAIT_FOR_EVER);
+      rmtDeinit(pin);
+      neopixel_strips[i] = NULL;
+      free(strip->buffer[0]);
+      free(strip);
+      return;
+    }
+  }
+#endif /* SOC_RMT_SUPPORTED */
+}
+
+uint8_t *neopixelStripGetBuffer(uint8_t pin) {
+#if SOC_RMT_SUPPORTED
+  neopixel_strip_t *strip = _neopixelStripGet(_neopixelPin(pin), __FUNCTION__);
+  return strip != NULL ? strip->buffer[strip->back] : NULL;
+#else
+  return NULL;
+#endif /* SOC_RMT_SUPPORTED */
+}
+
+bool neopixelStripSetPixel(uint8_t pin, uint16_t index, uint8_t red_val, uint8_t green_val, uint8_t blue_val, uint8_t white_val) {
+#if SOC_RMT_SUPPORTED
+  neopixel_strip_t *strip = _neopixelStripGet(_neopixelPin(pin), __FUNCTION__);
+  if (strip == NULL || index >= strip->num_pixels) {
+    return false;
+  }
+  uint8_t *px = strip->buffer[strip->back] + (size_t)index * strip->bytes_per_pixel;
+  px[0] = green_val;
+  px[1] = red_val;
+  px[2] = blue_val;
+  if (strip->bytes_per_pixel == 4) {
+    px[3] = white_val;
+  }
+  return true;
+#else
+  return false;
+#endif /* SOC_RMT_SUPPORTED */
+}
+
+bool neopixelStripShow(uint8_t pin, uint32_t timeout_ms) {
+#if SOC_RMT_SUPPORTED
+  pin = _neopixelPin(pin);
+  neopixel_strip_t *strip = _neopixelStripGet(pin, __FUNCTION__);
+  if (strip == NULL) {
+    return false;
+  }
+  // only waits when the previous frame is still being sent
+  if (!rmtWaitTransmitCompleted(pin, timeout_ms)) {
+    log_w("GPIO %d - NeoPixel Strip previous frame still pending.", pin);
+    return false;
+  }
+  size_t buf_size = (size_t)strip->num_pixels * strip->bytes_per_pixel;
+  uint8_t *front = strip->buffer[strip->back];
+  strip->back ^= 1;
+  // keeps the back buffer in sync, so that the next frame may change just a few pixels
+  memcpy(strip->buffer[strip->back], front, buf_size);
+  return rmtWriteBytesAsync(pin, front, buf_size);
+#else
+  return false;
 #endif /* SOC_RMT_SUPPORTED */
 }
@@ -11,8 +11,50 @@ extern "C" {
 #define RGB_BRIGHTNESS 64
 #endif
 
+typedef enum {
+  NEOPIXEL_STRIP_GRB = 0,   // WS2812 and alike - 3 bytes per pixel
+  NEOPIXEL_STRIP_GRBW = 1,  // SK6812 RGBW and alike - 4 bytes per pixel
+} neopixel_strip_type_t;
+
 void neopixelWrite(uint8_t pin, uint8_t red_val, uint8_t green_val, uint8_t blue_val);
 
+/**
+     NeoPixel Strip API - double buffered pixel frames sent by the RMT Bytes Encoder.
+     Memory used is 2 x <num_pixels> x 3 (GRB) or 4 (GRBW) bytes per strip, instead of 32 bytes
+     per color byte when each bit is stored as a rmt_data_t.
+     Each strip uses one RMT TX channel, thus many strips are sent in parallel.
+
+     neopixelStripBegin() allocates the pixel buffers and the RMT channel for <pin>.
+     Returns <true> on execution success, <false> otherwise.
+*/
+bool neopixelStripBegin(uint8_t pin, uint16_t num_pixels, neopixel_strip_type_t type);
+
+/**
+     Waits for any pending frame, then releases the RMT channel and the pixel buffers.
+*/
+void neopixelStripEnd(uint8_t pin);
+
+/**
+     Returns the back buffer, where the next frame is drawn, or NULL if the strip isn't initialized.
+     Pixels are in wire order: G, R, B (and W for GRBW strips). The pointer changes after each
+     neopixelStripShow() call.
+*/
+uint8_t *neopixelStripGetBuffer(uint8_t pin);
+
+/**
+     Sets a pixel in the back buffer. <white_val> is ignored for GRB strips.
+     Returns <true> on execution success, <false> otherwise.
+*/
+bool neopixelStripSetPixel(uint8_t pin, uint16_t index, uint8_t red_val, uint8_t green_val, uint8_t blue_val, uint8_t white_val);
+
+/**
+     Starts sending the back buffer and swaps the buffers. The new back buffer starts as a copy
+     of the frame being sent.
+     Non-Blocking mode - it only waits up to <timeout_ms> for the previous frame to finish.
+     Returns <true> on execution success, <false> otherwise, including when it exits by timeout.
+*/
+bool neopixelStripShow(uint8_t pin, uint32_t timeout_ms);
+
 #ifdef __cplusplus
 }
 #endif
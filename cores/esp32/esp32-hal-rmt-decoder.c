@@ -0,0 +1,297 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "soc/soc_caps.h"
+
+#if SOC_RMT_SUPPORTED
+#include <string.h>
+#include "esp32-hal-rmt-decoder.h"
+
+#define RMT_DECODER_DEFAULT_TOLERANCE 25  // percent
+
+// decoder->state common values
+#define RMT_DECODER_IDLE      0     // waiting for the start of a frame
+#define RMT_DECODER_SKIP      0xFF  // bad timing - waits for the end of the RMT frame
+
+// NEC timings in ns
+#define NEC_LEADER_MARK  9000000
+#define NEC_LEADER_SPACE 4500000
+#define NEC_REPEAT_SPACE 2250000
+#define NEC_BIT_MARK     560000
+#define NEC_ZERO_SPACE   560000
+#define NEC_ONE_SPACE    1690000
+#define NEC_BITS         32
+#define NEC_DATA         1  // decoder->state while receiving data bits
+
+// RC5 timings in ns
+#define RC5_HALF_BIT 889000
+#define RC5_BITS     14
+// decoder->state while receiving a RC5 frame: the pending half bit, if any
+#define RC5_HALF_NONE  1
+#define RC5_HALF_MARK  2
+#define RC5_HALF_SPACE 3
+
+// WS28XX timings in ns
+#define WS28XX_BIT_THRESHOLD 525    // T0H is up to 500ns and T1H is at least 550ns
+#define WS28XX_RESET_LOW     50000  // LOW for longer than this ends a frame
+#define WS28XX_BITS          24
+
+static inline uint32_t _ticksToNs(const rmt_decoder_t *decoder, uint32_t ticks) {
+  return ticks * decoder->tick_ns;
+}
+
+static inline bool _isEndOfFrame(rmt_data_t symbol) {
+  return symbol.duration0 == 0 || symbol.duration1 == 0;
+}
+
+bool rmtDecoderMatch(const rmt_decoder_t *decoder, uint32_t ticks, uint32_t expected_ns) {
+  uint32_t ns = _ticksToNs(decoder, ticks);
+  uint32_t delta = expected_ns / 100 * decoder->tolerance;
+  return ns + delta >= expected_ns && ns <= expected_ns + delta;
+}
+
+/**
+   NEC
+*/
+static void _necFrame(uint32_t bits, bool repeat, rmt_frame_t *frame) {
+  memset(frame, 0, sizeof(rmt_frame_t));
+  frame->protocol = RMT_PROTOCOL_NEC;
+  frame->repeat = repeat;
+  frame->num_bits = NEC_BITS;
+  frame->data = bits;
+  // Extended NEC uses 16 bits address, without the inverted copy
+  uint8_t addr = bits & 0xFF, addr_inv = (bits >> 8) & 0xFF;
+  frame->address = (addr ^ addr_inv) == 0xFF ? addr : bits & 0xFFFF;
+  uint8_t cmd = (bits >> 16) & 0xFF, cmd_inv = (bits >> 24) & 0xFF;
+  frame->command = (cmd ^ cmd_inv) == 0xFF ? cmd : bits >> 16;
+}
+
+static bool _necFeed(rmt_decoder_t *decoder, rmt_data_t symbol, rmt_frame_t *frame) {
+  bool done = false;
+  switch (decoder->state) {
+    case RMT_DECODER_IDLE:
+      if (!rmtDecoderMatch(decoder, symbol.duration0, NEC_LEADER_MARK)) {
+        break;  // the stop bit or noise
+      }
+      if (rmtDecoderMatch(decoder, symbol.duration1, NEC_LEADER_SPACE)) {
+        decoder->state = NEC_DATA;
+        decoder->bits = 0;
+        decoder->num_bits = 0;
+      } else if (rmtDecoderMatch(decoder, symbol.duration1, NEC_REPEAT_SPACE)) {
+        // repeats the last code, if any
+        bool valid = decoder->num_bits == NEC_BITS;
+        _necFrame(valid ? decoder->bits : 0, true, frame);
+        frame->num_bits = valid ? NEC_BITS : 0;  // zero when there is no valid code to repeat
+        done = true;
+      }
+      break;
+
+    case NEC_DATA:
+      if (!rmtDecoderMatch(decoder, symbol.duration0, NEC_BIT_MARK)) {
+        decoder->state = RMT_DECODER_SKIP;
+        break;
+      }
+      if (rmtDecoderMatch(decoder, symbol.duration1, NEC_ONE_SPACE)) {
+        decoder->bits |= 1UL << decoder->num_bits;  // LSB first
+      } else if (!rmtDecoderMatch(decoder, symbol.duration1, NEC_ZERO_SPACE)) {
+        decoder->state = RMT_DECODER_SKIP;
+        break;
+      }
+      if (++decoder->num_bits == NEC_BITS) {
+        _necFrame(decoder->bits, false, frame);
+        decoder->state = RMT_DECODER_IDLE;  // keeps bits for repeat codes
+        done = true;
+      }
+      break;
+  }
+  if (decoder->state == RMT_DECODER_SKIP) {
+    decoder->num_bits = 0;  // invalidates repeat codes
+  }
+  if (_isEndOfFrame(symbol) && decoder->state != RMT_DECODER_IDLE) {
+    decoder->state = RMT_DECODER_IDLE;
+    decoder->num_bits = 0;
+  }
+  return done;
+}
+
+/**
+   RC5 - Manchester coded, MSB first. Bit "1" is space + mark, bit "0" is mark + space.
+   The first half of the start bit is a space, thus the RMT frame starts in the middle of it.
+*/
+static int _rc5HalfBits(const rmt_decoder_t *decoder, uint32_t ticks) {
+  if (rmtDecoderMatch(decoder, ticks, RC5_HALF_BIT)) {
+    return 1;
+  }
+  if (rmtDecoderMatch(decoder, ticks, 2 * RC5_HALF_BIT)) {
+    return 2;
+  }
+  return -1;
+}
+
+// returns <true> when the frame is complete
+static bool _rc5PushHalf(rmt_decoder_t *decoder, bool mark) {
+  if (decoder->state == RC5_HALF_NONE) {
+    decoder->state = mark ? RC5_HALF_MARK : RC5_HALF_SPACE;
+    return false;
+  }
+  if ((decoder->state == RC5_HALF_MARK) == mark) {
+    decoder->state = RMT_DECODER_SKIP;  // a bit must have a transition in its middle
+    return false;
+  }
+  decoder->bits = (decoder->bits << 1) | (mark ? 1 : 0);
+  decoder->state = RC5_HALF_NONE;
+  return ++decoder->num_bits == RC5_BITS;
+}
+
+static void _rc5Frame(const rmt_decoder_t *decoder, rmt_frame_t *frame) {
+  uint32_t bits = decoder->bits;
+  memset(frame, 0, sizeof(rmt_frame_t));
+  frame->protocol = RMT_PROTOCOL_RC5;
+  frame->num_bits = RC5_BITS;
+  frame->data = bits;
+  frame->repeat = (bits >> 11) & 1;  // toggle bit
+  frame->address = (bits >> 6) & 0x1F;
+  // the field bit is the inverted command bit 6 (RC5X)
+  frame->command = (bits & 0x3F) | ((~bits >> 12) & 1) << 6;
+}
+
+static bool _rc5Feed(rmt_decoder_t *decoder, rmt_data_t symbol, rmt_frame_t *frame) {
+  bool done = false;
+  if (decoder->state == RMT_DECODER_IDLE) {
+    decoder->bits = 0;
+    decoder->num_bits = 0;
+    decoder->state = RC5_HALF_SPACE;  // first half of the start bit
+  }
+  if (decoder->state != RMT_DECODER_SKIP) {
+    int marks = _rc5HalfBits(decoder, symbol.duration0);
+    int spaces = symbol.duration1 == 0 ? 0 : _rc5HalfBits(decoder, symbol.duration1);
+    if (marks < 0 || spaces < 0) {
+      decoder->state = RMT_DECODER_SKIP;
+    }
+    for (int i = 0; i < marks && !done && decoder->state != RMT_DECODER_SKIP; i++) {
+      done = _rc5PushHalf(decoder, true);
+    }
+    for (int i = 0; i < spaces && !done && decoder->state != RMT_DECODER_SKIP; i++) {
+      done = _rc5PushHalf(decoder, false);
+    }
+    // a frame ending with bit "0" has its last half space merged into the idle time
+    if (!done && symbol.duration1 == 0 && decoder->state == RC5_HALF_MARK && decoder->num_bits == RC5_BITS - 1) {
+      done = _rc5PushHalf(decoder, false);
+    }
+  }
+  if (done) {
+    _rc5Frame(decoder, frame);
+    decoder->state = _isEndOfFrame(symbol) ? RMT_DECODER_IDLE : RMT_DECODER_SKIP;
+  } else if (_isEndOfFrame(symbol)) {
+    decoder->state = RMT_DECODER_IDLE;
+  }
+  return done;
+}
+
+/**
+   WS28XX - the HIGH time defines each bit, MSB first, 24 bits per pixel
+*/
+static bool _ws28xxFeed(rmt_decoder_t *decoder, rmt_data_t symbol, rmt_frame_t *frame) {
+  uint32_t high_ticks = symbol.level0 ? symbol.duration0 : symbol.duration1;
+  uint32_t low_ticks = symbol.level0 ? symbol.duration1 : symbol.duration0;
+  bool done = false;
+
+  if (high_ticks != 0) {
+    decoder->bits = (decoder->bits << 1) | (_ticksToNs(decoder, high_ticks) > WS28XX_BIT_THRESHOLD ? 1 : 0);
+    if (++decoder->num_bits == WS28XX_BITS) {
+      memset(frame, 0, sizeof(rmt_frame_t));
+      frame->protocol = RMT_PROTOCOL_WS28XX;
+      frame->num_bits = WS28XX_BITS;
+      frame->data = decoder->bits & 0xFFFFFF;
+      decoder->bits = 0;
+      decoder->num_bits = 0;
+      done = true;
+    }
+  }
+  // the reset (latch) time or the end of the RMT frame drops any partial pixel
+  if (_isEndOfFrame(symbol) || _ticksToNs(decoder, low_ticks) >= WS28XX_RESET_LOW) {
+    decoder->bits = 0;
+    decoder->num_bits = 0;
+  }
+  return done;
+}
+
+/**
+   PULSE - reports each RMT Symbol as HIGH and LOW times
+*/
+static bool _pulseFeed(rmt_decoder_t *decoder, rmt_data_t symbol, rmt_frame_t *frame) {
+  if (symbol.duration0 == 0 && symbol.duration1 == 0) {
+    return false;
+  }
+  memset(frame, 0, sizeof(rmt_frame_t));
+  frame->protocol = RMT_PROTOCOL_PULSE;
+  frame->high_ns = _ticksToNs(decoder, symbol.level0 ? symbol.duration0 : symbol.duration1);
+  frame->low_ns = _ticksToNs(decoder, symbol.level0 ? symbol.duration1 : symbol.duration0);
+  return true;
+}
+
+static bool _rmtDecoderSetup(rmt_decoder_t *decoder, rmt_protocol_t protocol, rmt_decoder_feed_cb_t feed, uint32_t frequency_Hz, void *user_data) {
+  if (decoder == NULL || feed == NULL || frequency_Hz == 0 || frequency_Hz > 1000000000) {
+    return false;
+  }
+  memset(decoder, 0, sizeof(rmt_decoder_t));
+  decoder->protocol = protocol;
+  decoder->feed = feed;
+  decoder->tick_ns = 1000000000 / frequency_Hz;
+  decoder->tolerance = RMT_DECODER_DEFAULT_TOLERANCE;
+  decoder->user_data = user_data;
+  return true;
+}
+
+bool rmtDecoderInit(rmt_decoder_t *decoder, rmt_protocol_t protocol, uint32_t frequency_Hz) {
+  rmt_decoder_feed_cb_t feed = NULL;
+  switch (protocol) {
+    case RMT_PROTOCOL_NEC:    feed = _necFeed; break;
+    case RMT_PROTOCOL_RC5:    feed = _rc5Feed; break;
+    case RMT_PROTOCOL_WS28XX: feed = _ws28xxFeed; break;
+    case RMT_PROTOCOL_PULSE:  feed = _pulseFeed; break;
+    default:                  break;
+  }
+  return _rmtDecoderSetup(decoder, protocol, feed, frequency_Hz, NULL);
+}
+
+bool rmtDecoderInitCustom(rmt_decoder_t *decoder, rmt_decoder_feed_cb_t feed, uint32_t frequency_Hz, void *user_data) {
+  return _rmtDecoderSetup(decoder, RMT_PROTOCOL_CUSTOM, feed, frequency_Hz, user_data);
+}
+
+void rmtDecoderReset(rmt_decoder_t *decoder) {
+  decoder->bits = 0;
+  decoder->num_bits = 0;
+  decoder->state = RMT_DECODER_IDLE;
+}
+
+bool rmtDecoderFeed(rmt_decoder_t *decoder, rmt_data_t symbol, rmt_frame_t *frame) {
+  return decoder->feed(decoder, symbol, frame);
+}
+
+size_t rmtDecode(rmt_decoder_t *decoder, const rmt_data_t *data, size_t num_rmt_symbols, rmt_frame_t *frames, size_t max_frames, size_t *consumed) {
+  size_t num_frames = 0;
+  size_t i = 0;
+  while (i < num_rmt_symbols && num_frames < max_frames) {
+    if (decoder->feed(decoder, data[i++], &frames[num_frames])) {
+      num_frames++;
+    }
+  }
+  if (consumed != NULL) {
+    *consumed = i;
+  }
+  return num_frames;
+}
+
+#endif /* SOC_RMT_SUPPORTED */
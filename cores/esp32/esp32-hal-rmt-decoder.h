@@ -0,0 +1,116 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MAIN_ESP32_HAL_RMT_DECODER_H_
+#define MAIN_ESP32_HAL_RMT_DECODER_H_
+
+#include "soc/soc_caps.h"
+#if SOC_RMT_SUPPORTED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp32-hal-rmt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+   RMT Symbol decoders turn received RMT Symbols into protocol frames, one symbol at a time,
+   thus a frame may be split across many rmtRead() or rmtReadContinuousFrame() buffers.
+
+   IR decoders only look at durations: the first half of each symbol is taken as the mark
+   (carrier on) and the second half as the space, whatever the input polarity is.
+   An RMT Symbol with a zero duration ends the frame, as set by the RMT RX driver.
+*/
+
+typedef enum {
+  RMT_PROTOCOL_NEC = 0,     // NEC and Extended NEC IR - 32 bits LSB first and repeat codes
+  RMT_PROTOCOL_RC5 = 1,     // Philips RC5 IR - 14 bits Manchester coded
+  RMT_PROTOCOL_WS28XX = 2,  // WS2812 and alike data line echo - 24 bits per pixel
+  RMT_PROTOCOL_PULSE = 3,   // pulse width measurement - one frame per RMT Symbol
+  RMT_PROTOCOL_CUSTOM = 4,  // user decoder
+} rmt_protocol_t;
+
+typedef struct {
+  rmt_protocol_t protocol;
+  uint8_t num_bits;  // number of bits in <data>
+  bool repeat;       // NEC repeat code | RC5 toggle bit
+  uint16_t address;  // NEC (8 or 16 bits) | RC5 (5 bits)
+  uint16_t command;  // NEC (8 bits) | RC5 (6 bits + field bit as bit 6)
+  uint32_t data;     // raw bits as received | WS28XX 0xGGRRBB pixel
+  uint32_t high_ns;  // PULSE: time at HIGH level in nanoseconds
+  uint32_t low_ns;   // PULSE: time at LOW level in nanoseconds
+} rmt_frame_t;
+
+typedef struct rmt_decoder_s rmt_decoder_t;
+
+// Protocol decoder plug-in: returns <true> when <frame> has been filled with a complete frame
+typedef bool (*rmt_decoder_feed_cb_t)(rmt_decoder_t *decoder, rmt_data_t symbol, rmt_frame_t *frame);
+
+struct rmt_decoder_s {
+  rmt_protocol_t protocol;
+  rmt_decoder_feed_cb_t feed;  // protocol decoder
+  uint32_t tick_ns;            // RMT tick period, from the RMT channel frequency
+  uint32_t tolerance;          // timing tolerance in percent - default is 25%
+  // decoder state
+  uint32_t bits;     // bits decoded so far
+  uint8_t num_bits;  // number of bits decoded so far
+  uint8_t state;     // protocol dependent state
+  void *user_data;   // free for RMT_PROTOCOL_CUSTOM decoders
+};
+
+/**
+     Initializes <decoder> for one of the built-in protocols.
+     <frequency_Hz> is the RMT channel frequency used in rmtInit(), so that ticks are converted to time.
+     Returns <true> on execution success, <false> otherwise.
+*/
+bool rmtDecoderInit(rmt_decoder_t *decoder, rmt_protocol_t protocol, uint32_t frequency_Hz);
+
+/**
+     Initializes <decoder> with a user protocol decoder. <user_data> is available in decoder->user_data.
+     Returns <true> on execution success, <false> otherwise.
+*/
+bool rmtDecoderInitCustom(rmt_decoder_t *decoder, rmt_decoder_feed_cb_t feed, uint32_t frequency_Hz, void *user_data);
+
+/**
+     Drops any partially decoded frame.
+*/
+void rmtDecoderReset(rmt_decoder_t *decoder);
+
+/**
+     Feeds one RMT Symbol. Returns <true> when a complete frame has been decoded into <frame>.
+*/
+bool rmtDecoderFeed(rmt_decoder_t *decoder, rmt_data_t symbol, rmt_frame_t *frame);
+
+/**
+     Feeds <num_rmt_symbols> RMT Symbols and stores up to <max_frames> decoded frames in <frames>.
+     Decoding stops when <frames> is full. <*consumed>, when not NULL, returns the number of RMT
+     Symbols used, so that the remaining ones can be fed later.
+     Returns the number of decoded frames.
+*/
+size_t rmtDecode(rmt_decoder_t *decoder, const rmt_data_t *data, size_t num_rmt_symbols, rmt_frame_t *frames, size_t max_frames, size_t *consumed);
+
+/**
+     Helper for custom decoders: returns <true> when <ticks> matches <expected_ns> within the decoder tolerance.
+*/
+bool rmtDecoderMatch(const rmt_decoder_t *decoder, uint32_t ticks, uint32_t expected_ns);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SOC_RMT_SUPPORTED */
+#endif /* MAIN_ESP32_HAL_RMT_DECODER_H_ */
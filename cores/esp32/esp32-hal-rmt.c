@@ -52,17 +52,19 @@ extern TaskHandle_t loopTaskHandle;
 
 struct rmt_obj_s {
   // general RMT information
-  rmt_channel_handle_t rmt_channel_h;       // IDF RMT channel handler
-  rmt_encoder_handle_t rmt_copy_encoder_h;  // RMT simple copy encoder handle
+  rmt_channel_handle_t rmt_channel_h;        // IDF RMT channel handler
+  rmt_encoder_handle_t rmt_copy_encoder_h;   // RMT simple copy encoder handle
+  rmt_encoder_handle_t rmt_bytes_encoder_h;  // RMT bytes encoder handle - created by rmtSetBytesEncoding()
 
   uint32_t signal_range_min_ns;  // RX Filter data - Low Pass pulse width
   uint32_t signal_range_max_ns;  // RX idle time that defines end of reading
 
-  EventGroupHandle_t rmt_events;  // read/write done event RMT callback handle
-  bool rmt_ch_is_looping;         // Is this RMT TX Channel in LOOPING MODE?
-  size_t *num_symbols_read;       // Pointer to the number of RMT symbol read by IDF RMT RX Done
-  uint32_t frequency_Hz;          // RMT Frequency
-  uint8_t rmt_EOT_Level;          // RMT End of Transmission Level - default is LOW
+  EventGroupHandle_t rmt_events;      // read/write done event RMT callback handle
+  struct rmt_rx_stream_s *rx_stream;  // Continuous Reading ring of buffers - NULL when not in use
+  bool rmt_ch_is_looping;             // Is this RMT TX Channel in LOOPING MODE?
+  size_t *num_symbols_read;           // Pointer to the number of RMT symbol read by IDF RMT RX Done
+  uint32_t frequency_Hz;              // RMT Frequency
+  uint8_t rmt_EOT_Level;              // RMT End of Transmission Level - default is LOW
 
 #if !CONFIG_DISABLE_HAL_LOCKS
   SemaphoreHandle_t g_rmt_objlocks;  // Channel Semaphore Lock
@@ -71,6 +73,33 @@ struct rmt_obj_s {
 
 typedef struct rmt_obj_s *rmt_bus_handle_t;
 
+// Bytes Encoder: expands each data bit into a bit0/bit1 RMT symbol on the fly (in the RMT ISR)
+// and optionally appends a reset symbol at the end of the frame (WS2812 latch, for instance)
+typedef struct {
+  rmt_encoder_t base;                  // IDF encoder interface - must be the first field
+  rmt_encoder_handle_t bytes_encoder;  // IDF bytes encoder - bit0/bit1 expansion
+  rmt_encoder_handle_t copy_encoder;   // IDF copy encoder - end of frame reset symbol
+  rmt_symbol_word_t reset_symbol;      // reset symbol sent after all bytes - zero means no reset symbol
+  int state;                           // 0 = encoding bytes, 1 = encoding the reset symbol
+} rmt_bytes_encoder_t;
+
+// Continuous Reading: a ring of symbol buffers. The RX done ISR hands the filled buffer to the user
+// and a small task re-arms the channel with the next free buffer (rmt_receive() is not ISR safe in IDF 5.1)
+#define RMT_RX_STREAM_TASK_STACK    2048
+#define RMT_RX_STREAM_TASK_PRIORITY (configMAX_PRIORITIES - 2)
+
+struct rmt_rx_stream_s {
+  rmt_data_t *buffers;         // <num_buffers> x <buffer_symbols> RMT Symbols
+  size_t *num_symbols;         // number of RMT Symbols received in each buffer
+  size_t buffer_symbols;       // size of each buffer in RMT Symbols
+  uint8_t num_buffers;         // number of buffers in the ring
+  int armed;                   // buffer index being filled by the RMT channel, -1 when none
+  QueueHandle_t free_queue;    // buffer indexes ready to be filled
+  QueueHandle_t frame_queue;   // buffer indexes holding received frames, in arrival order
+  TaskHandle_t task;           // re-arms the RMT channel after each frame
+  volatile uint32_t overruns;  // frames dropped because the user didn't release the buffers on time
+};
+
 /**
    Internal variables used in RMT API
 */
@@ -84,6 +113,18 @@ static SemaphoreHandle_t g_rmt_block_lock = NULL;
 static bool _rmt_rx_done_callback(rmt_channel_handle_t channel, const rmt_rx_done_event_data_t *data, void *args) {
   BaseType_t high_task_wakeup = pdFALSE;
   rmt_bus_handle_t bus = (rmt_bus_handle_t)args;
+  struct rmt_rx_stream_s *stream = bus->rx_stream;
+  if (stream != NULL) {
+    // Continuous Reading: delivers the frame and wakes up the task that re-arms the channel
+    int index = stream->armed;
+    stream->armed = -1;
+    if (index >= 0) {
+      stream->num_symbols[index] = data->num_symbols;
+      xQueueSendFromISR(stream->frame_queue, &index, &high_task_wakeup);
+    }
+    vTaskNotifyGiveFromISR(stream->task, &high_task_wakeup);
+    return high_task_wakeup == pdTRUE;
+  }
   // sets the returning number of RMT symbols (32 bits) effectively read
   *bus->num_symbols_read = data->num_symbols;
   // set RX event group and signal the received RMT symbols of that channel
@@ -131,6 +172,137 @@ static rmt_bus_handle_t _rmtGetBus(int pin, const char *labelFunc) {
   return (rmt_bus_handle_t)perimanGetPinBus(pin, rmt_bus_type);
 }
 
+// This is called from an IDF ISR code, therefore this code is part of an ISR
+static size_t _rmt_bytes_encode(rmt_encoder_t *encoder, rmt_channel_handle_t channel, const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state) {
+  rmt_bytes_encoder_t *enc = __containerof(encoder, rmt_bytes_encoder_t, base);
+  rmt_encode_state_t session_state = RMT_ENCODING_RESET;
+  rmt_encode_state_t state = RMT_ENCODING_RESET;
+  size_t encoded_symbols = 0;
+
+  switch (enc->state) {
+    case 0:  // data bytes
+      encoded_symbols += enc->bytes_encoder->encode(enc->bytes_encoder, channel, primary_data, data_size, &session_state);
+      if (session_state & RMT_ENCODING_COMPLETE) {
+        if (enc->reset_symbol.val == 0) {
+          // no reset symbol, the frame is done
+          state |= RMT_ENCODING_COMPLETE;
+          break;
+        }
+        enc->state = 1;
+      }
+      if (session_state & RMT_ENCODING_MEM_FULL) {
+        state |= RMT_ENCODING_MEM_FULL;
+        break;  // yields until the RMT ISR frees some channel memory
+      }
+      // fall through
+    case 1:  // reset symbol
+      encoded_symbols += enc->copy_encoder->encode(enc->copy_encoder, channel, &enc->reset_symbol, sizeof(enc->reset_symbol), &session_state);
+      if (session_state & RMT_ENCODING_COMPLETE) {
+        enc->state = 0;
+        state |= RMT_ENCODING_COMPLETE;
+      }
+      if (session_state & RMT_ENCODING_MEM_FULL) {
+        state |= RMT_ENCODING_MEM_FULL;
+      }
+      break;
+  }
+  *ret_state = state;
+  return encoded_symbols;
+}
+
+static esp_err_t _rmt_bytes_encoder_reset(rmt_encoder_t *encoder) {
+  rmt_bytes_encoder_t *enc = __containerof(encoder, rmt_bytes_encoder_t, base);
+  rmt_encoder_reset(enc->bytes_encoder);
+  rmt_encoder_reset(enc->copy_encoder);
+  enc->state = 0;
+  return ESP_OK;
+}
+
+static esp_err_t _rmt_bytes_encoder_del(rmt_encoder_t *encoder) {
+  rmt_bytes_encoder_t *enc = __containerof(encoder, rmt_bytes_encoder_t, base);
+  if (enc->bytes_encoder != NULL) {
+    rmt_del_encoder(enc->bytes_encoder);
+  }
+  if (enc->copy_encoder != NULL) {
+    rmt_del_encoder(enc->copy_encoder);
+  }
+  free(enc);
+  return ESP_OK;
+}
+
+static rmt_encoder_handle_t _rmtNewBytesEncoder(rmt_data_t bit0, rmt_data_t bit1, rmt_data_t reset_symbol, bool msb_first) {
+  rmt_bytes_encoder_t *enc = (rmt_bytes_encoder_t *)heap_caps_calloc(1, sizeof(rmt_bytes_encoder_t), MALLOC_CAP_DEFAULT);
+  if (enc == NULL) {
+    return NULL;
+  }
+  enc->base.encode = _rmt_bytes_encode;
+  enc->base.reset = _rmt_bytes_encoder_reset;
+  enc->base.del = _rmt_bytes_encoder_del;
+  enc->reset_symbol.val = reset_symbol.val;
+
+  rmt_bytes_encoder_config_t bytes_cfg = {0};
+  bytes_cfg.bit0.val = bit0.val;
+  bytes_cfg.bit1.val = bit1.val;
+  bytes_cfg.flags.msb_first = msb_first;
+  rmt_copy_encoder_config_t copy_cfg = {};
+  if (rmt_new_bytes_encoder(&bytes_cfg, &enc->bytes_encoder) != ESP_OK || rmt_new_copy_encoder(&copy_cfg, &enc->copy_encoder) != ESP_OK) {
+    _rmt_bytes_encoder_del(&enc->base);
+    return NULL;
+  }
+  return &enc->base;
+}
+
+static void _rmtRxStreamTask(void *args) {
+  rmt_bus_handle_t bus = (rmt_bus_handle_t)args;
+  struct rmt_rx_stream_s *stream = bus->rx_stream;
+  rmt_receive_config_t receive_config;
+  int index;
+
+  for (;;) {
+    // gets a free buffer or, when the user holds all of them, drops the oldest received frame
+    if (xQueueReceive(stream->free_queue, &index, 0) != pdTRUE) {
+      if (xQueueReceive(stream->frame_queue, &index, 0) == pdTRUE) {
+        stream->overruns++;
+      } else {
+        // all buffers are held by the user - waits for one to be released
+        xQueueReceive(stream->free_queue, &index, portMAX_DELAY);
+      }
+    }
+    receive_config.signal_range_min_ns = bus->signal_range_min_ns;
+    receive_config.signal_range_max_ns = bus->signal_range_max_ns;
+    stream->armed = index;
+    if (ESP_OK != rmt_receive(bus->rmt_channel_h, stream->buffers + index * stream->buffer_symbols, stream->buffer_symbols * sizeof(rmt_data_t), &receive_config)) {
+      log_e("RMT Continuous Reading failed to start receiving.");
+      stream->armed = -1;
+      xQueueSend(stream->free_queue, &index, 0);
+      vTaskSuspend(NULL);  // until rmtReadContinuousStop() or rmtDeinit() deletes it
+    }
+    // waits for the RX done ISR
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+}
+
+// It must be called only when the RMT channel is disabled, thus the ISR won't use the stream anymore
+static void _rmtRxStreamFree(rmt_bus_handle_t bus) {
+  struct rmt_rx_stream_s *stream = bus->rx_stream;
+  if (stream == NULL) {
+    return;
+  }
+  bus->rx_stream = NULL;
+  if (stream->task != NULL) {
+    vTaskDelete(stream->task);
+  }
+  if (stream->frame_queue != NULL) {
+    vQueueDelete(stream->frame_queue);
+  }
+  if (stream->free_queue != NULL) {
+    vQueueDelete(stream->free_queue);
+  }
+  free(stream->num_symbols);
+  free(stream->buffers);
+  free(stream);
+}
+
 // Peripheral Manager detach callback
 static bool _rmtDetachBus(void *busptr) {
   // sanity check - it should never happen
@@ -155,10 +327,17 @@ static bool _rmtDetachBus(void *busptr) {
       retCode = false;
     }
   }
+  if (bus->rmt_bytes_encoder_h != NULL) {
+    if (ESP_OK != rmt_del_encoder(bus->rmt_bytes_encoder_h)) {
+      log_w("RMT Bytes Encoder Deletion has failed.");
+      retCode = false;
+    }
+  }
   // disable and deallocate RMT channel
   if (bus->rmt_channel_h != NULL) {
     // force stopping rmt TX/RX processing and unlock Power Management (APB Freq)
     rmt_disable(bus->rmt_channel_h);
+    _rmtRxStreamFree(bus);
     if (ESP_OK != rmt_del_channel(bus->rmt_channel_h)) {
       log_w("RMT Channel Deletion has failed.");
       retCode = false;
@@ -283,7 +462,8 @@ bool rmtDeinit(int pin) {
   return false;
 }
 
-static bool _rmtWrite(int pin, rmt_data_t *data, size_t num_rmt_symbols, bool blocking, bool loop, uint32_t timeout_ms) {
+// <data_size> is in bytes. <bytes_encoder> selects the Bytes Encoder (rmtWriteBytes) instead of the Copy Encoder
+static bool _rmtWrite(int pin, const void *data, size_t data_size, bool bytes_encoder, bool blocking, bool loop, uint32_t timeout_ms) {
   rmt_bus_handle_t bus = _rmtGetBus(pin, __FUNCTION__);
   if (bus == NULL) {
     return false;
@@ -291,8 +471,13 @@ static bool _rmtWrite(int pin, rmt_data_t *data, size_t num_rmt_symbols, bool bl
   if (!_rmtCheckDirection(pin, RMT_TX_MODE, __FUNCTION__)) {
     return false;
   }
+  rmt_encoder_handle_t encoder = bytes_encoder ? bus->rmt_bytes_encoder_h : bus->rmt_copy_encoder_h;
+  if (encoder == NULL) {
+    log_w("GPIO %d - RMT Bytes Encoding not set. Call rmtSetBytesEncoding() first.", pin);
+    return false;
+  }
   bool loopCancel = false;  // user wants to cancel the writing loop mode
-  if (data == NULL || num_rmt_symbols == 0) {
+  if (data == NULL || data_size == 0) {
     if (!loop) {
       log_w("GPIO %d - RMT Write Data NULL pointer or size is zero.", pin);
       return false;
@@ -301,7 +486,10 @@ static bool _rmtWrite(int pin, rmt_data_t *data, size_t num_rmt_symbols, bool bl
     }
   }
 
-  log_v("GPIO: %d - Request: %d RMT Symbols - %s - Timeout: %d", pin, num_rmt_symbols, blocking ? "Blocking" : "Non-Blocking", timeout_ms);
+  log_v(
+    "GPIO: %d - Request: %d %s - %s - Timeout: %d", pin, bytes_encoder ? data_size : data_size / sizeof(rmt_data_t), bytes_encoder ? "Bytes" : "RMT Symbols",
+    blocking ? "Blocking" : "Non-Blocking", timeout_ms
+  );
   log_v(
     "GPIO: %d - Currently in Loop Mode: [%s] | Asked to Loop: %s, LoopCancel: %s", pin, bus->rmt_ch_is_looping ? "YES" : "NO", loop ? "YES" : "NO",
     loopCancel ? "YES" : "NO"
@@ -341,7 +529,7 @@ static bool _rmtWrite(int pin, rmt_data_t *data, size_t num_rmt_symbols, bool bl
       xEventGroupClearBits(bus->rmt_events, RMT_FLAG_TX_DONE);
     }
     // transmits just once or looping data
-    if (ESP_OK != rmt_transmit(bus->rmt_channel_h, bus->rmt_copy_encoder_h, (const void *)data, num_rmt_symbols * sizeof(rmt_data_t), &transmit_cfg)) {
+    if (ESP_OK != rmt_transmit(bus->rmt_channel_h, encoder, data, data_size, &transmit_cfg)) {
       retCode = false;
       log_w("GPIO %d - RMT Transmission failed.", pin);
     } else {  // transmit OK
@@ -373,6 +561,10 @@ static bool _rmtRead(int pin, rmt_data_t *data, size_t *num_rmt_symbols, bool wa
     log_w("GPIO %d - RMT Read Data and/or Size NULL pointer.", pin);
     return false;
   }
+  if (bus->rx_stream != NULL) {
+    log_w("GPIO %d - RMT Continuous Reading is running. Use rmtReadContinuousFrame() instead.", pin);
+    return false;
+  }
   log_v("GPIO: %d - Request: %d RMT Symbols - %s - Timeout: %d", pin, *num_rmt_symbols, waitForData ? "Blocking" : "Non-Blocking", timeout_ms);
   bool retCode = true;
   RMT_MUTEX_LOCK(bus);
@@ -398,15 +590,51 @@ static bool _rmtRead(int pin, rmt_data_t *data, size_t *num_rmt_symbols, bool wa
 }
 
 bool rmtWrite(int pin, rmt_data_t *data, size_t num_rmt_symbols, uint32_t timeout_ms) {
-  return _rmtWrite(pin, data, num_rmt_symbols, true /*blocks*/, false /*looping*/, timeout_ms);
+  return _rmtWrite(pin, data, num_rmt_symbols * sizeof(rmt_data_t), false /*copy encoder*/, true /*blocks*/, false /*looping*/, timeout_ms);
 }
 
 bool rmtWriteAsync(int pin, rmt_data_t *data, size_t num_rmt_symbols) {
-  return _rmtWrite(pin, data, num_rmt_symbols, false /*blocks*/, false /*looping*/, 0 /*N/A*/);
+  return _rmtWrite(pin, data, num_rmt_symbols * sizeof(rmt_data_t), false /*copy encoder*/, false /*blocks*/, false /*looping*/, 0 /*N/A*/);
 }
 
 bool rmtWriteLooping(int pin, rmt_data_t *data, size_t num_rmt_symbols) {
-  return _rmtWrite(pin, data, num_rmt_symbols, false /*blocks*/, true /*looping*/, 0 /*N/A*/);
+  return _rmtWrite(pin, data, num_rmt_symbols * sizeof(rmt_data_t), false /*copy encoder*/, false /*blocks*/, true /*looping*/, 0 /*N/A*/);
+}
+
+bool rmtSetBytesEncoding(int pin, rmt_data_t bit0, rmt_data_t bit1, rmt_data_t reset_symbol, bool msb_first) {
+  rmt_bus_handle_t bus = _rmtGetBus(pin, __FUNCTION__);
+  if (bus == NULL) {
+    return false;
+  }
+  if (!_rmtCheckDirection(pin, RMT_TX_MODE, __FUNCTION__)) {
+    return false;
+  }
+  if ((xEventGroupGetBits(bus->rmt_events) & RMT_FLAG_TX_DONE) == 0) {
+    log_w("GPIO %d - Can't change RMT Bytes Encoding while a transmission is pending.", pin);
+    return false;
+  }
+
+  rmt_encoder_handle_t encoder = _rmtNewBytesEncoder(bit0, bit1, reset_symbol, msb_first);
+  if (encoder == NULL) {
+    log_e("GPIO %d - RMT Bytes Encoder Memory Allocation error.", pin);
+    return false;
+  }
+  RMT_MUTEX_LOCK(bus);
+  // replaces any previous encoding setup
+  if (bus->rmt_bytes_encoder_h != NULL) {
+    rmt_del_encoder(bus->rmt_bytes_encoder_h);
+  }
+  bus->rmt_bytes_encoder_h = encoder;
+  RMT_MUTEX_UNLOCK(bus);
+  return true;
+}
+
+bool rmtWriteBytes(int pin, const uint8_t *data, size_t num_bytes, uint32_t timeout_ms) {
+  return _rmtWrite(pin, data, num_bytes, true /*bytes encoder*/, true /*blocks*/, false /*looping*/, timeout_ms);
+}
+
+bool rmtWriteBytesAsync(int pin, const uint8_t *data, size_t num_bytes) {
+  return _rmtWrite(pin, data, num_bytes, true /*bytes encoder*/, false /*blocks*/, false /*looping*/, 0 /*N/A*/);
 }
 
 bool rmtTransmitCompleted(int pin) {
@@ -425,6 +653,20 @@ bool rmtTransmitCompleted(int pin) {
   return retCode;
 }
 
+bool rmtWaitTransmitCompleted(int pin, uint32_t timeout_ms) {
+  rmt_bus_handle_t bus = _rmtGetBus(pin, __FUNCTION__);
+  if (bus == NULL) {
+    return false;
+  }
+  if (!_rmtCheckDirection(pin, RMT_TX_MODE, __FUNCTION__)) {
+    return false;
+  }
+  // no need to lock the channel - the event group is only read here
+  return (xEventGroupWaitBits(bus->rmt_events, RMT_FLAG_TX_DONE, pdFALSE /* do not clear on exit */, pdFALSE /* wait for all bits */, timeout_ms)
+          & RMT_FLAG_TX_DONE)
+         != 0;
+}
+
 bool rmtRead(int pin, rmt_data_t *data, size_t *num_rmt_symbols, uint32_t timeout_ms) {
   return _rmtRead(pin, data, num_rmt_symbols, true /* blocking */, timeout_ms);
 }
@@ -433,6 +675,130 @@ bool rmtReadAsync(int pin, rmt_data_t *data, size_t *num_rmt_symbols) {
   return _rmtRead(pin, data, num_rmt_symbols, false /* non-blocking */, 0 /* N/A */);
 }
 
+bool rmtReadContinuous(int pin, uint8_t num_buffers, size_t buffer_symbols) {
+  rmt_bus_handle_t bus = _rmtGetBus(pin, __FUNCTION__);
+  if (bus == NULL) {
+    return false;
+  }
+  if (!_rmtCheckDirection(pin, RMT_RX_MODE, __FUNCTION__)) {
+    return false;
+  }
+  if (num_buffers < 2 || buffer_symbols == 0) {
+    log_e("GPIO %d - RMT Continuous Reading needs at least 2 buffers of 1 RMT Symbol.", pin);
+    return false;
+  }
+  if (bus->rx_stream != NULL) {
+    log_w("GPIO %d - RMT Continuous Reading is already running.", pin);
+    return false;
+  }
+  if ((xEventGroupGetBits(bus->rmt_events) & RMT_FLAG_RX_DONE) == 0) {
+    log_w("GPIO %d - RMT Read still pending to be completed.", pin);
+    return false;
+  }
+
+  struct rmt_rx_stream_s *stream = (struct rmt_rx_stream_s *)heap_caps_calloc(1, sizeof(struct rmt_rx_stream_s), MALLOC_CAP_DEFAULT);
+  if (stream == NULL) {
+    log_e("GPIO %d - RMT Continuous Reading Memory allocation fault.", pin);
+    return false;
+  }
+  stream->num_buffers = num_buffers;
+  stream->buffer_symbols = buffer_symbols;
+  stream->armed = -1;
+  // RMT RX in IDF 5.1 can't write to PSRAM
+  stream->buffers = (rmt_data_t *)heap_caps_malloc(num_buffers * buffer_symbols * sizeof(rmt_data_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  stream->num_symbols = (size_t *)calloc(num_buffers, sizeof(size_t));
+  stream->free_queue = xQueueCreate(num_buffers, sizeof(int));
+  stream->frame_queue = xQueueCreate(num_buffers, sizeof(int));
+  if (stream->buffers == NULL || stream->num_symbols == NULL || stream->free_queue == NULL || stream->frame_queue == NULL) {
+    log_e("GPIO %d - RMT Continuous Reading Memory allocation fault.", pin);
+    bus->rx_stream = stream;
+    _rmtRxStreamFree(bus);
+    return false;
+  }
+  for (int i = 0; i < num_buffers; i++) {
+    xQueueSend(stream->free_queue, &i, 0);
+  }
+
+  bool retCode = true;
+  RMT_MUTEX_LOCK(bus);
+  bus->rx_stream = stream;
+  if (xTaskCreate(_rmtRxStreamTask, "rmt_rx_stream", RMT_RX_STREAM_TASK_STACK, bus, RMT_RX_STREAM_TASK_PRIORITY, &stream->task) != pdPASS) {
+    log_e("GPIO %d - RMT Continuous Reading task creation failed.", pin);
+    stream->task = NULL;
+    _rmtRxStreamFree(bus);
+    retCode = false;
+  }
+  RMT_MUTEX_UNLOCK(bus);
+  return retCode;
+}
+
+bool rmtReadContinuousFrame(int pin, rmt_data_t **data, size_t *num_rmt_symbols, uint32_t timeout_ms) {
+  rmt_bus_handle_t bus = _rmtGetBus(pin, __FUNCTION__);
+  if (bus == NULL) {
+    return false;
+  }
+  struct rmt_rx_stream_s *stream = bus->rx_stream;
+  if (stream == NULL) {
+    log_w("GPIO %d - RMT Continuous Reading is not running.", pin);
+    return false;
+  }
+  if (data == NULL || num_rmt_symbols == NULL) {
+    log_w("GPIO %d - RMT Read Data and/or Size NULL pointer.", pin);
+    return false;
+  }
+
+  int index;
+  if (xQueueReceive(stream->frame_queue, &index, timeout_ms) != pdTRUE) {
+    return false;
+  }
+  *data = stream->buffers + index * stream->buffer_symbols;
+  *num_rmt_symbols = stream->num_symbols[index];
+  return true;
+}
+
+bool rmtReadContinuousRelease(int pin, rmt_data_t *data) {
+  rmt_bus_handle_t bus = _rmtGetBus(pin, __FUNCTION__);
+  if (bus == NULL) {
+    return false;
+  }
+  struct rmt_rx_stream_s *stream = bus->rx_stream;
+  if (stream == NULL || data == NULL) {
+    return false;
+  }
+  size_t offset = data - stream->buffers;
+  if (data < stream->buffers || offset % stream->buffer_symbols != 0 || offset / stream->buffer_symbols >= stream->num_buffers) {
+    log_w("GPIO %d - Buffer doesn't belong to RMT Continuous Reading.", pin);
+    return false;
+  }
+  int index = offset / stream->buffer_symbols;
+  return xQueueSend(stream->free_queue, &index, 0) == pdTRUE;
+}
+
+uint32_t rmtReadContinuousOverruns(int pin) {
+  rmt_bus_handle_t bus = _rmtGetBus(pin, __FUNCTION__);
+  if (bus == NULL || bus->rx_stream == NULL) {
+    return 0;
+  }
+  return bus->rx_stream->overruns;
+}
+
+bool rmtReadContinuousStop(int pin) {
+  rmt_bus_handle_t bus = _rmtGetBus(pin, __FUNCTION__);
+  if (bus == NULL) {
+    return false;
+  }
+  if (bus->rx_stream == NULL) {
+    return true;
+  }
+  RMT_MUTEX_LOCK(bus);
+  // disabling the channel stops any pending reception, thus the ISR won't touch the ring anymore
+  rmt_disable(bus->rmt_channel_h);
+  _rmtRxStreamFree(bus);
+  rmt_enable(bus->rmt_channel_h);
+  RMT_MUTEX_UNLOCK(bus);
+  return true;
+}
+
 bool rmtReceiveCompleted(int pin) {
   rmt_bus_handle_t bus = _rmtGetBus(pin, __FUNCTION__);
   if (bus == NULL) {
@@ -149,6 +149,49 @@ bool rmtWriteLooping(int pin, rmt_data_t *data, size_t num_rmt_symbols);
 */
 bool rmtTransmitCompleted(int pin);
 
+/**
+     Waits up to <timeout_ms> milliseconds for the current transmission to finish.
+     Timeout can be set as undefined time by passing <RMT_WAIT_FOR_EVER> as <timeout_ms> parameter.
+     Returns <true> when all data has been sent, <false> otherwise, including when it exits by timeout.
+*/
+bool rmtWaitTransmitCompleted(int pin, uint32_t timeout_ms);
+
+/**
+     Sets up the Bytes Encoder used by rmtWriteBytes() and rmtWriteBytesAsync().
+     Instead of expanding each data bit into a rmt_data_t in RAM, the Bytes Encoder converts
+     the bytes on the fly, while the RMT channel is transmitting, using:
+      <bit0> as the RMT Symbol sent for each 0 bit
+      <bit1> as the RMT Symbol sent for each 1 bit
+      <reset_symbol> as an RMT Symbol sent after the last byte, for instance, the WS2812 latch time.
+                     Passing a zeroed rmt_data_t means that no symbol is added at the end of the data.
+      <msb_first> sets the bit order for each byte
+
+     It can be called again to change the encoding, but only when no transmission is pending.
+     Returns <true> on execution success, <false> otherwise.
+*/
+bool rmtSetBytesEncoding(int pin, rmt_data_t bit0, rmt_data_t bit1, rmt_data_t reset_symbol, bool msb_first);
+
+/**
+     Sending bytes in Blocking Mode, using the encoding set by rmtSetBytesEncoding().
+     Each data bit is sent as the <bit0> or <bit1> RMT Symbol, thus <data> uses 32 times less memory
+     than the equivalent rmt_data_t array used with rmtWrite().
+
+     It has the same Blocking and Timeout behavior as rmtWrite().
+     Returns <true> when there is no error in the write operation, <false> otherwise, including when it
+     exits by timeout.
+*/
+bool rmtWriteBytes(int pin, const uint8_t *data, size_t num_bytes, uint32_t timeout_ms);
+
+/**
+     Sending bytes in Async Mode, using the encoding set by rmtSetBytesEncoding().
+     <data> is read by the RMT driver while transmitting, therefore it must not be modified
+     until rmtTransmitCompleted() returns <true>.
+
+     It has the same Non-Blocking behavior as rmtWriteAsync().
+     Returns <true> on execution success, <false> otherwise.
+*/
+bool rmtWriteBytesAsync(int pin, const uint8_t *data, size_t num_bytes);
+
 /**
      Initiates blocking receive. Read data will be stored in a user provided buffer <*data>
      It will read up to <num_rmt_symbols> RMT Symbols and the value of this variable will
@@ -190,6 +233,44 @@ bool rmtReadAsync(int pin, rmt_data_t *data, size_t *num_rmt_symbols);
 */
 bool rmtReceiveCompleted(int pin);
 
+/**
+     Starts Continuous Reading. The RMT channel keeps receiving frames into a ring of <num_buffers>
+     buffers with <buffer_symbols> RMT Symbols each, allocated by the driver. A frame ends when the
+     input stays idle for longer than the time set by rmtSetRxMaxThreshold().
+     The channel is re-armed right after each frame, without waiting for the application.
+
+     While Continuous Reading is running, rmtRead() and rmtReadAsync() can't be used in this pin.
+     Returns <true> on execution success, <false> otherwise.
+*/
+bool rmtReadContinuous(int pin, uint8_t num_buffers, size_t buffer_symbols);
+
+/**
+     Gets the oldest received frame, waiting up to <timeout_ms> for it.
+     <*data> points to the driver buffer holding the frame and <*num_rmt_symbols> is its number of RMT Symbols.
+     The buffer must be given back with rmtReadContinuousRelease() after processing it.
+     When the application holds the buffers for too long, the oldest frames not yet taken are dropped
+     and counted by rmtReadContinuousOverruns().
+     Returns <true> when a frame is available, <false> otherwise, including when it exits by timeout.
+*/
+bool rmtReadContinuousFrame(int pin, rmt_data_t **data, size_t *num_rmt_symbols, uint32_t timeout_ms);
+
+/**
+     Gives back a buffer returned by rmtReadContinuousFrame(), so that it can receive new frames.
+     Returns <true> on execution success, <false> otherwise.
+*/
+bool rmtReadContinuousRelease(int pin, rmt_data_t *data);
+
+/**
+     Returns the number of frames dropped since rmtReadContinuous() was called.
+*/
+uint32_t rmtReadContinuousOverruns(int pin);
+
+/**
+     Stops Continuous Reading and releases its buffers. Buffers held by the application become invalid.
+     Returns <true> on execution success, <false> otherwise.
+*/
+bool rmtReadContinuousStop(int pin);
+
 /**
    Function used to set a threshold (in ticks) used to consider that a data reception has ended.
    In receive mode, when no edge is detected on the input signal for longer than idle_thres_ticks
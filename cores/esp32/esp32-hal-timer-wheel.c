@@ -0,0 +1,182 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "esp32-hal-timer-wheel.h"
+
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+static inline void _listInit(timer_wheel_node_t *head) {
+  head->next = head;
+  head->prev = head;
+}
+
+static inline bool _listEmpty(const timer_wheel_node_t *head) {
+  return head->next == head;
+}
+
+static inline void _listAppend(timer_wheel_node_t *head, timer_wheel_node_t *node) {
+  node->prev = head->prev;
+  node->next = head;
+  head->prev->next = node;
+  head->prev = node;
+}
+
+static inline void _listUnlink(timer_wheel_node_t *node) {
+  node->prev->next = node->next;
+  node->next->prev = node->prev;
+  node->next = NULL;
+  node->prev = NULL;
+}
+
+// moves all nodes of <from> at the end of <to>, leaving <from> empty
+static inline void _listSplice(timer_wheel_node_t *from, timer_wheel_node_t *to) {
+  if (_listEmpty(from)) {
+    return;
+  }
+  from->next->prev = to->prev;
+  to->prev->next = from->next;
+  from->prev->next = to;
+  to->prev = from->prev;
+  _listInit(from);
+}
+
+// places a timer in the slot matching its expiration time, relative to the current tick
+static void _timerWheelPlace(timer_wheel_t *wheel, timer_wheel_timer_t *timer) {
+  uint64_t delta = timer->expires - wheel->now;
+  uint8_t level;
+  for (level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    if (delta < (1ULL << (TIMER_WHEEL_LEVEL_BITS * (level + 1)))) {
+      break;
+    }
+  }
+  size_t slot;
+  if (level == TIMER_WHEEL_LEVELS) {
+    // Beyond the span of the wheel: park it in the top level slot visited last, it will be placed again from there
+    level = TIMER_WHEEL_LEVELS - 1;
+    slot = ((wheel->now >> (TIMER_WHEEL_LEVEL_BITS * level)) - 1) & TIMER_WHEEL_MASK;
+  } else {
+    slot = (timer->expires >> (TIMER_WHEEL_LEVEL_BITS * level)) & TIMER_WHEEL_MASK;
+  }
+  _listAppend(&wheel->slots[level][slot], &timer->node);
+}
+
+// moves the timers of the current slot of <level> to the lower levels
+static bool _timerWheelCascade(timer_wheel_t *wheel, uint8_t level) {
+  size_t slot = (wheel->now >> (TIMER_WHEEL_LEVEL_BITS * level)) & TIMER_WHEEL_MASK;
+  timer_wheel_node_t pending;
+  _listInit(&pending);
+  _listSplice(&wheel->slots[level][slot], &pending);
+  while (!_listEmpty(&pending)) {
+    timer_wheel_timer_t *timer = (timer_wheel_timer_t *)pending.next;
+    _listUnlink(&timer->node);
+    _timerWheelPlace(wheel, timer);
+  }
+  // the next level is due when this one wraps around
+  return slot == 0;
+}
+
+void timerWheelInit(timer_wheel_t *wheel, uint64_t now) {
+  wheel->now = now;
+  wheel->count = 0;
+  _listInit(&wheel->due);
+  for (uint8_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    for (size_t slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+      _listInit(&wheel->slots[level][slot]);
+    }
+  }
+}
+
+void timerWheelTimerInit(timer_wheel_timer_t *timer, timer_wheel_cb_t cb, void *arg) {
+  timer->node.next = NULL;
+  timer->node.prev = NULL;
+  timer->expires = 0;
+  timer->period = 0;
+  timer->cb = cb;
+  timer->arg = arg;
+}
+
+void timerWheelAdd(timer_wheel_t *wheel, timer_wheel_timer_t *timer, uint32_t delay, uint32_t period) {
+  timerWheelCancel(wheel, timer);
+  timer->expires = wheel->now + (delay ? delay : 1);
+  timer->period = period;
+  _timerWheelPlace(wheel, timer);
+  wheel->count++;
+}
+
+bool timerWheelCancel(timer_wheel_t *wheel, timer_wheel_timer_t *timer) {
+  if (timer->node.next == NULL) {
+    return false;
+  }
+  _listUnlink(&timer->node);
+  wheel->count--;
+  return true;
+}
+
+void timerWheelClear(timer_wheel_t *wheel) {
+  _listSplice(&wheel->due, &wheel->slots[0][0]);
+  for (uint8_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    for (size_t slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+      timer_wheel_node_t *head = &wheel->slots[level][slot];
+      while (!_listEmpty(head)) {
+        _listUnlink(head->next);
+      }
+    }
+  }
+  wheel->count = 0;
+}
+
+bool timerWheelActive(const timer_wheel_timer_t *timer) {
+  return timer->node.next != NULL;
+}
+
+timer_wheel_timer_t *timerWheelPop(timer_wheel_t *wheel, uint64_t now) {
+  while (_listEmpty(&wheel->due)) {
+    if (wheel->now >= now) {
+      return NULL;
+    }
+    if (wheel->count == 0) {
+      // nothing to cascade, skip the empty ticks at once
+      wheel->now = now;
+      return NULL;
+    }
+    wheel->now++;
+    size_t slot = wheel->now & TIMER_WHEEL_MASK;
+    if (slot == 0) {
+      for (uint8_t level = 1; level < TIMER_WHEEL_LEVELS && _timerWheelCascade(wheel, level); level++);
+    }
+    _listSplice(&wheel->slots[0][slot], &wheel->due);
+  }
+
+  timer_wheel_timer_t *timer = (timer_wheel_timer_t *)wheel->due.next;
+  _listUnlink(&timer->node);
+  if (timer->period) {
+    timer->expires += timer->period;
+    _timerWheelPlace(wheel, timer);
+  } else {
+    wheel->count--;
+  }
+  return timer;
+}
+
+size_t timerWheelAdvance(timer_wheel_t *wheel, uint64_t now) {
+  size_t fired = 0;
+  timer_wheel_timer_t *timer;
+  while ((timer = timerWheelPop(wheel, now)) != NULL) {
+    fired++;
+    if (timer->cb) {
+      timer->cb(timer, timer->arg);
+    }
+  }
+  return fired;
+}
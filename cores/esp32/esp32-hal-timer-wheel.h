@@ -0,0 +1,145 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MAIN_ESP32_HAL_TIMER_WHEEL_H_
+#define MAIN_ESP32_HAL_TIMER_WHEEL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+   Hierarchical timer wheel: any number of software timers driven by a single tick source.
+
+   Timers are kept in TIMER_WHEEL_LEVELS wheels of TIMER_WHEEL_SLOTS slots each, every level
+   covering TIMER_WHEEL_SLOTS times the span of the level below. Adding and cancelling a timer
+   is O(1), timers far in the future are moved down one level at a time as the wheel turns.
+   Timers are owned by the caller, the wheel never allocates memory.
+
+   This file has no dependency on the SoC, it does not lock anything: the owner of the wheel
+   must serialize all calls, as done by timerWheelBegin() in esp32-hal-timer.h.
+*/
+
+#define TIMER_WHEEL_LEVEL_BITS 6
+#define TIMER_WHEEL_SLOTS      (1 << TIMER_WHEEL_LEVEL_BITS)
+#define TIMER_WHEEL_LEVELS     4
+
+typedef struct timer_wheel_node_s {
+  struct timer_wheel_node_s *next;
+  struct timer_wheel_node_s *prev;
+} timer_wheel_node_t;
+
+typedef struct timer_wheel_timer_s timer_wheel_timer_t;
+
+typedef void (*timer_wheel_cb_t)(timer_wheel_timer_t *timer, void *arg);
+
+struct timer_wheel_timer_s {
+  timer_wheel_node_t node;  // must be first - links the timer in a wheel slot
+  uint64_t expires;         // absolute tick of the next expiration
+  uint32_t period;          // ticks between expirations, 0 for one shot timers
+  timer_wheel_cb_t cb;
+  void *arg;
+};
+
+typedef struct {
+  uint64_t now;            // last tick processed
+  uint32_t count;          // number of scheduled timers
+  timer_wheel_node_t due;  // timers expired at <now>, not yet popped
+  timer_wheel_node_t slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+} timer_wheel_t;
+
+/**
+ * @brief Initialize an empty timer wheel.
+ *
+ * @param wheel timer wheel
+ * @param now current tick
+ */
+void timerWheelInit(timer_wheel_t *wheel, uint64_t now);
+
+/**
+ * @brief Initialize a timer, before it is added to a timer wheel for the first time.
+ *
+ * @param timer timer
+ * @param cb function called when the timer expires
+ * @param arg argument passed to <cb>
+ */
+void timerWheelTimerInit(timer_wheel_timer_t *timer, timer_wheel_cb_t cb, void *arg);
+
+/**
+ * @brief Schedule a timer. A timer already scheduled is rescheduled.
+ *
+ * @param wheel timer wheel
+ * @param timer timer initialized by timerWheelTimerInit()
+ * @param delay ticks until the first expiration, 0 is rounded up to the next tick
+ * @param period ticks between the following expirations, 0 for a one shot timer
+ */
+void timerWheelAdd(timer_wheel_t *wheel, timer_wheel_timer_t *timer, uint32_t delay, uint32_t period);
+
+/**
+ * @brief Cancel a timer.
+ *
+ * @param wheel timer wheel
+ * @param timer timer
+ *
+ * @return true if the timer was scheduled, false otherwise.
+ */
+bool timerWheelCancel(timer_wheel_t *wheel, timer_wheel_timer_t *timer);
+
+/**
+ * @brief Cancel all timers of a timer wheel.
+ *
+ * @param wheel timer wheel
+ */
+void timerWheelClear(timer_wheel_t *wheel);
+
+/**
+ * @brief Check if a timer is scheduled.
+ *
+ * @param timer timer
+ *
+ * @return true if the timer is scheduled, false otherwise.
+ */
+bool timerWheelActive(const timer_wheel_timer_t *timer);
+
+/**
+ * @brief Turn the wheel up to tick <now> and return the next expired timer, without calling it.
+ *        A one shot timer is no longer scheduled when returned, a periodic one is already
+ *        rescheduled, so its callback may freely add or cancel timers.
+ *
+ * @param wheel timer wheel
+ * @param now current tick
+ *
+ * @return the next expired timer, or NULL when all timers up to <now> have been returned.
+ */
+timer_wheel_timer_t *timerWheelPop(timer_wheel_t *wheel, uint64_t now);
+
+/**
+ * @brief Turn the wheel up to tick <now> and call all expired timers.
+ *
+ * @param wheel timer wheel
+ * @param now current tick
+ *
+ * @return number of timers called.
+ */
+size_t timerWheelAdvance(timer_wheel_t *wheel, uint64_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_ESP32_HAL_TIMER_WHEEL_H_ */
@@ -214,4 +214,162 @@ double timerReadSeconds(hw_timer_t *timer) {
   return (double)timer_val / frequency;
 }
 
+#define TIMER_WHEEL_TASK_STACK    4096
+#define TIMER_WHEEL_TASK_PRIORITY (configMAX_PRIORITIES - 2)
+
+typedef struct {
+  hw_timer_t *timer;
+  timer_wheel_t wheel;
+  uint64_t ticks;  // ticks counted by the GPTimer, the wheel may be behind in task dispatch mode
+  uint32_t tick_us;
+  TaskHandle_t task;
+  portMUX_TYPE lock;
+} timer_wheel_handle_t;
+
+static timer_wheel_handle_t *timer_wheel = NULL;
+
+static bool IRAM_ATTR timerWheelIsr(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *args) {
+  timer_wheel_handle_t *tw = (timer_wheel_handle_t *)args;
+  BaseType_t xTaskWoken = pdFALSE;
+
+  portENTER_CRITICAL_ISR(&tw->lock);
+  tw->ticks++;
+  if (tw->task != NULL) {
+    portEXIT_CRITICAL_ISR(&tw->lock);
+    vTaskNotifyGiveFromISR(tw->task, &xTaskWoken);
+    return xTaskWoken == pdTRUE;
+  }
+  // ISR dispatch: the lock is released while a callback runs, so that it can start and stop timers
+  timer_wheel_timer_t *t;
+  while ((t = timerWheelPop(&tw->wheel, tw->ticks)) != NULL) {
+    portEXIT_CRITICAL_ISR(&tw->lock);
+    if (t->cb) {
+      t->cb(t, t->arg);
+    }
+    portENTER_CRITICAL_ISR(&tw->lock);
+  }
+  portEXIT_CRITICAL_ISR(&tw->lock);
+  return false;
+}
+
+static void timerWheelTask(void *args) {
+  timer_wheel_handle_t *tw = (timer_wheel_handle_t *)args;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    for (;;) {
+      portENTER_CRITICAL(&tw->lock);
+      timer_wheel_timer_t *t = timerWheelPop(&tw->wheel, tw->ticks);
+      portEXIT_CRITICAL(&tw->lock);
+      if (t == NULL) {
+        break;
+      }
+      if (t->cb) {
+        t->cb(t, t->arg);
+      }
+    }
+  }
+}
+
+static inline uint32_t timerWheelUsToTicks(uint64_t us) {
+  uint64_t ticks = (us + timer_wheel->tick_us - 1) / timer_wheel->tick_us;
+  return (ticks > UINT32_MAX) ? UINT32_MAX : (uint32_t)ticks;
+}
+
+bool timerWheelBegin(uint32_t tick_us, timer_wheel_dispatch_t dispatch) {
+  if (timer_wheel != NULL) {
+    log_e("Timer Wheel is already running");
+    return false;
+  }
+  if (tick_us == 0) {
+    log_e("Timer Wheel tick can't be zero");
+    return false;
+  }
+  timer_wheel_handle_t *tw = (timer_wheel_handle_t *)calloc(1, sizeof(timer_wheel_handle_t));
+  if (tw == NULL) {
+    log_e("Timer Wheel allocation failed");
+    return false;
+  }
+  timerWheelInit(&tw->wheel, 0);
+  tw->tick_us = tick_us;
+  portMUX_INITIALIZE(&tw->lock);
+
+  if (dispatch == TIMER_WHEEL_DISPATCH_TASK) {
+    if (xTaskCreate(timerWheelTask, "timer_wheel", TIMER_WHEEL_TASK_STACK, tw, TIMER_WHEEL_TASK_PRIORITY, &tw->task) != pdPASS) {
+      log_e("Timer Wheel task creation failed");
+      free(tw);
+      return false;
+    }
+  }
+
+  tw->timer = timerBegin(1000000);
+  if (tw->timer == NULL) {
+    if (tw->task != NULL) {
+      vTaskDelete(tw->task);
+    }
+    free(tw);
+    return false;
+  }
+
+  gptimer_event_callbacks_t cbs = {
+    .on_alarm = timerWheelIsr,
+  };
+  gptimer_stop(tw->timer->timer_handle);
+  gptimer_disable(tw->timer->timer_handle);
+  esp_err_t err = gptimer_register_event_callbacks(tw->timer->timer_handle, &cbs, tw);
+  gptimer_enable(tw->timer->timer_handle);
+  if (err != ESP_OK) {
+    log_e("Timer Wheel Attach Interrupt failed, error num=%d", err);
+    tw->timer->timer_started = false;
+    timerEnd(tw->timer);
+    if (tw->task != NULL) {
+      vTaskDelete(tw->task);
+    }
+    free(tw);
+    return false;
+  }
+
+  timer_wheel = tw;
+  timerAlarm(tw->timer, tick_us, true, 0);
+  timerWrite(tw->timer, 0);
+  gptimer_start(tw->timer->timer_handle);
+  return true;
+}
+
+void timerWheelEnd(void) {
+  timer_wheel_handle_t *tw = timer_wheel;
+  if (tw == NULL) {
+    return;
+  }
+  timerEnd(tw->timer);
+  if (tw->task != NULL) {
+    vTaskDelete(tw->task);
+  }
+  // Timers are owned by the application, they must not keep pointing to the freed wheel
+  timerWheelClear(&tw->wheel);
+  timer_wheel = NULL;
+  free(tw);
+}
+
+bool timerWheelStart(timer_wheel_timer_t *timer, uint64_t delay_us, uint64_t period_us) {
+  if (timer_wheel == NULL || timer == NULL) {
+    log_e("Timer Wheel is not running, call timerWheelBegin first!");
+    return false;
+  }
+  uint32_t delay = timerWheelUsToTicks(delay_us), period = timerWheelUsToTicks(period_us);
+  portENTER_CRITICAL_SAFE(&timer_wheel->lock);
+  timerWheelAdd(&timer_wheel->wheel, timer, delay, period);
+  portEXIT_CRITICAL_SAFE(&timer_wheel->lock);
+  return true;
+}
+
+bool timerWheelStop(timer_wheel_timer_t *timer) {
+  if (timer_wheel == NULL || timer == NULL) {
+    return false;
+  }
+  portENTER_CRITICAL_SAFE(&timer_wheel->lock);
+  bool scheduled = timerWheelCancel(&timer_wheel->wheel, timer);
+  portEXIT_CRITICAL_SAFE(&timer_wheel->lock);
+  return scheduled;
+}
+
 #endif /* SOC_GPTIMER_SUPPORTED */
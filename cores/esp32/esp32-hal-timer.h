@@ -23,6 +23,7 @@
 #if SOC_GPTIMER_SUPPORTED
 
 #include "esp32-hal.h"
+#include "esp32-hal-timer-wheel.h"
 #include "driver/gptimer_types.h"
 
 #ifdef __cplusplus
@@ -53,6 +54,37 @@ void timerDetachInterrupt(hw_timer_t *timer);
 
 void timerAlarm(hw_timer_t *timer, uint64_t alarm_value, bool autoreload, uint64_t reload_count);
 
+/*
+ * Timer Wheel - many software timers multiplexed onto one GPTimer
+ * */
+
+typedef enum {
+  TIMER_WHEEL_DISPATCH_ISR,   // callbacks run in the GPTimer interrupt - keep them short
+  TIMER_WHEEL_DISPATCH_TASK,  // callbacks run in a dedicated high priority task
+} timer_wheel_dispatch_t;
+
+/*
+ * Starts the timer wheel with a tick of <tick_us> microseconds, on a new GPTimer.
+ * All timers are rounded up to a whole number of ticks.
+ * */
+bool timerWheelBegin(uint32_t tick_us, timer_wheel_dispatch_t dispatch);
+
+/*
+ * Stops the timer wheel and releases its GPTimer. All timers are cancelled.
+ * */
+void timerWheelEnd(void);
+
+/*
+ * Schedules a timer initialized by timerWheelTimerInit(). A scheduled timer is rescheduled.
+ * <period_us> set to 0 makes a one shot timer. May be called from timer callbacks.
+ * */
+bool timerWheelStart(timer_wheel_timer_t *timer, uint64_t delay_us, uint64_t period_us);
+
+/*
+ * Cancels a timer. Returns false if it was not scheduled. May be called from timer callbacks.
+ * */
+bool timerWheelStop(timer_wheel_timer_t *timer);
+
 #ifdef __cplusplus
 }
 #endif
@@ -33,6 +33,13 @@
 #include "hal/gpio_hal.h"
 #include "esp_rom_gpio.h"
 
+#include "esp32-hal-log-ring.h"
+#include "esp32-hal-log-token.h"
+#include "esp_heap_caps.h"
+#include "esp_memory_utils.h"
+#include "esp_system.h"
+#include <string.h>
+
 static int s_uart_debug_nr = 0;  // UART number for debug output
 
 struct uart_struct_t {
@@ -856,19 +863,285 @@ int uartGetDebug() {
   return s_uart_debug_nr;
 }
 
+/*
+ * Deferred logging: the messages are kept as format and arguments in a ring per core, and
+ * formatted then written to the log output by a low priority task.
+ */
+#define LOG_DEFERRED_RING_SIZE 2048  // bytes per core, when log_deferred_begin() is given 0
+#define LOG_DEFERRED_IDLE_MS   20    // drain period, for messages that could not wake the task
+#define LOG_DEFERRED_CHUNK     128   // bytes written to the log output at once
+
+typedef struct {
+  char buf[LOG_DEFERRED_CHUNK];
+  size_t len;
+} log_deferred_out_t;
+
+static log_ring_t s_log_rings[portNUM_PROCESSORS];
+static uint8_t *s_log_ring_buf = NULL;
+static size_t s_log_ring_size = 0;
+static TaskHandle_t s_log_task = NULL;
+static SemaphoreHandle_t s_log_task_exited = NULL;
+static volatile bool s_log_task_stop = false;  // asks the task to exit once it drained the rings
+static volatile bool s_log_deferred = false;
+static volatile bool s_log_draining = false;
+static uint32_t s_log_written = 0;
+static uint32_t s_log_reported = 0;  // dropped messages already reported in the log
+
+// strings in flash outlive the messages, others are copied
+static bool log_deferred_is_static(const void *ptr) {
+  return esp_ptr_in_drom(ptr);
+}
+
+// raw bytes to the ROM putc, which may also be USB CDC
+static void log_putc_bytes(const char *data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+#if CONFIG_IDF_TARGET_ESP32C3
+    ets_printf("%c", data[i]);
+#else
+    ets_write_char_uart(data[i]);
+#endif
+  }
+}
+
+static void log_deferred_output(const char *data, size_t len) {
+  if (s_uart_debug_nr != -1 && uart_is_driver_installed(s_uart_debug_nr)) {
+    uart_write_bytes(s_uart_debug_nr, data, len);
+  } else {
+    log_putc_bytes(data, len);
+  }
+  s_log_written += len;
+}
+
+static void log_deferred_write(const char *data, size_t len, void *arg) {
+  log_deferred_out_t *out = (log_deferred_out_t *)arg;
+  while (len) {
+    size_t n = len < LOG_DEFERRED_CHUNK - out->len ? len : LOG_DEFERRED_CHUNK - out->len;
+    memcpy(out->buf + out->len, data, n);
+    out->len += n;
+    data += n;
+    len -= n;
+    if (out->len == LOG_DEFERRED_CHUNK) {
+      log_deferred_output(out->buf, out->len);
+      out->len = 0;
+    }
+  }
+}
+
+static void log_deferred_drain(void) {
+  log_deferred_out_t out;
+  out.len = 0;
+  s_log_draining = true;
+  for (;;) {
+    // messages of all cores, in the order of their time stamps
+    log_ring_t *oldest = NULL;
+    uint32_t oldestStamp = 0, stamp;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+      if (logRingPeek(&s_log_rings[i], &stamp) && (!oldest || (int32_t)(stamp - oldestStamp) < 0)) {
+        oldest = &s_log_rings[i];
+        oldestStamp = stamp;
+      }
+    }
+    if (!oldest) {
+      break;
+    }
+    logRingRead(oldest, log_deferred_write, &out);
+  }
+  uint32_t dropped = 0;
+  for (int i = 0; i < portNUM_PROCESSORS; i++) {
+    dropped += s_log_rings[i].dropped;
+  }
+  if (dropped != s_log_reported) {
+    char line[48];
+    int len = snprintf(line, sizeof(line), "[log] %lu messages dropped\r\n", (unsigned long)(dropped - s_log_reported));
+    log_deferred_write(line, len, &out);
+    s_log_reported = dropped;
+  }
+  if (out.len) {
+    log_deferred_output(out.buf, out.len);
+  }
+  s_log_draining = false;
+}
+
+static void log_deferred_task(void *arg) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOG_DEFERRED_IDLE_MS));
+    log_deferred_drain();
+    // only exits between two writes to the log output
+    if (s_log_task_stop) {
+      xSemaphoreGive(s_log_task_exited);
+      vTaskDelete(NULL);
+    }
+  }
+}
+
+static int log_deferred_push(const uint8_t *rec, size_t len) {
+  // the writers of a ring all run on its core, masking the interrupts serializes them
+  UBaseType_t state = portSET_INTERRUPT_MASK_FROM_ISR();
+  log_ring_t *ring = &s_log_rings[xPortGetCoreID()];
+  bool wake = logRingUsed(ring) == 0;
+  bool written = logRingWrite(ring, rec, len);
+  portCLEAR_INTERRUPT_MASK_FROM_ISR(state);
+  if (!written) {
+    return 0;
+  }
+  // the task drains until the rings are empty, it only needs waking for the first message
+  if (wake && s_log_task) {
+    if (xPortInIsrContext()) {
+      BaseType_t woken = pdFALSE;
+      vTaskNotifyGiveFromISR(s_log_task, &woken);
+      if (woken) {
+        portYIELD_FROM_ISR();
+      }
+    } else if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) {
+      xTaskNotifyGive(s_log_task);
+    }
+  }
+  return len;
+}
+
+static int log_deferred_pushv(const char *format, va_list arg) {
+  uint8_t rec[LOG_RING_RECORD_MAX];
+  return log_deferred_push(rec, logRingEncode(rec, (uint32_t)esp_timer_get_time(), format, arg, log_deferred_is_static));
+}
+
+static void log_deferred_shutdown(void) {
+  if (!xPortInIsrContext()) {
+    log_deferred_flush(100);
+  }
+}
+
+bool log_deferred_begin(size_t ring_size, uint8_t priority) {
+  if (s_log_deferred) {
+    return true;
+  }
+  if (!ring_size) {
+    ring_size = LOG_DEFERRED_RING_SIZE;
+  }
+  ring_size = (ring_size + 3) & ~3U;
+  if (s_log_ring_buf && s_log_ring_size != ring_size) {
+    free(s_log_ring_buf);
+    s_log_ring_buf = NULL;
+  }
+  if (!s_log_ring_buf) {
+    // internal RAM, the rings are written from interrupts
+    s_log_ring_buf = (uint8_t *)heap_caps_malloc(ring_size * portNUM_PROCESSORS, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!s_log_ring_buf) {
+      log_e("Failed to allocate %u bytes for the log rings", ring_size * portNUM_PROCESSORS);
+      return false;
+    }
+    s_log_ring_size = ring_size;
+  }
+  for (int i = 0; i < portNUM_PROCESSORS; i++) {
+    logRingInit(&s_log_rings[i], s_log_ring_buf + i * ring_size, ring_size, log_deferred_is_static);
+  }
+  if (!s_log_task_exited) {
+    s_log_task_exited = xSemaphoreCreateBinary();
+    if (!s_log_task_exited) {
+      log_e("Failed to create the log task semaphore");
+      return false;
+    }
+  }
+  s_log_reported = 0;
+  s_log_task_stop = false;
+  if (xTaskCreate(log_deferred_task, "log", 4096, NULL, priority, &s_log_task) != pdPASS) {
+    log_e("Failed to create the log task");
+    s_log_task = NULL;
+    return false;
+  }
+  static bool shutdown_registered = false;
+  if (!shutdown_registered) {
+    shutdown_registered = esp_register_shutdown_handler(log_deferred_shutdown) == ESP_OK;
+  }
+  s_log_deferred = true;
+  return true;
+}
+
+void log_deferred_end(void) {
+  if (!s_log_deferred) {
+    return;
+  }
+  // new messages are written directly again, the queued ones are drained first
+  s_log_deferred = false;
+  log_deferred_flush(1000);
+  TaskHandle_t task = s_log_task;
+  s_log_task = NULL;
+  s_log_task_stop = true;
+  xTaskNotifyGive(task);
+  xSemaphoreTake(s_log_task_exited, portMAX_DELAY);
+}
+
+bool log_deferred_flush(uint32_t timeout_ms) {
+  if (!s_log_task) {
+    return true;
+  }
+  uint32_t start = millis();
+  for (;;) {
+    bool empty = !s_log_draining;
+    for (int i = 0; empty && i < portNUM_PROCESSORS; i++) {
+      empty = logRingUsed(&s_log_rings[i]) == 0;
+    }
+    if (empty) {
+      return true;
+    }
+    if ((millis() - start) >= timeout_ms) {
+      return false;
+    }
+    xTaskNotifyGive(s_log_task);
+    vTaskDelay(1);
+  }
+}
+
+void log_deferred_stats(log_deferred_stats_t *stats) {
+  memset(stats, 0, sizeof(log_deferred_stats_t));
+  if (!s_log_ring_buf) {
+    return;
+  }
+  for (int i = 0; i < portNUM_PROCESSORS; i++) {
+    stats->queued += s_log_rings[i].queued;
+    stats->dropped += s_log_rings[i].dropped;
+    if (s_log_rings[i].peak > stats->peak) {
+      stats->peak = s_log_rings[i].peak;
+    }
+  }
+  stats->written = s_log_written;
+}
+
+bool log_deferred_active(void) {
+  return s_log_deferred;
+}
+
+int log_deferred_printf(const char *format, ...) {
+  if (!s_log_deferred) {
+    return 0;
+  }
+  va_list arg;
+  va_start(arg, format);
+  int len = log_deferred_pushv(format, arg);
+  va_end(arg);
+  return len;
+}
+
 int log_printfv(const char *format, va_list arg) {
-  static char loc_buf[64];
+  if (s_log_deferred) {
+    return log_deferred_pushv(format, arg);
+  }
+  // formatted once, unless the message does not fit in loc_buf
+  char loc_buf[64];
   char *temp = loc_buf;
-  uint32_t len;
+  int len;
   va_list copy;
   va_copy(copy, arg);
-  len = vsnprintf(NULL, 0, format, copy);
+  len = vsnprintf(loc_buf, sizeof(loc_buf), format, copy);
   va_end(copy);
-  if (len >= sizeof(loc_buf)) {
+  if (len < 0) {
+    return 0;
+  }
+  if (len >= (int)sizeof(loc_buf)) {
     temp = (char *)malloc(len + 1);
     if (temp == NULL) {
       return 0;
     }
+    vsnprintf(temp, len + 1, format, arg);
   }
 /*
 // This causes dead locks with logging in specific cases and also with C++ constructors that may send logs
@@ -879,11 +1152,9 @@ int log_printfv(const char *format, va_list arg) {
 #endif
 */
 #if CONFIG_IDF_TARGET_ESP32C3
-  vsnprintf(temp, len + 1, format, arg);
   ets_printf("%s", temp);
 #else
-  int wlen = vsnprintf(temp, len + 1, format, arg);
-  for (int i = 0; i < wlen; i++) {
+  for (int i = 0; i < len; i++) {
     ets_write_char_uart(temp[i]);
   }
 #endif
@@ -895,7 +1166,7 @@ int log_printfv(const char *format, va_list arg) {
     }
 #endif
 */
-  if (len >= sizeof(loc_buf)) {
+  if (temp != loc_buf) {
     free(temp);
   }
   // flushes TX - make sure that the log message is completely sent.
@@ -914,6 +1185,27 @@ int log_printf(const char *format, ...) {
   return len;
 }
 
+void log_token_printf(uint32_t *token, const char *format, ...) {
+  // hashed by the first message of the call site, a race only computes the same token twice
+  if (!*token) {
+    *token = logTokenHash(format);
+  }
+  uint8_t frame[LOG_TOKEN_FRAME_MAX];
+  va_list arg;
+  va_start(arg, format);
+  size_t len = logTokenEncode(frame, *token, format, arg, log_deferred_is_static);
+  va_end(arg);
+  if (s_log_deferred) {
+    uint8_t rec[LOG_RING_RECORD_MAX];
+    log_deferred_push(rec, logRingEncodeData(rec, (uint32_t)esp_timer_get_time(), frame, len));
+    return;
+  }
+  log_putc_bytes((const char *)frame, len);
+  if (s_uart_debug_nr != -1) {
+    while (!uart_ll_is_tx_idle(UART_LL_GET_HW(s_uart_debug_nr)));
+  }
+}
+
 static void log_print_buf_line(const uint8_t *b, size_t len, size_t total_len) {
   for (size_t i = 0; i < len; i++) {
     log_printf("%s0x%02x,", i ? " " : "", b[i]);
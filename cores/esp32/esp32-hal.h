@@ -80,6 +80,7 @@ void yield(void);
 #include "esp32-hal-i2c.h"
 #include "esp32-hal-ledc.h"
 #include "esp32-hal-rmt.h"
+#include "esp32-hal-rmt-decoder.h"
 #include "esp32-hal-sigmadelta.h"
 #include "esp32-hal-timer.h"
 #include "esp32-hal-bt.h"
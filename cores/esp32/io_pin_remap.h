@@ -20,6 +20,9 @@ int8_t gpioNumberToDigitalPin(int8_t gpioNumber);
 #define noTone(_pin)              noTone(digitalPinToGPIONumber(_pin))
 #define tone(_pin, args...)       tone(digitalPinToGPIONumber(_pin), args)
 
+// cores/esp32/FunctionalInterrupt.h
+#define attachInterruptDeferred(pin, fcn, mode) attachInterruptDeferred(digitalPinToGPIONumber(pin), fcn, mode)
+
 // cores/esp32/esp32-hal.h
 #define analogGetChannel(pin)            analogGetChannel(digitalPinToGPIONumber(pin))
 #define analogWrite(pin, value)          analogWrite(digitalPinToGPIONumber(pin), value)
@@ -71,6 +74,24 @@ int8_t gpioNumberToDigitalPin(int8_t gpioNumber);
 #define ledcFadeWithInterruptArg(pin, start_duty, target_duty, max_fade_time_ms, userFunc, arg) \
   ledcFadeWithInterruptArg(digitalPinToGPIONumber(pin), start_duty, target_duty, max_fade_time_ms, userFunc, arg)
 
+#define ledcWriteStage(pin, duty)                                      ledcWriteStage(digitalPinToGPIONumber(pin), duty)
+#define ledcFadeSequence(pin, duties, num_duties, step_time_ms, loop) ledcFadeSequence(digitalPinToGPIONumber(pin), duties, num_duties, step_time_ms, loop)
+#define ledcFadeSequenceRunning(pin)                                  ledcFadeSequenceRunning(digitalPinToGPIONumber(pin))
+#define ledcFadeSequenceStop(pin)                                     ledcFadeSequenceStop(digitalPinToGPIONumber(pin))
+
+// the pins of a batch are remapped one by one, as they are staged
+static inline bool ledcWriteBatchRemap(const uint8_t *pins, const uint32_t *duties, size_t count) {
+  if (pins == NULL || duties == NULL || count == 0) {
+    return false;
+  }
+  bool ret = true;
+  for (size_t i = 0; i < count; i++) {
+    ret &= (ledcWriteStage)(digitalPinToGPIONumber(pins[i]), duties[i]);
+  }
+  return ledcWriteCommit() && ret;
+}
+#define ledcWriteBatch(pins, duties, count) ledcWriteBatchRemap(pins, duties, count)
+
 // cores/esp32/esp32-hal-matrix.h
 #define pinMatrixInAttach(pin, signal, inverted)                   pinMatrixInAttach(digitalPinToGPIONumber(pin), signal, inverted)
 #define pinMatrixOutAttach(pin, function, invertOut, invertEnable) pinMatrixOutAttach(digitalPinToGPIONumber(pin), function, invertOut, invertEnable)
@@ -78,6 +99,12 @@ int8_t gpioNumberToDigitalPin(int8_t gpioNumber);
 
 // cores/esp32/esp32-hal-rgb-led.h
 #define neopixelWrite(pin, red_val, green_val, blue_val) neopixelWrite(digitalPinToGPIONumber(pin), red_val, green_val, blue_val)
+#define neopixelStripBegin(pin, num_pixels, type)        neopixelStripBegin(digitalPinToGPIONumber(pin), num_pixels, type)
+#define neopixelStripEnd(pin)                            neopixelStripEnd(digitalPinToGPIONumber(pin))
+#define neopixelStripGetBuffer(pin)                      neopixelStripGetBuffer(digitalPinToGPIONumber(pin))
+#define neopixelStripShow(pin, timeout_ms)               neopixelStripShow(digitalPinToGPIONumber(pin), timeout_ms)
+#define neopixelStripSetPixel(pin, index, red_val, green_val, blue_val, white_val) \
+  neopixelStripSetPixel(digitalPinToGPIONumber(pin), index, red_val, green_val, blue_val, white_val)
 
 // cores/esp32/esp32-hal-rmt.h
 #define rmtInit(pin, channel_direction, memsize, frequency_Hz) rmtInit(digitalPinToGPIONumber(pin), channel_direction, memsize, frequency_Hz)
@@ -86,9 +113,20 @@ int8_t gpioNumberToDigitalPin(int8_t gpioNumber);
 #define rmtWriteAsync(pin, data, num_rmt_symbols)              rmtWriteAsync(digitalPinToGPIONumber(pin), data, num_rmt_symbols)
 #define rmtWriteLooping(pin, data, num_rmt_symbols)            rmtWriteLooping(digitalPinToGPIONumber(pin), data, num_rmt_symbols)
 #define rmtTransmitCompleted(pin)                              rmtTransmitCompleted(digitalPinToGPIONumber(pin))
+#define rmtWaitTransmitCompleted(pin, timeout_ms)              rmtWaitTransmitCompleted(digitalPinToGPIONumber(pin), timeout_ms)
+#define rmtWriteBytes(pin, data, num_bytes, timeout_ms)        rmtWriteBytes(digitalPinToGPIONumber(pin), data, num_bytes, timeout_ms)
+#define rmtWriteBytesAsync(pin, data, num_bytes)               rmtWriteBytesAsync(digitalPinToGPIONumber(pin), data, num_bytes)
+#define rmtSetBytesEncoding(pin, bit0, bit1, reset_symbol, msb_first) \
+  rmtSetBytesEncoding(digitalPinToGPIONumber(pin), bit0, bit1, reset_symbol, msb_first)
 #define rmtRead(pin, data, num_rmt_symbols, timeout_ms)        rmtRead(digitalPinToGPIONumber(pin), data, num_rmt_symbols, timeout_ms)
 #define rmtReadAsync(pin, data, num_rmt_symbols)               rmtReadAsync(digitalPinToGPIONumber(pin), data, num_rmt_symbols)
 #define rmtReceiveCompleted(pin)                               rmtReceiveCompleted(digitalPinToGPIONumber(pin))
+#define rmtReadContinuous(pin, num_buffers, buffer_symbols)    rmtReadContinuous(digitalPinToGPIONumber(pin), num_buffers, buffer_symbols)
+#define rmtReadContinuousFrame(pin, data, num_rmt_symbols, timeout_ms) \
+  rmtReadContinuousFrame(digitalPinToGPIONumber(pin), data, num_rmt_symbols, timeout_ms)
+#define rmtReadContinuousRelease(pin, data)                    rmtReadContinuousRelease(digitalPinToGPIONumber(pin), data)
+#define rmtReadContinuousOverruns(pin)                         rmtReadContinuousOverruns(digitalPinToGPIONumber(pin))
+#define rmtReadContinuousStop(pin)                             rmtReadContinuousStop(digitalPinToGPIONumber(pin))
 #define rmtSetRxMaxThreshold(pin, idle_thres_ticks)            rmtSetRxMaxThreshold(digitalPinToGPIONumber(pin), idle_thres_ticks)
 #define rmtSetCarrier(pin, carrier_en, carrier_level, frequency_Hz, duty_percent) \
   rmtSetCarrier(digitalPinToGPIONumber(pin), carrier_en, carrier_level, frequency_Hz, duty_percent)
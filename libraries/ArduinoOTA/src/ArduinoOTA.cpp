@@ -237,6 +237,8 @@ void ArduinoOTAClass::_onRx() {
 
 void ArduinoOTAClass::_runUpdate() {
   const char *partition_label = _partition_label.length() ? _partition_label.c_str() : NULL;
+  // keep reading the socket while the flash is erased and programmed
+  Update.setPipeline();
   if (!Update.begin(_size, _cmd, -1, LOW, partition_label)) {
 
     log_e("Begin ERROR: %s", Update.errorString());
@@ -0,0 +1,112 @@
+/*
+   BLE notification throughput
+
+   Streams notifications as fast as each connected client accepts them, using
+   BLECharacteristic::notifyAsync(), and prints every second the throughput of
+   each connection in kbit/s with its queue counters.
+
+   The messages are queued per connection and a notification carries as many of
+   them as fit in the MTU, so for the best throughput the client should request
+   a large MTU (up to 517) and, on chips supporting Bluetooth 5, the 2M PHY is
+   asked for on connection.
+
+   The service advertises itself as: 4fafc201-1fb5-459e-8fcc-c5c9c331914b
+   And has a characteristic of: beb5483e-36e1-4688-b7f5-ea07361b26a8
+*/
+#include <BLEDevice.h>
+#include <BLEServer.h>
+#include <BLEUtils.h>
+#include <BLE2902.h>
+
+#define SERVICE_UUID        "4fafc201-1fb5-459e-8fcc-c5c9c331914b"
+#define CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26a8"
+
+#define MESSAGE_SIZE    20  // a sensor sample
+#define MAX_CONNECTIONS 9
+
+BLEServer *pServer = NULL;
+BLECharacteristic *pCharacteristic = NULL;
+// by connection id
+volatile bool connected[MAX_CONNECTIONS];
+uint32_t lastSentBytes[MAX_CONNECTIONS];
+uint32_t sequence = 0;
+uint32_t lastReport = 0;
+
+class MyServerCallbacks : public BLEServerCallbacks {
+  void onConnect(BLEServer *pServer, esp_ble_gatts_cb_param_t *param) {
+    Serial.printf("Client %u connected\n", param->connect.conn_id);
+    if (param->connect.conn_id < MAX_CONNECTIONS) {
+      lastSentBytes[param->connect.conn_id] = 0;
+      connected[param->connect.conn_id] = true;
+    }
+    // short connection interval: 7.5 to 15 ms
+    pServer->updateConnParams(param->connect.remote_bda, 6, 12, 0, 400);
+#ifdef SOC_BLE_50_SUPPORTED
+    esp_ble_gap_set_preferred_phy(param->connect.remote_bda, 0, ESP_BLE_GAP_PHY_2M_PREF_MASK, ESP_BLE_GAP_PHY_2M_PREF_MASK, ESP_BLE_GAP_PHY_OPTIONS_NO_PREF);
+#endif
+    pServer->startAdvertising();  // accept more clients
+  }
+
+  void onDisconnect(BLEServer *pServer, esp_ble_gatts_cb_param_t *param) {
+    Serial.printf("Client %u disconnected\n", param->disconnect.conn_id);
+    if (param->disconnect.conn_id < MAX_CONNECTIONS) {
+      connected[param->disconnect.conn_id] = false;
+    }
+    pServer->startAdvertising();
+  }
+};
+
+void setup() {
+  Serial.begin(115200);
+
+  BLEDevice::init("ESP32 throughput");
+  BLEDevice::setMTU(517);
+
+  pServer = BLEDevice::createServer();
+  pServer->setCallbacks(new MyServerCallbacks());
+
+  BLEService *pService = pServer->createService(SERVICE_UUID);
+  pCharacteristic = pService->createCharacteristic(CHARACTERISTIC_UUID, BLECharacteristic::PROPERTY_NOTIFY);
+  pCharacteristic->addDescriptor(new BLE2902());
+  // 8 KB of messages per connection, 8 notifications in flight
+  pCharacteristic->setNotifyQueue(8192, 8);
+  pService->start();
+
+  BLEAdvertising *pAdvertising = BLEDevice::getAdvertising();
+  pAdvertising->addServiceUUID(SERVICE_UUID);
+  BLEDevice::startAdvertising();
+  Serial.println("Waiting for clients to subscribe...");
+}
+
+void loop() {
+  // keep the queues fed, without flooding them
+  for (uint16_t connId = 0; connId < MAX_CONNECTIONS; connId++) {
+    ble_notify_stats_t stats;
+    while (connected[connId] && (!pCharacteristic->getNotifyStats(connId, &stats) || stats.pending < 4096)) {
+      uint8_t message[MESSAGE_SIZE];
+      memset(message, sequence & 0xFF, sizeof(message));
+      memcpy(message, &sequence, sizeof(sequence));
+      if (!pCharacteristic->notifyAsync(connId, message, sizeof(message))) {
+        break;  // not subscribed yet, or full
+      }
+      sequence++;
+    }
+  }
+
+  uint32_t now = millis();
+  if (now - lastReport >= 1000) {
+    for (uint16_t connId = 0; connId < MAX_CONNECTIONS; connId++) {
+      ble_notify_stats_t stats;
+      if (connected[connId] && pCharacteristic->getNotifyStats(connId, &stats)) {
+        uint32_t bytes = stats.sentBytes - lastSentBytes[connId];
+        lastSentBytes[connId] = stats.sentBytes;
+        Serial.printf(
+          "conn %u: %6.1f kbit/s, %lu notifications, %lu queued, %lu dropped, %lu failed, %lu congestions, %lu bytes pending\n", connId,
+          bytes * 8.0f / (now - lastReport), stats.sent, stats.queued, stats.dropped, stats.failed, stats.congestions, stats.pending
+        );
+      }
+    }
+    lastReport = now;
+  }
+  delay(1);
+}
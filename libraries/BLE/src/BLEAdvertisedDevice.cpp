@@ -16,28 +16,28 @@
 #include "sdkconfig.h"
 #if defined(CONFIG_BLUEDROID_ENABLED)
 #include <sstream>
+#include <string.h>
 #include "BLEAdvertisedDevice.h"
 #include "BLEUtils.h"
 #include "esp32-hal-log.h"
 
+// UUIDs are sent least significant byte first
+static BLEUUID uuidFromData(const uint8_t *data, size_t size) {
+  switch (size) {
+    case 2:  return BLEUUID((uint16_t)(data[0] | (data[1] << 8)));
+    case 4:  return BLEUUID((uint32_t)(data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24)));
+    case 16: return BLEUUID((uint8_t *)data, 16, false);
+    default: return BLEUUID();
+  }
+}
+
 BLEAdvertisedDevice::BLEAdvertisedDevice() {
   m_adFlag = 0;
-  m_appearance = 0;
-  m_deviceType = 0;
-  m_manufacturerData = "";
-  m_name = "";
   m_rssi = -9999;
-  m_serviceUUIDs = {};
-  m_serviceData = {};
-  m_serviceDataUUIDs = {};
-  m_txPower = 0;
   m_pScan = nullptr;
+  m_addressType = BLE_ADDR_TYPE_PUBLIC;
 
-  m_haveAppearance = false;
-  m_haveManufacturerData = false;
-  m_haveName = false;
   m_haveRSSI = false;
-  m_haveTXPower = false;
 
 }  // BLEAdvertisedDevice
 
@@ -62,7 +62,9 @@ BLEAddress BLEAdvertisedDevice::getAddress() {
  * @return The appearance of the advertised device.
  */
 uint16_t BLEAdvertisedDevice::getAppearance() {
-  return m_appearance;
+  size_t length;
+  const uint8_t *data = getView().findData(ESP_BLE_AD_TYPE_APPEARANCE, &length);
+  return length >= 2 ? data[0] | (data[1] << 8) : 0;
 }  // getAppearance
 
 /**
@@ -70,7 +72,9 @@ uint16_t BLEAdvertisedDevice::getAppearance() {
  * @return The manufacturer data of the advertised device.
  */
 String BLEAdvertisedDevice::getManufacturerData() {
-  return m_manufacturerData;
+  size_t length;
+  const uint8_t *data = getView().findData(ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE, &length);
+  return data ? String((const char *)data, length) : String();
 }  // getManufacturerData
 
 /**
@@ -78,7 +82,9 @@ String BLEAdvertisedDevice::getManufacturerData() {
  * @return The name of the advertised device.
  */
 String BLEAdvertisedDevice::getName() {
-  return m_name;
+  size_t length;
+  const uint8_t *data = getView().findData(ESP_BLE_AD_TYPE_NAME_CMPL, &length);
+  return data ? String((const char *)data, length) : String();
 }  // getName
 
 /**
@@ -102,7 +108,7 @@ BLEScan *BLEAdvertisedDevice::getScan() {
  * @return Number of service data discovered.
  */
 int BLEAdvertisedDevice::getServiceDataCount() {
-  return m_serviceData.size();
+  return getView().getServiceDataCount();
 }  //getServiceDataCount
 
 /**
@@ -110,7 +116,7 @@ int BLEAdvertisedDevice::getServiceDataCount() {
  * @return The ServiceData of the advertised device.
  */
 String BLEAdvertisedDevice::getServiceData() {
-  return m_serviceData.empty() ? String() : m_serviceData.front();
+  return getServiceData(0);
 }  //getServiceData
 
 /**
@@ -118,7 +124,9 @@ String BLEAdvertisedDevice::getServiceData() {
  * @return The ServiceData of the advertised device.
  */
 String BLEAdvertisedDevice::getServiceData(int i) {
-  return m_serviceData[i];
+  size_t uuidSize, length;
+  const uint8_t *data = getView().getServiceData(i, &uuidSize, &length);
+  return data ? String((const char *)data + uuidSize, length) : String();
 }  //getServiceData
 
 /**
@@ -126,7 +134,7 @@ String BLEAdvertisedDevice::getServiceData(int i) {
  * @return Number of service data UUIDs discovered.
  */
 int BLEAdvertisedDevice::getServiceDataUUIDCount() {
-  return m_serviceDataUUIDs.size();
+  return getView().getServiceDataCount();
 }  //getServiceDataUUIDCount
 
 /**
@@ -134,7 +142,7 @@ int BLEAdvertisedDevice::getServiceDataUUIDCount() {
  * @return The service data UUID.
  */
 BLEUUID BLEAdvertisedDevice::getServiceDataUUID() {
-  return m_serviceDataUUIDs.empty() ? BLEUUID() : m_serviceDataUUIDs.front();
+  return getServiceDataUUID(0);
 }  // getServiceDataUUID
 
 /**
@@ -142,7 +150,9 @@ BLEUUID BLEAdvertisedDevice::getServiceDataUUID() {
  * @return The service data UUID.
  */
 BLEUUID BLEAdvertisedDevice::getServiceDataUUID(int i) {
-  return m_serviceDataUUIDs[i];
+  size_t uuidSize, length;
+  const uint8_t *data = getView().getServiceData(i, &uuidSize, &length);
+  return uuidFromData(data, uuidSize);
 }  // getServiceDataUUID
 
 /**
@@ -150,7 +160,7 @@ BLEUUID BLEAdvertisedDevice::getServiceDataUUID(int i) {
  * @return Number of service UUIDs discovered.
  */
 int BLEAdvertisedDevice::getServiceUUIDCount() {
-  return m_serviceUUIDs.size();
+  return getView().getServiceUUIDCount();
 }  //getServiceUUIDCount
 
 /**
@@ -158,7 +168,7 @@ int BLEAdvertisedDevice::getServiceUUIDCount() {
  * @return The Service UUID of the advertised device.
  */
 BLEUUID BLEAdvertisedDevice::getServiceUUID() {
-  return m_serviceUUIDs.empty() ? BLEUUID() : m_serviceUUIDs.front();
+  return getServiceUUID(0);
 }  // getServiceUUID
 
 /**
@@ -166,7 +176,9 @@ BLEUUID BLEAdvertisedDevice::getServiceUUID() {
  * @return The Service UUID of the advertised device.
  */
 BLEUUID BLEAdvertisedDevice::getServiceUUID(int i) {
-  return m_serviceUUIDs[i];
+  size_t size;
+  const uint8_t *data = getView().getServiceUUID(i, &size);
+  return uuidFromData(data, size);
 }  // getServiceUUID
 
 /**
@@ -174,8 +186,11 @@ BLEUUID BLEAdvertisedDevice::getServiceUUID(int i) {
  * @return Return true if service is advertised
  */
 bool BLEAdvertisedDevice::isAdvertisingService(BLEUUID uuid) {
-  for (int i = 0; i < getServiceUUIDCount(); i++) {
-    if (m_serviceUUIDs[i].equals(uuid)) {
+  BLEAdvertisementView view = getView();
+  size_t size;
+  const uint8_t *data;
+  for (size_t i = 0; (data = view.getServiceUUID(i, &size)) != nullptr; i++) {
+    if (uuidFromData(data, size).equals(uuid)) {
       return true;
     }
   }
@@ -187,7 +202,9 @@ bool BLEAdvertisedDevice::isAdvertisingService(BLEUUID uuid) {
  * @return The TX Power of the advertised device.
  */
 int8_t BLEAdvertisedDevice::getTXPower() {
-  return m_txPower;
+  size_t length;
+  const uint8_t *data = getView().findData(ESP_BLE_AD_TYPE_TX_PWR, &length);
+  return length >= 1 ? (int8_t)data[0] : 0;
 }  // getTXPower
 
 /**
@@ -195,7 +212,9 @@ int8_t BLEAdvertisedDevice::getTXPower() {
  * @return True if there is an appearance value present.
  */
 bool BLEAdvertisedDevice::haveAppearance() {
-  return m_haveAppearance;
+  size_t length;
+  getView().findData(ESP_BLE_AD_TYPE_APPEARANCE, &length);
+  return length >= 2;
 }  // haveAppearance
 
 /**
@@ -203,7 +222,7 @@ bool BLEAdvertisedDevice::haveAppearance() {
  * @return True if there is manufacturer data present.
  */
 bool BLEAdvertisedDevice::haveManufacturerData() {
-  return m_haveManufacturerData;
+  return getView().find(ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE) >= 0;
 }  // haveManufacturerData
 
 /**
@@ -211,7 +230,7 @@ bool BLEAdvertisedDevice::haveManufacturerData() {
  * @return True if there is a name value present.
  */
 bool BLEAdvertisedDevice::haveName() {
-  return m_haveName;
+  return getView().find(ESP_BLE_AD_TYPE_NAME_CMPL) >= 0;
 }  // haveName
 
 /**
@@ -227,7 +246,7 @@ bool BLEAdvertisedDevice::haveRSSI() {
  * @return True if there is a service data value present.
  */
 bool BLEAdvertisedDevice::haveServiceData() {
-  return !m_serviceData.empty();
+  return getView().getServiceDataCount() != 0;
 }  // haveServiceData
 
 /**
@@ -235,7 +254,7 @@ bool BLEAdvertisedDevice::haveServiceData() {
  * @return True if there is a service UUID value present.
  */
 bool BLEAdvertisedDevice::haveServiceUUID() {
-  return !m_serviceUUIDs.empty();
+  return getView().getServiceUUIDCount() != 0;
 }  // haveServiceUUID
 
 /**
@@ -243,7 +262,9 @@ bool BLEAdvertisedDevice::haveServiceUUID() {
  * @return True if there is a transmission power value present.
  */
 bool BLEAdvertisedDevice::haveTXPower() {
-  return m_haveTXPower;
+  size_t length;
+  getView().findData(ESP_BLE_AD_TYPE_TX_PWR, &length);
+  return length >= 1;
 }  // haveTXPower
 
 /**
@@ -259,157 +280,43 @@ bool BLEAdvertisedDevice::haveTXPower() {
  * https://www.bluetooth.com/specifications/assigned-numbers/generic-access-profile
  */
 void BLEAdvertisedDevice::parseAdvertisement(uint8_t *payload, size_t total_len) {
-  uint8_t length;
-  uint8_t ad_type;
-  uint8_t sizeConsumed = 0;
-  bool finished = false;
-  m_payload = payload;
-  m_payloadLength = total_len;
-
-  while (!finished) {
-    length = *payload;           // Retrieve the length of the record.
-    payload++;                   // Skip to type
-    sizeConsumed += 1 + length;  // increase the size consumed.
-
-    if (length != 0) {  // A length of 0 indicates that we have reached the end.
-      ad_type = *payload;
-      payload++;
-      length--;
-
-      char *pHex = BLEUtils::buildHexData(nullptr, payload, length);
-      log_d("Type: 0x%.2x (%s), length: %d, data: %s", ad_type, BLEUtils::advTypeToString(ad_type), length, pHex);
-      free(pHex);
-
-      switch (ad_type) {
-        case ESP_BLE_AD_TYPE_NAME_CMPL:
-        {  // Adv Data Type: 0x09
-          setName(String(reinterpret_cast<char *>(payload), length));
-          break;
-        }  // ESP_BLE_AD_TYPE_NAME_CMPL
-
-        case ESP_BLE_AD_TYPE_TX_PWR:
-        {  // Adv Data Type: 0x0A
-          setTXPower(*payload);
-          break;
-        }  // ESP_BLE_AD_TYPE_TX_PWR
-
-        case ESP_BLE_AD_TYPE_APPEARANCE:
-        {  // Adv Data Type: 0x19
-          setAppearance(*reinterpret_cast<uint16_t *>(payload));
-          break;
-        }  // ESP_BLE_AD_TYPE_APPEARANCE
-
-        case ESP_BLE_AD_TYPE_FLAG:
-        {  // Adv Data Type: 0x01
-          setAdFlag(*payload);
-          break;
-        }  // ESP_BLE_AD_TYPE_FLAG
-
-        case ESP_BLE_AD_TYPE_16SRV_CMPL:
-        case ESP_BLE_AD_TYPE_16SRV_PART:
-        {  // Adv Data Type: 0x02
-          for (int var = 0; var < length / 2; ++var) {
-            setServiceUUID(BLEUUID(*reinterpret_cast<uint16_t *>(payload + var * 2)));
-          }
-          break;
-        }  // ESP_BLE_AD_TYPE_16SRV_PART
-
-        case ESP_BLE_AD_TYPE_32SRV_CMPL:
-        case ESP_BLE_AD_TYPE_32SRV_PART:
-        {  // Adv Data Type: 0x04
-          for (int var = 0; var < length / 4; ++var) {
-            setServiceUUID(BLEUUID(*reinterpret_cast<uint32_t *>(payload + var * 4)));
-          }
-          break;
-        }  // ESP_BLE_AD_TYPE_32SRV_PART
-
-        case ESP_BLE_AD_TYPE_128SRV_CMPL:
-        {  // Adv Data Type: 0x07
-          setServiceUUID(BLEUUID(payload, 16, false));
-          break;
-        }  // ESP_BLE_AD_TYPE_128SRV_CMPL
-
-        case ESP_BLE_AD_TYPE_128SRV_PART:
-        {  // Adv Data Type: 0x06
-          setServiceUUID(BLEUUID(payload, 16, false));
-          break;
-        }  // ESP_BLE_AD_TYPE_128SRV_PART
-
-        // See CSS Part A 1.4 Manufacturer Specific Data
-        case ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE:
-        {
-          setManufacturerData(String(reinterpret_cast<char *>(payload), length));
-          break;
-        }  // ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE
-
-        case ESP_BLE_AD_TYPE_SERVICE_DATA:
-        {  // Adv Data Type: 0x16 (Service Data) - 2 byte UUID
-          if (length < 2) {
-            log_e("Length too small for ESP_BLE_AD_TYPE_SERVICE_DATA");
-            break;
-          }
-          uint16_t uuid = *(uint16_t *)payload;
-          setServiceDataUUID(BLEUUID(uuid));
-          if (length > 2) {
-            setServiceData(String(reinterpret_cast<char *>(payload + 2), length - 2));
-          }
-          break;
-        }  //ESP_BLE_AD_TYPE_SERVICE_DATA
-
-        case ESP_BLE_AD_TYPE_32SERVICE_DATA:
-        {  // Adv Data Type: 0x20 (Service Data) - 4 byte UUID
-          if (length < 4) {
-            log_e("Length too small for ESP_BLE_AD_TYPE_32SERVICE_DATA");
-            break;
-          }
-          uint32_t uuid = *(uint32_t *)payload;
-          setServiceDataUUID(BLEUUID(uuid));
-          if (length > 4) {
-            setServiceData(String(reinterpret_cast<char *>(payload + 4), length - 4));
-          }
-          break;
-        }  //ESP_BLE_AD_TYPE_32SERVICE_DATA
-
-        case ESP_BLE_AD_TYPE_128SERVICE_DATA:
-        {  // Adv Data Type: 0x21 (Service Data) - 16 byte UUID
-          if (length < 16) {
-            log_e("Length too small for ESP_BLE_AD_TYPE_128SERVICE_DATA");
-            break;
-          }
-
-          setServiceDataUUID(BLEUUID(payload, (size_t)16, false));
-          if (length > 16) {
-            setServiceData(String(reinterpret_cast<char *>(payload + 16), length - 16));
-          }
-          break;
-        }  //ESP_BLE_AD_TYPE_32SERVICE_DATA
-
-        default:
-        {
-          log_d("Unhandled type: adType: %d - 0x%.2x", ad_type, ad_type);
-          break;
-        }
-      }  // switch
-      payload += length;
-    }  // Length <> 0
-
-    if (sizeConsumed >= total_len) {
-      finished = true;
-    }
-
-  }  // !finished
+  setPayload(payload, total_len);
+
+  // The fields are only decoded when asked for, the records are walked here for the debug log only.
+#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_DEBUG
+  BLEAdvertisementView view = getView();
+  for (size_t i = 0; i < view.getCount(); i++) {
+    size_t length;
+    uint8_t *data = (uint8_t *)view.getData(i, &length);
+    char *pHex = BLEUtils::buildHexData(nullptr, data, length);
+    log_d("Type: 0x%.2x (%s), length: %d, data: %s", view.getType(i), BLEUtils::advTypeToString(view.getType(i)), length, pHex);
+    free(pHex);
+  }
+#endif
 }  // parseAdvertisement
 
 /**
- * @brief Parse the advertising payload.
+ * @brief Set the advertising payload.
+ * The payload is copied, its fields are decoded when asked for.
  * @param [in] payload The payload of the advertised device.
  * @param [in] total_len The length of payload
  */
 void BLEAdvertisedDevice::setPayload(uint8_t *payload, size_t total_len) {
-  m_payload = payload;
+  if (total_len > sizeof(m_payload)) {
+    total_len = sizeof(m_payload);
+  }
+  memcpy(m_payload, payload, total_len);
   m_payloadLength = total_len;
 }  // setPayload
 
+/**
+ * @brief Get the index of the AD structures of the payload, to read fields without copying them.
+ * @return A view of the payload, valid as long as this device.
+ */
+BLEAdvertisementView BLEAdvertisedDevice::getView() {
+  return BLEAdvertisementView(m_payload, m_payloadLength);
+}  // getView
+
 /**
  * @brief Set the address of the advertised device.
  * @param [in] address The address of the advertised device.
@@ -426,38 +333,6 @@ void BLEAdvertisedDevice::setAdFlag(uint8_t adFlag) {
   m_adFlag = adFlag;
 }  // setAdFlag
 
-/**
- * @brief Set the appearance for this device.
- * @param [in] The discovered appearance.
- */
-void BLEAdvertisedDevice::setAppearance(uint16_t appearance) {
-  m_appearance = appearance;
-  m_haveAppearance = true;
-  log_d("- appearance: %d", m_appearance);
-}  // setAppearance
-
-/**
- * @brief Set the manufacturer data for this device.
- * @param [in] The discovered manufacturer data.
- */
-void BLEAdvertisedDevice::setManufacturerData(String manufacturerData) {
-  m_manufacturerData = manufacturerData;
-  m_haveManufacturerData = true;
-  char *pHex = BLEUtils::buildHexData(nullptr, (uint8_t *)m_manufacturerData.c_str(), (uint8_t)m_manufacturerData.length());
-  log_d("- manufacturer data: %s", pHex);
-  free(pHex);
-}  // setManufacturerData
-
-/**
- * @brief Set the name for this device.
- * @param [in] name The discovered name.
- */
-void BLEAdvertisedDevice::setName(String name) {
-  m_name = name;
-  m_haveName = true;
-  log_d("- setName(): name: %s", m_name.c_str());
-}  // setName
-
 /**
  * @brief Set the RSSI for this device.
  * @param [in] rssi The discovered RSSI.
@@ -476,50 +351,6 @@ void BLEAdvertisedDevice::setScan(BLEScan *pScan) {
   m_pScan = pScan;
 }  // setScan
 
-/**
- * @brief Set the Service UUID for this device.
- * @param [in] serviceUUID The discovered serviceUUID
- */
-void BLEAdvertisedDevice::setServiceUUID(const char *serviceUUID) {
-  return setServiceUUID(BLEUUID(serviceUUID));
-}  // setServiceUUID
-
-/**
- * @brief Set the Service UUID for this device.
- * @param [in] serviceUUID The discovered serviceUUID
- */
-void BLEAdvertisedDevice::setServiceUUID(BLEUUID serviceUUID) {
-  m_serviceUUIDs.push_back(serviceUUID);
-  log_d("- addServiceUUID(): serviceUUID: %s", serviceUUID.toString().c_str());
-}  // setServiceUUID
-
-/**
- * @brief Set the ServiceData value.
- * @param [in] data ServiceData value.
- */
-void BLEAdvertisedDevice::setServiceData(String serviceData) {
-  m_serviceData.push_back(serviceData);  // Save the service data that we received.
-}  //setServiceData
-
-/**
- * @brief Set the ServiceDataUUID value.
- * @param [in] data ServiceDataUUID value.
- */
-void BLEAdvertisedDevice::setServiceDataUUID(BLEUUID uuid) {
-  m_serviceDataUUIDs.push_back(uuid);
-  log_d("- addServiceDataUUID(): serviceDataUUID: %s", uuid.toString().c_str());
-}  // setServiceDataUUID
-
-/**
- * @brief Set the power level for this device.
- * @param [in] txPower The discovered power level.
- */
-void BLEAdvertisedDevice::setTXPower(int8_t txPower) {
-  m_txPower = txPower;
-  m_haveTXPower = true;
-  log_d("- txPower: %d", m_txPower);
-}  // setTXPower
-
 /**
  * @brief Create a string representation of this device.
  * @return A string representation of this device.
@@ -533,7 +364,8 @@ String BLEAdvertisedDevice::toString() {
     res += val;
   }
   if (haveManufacturerData()) {
-    char *pHex = BLEUtils::buildHexData(nullptr, (uint8_t *)getManufacturerData().c_str(), getManufacturerData().length());
+    String manufacturerData = getManufacturerData();
+    char *pHex = BLEUtils::buildHexData(nullptr, (uint8_t *)manufacturerData.c_str(), manufacturerData.length());
     res += ", manufacturer data: ";
     res += pHex;
     free(pHex);
@@ -572,16 +404,18 @@ esp_ble_addr_type_t BLEAdvertisedDevice::getAddressType() {
 }
 
 ble_frame_type_t BLEAdvertisedDevice::getFrameType() {
-  for (int i = 0; i < m_payloadLength; ++i) {
-    log_d("check [%d]=0x%02X", i, m_payload[i]);
-    if (m_payload[i] == 0x16 && m_payloadLength >= i + 3 && m_payload[i + 1] == 0xAA && m_payload[i + 2] == 0xFE && m_payload[i + 3] == 0x00) {
-      return BLE_EDDYSTONE_UUID_FRAME;
-    }
-    if (m_payload[i] == 0x16 && m_payloadLength >= i + 3 && m_payload[i + 1] == 0xAA && m_payload[i + 2] == 0xFE && m_payload[i + 3] == 0x10) {
-      return BLE_EDDYSTONE_URL_FRAME;
-    }
-    if (m_payload[i] == 0x16 && m_payloadLength >= i + 3 && m_payload[i + 1] == 0xAA && m_payload[i + 2] == 0xFE && m_payload[i + 3] == 0x20) {
-      return BLE_EDDYSTONE_TLM_FRAME;
+  // Eddystone frames are service data of the 0xFEAA service, the frame type being their first byte
+  BLEAdvertisementView view = getView();
+  for (int i = view.find(ESP_BLE_AD_TYPE_SERVICE_DATA); i >= 0; i = view.find(ESP_BLE_AD_TYPE_SERVICE_DATA, i + 1)) {
+    size_t length;
+    const uint8_t *data = view.getData(i, &length);
+    if (length >= 3 && data[0] == 0xAA && data[1] == 0xFE) {
+      switch (data[2]) {
+        case 0x00: return BLE_EDDYSTONE_UUID_FRAME;
+        case 0x10: return BLE_EDDYSTONE_URL_FRAME;
+        case 0x20: return BLE_EDDYSTONE_TLM_FRAME;
+        default:   break;
+      }
     }
   }
   return BLE_UNKNOWN_FRAME;
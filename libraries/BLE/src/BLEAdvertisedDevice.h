@@ -17,6 +17,7 @@
 #include <map>
 
 #include "BLEAddress.h"
+#include "BLEAdvertisementView.h"
 #include "BLEScan.h"
 #include "BLEUUID.h"
 
@@ -59,6 +60,7 @@ public:
   size_t getPayloadLength();
   esp_ble_addr_type_t getAddressType();
   ble_frame_type_t getFrameType();
+  BLEAdvertisementView getView();
   void setAddressType(esp_ble_addr_type_t type);
 
   bool isAdvertisingService(BLEUUID uuid);
@@ -74,42 +76,23 @@ public:
 
 private:
   friend class BLEScan;
+  friend class BLEScanReport;
 
   void parseAdvertisement(uint8_t *payload, size_t total_len = 62);
   void setPayload(uint8_t *payload, size_t total_len = 62);
   void setAddress(BLEAddress address);
   void setAdFlag(uint8_t adFlag);
-  void setAdvertizementResult(uint8_t *payload);
-  void setAppearance(uint16_t appearance);
-  void setManufacturerData(String manufacturerData);
-  void setName(String name);
   void setRSSI(int rssi);
   void setScan(BLEScan *pScan);
-  void setServiceData(String data);
-  void setServiceDataUUID(BLEUUID uuid);
-  void setServiceUUID(const char *serviceUUID);
-  void setServiceUUID(BLEUUID serviceUUID);
-  void setTXPower(int8_t txPower);
-
-  bool m_haveAppearance;
-  bool m_haveManufacturerData;
-  bool m_haveName;
+
   bool m_haveRSSI;
-  bool m_haveTXPower;
 
   BLEAddress m_address = BLEAddress((uint8_t *)"\0\0\0\0\0\0");
   uint8_t m_adFlag;
-  uint16_t m_appearance;
-  int m_deviceType;
-  String m_manufacturerData;
-  String m_name;
   BLEScan *m_pScan;
   int m_rssi;
-  std::vector<BLEUUID> m_serviceUUIDs;
-  int8_t m_txPower;
-  std::vector<String> m_serviceData;
-  std::vector<BLEUUID> m_serviceDataUUIDs;
-  uint8_t *m_payload;
+  // the fields are decoded from the payload when asked for
+  uint8_t m_payload[BLE_ADV_PAYLOAD_MAX];
   size_t m_payloadLength = 0;
   esp_ble_addr_type_t m_addressType;
 };
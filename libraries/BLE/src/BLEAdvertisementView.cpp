@@ -0,0 +1,181 @@
+/*
+ * BLEAdvertisementView.cpp
+ *
+ *  An index of the AD structures of an advertising payload, decoded on demand.
+ *
+ * See also:
+ * https://www.bluetooth.com/specifications/assigned-numbers/generic-access-profile
+ */
+#include "soc/soc_caps.h"
+#if SOC_BLE_SUPPORTED
+
+#include "sdkconfig.h"
+#if defined(CONFIG_BLUEDROID_ENABLED)
+
+#include "BLEAdvertisementView.h"
+
+// size of the service UUIDs listed by an AD structure, 0 if it is not a list of service UUIDs
+static size_t serviceUUIDSize(uint8_t adType) {
+  switch (adType) {
+    case ESP_BLE_AD_TYPE_16SRV_PART:
+    case ESP_BLE_AD_TYPE_16SRV_CMPL:  return 2;
+    case ESP_BLE_AD_TYPE_32SRV_PART:
+    case ESP_BLE_AD_TYPE_32SRV_CMPL:  return 4;
+    case ESP_BLE_AD_TYPE_128SRV_PART:
+    case ESP_BLE_AD_TYPE_128SRV_CMPL: return 16;
+    default:                          return 0;
+  }
+}
+
+// size of the UUID heading a service data AD structure, 0 if it is not service data
+static size_t serviceDataUUIDSize(uint8_t adType) {
+  switch (adType) {
+    case ESP_BLE_AD_TYPE_SERVICE_DATA:    return 2;
+    case ESP_BLE_AD_TYPE_32SERVICE_DATA:  return 4;
+    case ESP_BLE_AD_TYPE_128SERVICE_DATA: return 16;
+    default:                              return 0;
+  }
+}
+
+/**
+ * @brief Index the AD structures of a payload.
+ * @param [in] payload The advertising data, followed by the scan response if any.
+ * @param [in] length The length of the payload.
+ */
+BLEAdvertisementView::BLEAdvertisementView(const uint8_t *payload, size_t length) : m_payload(payload), m_count(0) {
+  if (length > BLE_ADV_PAYLOAD_MAX) {
+    length = BLE_ADV_PAYLOAD_MAX;
+  }
+  size_t pos = 0;
+  while (pos < length && m_count < BLE_ADV_STRUCTURES_MAX) {
+    uint8_t fieldLength = payload[pos];
+    if (fieldLength == 0) {  // padding
+      pos++;
+      continue;
+    }
+    if (pos + 1 + fieldLength > length) {  // truncated
+      break;
+    }
+    m_offsets[m_count++] = pos;
+    pos += 1 + fieldLength;
+  }
+}  // BLEAdvertisementView
+
+/**
+ * @brief Get the data of an AD structure.
+ * @param [in] i The index of the structure, between 0 and getCount() - 1.
+ * @param [out] length The length of its data.
+ * @return Its data, following the type byte.
+ */
+const uint8_t *BLEAdvertisementView::getData(size_t i, size_t *length) const {
+  *length = m_payload[m_offsets[i]] - 1;
+  return m_payload + m_offsets[i] + 2;
+}  // getData
+
+/**
+ * @brief Find an AD structure.
+ * @param [in] adType The type of the structure, e.g. ESP_BLE_AD_TYPE_NAME_CMPL.
+ * @param [in] from The index to start from, to find the next structures of the same type.
+ * @return The index of the structure, or -1 if there is none.
+ */
+int BLEAdvertisementView::find(uint8_t adType, size_t from) const {
+  for (size_t i = from; i < m_count; i++) {
+    if (getType(i) == adType) {
+      return i;
+    }
+  }
+  return -1;
+}  // find
+
+/**
+ * @brief Find the data of the first AD structure of a type.
+ * @param [in] adType The type of the structure.
+ * @param [out] length The length of its data, 0 if there is none.
+ * @return Its data, or nullptr if there is none.
+ */
+const uint8_t *BLEAdvertisementView::findData(uint8_t adType, size_t *length) const {
+  int i = find(adType);
+  if (i < 0) {
+    *length = 0;
+    return nullptr;
+  }
+  return getData(i, length);
+}  // findData
+
+/**
+ * @brief Get the number of service UUIDs listed by the 16, 32 and 128 bit service UUID structures.
+ */
+size_t BLEAdvertisementView::getServiceUUIDCount() const {
+  size_t count = 0;
+  for (size_t i = 0; i < m_count; i++) {
+    size_t size = serviceUUIDSize(getType(i));
+    if (size) {
+      size_t length;
+      getData(i, &length);
+      count += length / size;
+    }
+  }
+  return count;
+}  // getServiceUUIDCount
+
+/**
+ * @brief Get a service UUID.
+ * @param [in] n The index of the UUID, between 0 and getServiceUUIDCount() - 1.
+ * @param [out] size The size of the UUID: 2, 4 or 16 bytes.
+ * @return The UUID, least significant byte first, or nullptr if there is no such UUID.
+ */
+const uint8_t *BLEAdvertisementView::getServiceUUID(size_t n, size_t *size) const {
+  for (size_t i = 0; i < m_count; i++) {
+    *size = serviceUUIDSize(getType(i));
+    if (*size) {
+      size_t length;
+      const uint8_t *data = getData(i, &length);
+      if (n < length / *size) {
+        return data + n * *size;
+      }
+      n -= length / *size;
+    }
+  }
+  *size = 0;
+  return nullptr;
+}  // getServiceUUID
+
+/**
+ * @brief Get the number of service data structures.
+ */
+size_t BLEAdvertisementView::getServiceDataCount() const {
+  size_t count = 0;
+  for (size_t i = 0; i < m_count; i++) {
+    size_t uuidSize = serviceDataUUIDSize(getType(i));
+    size_t length;
+    getData(i, &length);
+    if (uuidSize && length >= uuidSize) {
+      count++;
+    }
+  }
+  return count;
+}  // getServiceDataCount
+
+/**
+ * @brief Get a service data structure.
+ * @param [in] n The index of the service data, between 0 and getServiceDataCount() - 1.
+ * @param [out] uuidSize The size of the service UUID heading the data: 2, 4 or 16 bytes.
+ * @param [out] length The length of the data following the UUID.
+ * @return The UUID, least significant byte first, followed by the data, or nullptr if there is no such service data.
+ */
+const uint8_t *BLEAdvertisementView::getServiceData(size_t n, size_t *uuidSize, size_t *length) const {
+  for (size_t i = 0; i < m_count; i++) {
+    *uuidSize = serviceDataUUIDSize(getType(i));
+    const uint8_t *data = getData(i, length);
+    if (*uuidSize && *length >= *uuidSize && n-- == 0) {
+      *length -= *uuidSize;
+      return data;
+    }
+  }
+  *uuidSize = 0;
+  *length = 0;
+  return nullptr;
+}  // getServiceData
+
+#endif /* CONFIG_BLUEDROID_ENABLED */
+#endif /* SOC_BLE_SUPPORTED */
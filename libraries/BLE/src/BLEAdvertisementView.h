@@ -0,0 +1,56 @@
+/*
+ * BLEAdvertisementView.h
+ *
+ *  An index of the AD structures of an advertising payload, decoded on demand.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLEADVERTISEMENTVIEW_H_
+#define COMPONENTS_CPP_UTILS_BLEADVERTISEMENTVIEW_H_
+#include "soc/soc_caps.h"
+#if SOC_BLE_SUPPORTED
+
+#include "sdkconfig.h"
+#if defined(CONFIG_BLUEDROID_ENABLED)
+#include <esp_gap_ble_api.h>
+
+// advertising data and scan response
+#define BLE_ADV_PAYLOAD_MAX 62
+// each AD structure takes at least its length and type bytes
+#define BLE_ADV_STRUCTURES_MAX (BLE_ADV_PAYLOAD_MAX / 2)
+
+/**
+ * @brief A view of the AD structures of an advertising payload.
+ *
+ * The constructor only records the offset of each [length][type][data...] structure; the data
+ * stays in the payload, which must outlive the view, and is decoded by the caller when asked for.
+ * Zero length structures are padding and skipped, a structure running past the end of the
+ * payload ends it.
+ */
+class BLEAdvertisementView {
+public:
+  BLEAdvertisementView(const uint8_t *payload, size_t length);
+
+  size_t getCount() const {
+    return m_count;
+  }
+  uint8_t getType(size_t i) const {
+    return m_payload[m_offsets[i] + 1];
+  }
+  const uint8_t *getData(size_t i, size_t *length) const;
+  int find(uint8_t adType, size_t from = 0) const;
+  const uint8_t *findData(uint8_t adType, size_t *length) const;
+
+  size_t getServiceUUIDCount() const;
+  const uint8_t *getServiceUUID(size_t n, size_t *size) const;
+  size_t getServiceDataCount() const;
+  const uint8_t *getServiceData(size_t n, size_t *uuidSize, size_t *length) const;
+
+private:
+  const uint8_t *m_payload;
+  uint8_t m_offsets[BLE_ADV_STRUCTURES_MAX];
+  uint8_t m_count;
+};  // BLEAdvertisementView
+
+#endif /* CONFIG_BLUEDROID_ENABLED */
+#endif /* SOC_BLE_SUPPORTED */
+#endif /* COMPONENTS_CPP_UTILS_BLEADVERTISEMENTVIEW_H_ */
@@ -51,6 +51,8 @@ BLECharacteristic::BLECharacteristic(BLEUUID uuid, uint32_t properties) {
   setNotifyProperty((properties & PROPERTY_NOTIFY) != 0);
   setIndicateProperty((properties & PROPERTY_INDICATE) != 0);
   setWriteNoResponseProperty((properties & PROPERTY_WRITE_NR) != 0);
+
+  m_notifyMutex = xSemaphoreCreateMutex();
 }  // BLECharacteristic
 
 /**
@@ -58,6 +60,11 @@ BLECharacteristic::BLECharacteristic(BLEUUID uuid, uint32_t properties) {
  */
 BLECharacteristic::~BLECharacteristic() {
   //free(m_value.attr_value); // Release the storage for the value.
+  for (auto &queue : m_notifyQueues) {
+    delete queue.second;
+  }
+  free(m_notifyBuffer);
+  vSemaphoreDelete(m_notifyMutex);
 }  // ~BLECharacteristic
 
 /**
@@ -416,6 +423,37 @@ void BLECharacteristic::handleGATTServerEvent(esp_gatts_cb_event_t event, esp_ga
           == getService()->getServer()->getConnId()) {  // && param->conf.handle == m_handle) // bug in esp-idf and not implemented in arduino yet
         m_semaphoreConfEvt.give(param->conf.status);
       }
+      // A notification of the queue has been handed to L2CAP, its credit can be used for the next one.
+      // ESP_GATT_CONGESTED means that it was accepted but the link is now congested.
+      if (param->conf.handle == m_handle && !m_notifyQueues.empty()) {
+        xSemaphoreTake(m_notifyMutex, portMAX_DELAY);
+        auto it = m_notifyQueues.find(param->conf.conn_id);
+        if (it != m_notifyQueues.end()) {
+          it->second->onConfirm(param->conf.status == ESP_GATT_OK || param->conf.status == ESP_GATT_CONGESTED);
+          sendNotifyQueues();
+        }
+        xSemaphoreGive(m_notifyMutex);
+      }
+      break;
+    }
+
+    // ESP_GATTS_CONGEST_EVT
+    //
+    // congest:
+    // - uint16_t conn_id   – The connection used.
+    // - bool     congested – Whether the link is congested.
+    //
+    case ESP_GATTS_CONGEST_EVT:
+    {
+      if (!m_notifyQueues.empty()) {
+        xSemaphoreTake(m_notifyMutex, portMAX_DELAY);
+        auto it = m_notifyQueues.find(param->congest.conn_id);
+        if (it != m_notifyQueues.end()) {
+          it->second->setCongested(param->congest.congested);
+          sendNotifyQueues();
+        }
+        xSemaphoreGive(m_notifyMutex);
+      }
       break;
     }
 
@@ -427,6 +465,18 @@ void BLECharacteristic::handleGATTServerEvent(esp_gatts_cb_event_t event, esp_ga
     case ESP_GATTS_DISCONNECT_EVT:
     {
       m_semaphoreConfEvt.give();
+      if (!m_notifyQueues.empty()) {
+        xSemaphoreTake(m_notifyMutex, portMAX_DELAY);
+        auto it = m_notifyQueues.find(param->disconnect.conn_id);
+        if (it != m_notifyQueues.end()) {
+          if (m_notifyInFlight == it->second) {
+            m_notifyInFlight = nullptr;
+          }
+          delete it->second;
+          m_notifyQueues.erase(it);
+        }
+        xSemaphoreGive(m_notifyMutex);
+      }
       break;
     }
 
@@ -533,6 +583,159 @@ void BLECharacteristic::notify(bool is_notification) {
   log_v("<< notify");
 }  // Notify
 
+/**
+ * @brief Queue a notification to every connected client, without waiting for it to be sent.
+ *
+ * Each connection has its own queue, sent as fast as the stack accepts notifications: a
+ * notification carries as many whole queued messages as fit in the MTU of the connection, and
+ * sending pauses while the connection is congested. Notifications are dropped, and counted as
+ * such, when the queue of the connection is full. Avoid mixing with notify() on the same
+ * characteristic, whose confirmations would be counted as those of the queue.
+ * @param [in] data The message to notify.
+ * @param [in] length The length of the message.
+ * @return The number of connections the message was queued to.
+ */
+size_t BLECharacteristic::notifyAsync(const uint8_t *data, size_t length) {
+  BLE2902 *p2902 = (BLE2902 *)getDescriptorByUUID((uint16_t)0x2902);
+  if (p2902 != nullptr && !p2902->getNotifications()) {
+    return 0;
+  }
+  size_t count = 0;
+  xSemaphoreTake(m_notifyMutex, portMAX_DELAY);
+  for (auto &peer : getService()->getServer()->m_connectedServersMap) {
+    if (queueNotify(peer.first, data, length)) {
+      count++;
+    }
+  }
+  xSemaphoreGive(m_notifyMutex);
+  return count;
+}  // notifyAsync
+
+/**
+ * @brief Queue a notification to one connected client, without waiting for it to be sent.
+ * @param [in] connId The connection of the client.
+ * @param [in] data The message to notify.
+ * @param [in] length The length of the message.
+ * @return False if the message was dropped.
+ */
+bool BLECharacteristic::notifyAsync(uint16_t connId, const uint8_t *data, size_t length) {
+  BLE2902 *p2902 = (BLE2902 *)getDescriptorByUUID((uint16_t)0x2902);
+  if (p2902 != nullptr && !p2902->getNotifications()) {
+    return false;
+  }
+  if (getService()->getServer()->m_connectedServersMap.count(connId) == 0) {
+    return false;
+  }
+  xSemaphoreTake(m_notifyMutex, portMAX_DELAY);
+  bool queued = queueNotify(connId, data, length);
+  xSemaphoreGive(m_notifyMutex);
+  return queued;
+}  // notifyAsync
+
+/**
+ * @brief Queue a message for a connection and send what can be sent, m_notifyMutex being held.
+ */
+bool BLECharacteristic::queueNotify(uint16_t connId, const uint8_t *data, size_t length) {
+  BLENotifyQueue *pQueue;
+  auto it = m_notifyQueues.find(connId);
+  if (it != m_notifyQueues.end()) {
+    pQueue = it->second;
+  } else {
+    if (m_notifyBuffer == nullptr) {
+      m_notifyBuffer = (uint8_t *)malloc(ESP_GATT_MAX_MTU_SIZE - 3);
+      if (m_notifyBuffer == nullptr) {
+        log_e("No memory for the notification buffer");
+        return false;
+      }
+    }
+    pQueue = new BLENotifyQueue(connId, m_notifyQueueSize, m_notifyCredits);
+    m_notifyQueues[connId] = pQueue;
+  }
+  bool queued = pQueue->push(data, length);
+  sendNotifyQueues();
+  return queued;
+}  // queueNotify
+
+/**
+ * @brief Hand the queued notifications of all the connections to the stack while they have credits, m_notifyMutex being held.
+ * The stack is called with m_notifyMutex released: it may block on a full queue of the BTC task, while the BTC task
+ * waits for m_notifyMutex to confirm a notification. One caller sends at a time, the others leave their messages to it.
+ */
+void BLECharacteristic::sendNotifyQueues() {
+  if (m_notifySending) {
+    return;
+  }
+  m_notifySending = true;
+  auto &peers = getService()->getServer()->m_connectedServersMap;
+  bool sent;
+  do {
+    sent = false;
+    for (auto it = m_notifyQueues.begin(); it != m_notifyQueues.end();) {
+      BLENotifyQueue *pQueue = it->second;
+      uint16_t connId = it->first;
+      auto peer = peers.find(connId);
+      if (peer == peers.end() || !pQueue->canSend()) {
+        ++it;
+        continue;
+      }
+      uint16_t maxLength = peer->second.mtu - 3;
+      size_t length = pQueue->peek(m_notifyBuffer, maxLength);
+      pQueue->onSent(length);  // its credit is used before the confirmation can come
+      m_notifyInFlight = pQueue;
+      xSemaphoreGive(m_notifyMutex);
+      esp_err_t errRc = ::esp_ble_gatts_send_indicate(getService()->getServer()->getGattsIf(), connId, getHandle(), length, m_notifyBuffer, false);
+      xSemaphoreTake(m_notifyMutex, portMAX_DELAY);
+      // the connection may have closed meanwhile, deleting its queue
+      bool closed = m_notifyInFlight == nullptr;
+      m_notifyInFlight = nullptr;
+      it = m_notifyQueues.upper_bound(connId);
+      if (closed) {
+        continue;
+      }
+      if (errRc != ESP_OK) {
+        // left queued, sending resumes with the next confirmation or message
+        log_w("esp_ble_gatts_send_indicate: rc=%d %s", errRc, GeneralUtils::errorToString(errRc));
+        pQueue->onSendFailed(length);
+        continue;
+      }
+      // only this caller takes from the queues, the messages pushed meanwhile stay after this notification
+      pQueue->consume(length);
+      sent = true;
+    }
+  } while (sent);
+  m_notifySending = false;
+}  // sendNotifyQueues
+
+/**
+ * @brief Set the size of the notifyAsync() queues.
+ * It applies to the connections made afterwards.
+ * @param [in] size The size in bytes of the queue of each connection, each message taking 2 more bytes.
+ * @param [in] credits The number of notifications handed to the stack and not confirmed yet, per connection.
+ */
+void BLECharacteristic::setNotifyQueue(size_t size, uint8_t credits) {
+  xSemaphoreTake(m_notifyMutex, portMAX_DELAY);
+  m_notifyQueueSize = size;
+  m_notifyCredits = credits ? credits : 1;
+  xSemaphoreGive(m_notifyMutex);
+}  // setNotifyQueue
+
+/**
+ * @brief Get the counters of the notifyAsync() queue of a connection.
+ * @param [in] connId The connection of the client.
+ * @param [out] stats The counters, since the client connected.
+ * @return False if nothing was queued for this connection.
+ */
+bool BLECharacteristic::getNotifyStats(uint16_t connId, ble_notify_stats_t *stats) {
+  xSemaphoreTake(m_notifyMutex, portMAX_DELAY);
+  auto it = m_notifyQueues.find(connId);
+  bool found = it != m_notifyQueues.end();
+  if (found) {
+    it->second->getStats(stats);
+  }
+  xSemaphoreGive(m_notifyMutex);
+  return found;
+}  // getNotifyStats
+
 /**
  * @brief Set the permission to broadcast.
  * A characteristics has properties associated with it which define what it is capable of doing.
@@ -18,6 +18,7 @@
 #include <esp_gatts_api.h>
 #include <esp_gap_ble_api.h>
 #include "BLEDescriptor.h"
+#include "BLENotifyQueue.h"
 #include "BLEValue.h"
 #include "RTOS.h"
 
@@ -69,6 +70,10 @@ public:
 
   void indicate();
   void notify(bool is_notification = true);
+  size_t notifyAsync(const uint8_t *data, size_t length);
+  bool notifyAsync(uint16_t connId, const uint8_t *data, size_t length);
+  void setNotifyQueue(size_t size, uint8_t credits = BLE_NOTIFY_CREDITS);
+  bool getNotifyStats(uint16_t connId, ble_notify_stats_t *stats);
   void setBroadcastProperty(bool value);
   void setCallbacks(BLECharacteristicCallbacks *pCallbacks);
   void setIndicateProperty(bool value);
@@ -112,12 +117,23 @@ private:
   esp_gatt_perm_t m_permissions = ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE;
   bool m_writeEvt = false;  // If we have started a long write, this tells the commit code that we were the target
 
+  // notifyAsync() queues, by connection id, guarded by m_notifyMutex
+  std::map<uint16_t, BLENotifyQueue *> m_notifyQueues;
+  SemaphoreHandle_t m_notifyMutex;
+  size_t m_notifyQueueSize = BLE_NOTIFY_QUEUE_SIZE;
+  uint8_t m_notifyCredits = BLE_NOTIFY_CREDITS;
+  uint8_t *m_notifyBuffer = nullptr;
+  bool m_notifySending = false;                 // a caller is handing notifications to the stack, see sendNotifyQueues()
+  BLENotifyQueue *m_notifyInFlight = nullptr;  // the queue of the notification being handed, cleared if it is deleted meanwhile
+
   void handleGATTServerEvent(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
 
   void executeCreate(BLEService *pService);
   esp_gatt_char_prop_t getProperties();
   BLEService *getService();
   void setHandle(uint16_t handle);
+  bool queueNotify(uint16_t connId, const uint8_t *data, size_t length);
+  void sendNotifyQueues();
   FreeRTOS::Semaphore m_semaphoreCreateEvt = FreeRTOS::Semaphore("CreateEvt");
   FreeRTOS::Semaphore m_semaphoreConfEvt = FreeRTOS::Semaphore("ConfEvt");
   FreeRTOS::Semaphore m_semaphoreSetValue = FreeRTOS::Semaphore("SetValue");
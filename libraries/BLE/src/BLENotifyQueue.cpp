@@ -0,0 +1,181 @@
+/*
+ * BLENotifyQueue.cpp
+ *
+ *  Notifications waiting to be sent to one connection.
+ */
+#include "soc/soc_caps.h"
+#if SOC_BLE_SUPPORTED
+
+#include "sdkconfig.h"
+#if defined(CONFIG_BLUEDROID_ENABLED)
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "BLENotifyQueue.h"
+
+#define MESSAGE_HEADER 2  // 16 bit length of each message
+
+BLENotifyQueue::BLENotifyQueue(uint16_t connId, size_t size, uint8_t credits)
+  : m_connId(connId), m_size(size), m_head(0), m_used(0), m_offset(0), m_credits(credits), m_maxCredits(credits), m_congested(false) {
+  m_buffer = (uint8_t *)malloc(size);
+  if (m_buffer == nullptr) {
+    m_size = 0;
+  }
+  memset(&m_stats, 0, sizeof(m_stats));
+}  // BLENotifyQueue
+
+BLENotifyQueue::~BLENotifyQueue() {
+  free(m_buffer);
+}  // ~BLENotifyQueue
+
+/**
+ * @brief Copy bytes out of the ring buffer.
+ */
+void BLENotifyQueue::read(size_t pos, uint8_t *buffer, size_t length) const {
+  size_t first = m_size - pos;
+  if (first > length) {
+    first = length;
+  }
+  memcpy(buffer, m_buffer + pos, first);
+  memcpy(buffer + first, m_buffer, length - first);
+}  // read
+
+/**
+ * @brief Queue a message.
+ * @param [in] data The message.
+ * @param [in] length Its length, up to 65535 bytes.
+ * @return False if the message was dropped, the queue being full.
+ */
+bool BLENotifyQueue::push(const uint8_t *data, size_t length) {
+  if (length == 0) {
+    return true;
+  }
+  if (length > 0xFFFF || m_used + MESSAGE_HEADER + length > m_size) {
+    m_stats.dropped++;
+    return false;
+  }
+  uint8_t header[MESSAGE_HEADER] = {(uint8_t)length, (uint8_t)(length >> 8)};
+  const uint8_t *parts[] = {header, data};
+  size_t lengths[] = {MESSAGE_HEADER, length};
+  size_t tail = (m_head + m_used) % m_size;
+  for (int i = 0; i < 2; i++) {
+    size_t first = m_size - tail;
+    if (first > lengths[i]) {
+      first = lengths[i];
+    }
+    memcpy(m_buffer + tail, parts[i], first);
+    memcpy(m_buffer, parts[i] + first, lengths[i] - first);
+    tail = (tail + lengths[i]) % m_size;
+  }
+  m_used += MESSAGE_HEADER + length;
+  m_stats.queued++;
+  m_stats.pending += length;
+  return true;
+}  // push
+
+/**
+ * @brief Gather the next notification: the whole messages that fit, or a part of a longer message.
+ * @return The length of the notification, 0 if the queue is empty.
+ */
+size_t BLENotifyQueue::take(uint8_t *buffer, size_t maxLength, size_t *head, size_t *used, size_t *offset) const {
+  size_t length = 0;
+  while (*used != 0) {
+    size_t messageLength = m_buffer[*head] | (m_buffer[(*head + 1) % m_size] << 8);
+    size_t left = messageLength - *offset;
+    size_t data = (*head + MESSAGE_HEADER + *offset) % m_size;
+    if (left <= maxLength - length) {
+      if (buffer) {
+        read(data, buffer + length, left);
+      }
+      length += left;
+      *head = (*head + MESSAGE_HEADER + messageLength) % m_size;
+      *used -= MESSAGE_HEADER + messageLength;
+      *offset = 0;
+    } else {
+      if (length == 0) {  // longer than a notification
+        if (buffer) {
+          read(data, buffer, maxLength);
+        }
+        length = maxLength;
+        *offset += maxLength;
+      }
+      break;
+    }
+  }
+  return length;
+}  // take
+
+/**
+ * @brief Copy the next notification, leaving it in the queue.
+ * @param [out] buffer Where to copy it.
+ * @param [in] maxLength The maximum length of a notification, the MTU - 3.
+ * @return The length of the notification, 0 if the queue is empty.
+ */
+size_t BLENotifyQueue::peek(uint8_t *buffer, size_t maxLength) const {
+  size_t head = m_head, used = m_used, offset = m_offset;
+  return take(buffer, maxLength, &head, &used, &offset);
+}  // peek
+
+/**
+ * @brief Remove the notification returned by peek(), even if messages were pushed since.
+ * @param [in] length The length peek() returned.
+ */
+void BLENotifyQueue::consume(size_t length) {
+  m_stats.pending -= take(nullptr, length, &m_head, &m_used, &m_offset);
+}  // consume
+
+/**
+ * @brief Account a notification handed to the stack.
+ */
+void BLENotifyQueue::onSent(size_t length) {
+  if (m_credits) {
+    m_credits--;
+  }
+  m_stats.sent++;
+  m_stats.sentBytes += length;
+}  // onSent
+
+/**
+ * @brief Undo onSent() for a notification the stack refused, which stays queued.
+ */
+void BLENotifyQueue::onSendFailed(size_t length) {
+  if (m_credits < m_maxCredits) {
+    m_credits++;
+  }
+  m_stats.sent--;
+  m_stats.sentBytes -= length;
+}  // onSendFailed
+
+/**
+ * @brief Account the confirmation of a notification by the stack, giving its credit back.
+ * @param [in] success False if the stack could not send it.
+ */
+void BLENotifyQueue::onConfirm(bool success) {
+  if (m_credits < m_maxCredits) {
+    m_credits++;
+  }
+  if (!success) {
+    m_stats.failed++;
+  }
+}  // onConfirm
+
+/**
+ * @brief Pause or resume the sending on the congestion events of the connection.
+ */
+void BLENotifyQueue::setCongested(bool congested) {
+  if (congested && !m_congested) {
+    m_stats.congestions++;
+  }
+  m_congested = congested;
+}  // setCongested
+
+/**
+ * @brief Get the counters of the queue.
+ */
+void BLENotifyQueue::getStats(ble_notify_stats_t *stats) const {
+  *stats = m_stats;
+}  // getStats
+
+#endif /* CONFIG_BLUEDROID_ENABLED */
+#endif /* SOC_BLE_SUPPORTED */
@@ -0,0 +1,86 @@
+/*
+ * BLENotifyQueue.h
+ *
+ *  Notifications waiting to be sent to one connection.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLENOTIFYQUEUE_H_
+#define COMPONENTS_CPP_UTILS_BLENOTIFYQUEUE_H_
+#include "soc/soc_caps.h"
+#if SOC_BLE_SUPPORTED
+
+#include "sdkconfig.h"
+#if defined(CONFIG_BLUEDROID_ENABLED)
+#include <stdint.h>
+#include <stddef.h>
+
+// default size in bytes of the queue of each connection
+#define BLE_NOTIFY_QUEUE_SIZE 4096
+// default number of notifications handed to the stack and not confirmed yet, per connection
+#define BLE_NOTIFY_CREDITS 6
+
+typedef struct {
+  uint32_t queued;       // messages accepted
+  uint32_t dropped;      // messages refused, the queue being full
+  uint32_t sent;         // notifications handed to the stack
+  uint32_t sentBytes;    // bytes of these notifications
+  uint32_t failed;       // notifications the stack reported as failed
+  uint32_t congestions;  // congestion events of the connection
+  uint32_t pending;      // bytes waiting in the queue
+} ble_notify_stats_t;
+
+/**
+ * @brief A queue of the messages to notify to one connection.
+ *
+ * The messages are kept whole in a ring buffer, a notification carries as many whole messages as fit
+ * in the MTU, and a message longer than the MTU is split across notifications. Sending is paced by
+ * credits: one is used per notification handed to the stack and given back when the stack confirms it,
+ * and nothing is sent while the connection is congested.
+ * The queue does no locking, its owner serializes the calls.
+ */
+class BLENotifyQueue {
+public:
+  BLENotifyQueue(uint16_t connId, size_t size = BLE_NOTIFY_QUEUE_SIZE, uint8_t credits = BLE_NOTIFY_CREDITS);
+  ~BLENotifyQueue();
+  BLENotifyQueue(const BLENotifyQueue &) = delete;
+  BLENotifyQueue &operator=(const BLENotifyQueue &) = delete;
+
+  bool push(const uint8_t *data, size_t length);
+  size_t peek(uint8_t *buffer, size_t maxLength) const;
+  void consume(size_t length);
+
+  bool canSend() const {
+    return m_credits != 0 && !m_congested && m_used != 0;
+  }
+  void onSent(size_t length);
+  void onSendFailed(size_t length);
+  void onConfirm(bool success);
+  void setCongested(bool congested);
+
+  uint16_t getConnId() const {
+    return m_connId;
+  }
+  size_t getPending() const {
+    return m_stats.pending;
+  }
+  void getStats(ble_notify_stats_t *stats) const;
+
+private:
+  size_t take(uint8_t *buffer, size_t maxLength, size_t *head, size_t *used, size_t *offset) const;
+  void read(size_t pos, uint8_t *buffer, size_t length) const;
+
+  uint16_t m_connId;
+  uint8_t *m_buffer;
+  size_t m_size;
+  size_t m_head;    // first byte of the oldest message
+  size_t m_used;    // bytes of the messages and their length headers
+  size_t m_offset;  // bytes of the oldest message already sent
+  uint8_t m_credits;
+  uint8_t m_maxCredits;
+  bool m_congested;
+  ble_notify_stats_t m_stats;
+};  // BLENotifyQueue
+
+#endif /* CONFIG_BLUEDROID_ENABLED */
+#endif /* SOC_BLE_SUPPORTED */
+#endif /* COMPONENTS_CPP_UTILS_BLENOTIFYQUEUE_H_ */
@@ -15,12 +15,11 @@
 
 #include <esp_err.h>
 
-#include <map>
-
 #include "BLEAdvertisedDevice.h"
 #include "BLEScan.h"
 #include "BLEUtils.h"
 #include "GeneralUtils.h"
+#include "esp32-hal.h"
 #include "esp32-hal-log.h"
 
 /**
@@ -36,6 +35,9 @@ BLEScan::BLEScan() {
   m_stopped = true;
   m_wantDuplicates = false;
   m_shouldParse = true;
+  m_scanCompleteCB = nullptr;
+  m_scanResults.m_store = &m_store;
+  m_scanResults.m_pScan = this;
   setInterval(100);
   setWindow(100);
 }  // BLEScan
@@ -92,49 +94,22 @@ void BLEScan::handleGAPEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_
             break;
           }
 
-          // Examine our list of previously scanned addresses and, if we found this one already,
-          // ignore it.
-          BLEAddress advertisedAddress(param->scan_rst.bda);
-          bool found = false;
-          bool shouldDelete = true;
-
-          if (!m_wantDuplicates) {
-            if (m_scanResults.m_vectorAdvertisedDevices.count(advertisedAddress.toString()) != 0) {
-              found = true;
-            }
-
-            if (found) {  // If we found a previous entry AND we don't want duplicates, then we are done.
-              log_d("Ignoring %s, already seen it.", advertisedAddress.toString().c_str());
-              vTaskDelay(1);  // <--- allow to switch task in case we scan infinity and dont have new devices to report, or we are blocked here
-              break;
-            }
-          }
+          // The report refers to the event data, nothing is allocated to look up or record the device.
+          BLEScanReport report(
+            param->scan_rst.bda, param->scan_rst.ble_addr_type, param->scan_rst.rssi, param->scan_rst.flag, param->scan_rst.ble_adv,
+            param->scan_rst.adv_data_len + param->scan_rst.scan_rsp_len, millis()
+          );
 
-          // We now construct a model of the advertised device that we have just found for the first
-          // time.
-          // ESP_LOG_BUFFER_HEXDUMP((uint8_t*)param->scan_rst.ble_adv, param->scan_rst.adv_data_len + param->scan_rst.scan_rsp_len, ESP_LOG_DEBUG);
-          // log_w("bytes length: %d + %d, addr type: %d", param->scan_rst.adv_data_len, param->scan_rst.scan_rsp_len, param->scan_rst.ble_addr_type);
-          BLEAdvertisedDevice *advertisedDevice = new BLEAdvertisedDevice();
-          advertisedDevice->setAddress(advertisedAddress);
-          advertisedDevice->setRSSI(param->scan_rst.rssi);
-          advertisedDevice->setAdFlag(param->scan_rst.flag);
-          if (m_shouldParse) {
-            advertisedDevice->parseAdvertisement((uint8_t *)param->scan_rst.ble_adv, param->scan_rst.adv_data_len + param->scan_rst.scan_rsp_len);
-          } else {
-            advertisedDevice->setPayload((uint8_t *)param->scan_rst.ble_adv, param->scan_rst.adv_data_len + param->scan_rst.scan_rsp_len);
+          // Record the device, or only refresh its RSSI and last seen time if we found this one already.
+          if (!m_wantDuplicates && m_store.update(report) == BLEScanStore::STORE_UPDATED) {
+            break;  // If we found a previous entry AND we don't want duplicates, then we are done.
           }
-          advertisedDevice->setScan(this);
-          advertisedDevice->setAddressType(param->scan_rst.ble_addr_type);
 
-          if (m_pAdvertisedDeviceCallbacks) {  // if has callback, no need to record to vector
-            m_pAdvertisedDeviceCallbacks->onResult(*advertisedDevice);
+          if (m_pScanReportCallbacks) {
+            m_pScanReportCallbacks->onReport(report);
           }
-          if (!m_wantDuplicates && !found) {  // if no callback and not want duplicate, and not already in vector, record it
-            m_scanResults.m_vectorAdvertisedDevices.insert(std::pair<String, BLEAdvertisedDevice *>(advertisedAddress.toString(), advertisedDevice));
-            shouldDelete = false;
-          }
-          if (shouldDelete) {
-            delete advertisedDevice;
+          if (m_pAdvertisedDeviceCallbacks) {
+            m_pAdvertisedDeviceCallbacks->onResult(report.toAdvertisedDevice(m_shouldParse, this));
           }
 
           break;
@@ -262,7 +237,8 @@ void BLEScan::setActiveScan(bool active) {
  * @brief Set the call backs to be invoked.
  * @param [in] pAdvertisedDeviceCallbacks Call backs to be invoked.
  * @param [in] wantDuplicates  True if we wish to be called back with duplicates.  Default is false.
- * @param [in] shouldParse  True if we wish to parse advertised package or raw payload.  Default is true.
+ * @param [in] shouldParse  True to log the parsed advertised package at debug level.  Default is true.
+ *                          The fields of the device are decoded from its payload when asked for in any case.
  */
 void BLEScan::setAdvertisedDeviceCallbacks(BLEAdvertisedDeviceCallbacks *pAdvertisedDeviceCallbacks, bool wantDuplicates, bool shouldParse) {
   m_wantDuplicates = wantDuplicates;
@@ -270,6 +246,29 @@ void BLEScan::setAdvertisedDeviceCallbacks(BLEAdvertisedDeviceCallbacks *pAdvert
   m_shouldParse = shouldParse;
 }  // setAdvertisedDeviceCallbacks
 
+/**
+ * @brief Set the call backs receiving the raw reports.
+ * Unlike BLEAdvertisedDeviceCallbacks, no BLEAdvertisedDevice is made nor parsed for them.
+ * @param [in] pScanReportCallbacks Call backs to be invoked.
+ * @param [in] wantDuplicates  True if we wish to be called back with duplicates.  Default is false.
+ */
+void BLEScan::setScanReportCallbacks(BLEScanReportCallbacks *pScanReportCallbacks, bool wantDuplicates) {
+  m_wantDuplicates = wantDuplicates;
+  m_pScanReportCallbacks = pScanReportCallbacks;
+}  // setScanReportCallbacks
+
+/**
+ * @brief Limit the number of devices kept in the scan results.
+ * The memory of the results is allocated at once, so that scanning does not allocate anymore.
+ * By default the results grow as devices are found.
+ * @param [in] maxResults The number of devices to keep, 0 to grow on demand.
+ * @param [in] evictOldest True to replace the least recently seen device when full, false to ignore new devices.
+ * @return False if the memory could not be allocated.
+ */
+bool BLEScan::setMaxResults(size_t maxResults, bool evictOldest) {
+  return m_store.setCapacity(maxResults, evictOldest);
+}  // setMaxResults
+
 #ifdef SOC_BLE_50_SUPPORTED
 
 void BLEScan::setExtendedScanCallback(BLEExtAdvertisingCallbacks *cb) {
@@ -380,10 +379,7 @@ bool BLEScan::start(uint32_t duration, void (*scanCompleteCB)(BLEScanResults), b
   //  if we are connecting to devices that are advertising even after being connected, multiconnecting peripherals
   //  then we should not clear map or we will connect the same device few times
   if (!is_continue) {
-    for (auto _dev : m_scanResults.m_vectorAdvertisedDevices) {
-      delete _dev.second;
-    }
-    m_scanResults.m_vectorAdvertisedDevices.clear();
+    m_store.clear();
   }
 
   esp_err_t errRc = ::esp_ble_gap_set_scan_params(&m_scan_params);
@@ -443,9 +439,7 @@ void BLEScan::stop() {
 // delete peer device from cache after disconnecting, it is required in case we are connecting to devices with not public address
 void BLEScan::erase(BLEAddress address) {
   log_i("erase device: %s", address.toString().c_str());
-  BLEAdvertisedDevice *advertisedDevice = m_scanResults.m_vectorAdvertisedDevices.find(address.toString())->second;
-  m_scanResults.m_vectorAdvertisedDevices.erase(address.toString());
-  delete advertisedDevice;
+  m_store.erase(*address.getNative());
 }
 
 /**
@@ -463,7 +457,7 @@ void BLEScanResults::dump() {
  * @return The number of devices found in the last scan.
  */
 int BLEScanResults::getCount() {
-  return m_vectorAdvertisedDevices.size();
+  return m_store->count();
 }  // getCount
 
 /**
@@ -473,27 +467,39 @@ int BLEScanResults::getCount() {
  * @return The device at the specified index.
  */
 BLEAdvertisedDevice BLEScanResults::getDevice(uint32_t i) {
-  uint32_t x = 0;
-  BLEAdvertisedDevice dev = *m_vectorAdvertisedDevices.begin()->second;
-  for (auto it = m_vectorAdvertisedDevices.begin(); it != m_vectorAdvertisedDevices.end(); it++) {
-    dev = *it->second;
-    if (x == i) {
-      break;
-    }
-    x++;
+  if (m_store->count() == 0) {
+    return BLEAdvertisedDevice();
   }
-  return dev;
-}
+  if (i >= m_store->count()) {
+    i = m_store->count() - 1;
+  }
+  return m_store->report(i).toAdvertisedDevice(m_pScan->m_shouldParse, m_pScan);
+}  // getDevice
+
+/**
+ * @brief Return the report of the device at the given index, without making a BLEAdvertisedDevice.
+ * The index should be between 0 and getCount()-1.
+ * @param [in] i The index of the device.
+ * @return The report, valid until the results are changed by the scan.
+ */
+BLEScanReport BLEScanResults::getReport(uint32_t i) {
+  return m_store->report(i);
+}  // getReport
+
+/**
+ * @brief Return the number of devices that were not recorded because the results were full.
+ * @return The number of devices dropped since the scan started.
+ */
+uint32_t BLEScanResults::getDropped() {
+  return m_store->dropped();
+}  // getDropped
 
 BLEScanResults *BLEScan::getResults() {
   return &m_scanResults;
 }
 
 void BLEScan::clearResults() {
-  for (auto _dev : m_scanResults.m_vectorAdvertisedDevices) {
-    delete _dev.second;
-  }
-  m_scanResults.m_vectorAdvertisedDevices.clear();
+  m_store.clear();
 }
 
 #endif /* CONFIG_BLUEDROID_ENABLED */
@@ -18,6 +18,8 @@
 #include <string>
 #include "BLEAdvertisedDevice.h"
 #include "BLEClient.h"
+#include "BLEScanReport.h"
+#include "BLEScanStore.h"
 #include "RTOS.h"
 
 class BLEAdvertisedDevice;
@@ -50,10 +52,13 @@ public:
   void dump();
   int getCount();
   BLEAdvertisedDevice getDevice(uint32_t i);
+  BLEScanReport getReport(uint32_t i);
+  uint32_t getDropped();
 
 private:
   friend BLEScan;
-  std::map<String, BLEAdvertisedDevice *> m_vectorAdvertisedDevices;
+  BLEScanStore *m_store = nullptr;
+  BLEScan *m_pScan = nullptr;
 };
 
 /**
@@ -65,6 +70,8 @@ class BLEScan {
 public:
   void setActiveScan(bool active);
   void setAdvertisedDeviceCallbacks(BLEAdvertisedDeviceCallbacks *pAdvertisedDeviceCallbacks, bool wantDuplicates = false, bool shouldParse = true);
+  void setScanReportCallbacks(BLEScanReportCallbacks *pScanReportCallbacks, bool wantDuplicates = false);
+  bool setMaxResults(size_t maxResults, bool evictOldest = false);
   void setInterval(uint16_t intervalMSecs);
   void setWindow(uint16_t windowMSecs);
   bool start(uint32_t duration, void (*scanCompleteCB)(BLEScanResults), bool is_continue = false);
@@ -91,13 +98,16 @@ private:
 private:
   BLEScan();  // One doesn't create a new instance instead one asks the BLEDevice for the singleton.
   friend class BLEDevice;
+  friend class BLEScanResults;
   void handleGAPEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
 
   esp_ble_scan_params_t m_scan_params;
   BLEAdvertisedDeviceCallbacks *m_pAdvertisedDeviceCallbacks = nullptr;
+  BLEScanReportCallbacks *m_pScanReportCallbacks = nullptr;
   bool m_stopped = true;
   bool m_shouldParse = true;
   FreeRTOS::Semaphore m_semaphoreScanEnd = FreeRTOS::Semaphore("ScanEnd");
+  BLEScanStore m_store;
   BLEScanResults m_scanResults;
   bool m_wantDuplicates;
   void (*m_scanCompleteCB)(BLEScanResults scanResults);
@@ -0,0 +1,61 @@
+/*
+ * BLEScanReport.cpp
+ *
+ *  A view of one advertising report, without copy nor allocation.
+ */
+#include "soc/soc_caps.h"
+#if SOC_BLE_SUPPORTED
+
+#include "sdkconfig.h"
+#if defined(CONFIG_BLUEDROID_ENABLED)
+
+#include "BLEScanReport.h"
+#include "BLEAdvertisedDevice.h"
+
+BLEScanReport::BLEScanReport(
+  const uint8_t *address, esp_ble_addr_type_t addressType, int rssi, uint8_t adFlag, const uint8_t *payload, size_t payloadLength, uint32_t lastSeen
+)
+  : m_address(address), m_addressType(addressType), m_rssi(rssi), m_adFlag(adFlag), m_payload(payload), m_payloadLength(payloadLength),
+    m_lastSeen(lastSeen) {}
+
+/**
+ * @brief Get the address.
+ * @return A copy of the address of the advertising device.
+ */
+BLEAddress BLEScanReport::getAddress() const {
+  return BLEAddress((uint8_t *)m_address);
+}  // getAddress
+
+/**
+ * @brief Find an AD structure of the payload.
+ * @param [in] adType The type of the AD structure, e.g. ESP_BLE_AD_TYPE_NAME_CMPL.
+ * @param [out] length The length of its data.
+ * @return Its data in the payload, or nullptr if the payload has none of this type.
+ */
+const uint8_t *BLEScanReport::findField(uint8_t adType, size_t *length) const {
+  return getView().findData(adType, length);
+}  // findField
+
+/**
+ * @brief Make a BLEAdvertisedDevice of the report.
+ * @param [in] parse True to log the AD structures of the payload, its fields are decoded when asked for anyway.
+ * @param [in] pScan The scan reported by the device.
+ * @return The device, with a copy of the payload.
+ */
+BLEAdvertisedDevice BLEScanReport::toAdvertisedDevice(bool parse, BLEScan *pScan) const {
+  BLEAdvertisedDevice advertisedDevice;
+  advertisedDevice.setAddress(getAddress());
+  advertisedDevice.setRSSI(m_rssi);
+  advertisedDevice.setAdFlag(m_adFlag);
+  if (parse) {
+    advertisedDevice.parseAdvertisement((uint8_t *)m_payload, m_payloadLength);
+  } else {
+    advertisedDevice.setPayload((uint8_t *)m_payload, m_payloadLength);
+  }
+  advertisedDevice.setScan(pScan);
+  advertisedDevice.setAddressType(m_addressType);
+  return advertisedDevice;
+}  // toAdvertisedDevice
+
+#endif /* CONFIG_BLUEDROID_ENABLED */
+#endif /* SOC_BLE_SUPPORTED */
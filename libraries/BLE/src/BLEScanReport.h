@@ -0,0 +1,88 @@
+/*
+ * BLEScanReport.h
+ *
+ *  A view of one advertising report, without copy nor allocation.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLESCANREPORT_H_
+#define COMPONENTS_CPP_UTILS_BLESCANREPORT_H_
+#include "soc/soc_caps.h"
+#if SOC_BLE_SUPPORTED
+
+#include "sdkconfig.h"
+#if defined(CONFIG_BLUEDROID_ENABLED)
+#include <esp_gap_ble_api.h>
+
+#include "BLEAddress.h"
+#include "BLEAdvertisementView.h"
+
+class BLEAdvertisedDevice;
+class BLEScan;
+
+/**
+ * @brief An advertising report received by a scan.
+ *
+ * The report refers to the address and payload memory it was made with: the GAP event while a
+ * BLEScanReportCallbacks::onReport() callback runs, or the scan results it was read from.
+ * Copy what is needed, or convert it to a BLEAdvertisedDevice, to keep it longer.
+ */
+class BLEScanReport {
+public:
+  BLEScanReport(
+    const uint8_t *address, esp_ble_addr_type_t addressType, int rssi, uint8_t adFlag, const uint8_t *payload, size_t payloadLength, uint32_t lastSeen
+  );
+
+  BLEAddress getAddress() const;
+  const uint8_t *getNativeAddress() const {
+    return m_address;
+  }
+  esp_ble_addr_type_t getAddressType() const {
+    return m_addressType;
+  }
+  int getRSSI() const {
+    return m_rssi;
+  }
+  uint8_t getAdFlag() const {
+    return m_adFlag;
+  }
+  const uint8_t *getPayload() const {
+    return m_payload;
+  }
+  size_t getPayloadLength() const {
+    return m_payloadLength;
+  }
+  // millis() when the address was last seen
+  uint32_t getLastSeen() const {
+    return m_lastSeen;
+  }
+
+  BLEAdvertisementView getView() const {
+    return BLEAdvertisementView(m_payload, m_payloadLength);
+  }
+  const uint8_t *findField(uint8_t adType, size_t *length) const;
+  BLEAdvertisedDevice toAdvertisedDevice(bool parse = true, BLEScan *pScan = nullptr) const;
+
+private:
+  const uint8_t *m_address;
+  esp_ble_addr_type_t m_addressType;
+  int m_rssi;
+  uint8_t m_adFlag;
+  const uint8_t *m_payload;
+  size_t m_payloadLength;
+  uint32_t m_lastSeen;
+};
+
+/**
+ * @brief A callback handler receiving the scan reports without allocating a BLEAdvertisedDevice.
+ *
+ * It is invoked from the %BLE stack task: keep it short.
+ */
+class BLEScanReportCallbacks {
+public:
+  virtual ~BLEScanReportCallbacks() {}
+  virtual void onReport(const BLEScanReport &report) = 0;
+};
+
+#endif /* CONFIG_BLUEDROID_ENABLED */
+#endif /* SOC_BLE_SUPPORTED */
+#endif /* COMPONENTS_CPP_UTILS_BLESCANREPORT_H_ */
@@ -0,0 +1,241 @@
+/*
+ * BLEScanStore.cpp
+ *
+ *  Scan results keyed by the raw device address.
+ */
+#include "soc/soc_caps.h"
+#if SOC_BLE_SUPPORTED
+
+#include "sdkconfig.h"
+#if defined(CONFIG_BLUEDROID_ENABLED)
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "BLEScanStore.h"
+#include "esp32-hal-log.h"
+
+#define BLE_SCAN_STORE_INITIAL 16
+#define BLE_SCAN_STORE_MAX     0x7FFF  // so the index table fits the 16 bit entry numbers
+
+// FNV-1a of the address
+static inline uint32_t hashAddress(const uint8_t *address) {
+  uint32_t hash = 2166136261UL;
+  for (int i = 0; i < ESP_BD_ADDR_LEN; i++) {
+    hash = (hash ^ address[i]) * 16777619UL;
+  }
+  return hash;
+}
+
+BLEScanStore::BLEScanStore()
+  : m_entries(nullptr), m_index(nullptr), m_indexMask(0), m_count(0), m_capacity(0), m_fixed(false), m_evictOldest(false), m_dropped(0) {}
+
+BLEScanStore::~BLEScanStore() {
+  free(m_entries);
+  free(m_index);
+}
+
+/**
+ * @brief Allocate the store with a fixed capacity.
+ * @param [in] maxEntries The number of devices to keep, 0 to grow on demand again.
+ * @param [in] evictOldest True to replace the least recently seen device when full, false to drop the new one.
+ * @return False if the memory could not be allocated, the store is then unchanged.
+ */
+bool BLEScanStore::setCapacity(size_t maxEntries, bool evictOldest) {
+  m_evictOldest = evictOldest;
+  if (maxEntries == 0) {
+    m_fixed = false;
+    return true;
+  }
+  if (maxEntries > BLE_SCAN_STORE_MAX) {
+    maxEntries = BLE_SCAN_STORE_MAX;
+  }
+  while (m_count > maxEntries) {
+    removeAt(m_count - 1);
+  }
+  if (!resize(maxEntries)) {
+    return false;
+  }
+  m_fixed = true;
+  return true;
+}  // setCapacity
+
+/**
+ * @brief Reallocate the entries and rebuild the index table.
+ */
+bool BLEScanStore::resize(size_t capacity) {
+  size_t indexSize = 1;
+  while (indexSize < capacity * 2) {
+    indexSize <<= 1;
+  }
+  uint16_t *index = (uint16_t *)calloc(indexSize, sizeof(uint16_t));
+  if (index == nullptr) {
+    log_e("No memory for %u scan results", capacity);
+    return false;
+  }
+  ble_scan_entry_t *entries = (ble_scan_entry_t *)realloc(m_entries, capacity * sizeof(ble_scan_entry_t));
+  if (entries == nullptr) {
+    log_e("No memory for %u scan results", capacity);
+    free(index);
+    return false;
+  }
+  free(m_index);
+  m_entries = entries;
+  m_index = index;
+  m_indexMask = indexSize - 1;
+  m_capacity = capacity;
+  for (size_t i = 0; i < m_count; i++) {
+    m_index[slotOf(m_entries[i].address)] = i + 1;
+  }
+  return true;
+}  // resize
+
+/**
+ * @brief Find the index slot of an address, or the free slot where it belongs.
+ */
+size_t BLEScanStore::slotOf(const uint8_t *address) const {
+  size_t slot = hashAddress(address) & m_indexMask;
+  while (m_index[slot] != 0 && memcmp(m_entries[m_index[slot] - 1].address, address, ESP_BD_ADDR_LEN) != 0) {
+    slot = (slot + 1) & m_indexMask;
+  }
+  return slot;
+}  // slotOf
+
+/**
+ * @brief Record a scan report.
+ * A device already stored only has its RSSI and last seen time updated.
+ * @param [in] report The report to record.
+ * @return STORE_NEW for a new device, STORE_UPDATED for a known one, STORE_FULL if the device could not be stored.
+ */
+BLEScanStore::result_t BLEScanStore::update(const BLEScanReport &report) {
+  const uint8_t *address = report.getNativeAddress();
+  size_t slot = 0;
+  if (m_capacity != 0) {
+    slot = slotOf(address);
+    if (m_index[slot] != 0) {
+      ble_scan_entry_t *entry = &m_entries[m_index[slot] - 1];
+      entry->rssi = report.getRSSI();
+      entry->lastSeen = report.getLastSeen();
+      return STORE_UPDATED;
+    }
+  }
+
+  if (m_count == m_capacity) {
+    size_t grown = m_capacity ? m_capacity * 2 : BLE_SCAN_STORE_INITIAL;
+    if (grown > BLE_SCAN_STORE_MAX) {
+      grown = BLE_SCAN_STORE_MAX;
+    }
+    if (!m_fixed && grown > m_capacity && resize(grown)) {
+      slot = slotOf(address);
+    } else if (m_evictOldest && m_count != 0) {
+      size_t oldest = 0;
+      for (size_t i = 1; i < m_count; i++) {
+        if ((int32_t)(m_entries[i].lastSeen - m_entries[oldest].lastSeen) < 0) {
+          oldest = i;
+        }
+      }
+      removeAt(oldest);
+      slot = slotOf(address);
+    } else {
+      m_dropped++;
+      return STORE_FULL;
+    }
+  }
+
+  ble_scan_entry_t *entry = &m_entries[m_count];
+  memcpy(entry->address, address, ESP_BD_ADDR_LEN);
+  entry->addressType = report.getAddressType();
+  entry->adFlag = report.getAdFlag();
+  entry->rssi = report.getRSSI();
+  entry->lastSeen = report.getLastSeen();
+  size_t length = report.getPayloadLength();
+  if (length > BLE_SCAN_PAYLOAD_MAX) {
+    length = BLE_SCAN_PAYLOAD_MAX;
+  }
+  entry->payloadLength = length;
+  memcpy(entry->payload, report.getPayload(), length);
+  m_index[slot] = ++m_count;
+  return STORE_NEW;
+}  // update
+
+/**
+ * @brief Find a device.
+ * @param [in] address The native address of the device.
+ * @return Its entry, or nullptr if it is not stored.
+ */
+const ble_scan_entry_t *BLEScanStore::find(const uint8_t *address) const {
+  if (m_count == 0) {
+    return nullptr;
+  }
+  size_t slot = slotOf(address);
+  return m_index[slot] ? &m_entries[m_index[slot] - 1] : nullptr;
+}  // find
+
+/**
+ * @brief Remove a device.
+ * @param [in] address The native address of the device.
+ * @return False if the device was not stored.
+ */
+bool BLEScanStore::erase(const uint8_t *address) {
+  const ble_scan_entry_t *entry = find(address);
+  if (entry == nullptr) {
+    return false;
+  }
+  removeAt(entry - m_entries);
+  return true;
+}  // erase
+
+/**
+ * @brief Remove an entry, moving the last entry in its place to keep the array dense.
+ */
+void BLEScanStore::removeAt(size_t i) {
+  // backward shift deletion, so that no probe sequence is broken
+  size_t hole = slotOf(m_entries[i].address);
+  size_t slot = hole;
+  for (;;) {
+    slot = (slot + 1) & m_indexMask;
+    if (m_index[slot] == 0) {
+      break;
+    }
+    size_t home = hashAddress(m_entries[m_index[slot] - 1].address) & m_indexMask;
+    // the entry can move back to the hole if its home slot is not in (hole, slot]
+    if (((slot - home) & m_indexMask) >= ((slot - hole) & m_indexMask)) {
+      m_index[hole] = m_index[slot];
+      hole = slot;
+    }
+  }
+  m_index[hole] = 0;
+
+  size_t last = m_count - 1;
+  if (i != last) {
+    m_index[slotOf(m_entries[last].address)] = i + 1;
+    m_entries[i] = m_entries[last];
+  }
+  m_count--;
+}  // removeAt
+
+/**
+ * @brief Remove all the devices, keeping the memory allocated.
+ */
+void BLEScanStore::clear() {
+  if (m_index != nullptr) {
+    memset(m_index, 0, (m_indexMask + 1) * sizeof(uint16_t));
+  }
+  m_count = 0;
+  m_dropped = 0;
+}  // clear
+
+/**
+ * @brief Get a stored device.
+ * @param [in] i The index of the device, between 0 and count() - 1.
+ * @return A report referring to the entry, valid until the store is next changed.
+ */
+BLEScanReport BLEScanStore::report(size_t i) const {
+  const ble_scan_entry_t *entry = &m_entries[i];
+  return BLEScanReport(
+    entry->address, (esp_ble_addr_type_t)entry->addressType, entry->rssi, entry->adFlag, entry->payload, entry->payloadLength, entry->lastSeen
+  );
+}  // report
+
+#endif /* CONFIG_BLUEDROID_ENABLED */
+#endif /* SOC_BLE_SUPPORTED */
@@ -0,0 +1,89 @@
+/*
+ * BLEScanStore.h
+ *
+ *  Scan results keyed by the raw device address.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_BLESCANSTORE_H_
+#define COMPONENTS_CPP_UTILS_BLESCANSTORE_H_
+#include "soc/soc_caps.h"
+#if SOC_BLE_SUPPORTED
+
+#include "sdkconfig.h"
+#if defined(CONFIG_BLUEDROID_ENABLED)
+#include <esp_gap_ble_api.h>
+
+#include "BLEScanReport.h"
+
+#define BLE_SCAN_PAYLOAD_MAX (ESP_BLE_ADV_DATA_LEN_MAX + ESP_BLE_SCAN_RSP_DATA_LEN_MAX)
+
+typedef struct {
+  esp_bd_addr_t address;
+  uint8_t addressType;
+  uint8_t adFlag;
+  int8_t rssi;
+  uint8_t payloadLength;
+  uint32_t lastSeen;
+  uint8_t payload[BLE_SCAN_PAYLOAD_MAX];
+} ble_scan_entry_t;
+
+/**
+ * @brief Storage of the devices found by a scan.
+ *
+ * The entries are kept in a dense array, indexed by an open-addressing hash table of the 6 address
+ * bytes, so that a report of an already seen device is a lookup and an update in place.
+ * The table grows on demand, or is allocated once with a fixed capacity by setCapacity(); when
+ * full, the least recently seen device is evicted if asked, otherwise the new device is dropped.
+ */
+class BLEScanStore {
+public:
+  typedef enum {
+    STORE_NEW,
+    STORE_UPDATED,
+    STORE_FULL
+  } result_t;
+
+  BLEScanStore();
+  ~BLEScanStore();
+  BLEScanStore(const BLEScanStore &) = delete;
+  BLEScanStore &operator=(const BLEScanStore &) = delete;
+
+  bool setCapacity(size_t maxEntries, bool evictOldest = false);
+  result_t update(const BLEScanReport &report);
+  const ble_scan_entry_t *find(const uint8_t *address) const;
+  bool erase(const uint8_t *address);
+  void clear();
+
+  size_t count() const {
+    return m_count;
+  }
+  size_t capacity() const {
+    return m_capacity;
+  }
+  // devices not stored because the store was full
+  uint32_t dropped() const {
+    return m_dropped;
+  }
+  const ble_scan_entry_t *at(size_t i) const {
+    return i < m_count ? &m_entries[i] : nullptr;
+  }
+  BLEScanReport report(size_t i) const;
+
+private:
+  size_t slotOf(const uint8_t *address) const;
+  bool resize(size_t capacity);
+  void removeAt(size_t i);
+
+  ble_scan_entry_t *m_entries;
+  uint16_t *m_index;  // entry index + 1, 0 for a free slot
+  size_t m_indexMask;
+  size_t m_count;
+  size_t m_capacity;
+  bool m_fixed;
+  bool m_evictOldest;
+  uint32_t m_dropped;
+};  // BLEScanStore
+
+#endif /* CONFIG_BLUEDROID_ENABLED */
+#endif /* SOC_BLE_SUPPORTED */
+#endif /* COMPONENTS_CPP_UTILS_BLESCANSTORE_H_ */
@@ -0,0 +1,82 @@
+// This example code is in the Public Domain (or CC0 licensed, at your option.)
+//
+// This example measures the throughput of the Serial Port Profile (SPP)
+//
+// Flash one ESP32 with this code as is (the Slave, receiving) and another one
+// with THROUGHPUT_MASTER defined (the Master, sending). The Master connects to
+// the Slave by name and streams blocks of data as fast as the link accepts them,
+// both print every second the rate in kB/s.
+//
+// The Slave also works with a phone or a laptop: send it a file from a
+// Bluetooth terminal app to measure the receiving rate.
+
+#include "BluetoothSerial.h"
+
+//#define THROUGHPUT_MASTER  // Uncomment this on the sending device
+
+// Check if Bluetooth is available
+#if !defined(CONFIG_BT_ENABLED) || !defined(CONFIG_BLUEDROID_ENABLED)
+#error Bluetooth is not enabled! Please run `make menuconfig` to and enable it
+#endif
+
+// Check Serial Port Profile
+#if !defined(CONFIG_BT_SPP_ENABLED)
+#error Serial Port Profile for Bluetooth is not available or not enabled. It is only available for the ESP32 chip.
+#endif
+
+#define BLOCK_SIZE 1024
+
+String slaveName = "ESP32-BT-Slave";
+String myName = "ESP32-BT-Master";
+
+BluetoothSerial SerialBT;
+uint8_t block[BLOCK_SIZE];
+uint32_t bytes = 0;
+uint32_t lastReport = 0;
+
+void setup() {
+  Serial.begin(115200);
+  // larger rings absorb the bursts of the link, they must be set before begin()
+  SerialBT.setRxBufferSize(4096);
+  SerialBT.setTxBufferSize(4096);
+
+#ifdef THROUGHPUT_MASTER
+  SerialBT.begin(myName, true);
+  Serial.printf("Connecting to slave BT device named \"%s\"\n", slaveName.c_str());
+  while (!SerialBT.connect(slaveName)) {
+    Serial.println("Failed to connect. Make sure the slave device is available and in range.");
+  }
+  Serial.println("Connected Successfully! Sending...");
+  for (int i = 0; i < BLOCK_SIZE; i++) {
+    block[i] = i;
+  }
+#else
+  SerialBT.begin(slaveName);
+  Serial.printf("The device with name \"%s\" is started, waiting for data...\n", slaveName.c_str());
+#endif
+  lastReport = millis();
+}
+
+void loop() {
+#ifdef THROUGHPUT_MASTER
+  if (SerialBT.connected()) {
+    bytes += SerialBT.write(block, BLOCK_SIZE);
+  } else {
+    delay(100);
+  }
+#else
+  size_t len = SerialBT.read(block, BLOCK_SIZE);
+  if (len) {
+    bytes += len;
+  } else {
+    delay(1);
+  }
+#endif
+
+  uint32_t now = millis();
+  if (now - lastReport >= 1000) {
+    Serial.printf("%s %6.1f kB/s\n", SerialBT.hasClient() ? "connected" : "waiting  ", bytes / (float)(now - lastReport));
+    bytes = 0;
+    lastReport = now;
+  }
+}
@@ -19,6 +19,7 @@
 #include <cstring>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/ringbuf.h"
 
 #if defined(CONFIG_BT_ENABLED) && defined(CONFIG_BLUEDROID_ENABLED)
 
@@ -40,16 +41,22 @@
 
 const char *_spp_server_name = "ESP32SPP";
 
-#define RX_QUEUE_SIZE         512
-#define TX_QUEUE_SIZE         32
+#define RX_QUEUE_SIZE         512   // bytes
+#define TX_QUEUE_SIZE         1024  // bytes
 #define SPP_TX_QUEUE_TIMEOUT  1000
 #define SPP_TX_DONE_TIMEOUT   1000
 #define SPP_CONGESTED_TIMEOUT 1000
+// writes handed to the stack and not yet completed by ESP_SPP_WRITE_EVT
+#define SPP_TX_CREDITS 4
 
 static uint32_t _spp_client = 0;
-static QueueHandle_t _spp_rx_queue = NULL;
-static QueueHandle_t _spp_tx_queue = NULL;
-static SemaphoreHandle_t _spp_tx_done = NULL;
+static RingbufHandle_t _spp_rx_ring = NULL;
+static RingbufHandle_t _spp_tx_ring = NULL;
+static size_t _spp_rx_queue_len = RX_QUEUE_SIZE;
+static size_t _spp_tx_queue_len = TX_QUEUE_SIZE;
+static size_t _spp_tx_ring_size = 0;
+static int _spp_rx_peek = -1;
+static SemaphoreHandle_t _spp_tx_credits = NULL;
 static TaskHandle_t _spp_task_handle = NULL;
 static EventGroupHandle_t _spp_event_group = NULL;
 static EventGroupHandle_t _bt_event_group = NULL;
@@ -103,11 +110,6 @@ static BTAdvertisedDeviceCb advertisedDeviceCb = nullptr;
 #define BT_SDP_RUNNING   0x04
 #define BT_SDP_COMPLETED 0x08
 
-typedef struct {
-  size_t len;
-  uint8_t data[];
-} spp_packet_t;
-
 #if (ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO)
 static char *bda2str(esp_bd_addr_t bda, char *str, size_t size) {
   if (bda == NULL || str == NULL || size < 18) {
@@ -142,98 +144,85 @@ static bool get_name_from_eir(uint8_t *eir, char *bdname, uint8_t *bdname_len) {
   return false;
 }
 
-static esp_err_t _spp_queue_packet(uint8_t *data, size_t len) {
+const uint16_t SPP_TX_MAX = 330;
+
+static void _spp_tx_reset_credits() {
+  if (_spp_tx_credits) {
+    while (uxSemaphoreGetCount(_spp_tx_credits) < SPP_TX_CREDITS && xSemaphoreGive(_spp_tx_credits) == pdTRUE) {}
+  }
+}
+
+static size_t _spp_queue_data(const uint8_t *data, size_t len) {
   if (!data || !len) {
     log_w("No data provided");
-    return ESP_OK;
+    return 0;
   }
-  spp_packet_t *packet = (spp_packet_t *)malloc(sizeof(spp_packet_t) + len);
-  if (!packet) {
-    log_e("SPP TX Packet Malloc Failed!");
-    return ESP_FAIL;
+  if (!_spp_tx_ring) {
+    return 0;
   }
-  packet->len = len;
-  memcpy(packet->data, data, len);
-  if (!_spp_tx_queue || xQueueSend(_spp_tx_queue, &packet, SPP_TX_QUEUE_TIMEOUT) != pdPASS) {
-    log_e("SPP TX Queue Send Failed!");
-    free(packet);
-    return ESP_FAIL;
+  size_t queued = 0;
+  while (queued < len) {
+    size_t chunk = len - queued;
+    size_t space = xRingbufferGetCurFreeSize(_spp_tx_ring);
+    if (space) {
+      // copy what fits now, the TX task is sending meanwhile
+      if (chunk > space) {
+        chunk = space;
+      }
+    } else {
+      // wait for about one packet to go out
+      if (chunk > SPP_TX_MAX) {
+        chunk = SPP_TX_MAX;
+      }
+      if (chunk > _spp_tx_ring_size) {
+        chunk = _spp_tx_ring_size;
+      }
+    }
+    if (xRingbufferSend(_spp_tx_ring, (void *)(data + queued), chunk, SPP_TX_QUEUE_TIMEOUT / portTICK_PERIOD_MS) != pdTRUE) {
+      log_e("SPP TX Ring Send Failed!");
+      break;
+    }
+    queued += chunk;
   }
-  return ESP_OK;
+  return queued;
 }
 
-const uint16_t SPP_TX_MAX = 330;
-static uint8_t _spp_tx_buffer[SPP_TX_MAX];
-static uint16_t _spp_tx_buffer_len = 0;
-
-static bool _spp_send_buffer() {
+static bool _spp_send_buffer(uint8_t *data, size_t len) {
+  if (xSemaphoreTake(_spp_tx_credits, SPP_TX_DONE_TIMEOUT) != pdTRUE) {
+    // a completion got lost, do not stall the stream for it
+    log_e("SPP Ack Failed!");
+  }
   if ((xEventGroupWaitBits(_spp_event_group, SPP_CONGESTED, pdFALSE, pdTRUE, SPP_CONGESTED_TIMEOUT) & SPP_CONGESTED) != 0) {
     if (!_spp_client) {
       log_v("SPP Client Gone!");
+      xSemaphoreGive(_spp_tx_credits);
       return false;
     }
-    log_v("SPP Write %u", _spp_tx_buffer_len);
-    esp_err_t err = esp_spp_write(_spp_client, _spp_tx_buffer_len, _spp_tx_buffer);
+    log_v("SPP Write %u", len);
+    // the stack copies the data, the ring space can be returned once this returns
+    esp_err_t err = esp_spp_write(_spp_client, len, data);
     if (err != ESP_OK) {
       log_e("SPP Write Failed! [0x%X]", err);
-      return false;
-    }
-    _spp_tx_buffer_len = 0;
-    if (xSemaphoreTake(_spp_tx_done, SPP_TX_DONE_TIMEOUT) != pdTRUE) {
-      log_e("SPP Ack Failed!");
+      xSemaphoreGive(_spp_tx_credits);
       return false;
     }
     return true;
   }
   log_e("SPP Write Congested!");
+  xSemaphoreGive(_spp_tx_credits);
   return false;
 }
 
 static void _spp_tx_task(void *arg) {
-  spp_packet_t *packet = NULL;
-  size_t len = 0, to_send = 0;
+  size_t len = 0;
   uint8_t *data = NULL;
   for (;;) {
-    if (_spp_tx_queue && xQueueReceive(_spp_tx_queue, &packet, portMAX_DELAY) == pdTRUE && packet) {
-      if (packet->len <= (SPP_TX_MAX - _spp_tx_buffer_len)) {
-        memcpy(_spp_tx_buffer + _spp_tx_buffer_len, packet->data, packet->len);
-        _spp_tx_buffer_len += packet->len;
-        free(packet);
-        packet = NULL;
-        if (SPP_TX_MAX == _spp_tx_buffer_len || uxQueueMessagesWaiting(_spp_tx_queue) == 0) {
-          _spp_send_buffer();
-        }
-      } else {
-        len = packet->len;
-        data = packet->data;
-        to_send = SPP_TX_MAX - _spp_tx_buffer_len;
-        memcpy(_spp_tx_buffer + _spp_tx_buffer_len, data, to_send);
-        _spp_tx_buffer_len = SPP_TX_MAX;
-        data += to_send;
-        len -= to_send;
-        if (!_spp_send_buffer()) {
-          len = 0;
-        }
-        while (len >= SPP_TX_MAX) {
-          memcpy(_spp_tx_buffer, data, SPP_TX_MAX);
-          _spp_tx_buffer_len = SPP_TX_MAX;
-          data += SPP_TX_MAX;
-          len -= SPP_TX_MAX;
-          if (!_spp_send_buffer()) {
-            len = 0;
-            break;
-          }
-        }
-        if (len) {
-          memcpy(_spp_tx_buffer, data, len);
-          _spp_tx_buffer_len += len;
-          if (uxQueueMessagesWaiting(_spp_tx_queue) == 0) {
-            _spp_send_buffer();
-          }
-        }
-        free(packet);
-        packet = NULL;
-      }
+    // up to one SPP packet, in place in the ring. What is written while
+    // waiting for credits or congestion is batched into the next packet.
+    data = (uint8_t *)xRingbufferReceiveUpTo(_spp_tx_ring, &len, portMAX_DELAY, SPP_TX_MAX);
+    if (data) {
+      _spp_send_buffer(data, len);
+      vRingbufferReturnItem(_spp_tx_ring, data);
     } else {
       log_e("Something went horribly wrong");
     }
@@ -242,6 +231,31 @@ static void _spp_tx_task(void *arg) {
   _spp_task_handle = NULL;
 }
 
+static size_t _spp_read_data(uint8_t *buffer, size_t size, TickType_t ticks) {
+  if (!_spp_rx_ring || !buffer || !size) {
+    return 0;
+  }
+  size_t count = 0;
+  if (_spp_rx_peek >= 0) {
+    buffer[count++] = (uint8_t)_spp_rx_peek;
+    _spp_rx_peek = -1;
+  }
+  TickType_t start = xTaskGetTickCount();
+  while (count < size) {
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    size_t len = 0;
+    // at most two pieces when the data wraps around the end of the ring
+    uint8_t *data = (uint8_t *)xRingbufferReceiveUpTo(_spp_rx_ring, &len, elapsed < ticks ? ticks - elapsed : 0, size - count);
+    if (!data) {
+      break;
+    }
+    memcpy(buffer + count, data, len);
+    vRingbufferReturnItem(_spp_rx_ring, data);
+    count += len;
+  }
+  return count;
+}
+
 static void esp_spp_cb(esp_spp_cb_event_t event, esp_spp_cb_param_t *param) {
   switch (event) {
     case ESP_SPP_INIT_EVT:  // Enum 0 - When SPP is initialized
@@ -296,6 +310,7 @@ static void esp_spp_cb(esp_spp_cb_event_t event, esp_spp_cb_param_t *param) {
       log_i("ESP_SPP_OPEN_EVT");
       if (!_spp_client) {
         _spp_client = param->open.handle;
+        _spp_tx_reset_credits();
       } else {
         secondConnectionAttempt = true;
         esp_spp_disconnect(param->open.handle);
@@ -315,6 +330,7 @@ static void esp_spp_cb(esp_spp_cb_event_t event, esp_spp_cb_param_t *param) {
           secondConnectionAttempt = false;
         } else {
           _spp_client = 0;
+          _spp_tx_reset_credits();  // the pending writes will not complete
           xEventGroupSetBits(_spp_event_group, SPP_DISCONNECTED);
           xEventGroupSetBits(_spp_event_group, SPP_CONGESTED);
           xEventGroupSetBits(_spp_event_group, SPP_CLOSED);
@@ -344,12 +360,15 @@ static void esp_spp_cb(esp_spp_cb_event_t event, esp_spp_cb_param_t *param) {
 
       if (custom_data_callback) {
         custom_data_callback(param->data_ind.data, param->data_ind.len);
-      } else if (_spp_rx_queue != NULL) {
-        for (int i = 0; i < param->data_ind.len; i++) {
-          if (xQueueSend(_spp_rx_queue, param->data_ind.data + i, (TickType_t)0) != pdTRUE) {
-            log_e("RX Full! Discarding %u bytes", param->data_ind.len - i);
-            break;
-          }
+      } else if (_spp_rx_ring != NULL) {
+        size_t len = param->data_ind.len;
+        size_t space = xRingbufferGetCurFreeSize(_spp_rx_ring);
+        if (len > space) {
+          log_e("RX Full! Discarding %u bytes", len - space);
+          len = space;
+        }
+        if (len && xRingbufferSend(_spp_rx_ring, param->data_ind.data, len, 0) != pdTRUE) {
+          log_e("RX Full! Discarding %u bytes", len);
         }
       }
       break;
@@ -372,7 +391,7 @@ static void esp_spp_cb(esp_spp_cb_event_t event, esp_spp_cb_param_t *param) {
       } else {
         log_e("ESP_SPP_WRITE_EVT failed!, status:%d", param->write.status);
       }
-      xSemaphoreGive(_spp_tx_done);  //we can try to send another packet
+      xSemaphoreGive(_spp_tx_credits);  //we can try to send another packet
       break;
 
     case ESP_SPP_SRV_OPEN_EVT:  // Enum 34 - When SPP Server connection open
@@ -380,7 +399,7 @@ static void esp_spp_cb(esp_spp_cb_event_t event, esp_spp_cb_param_t *param) {
         log_i("ESP_SPP_SRV_OPEN_EVT: %u", _spp_client);
         if (!_spp_client) {
           _spp_client = param->srv_open.handle;
-          _spp_tx_buffer_len = 0;
+          _spp_tx_reset_credits();
         } else {
           secondConnectionAttempt = true;
           esp_spp_disconnect(param->srv_open.handle);
@@ -636,27 +655,28 @@ static bool _init_bt(const char *deviceName, bt_mode mode) {
     xEventGroupSetBits(_spp_event_group, SPP_DISCONNECTED);
     xEventGroupSetBits(_spp_event_group, SPP_CLOSED);
   }
-  if (_spp_rx_queue == NULL) {
-    _spp_rx_queue = xQueueCreate(RX_QUEUE_SIZE, sizeof(uint8_t));  //initialize the queue
-    if (_spp_rx_queue == NULL) {
-      log_e("RX Queue Create Failed");
+  if (_spp_rx_ring == NULL) {
+    _spp_rx_ring = xRingbufferCreate(_spp_rx_queue_len, RINGBUF_TYPE_BYTEBUF);
+    if (_spp_rx_ring == NULL) {
+      log_e("RX Ring Create Failed");
       return false;
     }
+    _spp_rx_peek = -1;
   }
-  if (_spp_tx_queue == NULL) {
-    _spp_tx_queue = xQueueCreate(TX_QUEUE_SIZE, sizeof(spp_packet_t *));  //initialize the queue
-    if (_spp_tx_queue == NULL) {
-      log_e("TX Queue Create Failed");
+  if (_spp_tx_ring == NULL) {
+    _spp_tx_ring = xRingbufferCreate(_spp_tx_queue_len, RINGBUF_TYPE_BYTEBUF);
+    if (_spp_tx_ring == NULL) {
+      log_e("TX Ring Create Failed");
       return false;
     }
+    _spp_tx_ring_size = xRingbufferGetCurFreeSize(_spp_tx_ring);
   }
-  if (_spp_tx_done == NULL) {
-    _spp_tx_done = xSemaphoreCreateBinary();
-    if (_spp_tx_done == NULL) {
+  if (_spp_tx_credits == NULL) {
+    _spp_tx_credits = xSemaphoreCreateCounting(SPP_TX_CREDITS, SPP_TX_CREDITS);
+    if (_spp_tx_credits == NULL) {
       log_e("TX Semaphore Create Failed");
       return false;
     }
-    xSemaphoreTake(_spp_tx_done, 0);
   }
 
   if (!_spp_task_handle) {
@@ -756,22 +776,18 @@ static bool _stop_bt() {
     vEventGroupDelete(_spp_event_group);
     _spp_event_group = NULL;
   }
-  if (_spp_rx_queue) {
-    vQueueDelete(_spp_rx_queue);
-    //ToDo: clear RX queue when in packet mode
-    _spp_rx_queue = NULL;
+  if (_spp_rx_ring) {
+    vRingbufferDelete(_spp_rx_ring);
+    _spp_rx_ring = NULL;
+    _spp_rx_peek = -1;
   }
-  if (_spp_tx_queue) {
-    spp_packet_t *packet = NULL;
-    while (xQueueReceive(_spp_tx_queue, &packet, 0) == pdTRUE) {
-      free(packet);
-    }
-    vQueueDelete(_spp_tx_queue);
-    _spp_tx_queue = NULL;
+  if (_spp_tx_ring) {
+    vRingbufferDelete(_spp_tx_ring);
+    _spp_tx_ring = NULL;
   }
-  if (_spp_tx_done) {
-    vSemaphoreDelete(_spp_tx_done);
-    _spp_tx_done = NULL;
+  if (_spp_tx_credits) {
+    vSemaphoreDelete(_spp_tx_credits);
+    _spp_tx_credits = NULL;
   }
   if (_bt_event_group) {
     vEventGroupDelete(_bt_event_group);
@@ -829,18 +845,20 @@ bool BluetoothSerial::begin(String localName, bool isMaster, bool disableBLE) {
 }
 
 int BluetoothSerial::available(void) {
-  if (_spp_rx_queue == NULL) {
+  if (_spp_rx_ring == NULL) {
     return 0;
   }
-  return uxQueueMessagesWaiting(_spp_rx_queue);
+  UBaseType_t uxItemsWaiting = 0;
+  vRingbufferGetInfo(_spp_rx_ring, NULL, NULL, NULL, NULL, &uxItemsWaiting);
+  return uxItemsWaiting + (_spp_rx_peek >= 0 ? 1 : 0);
 }
 
 int BluetoothSerial::peek(void) {
   uint8_t c;
-  if (_spp_rx_queue && xQueuePeek(_spp_rx_queue, &c, this->timeoutTicks)) {
-    return c;
+  if (_spp_rx_peek < 0 && _spp_read_data(&c, 1, this->timeoutTicks)) {
+    _spp_rx_peek = c;
   }
-  return -1;
+  return _spp_rx_peek;
 }
 
 bool BluetoothSerial::hasClient(void) {
@@ -850,12 +868,21 @@ bool BluetoothSerial::hasClient(void) {
 int BluetoothSerial::read() {
 
   uint8_t c = 0;
-  if (_spp_rx_queue && xQueueReceive(_spp_rx_queue, &c, this->timeoutTicks)) {
+  if (_spp_read_data(&c, 1, this->timeoutTicks)) {
     return c;
   }
   return -1;
 }
 
+size_t BluetoothSerial::read(uint8_t *buffer, size_t size) {
+  return _spp_read_data(buffer, size, 0);
+}
+
+// Overrides Stream::readBytes() to copy whole pieces of the RX ring
+size_t BluetoothSerial::readBytes(uint8_t *buffer, size_t length) {
+  return _spp_read_data(buffer, length, getTimeout() / portTICK_PERIOD_MS);
+}
+
 /**
  * Set timeout for read / peek
  */
@@ -872,17 +899,70 @@ size_t BluetoothSerial::write(const uint8_t *buffer, size_t size) {
   if (!_spp_client) {
     return 0;
   }
-  return (_spp_queue_packet((uint8_t *)buffer, size) == ESP_OK) ? size : 0;
+  return _spp_queue_data(buffer, size);
+}
+
+int BluetoothSerial::availableForWrite() {
+  if (_spp_tx_ring == NULL) {
+    return 0;
+  }
+  return xRingbufferGetCurFreeSize(_spp_tx_ring);
 }
 
 void BluetoothSerial::flush() {
-  if (_spp_tx_queue != NULL) {
-    while (uxQueueMessagesWaiting(_spp_tx_queue) > 0) {
-      delay(100);
+  if (_spp_tx_ring != NULL) {
+    // the ring is free again once the TX task returned what it took,
+    // and the writes are done once their credits came back
+    size_t lastSpace = 0;
+    UBaseType_t lastCredits = 0;
+    uint32_t lastProgress = millis();
+    while (_spp_client) {
+      size_t space = xRingbufferGetCurFreeSize(_spp_tx_ring);
+      UBaseType_t credits = uxSemaphoreGetCount(_spp_tx_credits);
+      if (space >= _spp_tx_ring_size && credits >= SPP_TX_CREDITS) {
+        break;
+      }
+      if (space != lastSpace || credits != lastCredits) {
+        lastSpace = space;
+        lastCredits = credits;
+        lastProgress = millis();
+      } else if (millis() - lastProgress > SPP_TX_DONE_TIMEOUT + SPP_CONGESTED_TIMEOUT) {
+        // nothing moved for longer than the TX task waits for one packet
+        log_e("SPP Flush Timeout!");
+        if (space >= _spp_tx_ring_size) {
+          _spp_tx_reset_credits();  // the completions got lost
+        }
+        break;
+      }
+      delay(5);
     }
   }
 }
 
+/**
+ * Set the size of the RX ring, in bytes. Takes effect on the next begin().
+ */
+size_t BluetoothSerial::setRxBufferSize(size_t size) {
+  if (_spp_rx_ring) {
+    log_e("RX buffer size can only be set before begin()");
+    return 0;
+  }
+  _spp_rx_queue_len = size;
+  return size;
+}
+
+/**
+ * Set the size of the TX ring, in bytes. Takes effect on the next begin().
+ */
+size_t BluetoothSerial::setTxBufferSize(size_t size) {
+  if (_spp_tx_ring) {
+    log_e("TX buffer size can only be set before begin()");
+    return 0;
+  }
+  _spp_tx_queue_len = size;
+  return size;
+}
+
 void BluetoothSerial::end() {
   _stop_bt();
 }
@@ -47,9 +47,21 @@ public:
   int peek(void);
   bool hasClient(void);
   int read(void);
+  size_t read(uint8_t *buffer, size_t size);
+  inline size_t read(char *buffer, size_t size) {
+    return read((uint8_t *)buffer, size);
+  }
+  // Overrides Stream::readBytes() to be faster using the RX ring
+  size_t readBytes(uint8_t *buffer, size_t length);
+  size_t readBytes(char *buffer, size_t length) {
+    return readBytes((uint8_t *)buffer, length);
+  }
   size_t write(uint8_t c);
   size_t write(const uint8_t *buffer, size_t size);
+  int availableForWrite(void);
   void flush();
+  size_t setRxBufferSize(size_t size);
+  size_t setTxBufferSize(size_t size);
   void end(void);
   void memrelease();
   void setTimeout(int timeoutMS);
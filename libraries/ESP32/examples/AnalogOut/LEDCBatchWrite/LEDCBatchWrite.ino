@@ -0,0 +1,92 @@
+/* LEDC Batch Write Arduino Example
+
+   Measures the cost of updating several LEDC channels with ledcWrite()
+   against staging the duties and applying them with a single commit,
+   then plays a precomputed breathing curve on one pin with the hardware fade engine.
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+// use 10 bit precision for LEDC timer
+#define LEDC_RESOLUTION 10
+
+// use 1000 Hz as a LEDC base frequency
+#define LEDC_BASE_FREQ 1000
+
+// number of iterations used for the timing
+#define BENCH_ROUNDS 1000
+
+// PWM pins (replace with pins available on your board)
+const uint8_t pwmPins[] = {2, 4, 5, 6};
+#define NUM_PINS (int)(sizeof(pwmPins) / sizeof(pwmPins[0]))
+
+// breathing curve, played as linear hardware fades between the points
+#define CURVE_POINTS  16
+#define CURVE_STEP_MS 100
+uint32_t curve[CURVE_POINTS];
+
+uint32_t duties[NUM_PINS];
+
+void benchmark() {
+  uint32_t start = micros();
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    for (int i = 0; i < NUM_PINS; i++) {
+      ledcWrite(pwmPins[i], (round + i * 64) & 0x3FF);
+    }
+  }
+  uint32_t single = micros() - start;
+
+  start = micros();
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    for (int i = 0; i < NUM_PINS; i++) {
+      ledcWriteStage(pwmPins[i], (round + i * 64) & 0x3FF);
+    }
+    ledcWriteCommit();
+  }
+  uint32_t staged = micros() - start;
+
+  start = micros();
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    for (int i = 0; i < NUM_PINS; i++) {
+      duties[i] = (round + i * 64) & 0x3FF;
+    }
+    ledcWriteBatch(pwmPins, duties, NUM_PINS);
+  }
+  uint32_t batch = micros() - start;
+
+  Serial.printf("%u pins, %u rounds\n", NUM_PINS, BENCH_ROUNDS);
+  Serial.printf("ledcWrite:             %.2f us per pin update\n", (float)single / (BENCH_ROUNDS * NUM_PINS));
+  Serial.printf("ledcWriteStage+Commit: %.2f us per pin update\n", (float)staged / (BENCH_ROUNDS * NUM_PINS));
+  Serial.printf("ledcWriteBatch:        %.2f us per pin update\n", (float)batch / (BENCH_ROUNDS * NUM_PINS));
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  for (int i = 0; i < NUM_PINS; i++) {
+    if (!ledcAttach(pwmPins[i], LEDC_BASE_FREQ, LEDC_RESOLUTION)) {
+      Serial.printf("Failed to attach pin %u to LEDC\n", pwmPins[i]);
+    }
+  }
+
+  benchmark();
+
+  // Triangle shaped on a squared ramp, which looks linear to the eye
+  for (int i = 0; i < CURVE_POINTS; i++) {
+    int x = (i < CURVE_POINTS / 2) ? i : (CURVE_POINTS - 1 - i);
+    curve[i] = (x * x * 1023) / ((CURVE_POINTS / 2 - 1) * (CURVE_POINTS / 2 - 1));
+  }
+  ledcFadeSequence(pwmPins[0], curve, CURVE_POINTS, CURVE_STEP_MS, true);
+  Serial.println("Breathing curve started on the first pin.");
+}
+
+void loop() {
+  // The curve keeps playing without any work from the sketch
+  delay(1000);
+}
@@ -0,0 +1,71 @@
+// ADC Continuous Stream: loss-free streaming of raw samples, with a throughput report.
+// Each pin has its own ring buffer, filled by a driver task while the loop consumes the samples.
+
+// Total sampling frequency, shared by all pins
+#define SAMPLING_FREQ_HZ 80000
+// Conversions per pin in each driver frame
+#define CONVERSIONS_PER_PIN 64
+// Ring buffer size per pin, in samples
+#define SAMPLES_PER_PIN 4096
+// 1 for raw samples, N > 1 to output one filtered sample each N conversions
+#define DECIMATION 4
+#define REPORT_PERIOD_MS 2000
+
+#ifdef CONFIG_IDF_TARGET_ESP32
+uint8_t adc_pins[] = {36, 39};  //some of ADC1 pins for ESP32
+#else
+uint8_t adc_pins[] = {1, 2};  //ADC1 common pins for ESP32S2/S3 + ESP32C3/C6 + ESP32H2
+#endif
+uint8_t adc_pins_count = sizeof(adc_pins) / sizeof(uint8_t);
+
+// 8 taps low pass FIR filter in Q15 (sum is 32768), cut off at about 1/8 of the pin sampling rate
+const int16_t fir_coeffs[] = {1093, 2729, 5393, 7169, 7169, 5393, 2729, 1093};
+
+uint16_t samples[512];
+uint32_t samples_count[sizeof(adc_pins)];
+uint32_t read_us = 0;
+uint32_t convert_us = 0;
+uint32_t last_report = 0;
+
+void setup() {
+  Serial.begin(115200);
+
+  analogContinuous(adc_pins, adc_pins_count, CONVERSIONS_PER_PIN, SAMPLING_FREQ_HZ, NULL);
+  if (!analogContinuousStreamBegin(SAMPLES_PER_PIN, DECIMATION, DECIMATION > 1 ? fir_coeffs : NULL, DECIMATION > 1 ? 8 : 0)) {
+    Serial.println("ADC Continuous Stream failed to start!");
+  }
+  analogContinuousStart();
+  last_report = millis();
+}
+
+void loop() {
+  for (int i = 0; i < adc_pins_count; i++) {
+    uint32_t start = micros();
+    size_t count = analogContinuousStreamRead(adc_pins[i], samples, sizeof(samples) / sizeof(uint16_t), 10);
+    read_us += micros() - start;
+
+    start = micros();
+    analogContinuousStreamToMilliVolts(samples, samples, count);
+    convert_us += micros() - start;
+    samples_count[i] += count;
+  }
+
+  uint32_t now = millis();
+  if (now - last_report >= REPORT_PERIOD_MS) {
+    uint32_t total = 0;
+    for (int i = 0; i < adc_pins_count; i++) {
+      Serial.printf(
+        "PIN %d: %lu samples/s, last %u mV, %lu overruns\n", adc_pins[i], samples_count[i] * 1000 / (now - last_report), samples[0],
+        analogContinuousStreamOverruns(adc_pins[i])
+      );
+      total += samples_count[i];
+      samples_count[i] = 0;
+    }
+    if (total) {
+      Serial.printf("Read: %lu ns/sample - mV conversion: %lu ns/sample\n\n", read_us * 1000 / total, convert_us * 1000 / total);
+    }
+    read_us = 0;
+    convert_us = 0;
+    last_report = now;
+  }
+}
@@ -38,7 +38,7 @@
 const char *ssid = "**********";
 const char *password = "**********";
 
-void startCameraServer();
+void startCameraServer(size_t fb_count);
 void setupLedFlash(int pin);
 
 void setup() {
@@ -142,7 +142,7 @@ void setup() {
   Serial.println("");
   Serial.println("WiFi connected");
 
-  startCameraServer();
+  startCameraServer(config.fb_count);
 
   Serial.print("Camera Ready! Use 'http://");
   Serial.print(WiFi.localIP());
@@ -11,6 +11,8 @@
 // WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and
 // limitations under the License.
+#include <errno.h>
+#include <sys/socket.h>
 #include "esp_http_server.h"
 #include "esp_timer.h"
 #include "esp_camera.h"
@@ -19,6 +21,7 @@
 #include "esp32-hal-ledc.h"
 #include "sdkconfig.h"
 #include "camera_index.h"
+#include "frame_fanout.h"
 
 #if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
 #include "esp32-hal-log.h"
@@ -92,6 +95,11 @@ typedef struct {
   size_t len;
 } jpg_chunking_t;
 
+typedef struct {
+  httpd_req_t *req;
+  fanout_subscriber_t *sub;
+} stream_client_t;
+
 #define PART_BOUNDARY "123456789000000000000987654321"
 static const char *_STREAM_CONTENT_TYPE = "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;
 static const char *_STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
@@ -134,8 +142,6 @@ typedef struct {
   int *values;  //array to be filled with values
 } ra_filter_t;
 
-static ra_filter_t ra_filter;
-
 static ra_filter_t *ra_filter_init(ra_filter_t *filter, size_t sample_size) {
   memset(filter, 0, sizeof(ra_filter_t));
 
@@ -489,257 +495,268 @@ static esp_err_t capture_handler(httpd_req_t *req) {
 #endif
 }
 
-static esp_err_t stream_handler(httpd_req_t *req) {
-  camera_fb_t *fb = NULL;
-  struct timeval _timestamp;
-  esp_err_t res = ESP_OK;
-  size_t _jpg_buf_len = 0;
-  uint8_t *_jpg_buf = NULL;
-  char *part_buf[128];
 #if CONFIG_ESP_FACE_DETECT_ENABLED
+// Called by the capture task, so that the faces are detected once for all the streams
+static bool stream_encode(camera_fb_t *fb, uint8_t **jpg_buf, size_t *jpg_buf_len) {
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
   bool detected = false;
-  int64_t fr_ready = 0;
-  int64_t fr_recognize = 0;
-  int64_t fr_encode = 0;
-  int64_t fr_face = 0;
-  int64_t fr_start = 0;
+  int64_t fr_start = esp_timer_get_time();
+  int64_t fr_ready = fr_start;
+  int64_t fr_recognize = fr_start;
+  int64_t fr_encode = fr_start;
+  int64_t fr_face = fr_start;
 #endif
   int face_id = 0;
   size_t out_len = 0, out_width = 0, out_height = 0;
   uint8_t *out_buf = NULL;
   bool s = false;
 #if TWO_STAGE
-  HumanFaceDetectMSR01 s1(0.1F, 0.5F, 10, 0.2F);
-  HumanFaceDetectMNP01 s2(0.5F, 0.3F, 5);
+  static HumanFaceDetectMSR01 s1(0.1F, 0.5F, 10, 0.2F);
+  static HumanFaceDetectMNP01 s2(0.5F, 0.3F, 5);
 #else
-  HumanFaceDetectMSR01 s1(0.3F, 0.5F, 10, 0.2F);
-#endif
+  static HumanFaceDetectMSR01 s1(0.3F, 0.5F, 10, 0.2F);
 #endif
 
-  static int64_t last_frame = 0;
-  if (!last_frame) {
-    last_frame = esp_timer_get_time();
-  }
-
-  res = httpd_resp_set_type(req, _STREAM_CONTENT_TYPE);
-  if (res != ESP_OK) {
-    return res;
+  if (!detection_enabled || fb->width > 400) {
+    if (fb->format != PIXFORMAT_JPEG) {
+      return frame2jpg(fb, 80, jpg_buf, jpg_buf_len);
+    }
+    *jpg_buf = fb->buf;
+    *jpg_buf_len = fb->len;
+    return true;
   }
 
-  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-  httpd_resp_set_hdr(req, "X-Framerate", "60");
-
-#if CONFIG_LED_ILLUMINATOR_ENABLED
-  isStreaming = true;
-  enable_led(true);
+  if (fb->format == PIXFORMAT_RGB565
+#if CONFIG_ESP_FACE_RECOGNITION_ENABLED
+      && !recognition_enabled
 #endif
-
-  while (true) {
-#if CONFIG_ESP_FACE_DETECT_ENABLED
+  ) {
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-    detected = false;
+    fr_ready = esp_timer_get_time();
 #endif
-    face_id = 0;
+#if TWO_STAGE
+    std::list<dl::detect::result_t> &candidates = s1.infer((uint16_t *)fb->buf, {(int)fb->height, (int)fb->width, 3});
+    std::list<dl::detect::result_t> &results = s2.infer((uint16_t *)fb->buf, {(int)fb->height, (int)fb->width, 3}, candidates);
+#else
+    std::list<dl::detect::result_t> &results = s1.infer((uint16_t *)fb->buf, {(int)fb->height, (int)fb->width, 3});
 #endif
-
-    fb = esp_camera_fb_get();
-    if (!fb) {
-      log_e("Camera capture failed");
-      res = ESP_FAIL;
-    } else {
-      _timestamp.tv_sec = fb->timestamp.tv_sec;
-      _timestamp.tv_usec = fb->timestamp.tv_usec;
-#if CONFIG_ESP_FACE_DETECT_ENABLED
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-      fr_start = esp_timer_get_time();
-      fr_ready = fr_start;
-      fr_encode = fr_start;
-      fr_recognize = fr_start;
-      fr_face = fr_start;
-#endif
-      if (!detection_enabled || fb->width > 400) {
-#endif
-        if (fb->format != PIXFORMAT_JPEG) {
-          bool jpeg_converted = frame2jpg(fb, 80, &_jpg_buf, &_jpg_buf_len);
-          esp_camera_fb_return(fb);
-          fb = NULL;
-          if (!jpeg_converted) {
-            log_e("JPEG compression failed");
-            res = ESP_FAIL;
-          }
-        } else {
-          _jpg_buf_len = fb->len;
-          _jpg_buf = fb->buf;
-        }
-#if CONFIG_ESP_FACE_DETECT_ENABLED
-      } else {
-        if (fb->format == PIXFORMAT_RGB565
-#if CONFIG_ESP_FACE_RECOGNITION_ENABLED
-            && !recognition_enabled
+    fr_face = esp_timer_get_time();
+    fr_recognize = fr_face;
 #endif
-        ) {
+    if (results.size() > 0) {
+      fb_data_t rfb;
+      rfb.width = fb->width;
+      rfb.height = fb->height;
+      rfb.data = fb->buf;
+      rfb.bytes_per_pixel = 2;
+      rfb.format = FB_RGB565;
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-          fr_ready = esp_timer_get_time();
+      detected = true;
 #endif
-#if TWO_STAGE
-          std::list<dl::detect::result_t> &candidates = s1.infer((uint16_t *)fb->buf, {(int)fb->height, (int)fb->width, 3});
-          std::list<dl::detect::result_t> &results = s2.infer((uint16_t *)fb->buf, {(int)fb->height, (int)fb->width, 3}, candidates);
-#else
-          std::list<dl::detect::result_t> &results = s1.infer((uint16_t *)fb->buf, {(int)fb->height, (int)fb->width, 3});
-#endif
-#if CONFIG_ESP_FACE_DETECT_ENABLED && ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-          fr_face = esp_timer_get_time();
-          fr_recognize = fr_face;
-#endif
-          if (results.size() > 0) {
-            fb_data_t rfb;
-            rfb.width = fb->width;
-            rfb.height = fb->height;
-            rfb.data = fb->buf;
-            rfb.bytes_per_pixel = 2;
-            rfb.format = FB_RGB565;
+      draw_face_boxes(&rfb, &results, face_id);
+    }
+    s = fmt2jpg(fb->buf, fb->len, fb->width, fb->height, PIXFORMAT_RGB565, 80, jpg_buf, jpg_buf_len);
+    if (!s) {
+      log_e("fmt2jpg failed");
+    }
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-            detected = true;
-#endif
-            draw_face_boxes(&rfb, &results, face_id);
-          }
-          s = fmt2jpg(fb->buf, fb->len, fb->width, fb->height, PIXFORMAT_RGB565, 80, &_jpg_buf, &_jpg_buf_len);
-          esp_camera_fb_return(fb);
-          fb = NULL;
-          if (!s) {
-            log_e("fmt2jpg failed");
-            res = ESP_FAIL;
-          }
-#if CONFIG_ESP_FACE_DETECT_ENABLED && ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-          fr_encode = esp_timer_get_time();
-#endif
-        } else {
-          out_len = fb->width * fb->height * 3;
-          out_width = fb->width;
-          out_height = fb->height;
-          out_buf = (uint8_t *)malloc(out_len);
-          if (!out_buf) {
-            log_e("out_buf malloc failed");
-            res = ESP_FAIL;
-          } else {
-            s = fmt2rgb888(fb->buf, fb->len, fb->format, out_buf);
-            esp_camera_fb_return(fb);
-            fb = NULL;
-            if (!s) {
-              free(out_buf);
-              log_e("To rgb888 failed");
-              res = ESP_FAIL;
-            } else {
+    fr_encode = esp_timer_get_time();
+#endif
+  } else {
+    out_len = fb->width * fb->height * 3;
+    out_width = fb->width;
+    out_height = fb->height;
+    out_buf = (uint8_t *)malloc(out_len);
+    if (!out_buf) {
+      log_e("out_buf malloc failed");
+      return false;
+    }
+    s = fmt2rgb888(fb->buf, fb->len, fb->format, out_buf);
+    if (!s) {
+      free(out_buf);
+      log_e("To rgb888 failed");
+      return false;
+    }
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-              fr_ready = esp_timer_get_time();
+    fr_ready = esp_timer_get_time();
 #endif
 
-              fb_data_t rfb;
-              rfb.width = out_width;
-              rfb.height = out_height;
-              rfb.data = out_buf;
-              rfb.bytes_per_pixel = 3;
-              rfb.format = FB_BGR888;
+    fb_data_t rfb;
+    rfb.width = out_width;
+    rfb.height = out_height;
+    rfb.data = out_buf;
+    rfb.bytes_per_pixel = 3;
+    rfb.format = FB_BGR888;
 
 #if TWO_STAGE
-              std::list<dl::detect::result_t> &candidates = s1.infer((uint8_t *)out_buf, {(int)out_height, (int)out_width, 3});
-              std::list<dl::detect::result_t> &results = s2.infer((uint8_t *)out_buf, {(int)out_height, (int)out_width, 3}, candidates);
+    std::list<dl::detect::result_t> &candidates = s1.infer((uint8_t *)out_buf, {(int)out_height, (int)out_width, 3});
+    std::list<dl::detect::result_t> &results = s2.infer((uint8_t *)out_buf, {(int)out_height, (int)out_width, 3}, candidates);
 #else
-              std::list<dl::detect::result_t> &results = s1.infer((uint8_t *)out_buf, {(int)out_height, (int)out_width, 3});
+    std::list<dl::detect::result_t> &results = s1.infer((uint8_t *)out_buf, {(int)out_height, (int)out_width, 3});
 #endif
 
-#if CONFIG_ESP_FACE_DETECT_ENABLED && ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-              fr_face = esp_timer_get_time();
-              fr_recognize = fr_face;
+#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
+    fr_face = esp_timer_get_time();
+    fr_recognize = fr_face;
 #endif
 
-              if (results.size() > 0) {
+    if (results.size() > 0) {
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-                detected = true;
+      detected = true;
 #endif
 #if CONFIG_ESP_FACE_RECOGNITION_ENABLED
-                if (recognition_enabled) {
-                  face_id = run_face_recognition(&rfb, &results);
+      if (recognition_enabled) {
+        face_id = run_face_recognition(&rfb, &results);
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-                  fr_recognize = esp_timer_get_time();
-#endif
-                }
-#endif
-                draw_face_boxes(&rfb, &results, face_id);
-              }
-              s = fmt2jpg(out_buf, out_len, out_width, out_height, PIXFORMAT_RGB888, 90, &_jpg_buf, &_jpg_buf_len);
-              free(out_buf);
-              if (!s) {
-                log_e("fmt2jpg failed");
-                res = ESP_FAIL;
-              }
-#if CONFIG_ESP_FACE_DETECT_ENABLED && ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-              fr_encode = esp_timer_get_time();
-#endif
-            }
-          }
-        }
+        fr_recognize = esp_timer_get_time();
+#endif
       }
 #endif
+      draw_face_boxes(&rfb, &results, face_id);
     }
-    if (res == ESP_OK) {
-      res = httpd_resp_send_chunk(req, _STREAM_BOUNDARY, strlen(_STREAM_BOUNDARY));
+    s = fmt2jpg(out_buf, out_len, out_width, out_height, PIXFORMAT_RGB888, 90, jpg_buf, jpg_buf_len);
+    free(out_buf);
+    if (!s) {
+      log_e("fmt2jpg failed");
     }
+#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
+    fr_encode = esp_timer_get_time();
+#endif
+  }
+
+#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
+  int64_t ready_time = (fr_ready - fr_start) / 1000;
+  int64_t face_time = (fr_face - fr_ready) / 1000;
+  int64_t recognize_time = (fr_recognize - fr_face) / 1000;
+  int64_t encode_time = (fr_encode - fr_recognize) / 1000;
+  int64_t process_time = (fr_encode - fr_start) / 1000;
+#endif
+  log_i(
+    "Face: %u+%u+%u+%u=%u %s%d", (uint32_t)ready_time, (uint32_t)face_time, (uint32_t)recognize_time, (uint32_t)encode_time, (uint32_t)process_time,
+    (detected) ? "DETECTED " : "", face_id
+  );
+  return s;
+}
+#endif
+
+#if CONFIG_LED_ILLUMINATOR_ENABLED
+static uint32_t stream_count = 0;
+#endif
+
+// the client closed the connection, or it failed
+static bool stream_client_gone(httpd_req_t *req) {
+  int fd = httpd_req_to_sockfd(req);
+  if (fd < 0) {
+    return true;
+  }
+  char c;
+  int n = recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  return n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+}
+
+// Sends the frames of the capture task to one client, from its own task
+static void stream_task(void *arg) {
+  stream_client_t *client = (stream_client_t *)arg;
+  httpd_req_t *req = client->req;
+  esp_err_t res = ESP_OK;
+  char part_buf[128];
+  ra_filter_t ra_filter;
+  ra_filter_init(&ra_filter, 20);
+  int64_t last_frame = esp_timer_get_time();
+
+#if CONFIG_LED_ILLUMINATOR_ENABLED
+  if (__atomic_add_fetch(&stream_count, 1, __ATOMIC_RELAXED) == 1) {
+    isStreaming = true;
+    enable_led(true);
+  }
+#endif
+
+  res = httpd_resp_set_type(req, _STREAM_CONTENT_TYPE);
+  if (res == ESP_OK) {
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_set_hdr(req, "X-Framerate", "60");
+  }
+
+  while (res == ESP_OK) {
+    fanout_frame_t *frame = fanout_next(client->sub, pdMS_TO_TICKS(1000));
+    if (!frame) {
+      // no frame to fail a send when the client has gone
+      if (stream_client_gone(req)) {
+        log_i("Stream client gone");
+        break;
+      }
+      continue;
+    }
+    res = httpd_resp_send_chunk(req, _STREAM_BOUNDARY, strlen(_STREAM_BOUNDARY));
     if (res == ESP_OK) {
-      size_t hlen = snprintf((char *)part_buf, 128, _STREAM_PART, _jpg_buf_len, _timestamp.tv_sec, _timestamp.tv_usec);
+      size_t hlen = snprintf(part_buf, 128, _STREAM_PART, frame->len, frame->timestamp.tv_sec, frame->timestamp.tv_usec);
       res = httpd_resp_send_chunk(req, (const char *)part_buf, hlen);
     }
     if (res == ESP_OK) {
-      res = httpd_resp_send_chunk(req, (const char *)_jpg_buf, _jpg_buf_len);
-    }
-    if (fb) {
-      esp_camera_fb_return(fb);
-      fb = NULL;
-      _jpg_buf = NULL;
-    } else if (_jpg_buf) {
-      free(_jpg_buf);
-      _jpg_buf = NULL;
+      res = httpd_resp_send_chunk(req, (const char *)frame->buf, frame->len);
     }
+    size_t jpg_buf_len = frame->len;
+    fanout_release(frame);
     if (res != ESP_OK) {
       log_e("Send frame failed");
       break;
     }
     int64_t fr_end = esp_timer_get_time();
 
-#if CONFIG_ESP_FACE_DETECT_ENABLED && ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-    int64_t ready_time = (fr_ready - fr_start) / 1000;
-    int64_t face_time = (fr_face - fr_ready) / 1000;
-    int64_t recognize_time = (fr_recognize - fr_face) / 1000;
-    int64_t encode_time = (fr_encode - fr_recognize) / 1000;
-    int64_t process_time = (fr_encode - fr_start) / 1000;
-#endif
-
     int64_t frame_time = fr_end - last_frame;
+    last_frame = fr_end;
     frame_time /= 1000;
 #if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
     uint32_t avg_frame_time = ra_filter_run(&ra_filter, frame_time);
 #endif
     log_i(
-      "MJPG: %uB %ums (%.1ffps), AVG: %ums (%.1ffps)"
-#if CONFIG_ESP_FACE_DETECT_ENABLED
-      ", %u+%u+%u+%u=%u %s%d"
-#endif
-      ,
-      (uint32_t)(_jpg_buf_len), (uint32_t)frame_time, 1000.0 / (uint32_t)frame_time, avg_frame_time, 1000.0 / avg_frame_time
-#if CONFIG_ESP_FACE_DETECT_ENABLED
-      ,
-      (uint32_t)ready_time, (uint32_t)face_time, (uint32_t)recognize_time, (uint32_t)encode_time, (uint32_t)process_time, (detected) ? "DETECTED " : "", face_id
-#endif
+      "MJPG: %uB %ums (%.1ffps), AVG: %ums (%.1ffps), %u dropped", (uint32_t)(jpg_buf_len), (uint32_t)frame_time, 1000.0 / (uint32_t)frame_time,
+      avg_frame_time, 1000.0 / avg_frame_time, fanout_dropped(client->sub)
     );
   }
 
 #if CONFIG_LED_ILLUMINATOR_ENABLED
-  isStreaming = false;
-  enable_led(false);
+  if (__atomic_sub_fetch(&stream_count, 1, __ATOMIC_RELAXED) == 0) {
+    isStreaming = false;
+    enable_led(false);
+  }
 #endif
 
-  return res;
+  free(ra_filter.values);
+  fanout_unsubscribe(client->sub);
+  httpd_req_async_handler_complete(req);
+  free(client);
+  vTaskDelete(NULL);
+}
+
+static esp_err_t stream_handler(httpd_req_t *req) {
+  stream_client_t *client = (stream_client_t *)malloc(sizeof(stream_client_t));
+  if (!client) {
+    httpd_resp_send_500(req);
+    return ESP_FAIL;
+  }
+  client->sub = fanout_subscribe();
+  if (!client->sub) {
+    log_e("Too many streams");
+    free(client);
+    httpd_resp_send_500(req);
+    return ESP_FAIL;
+  }
+  // the request is kept open after the handler returns, for the task of the client
+  if (httpd_req_async_handler_begin(req, &client->req) != ESP_OK) {
+    fanout_unsubscribe(client->sub);
+    free(client);
+    return ESP_FAIL;
+  }
+  if (xTaskCreate(stream_task, "stream", 4096, client, tskIDLE_PRIORITY + 5, NULL) != pdPASS) {
+    log_e("Stream task creation failed");
+    httpd_req_async_handler_complete(client->req);
+    fanout_unsubscribe(client->sub);
+    free(client);
+    return ESP_FAIL;
+  }
+  return ESP_OK;
 }
 
 static esp_err_t parse_get(httpd_req_t *req, char **obuf) {
@@ -1140,7 +1157,7 @@ static esp_err_t index_handler(httpd_req_t *req) {
   }
 }
 
-void startCameraServer() {
+void startCameraServer(size_t fb_count) {
   httpd_config_t config = HTTPD_DEFAULT_CONFIG();
   config.max_uri_handlers = 16;
 
@@ -1287,8 +1304,6 @@ void startCameraServer() {
 #endif
   };
 
-  ra_filter_init(&ra_filter, 20);
-
 #if CONFIG_ESP_FACE_RECOGNITION_ENABLED
   recognizer.set_partition(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "fr");
 
@@ -1313,7 +1328,13 @@ void startCameraServer() {
   config.server_port += 1;
   config.ctrl_port += 1;
   log_i("Starting stream server on port: '%d'", config.server_port);
-  if (httpd_start(&stream_httpd, &config) == ESP_OK) {
+  // one capture task encodes the frames for all the streams
+#if CONFIG_ESP_FACE_DETECT_ENABLED
+  bool fanout = fanout_begin(fb_count, stream_encode, tskIDLE_PRIORITY + 5, config.stack_size);
+#else
+  bool fanout = fanout_begin(fb_count, NULL, tskIDLE_PRIORITY + 5, config.stack_size);
+#endif
+  if (fanout && httpd_start(&stream_httpd, &config) == ESP_OK) {
     httpd_register_uri_handler(stream_httpd, &stream_uri);
   }
 }
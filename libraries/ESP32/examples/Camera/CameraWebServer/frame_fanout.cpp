@@ -0,0 +1,270 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "frame_fanout.h"
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "img_converters.h"
+
+#if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
+#include "esp32-hal-log.h"
+#endif
+
+#define FANOUT_MAX_SUBSCRIBERS 8
+
+struct fanout_subscriber_s {
+  bool used;
+  fanout_frame_t *pending;  // latest frame, not returned by fanout_next() yet
+  SemaphoreHandle_t ready;
+  uint32_t dropped;
+};
+
+static fanout_subscriber_t subscribers[FANOUT_MAX_SUBSCRIBERS];
+static size_t subscriber_count = 0;
+static size_t held_fbs = 0;  // camera frame buffers referenced by the subscribers
+static size_t max_held_fbs = 0;
+static size_t fb_total = 0;
+static fanout_encode_t encoder = NULL;
+static TaskHandle_t capture_task = NULL;
+static portMUX_TYPE fanout_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void fanout_release(fanout_frame_t *frame) {
+  if (!frame) {
+    return;
+  }
+  portENTER_CRITICAL(&fanout_mux);
+  bool last = --frame->refs == 0;
+  if (last && frame->fb) {
+    held_fbs--;
+  }
+  portEXIT_CRITICAL(&fanout_mux);
+  if (!last) {
+    return;
+  }
+  if (frame->fb) {
+    esp_camera_fb_return(frame->fb);
+    // the capture task may wait for the buffer
+    xTaskNotifyGive(capture_task);
+  } else {
+    free((void *)frame->buf);
+  }
+  free(frame);
+}
+
+// a frame referencing the camera frame buffer, or a copy of it when the camera needs the buffer back
+static fanout_frame_t *fanout_frame(camera_fb_t *fb) {
+  fanout_frame_t *frame = (fanout_frame_t *)calloc(1, sizeof(fanout_frame_t));
+  if (!frame) {
+    esp_camera_fb_return(fb);
+    return NULL;
+  }
+  frame->width = fb->width;
+  frame->height = fb->height;
+  frame->timestamp = fb->timestamp;
+  frame->refs = 1;
+
+  uint8_t *buf = NULL;
+  size_t len = 0;
+  bool encoded;
+  if (encoder) {
+    encoded = encoder(fb, &buf, &len);
+  } else if (fb->format == PIXFORMAT_JPEG) {
+    buf = fb->buf;
+    len = fb->len;
+    encoded = true;
+  } else {
+    encoded = frame2jpg(fb, 80, &buf, &len);
+  }
+  if (!encoded) {
+    log_e("JPEG compression failed");
+    esp_camera_fb_return(fb);
+    free(frame);
+    return NULL;
+  }
+
+  if (buf == fb->buf) {
+    portENTER_CRITICAL(&fanout_mux);
+    // a single frame buffer is held by a single subscriber, the next frame being captured once it is released
+    bool keep = held_fbs < max_held_fbs || (fb_total == 1 && !held_fbs && subscriber_count == 1);
+    if (keep) {
+      held_fbs++;
+    }
+    portEXIT_CRITICAL(&fanout_mux);
+    if (keep) {
+      frame->fb = fb;
+      frame->buf = buf;
+      frame->len = len;
+      return frame;
+    }
+    buf = (uint8_t *)malloc(len);
+    if (!buf) {
+      log_e("Frame copy allocation failed");
+      esp_camera_fb_return(fb);
+      free(frame);
+      return NULL;
+    }
+    memcpy(buf, fb->buf, len);
+  }
+  esp_camera_fb_return(fb);
+  frame->buf = buf;
+  frame->len = len;
+  return frame;
+}
+
+static void fanout_capture_task(void *arg) {
+  fanout_frame_t *released[FANOUT_MAX_SUBSCRIBERS];
+  uint32_t frames = 0;
+  int64_t last_log = esp_timer_get_time();
+
+  for (;;) {
+    if (!subscriber_count) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      continue;
+    }
+    // the single frame buffer is sent by a subscriber
+    if (fb_total == 1 && held_fbs) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      continue;
+    }
+    camera_fb_t *fb = esp_camera_fb_get();
+    if (!fb) {
+      log_e("Camera capture failed");
+      vTaskDelay(pdMS_TO_TICKS(100));
+      continue;
+    }
+    fanout_frame_t *frame = fanout_frame(fb);
+    if (!frame) {
+      continue;
+    }
+
+    // replace the frame pending for each subscriber, which is released out of the critical section
+    size_t count = 0;
+    uint32_t notified = 0;
+    portENTER_CRITICAL(&fanout_mux);
+    for (size_t i = 0; i < FANOUT_MAX_SUBSCRIBERS; i++) {
+      fanout_subscriber_t *sub = &subscribers[i];
+      if (!sub->used) {
+        continue;
+      }
+      if (sub->pending) {
+        released[count++] = sub->pending;
+        sub->dropped++;
+      }
+      sub->pending = frame;
+      frame->refs++;
+      notified |= 1 << i;
+    }
+    portEXIT_CRITICAL(&fanout_mux);
+    for (size_t i = 0; i < FANOUT_MAX_SUBSCRIBERS; i++) {
+      if (notified & (1 << i)) {
+        xSemaphoreGive(subscribers[i].ready);
+      }
+    }
+    for (size_t i = 0; i < count; i++) {
+      fanout_release(released[i]);
+    }
+    fanout_release(frame);
+
+    frames++;
+    int64_t now = esp_timer_get_time();
+    if (now - last_log >= 1000000) {
+      log_i("Capture: %.1ffps, %u subscribers, %u frame buffers held", frames * 1000000.0 / (now - last_log), subscriber_count, held_fbs);
+      frames = 0;
+      last_log = now;
+    }
+  }
+}
+
+bool fanout_begin(size_t fb_count, fanout_encode_t encode, UBaseType_t priority, uint32_t stack_size) {
+  if (capture_task) {
+    return true;
+  }
+  // the camera keeps one frame buffer to capture the next frame
+  max_held_fbs = fb_count ? fb_count - 1 : 0;
+  fb_total = fb_count;
+  encoder = encode;
+  for (size_t i = 0; i < FANOUT_MAX_SUBSCRIBERS; i++) {
+    subscribers[i].ready = xSemaphoreCreateBinary();
+    if (!subscribers[i].ready) {
+      log_e("Semaphore creation failed");
+      return false;
+    }
+  }
+  if (xTaskCreate(fanout_capture_task, "fanout_capture", stack_size, NULL, priority, &capture_task) != pdPASS) {
+    log_e("Capture task creation failed");
+    capture_task = NULL;
+    return false;
+  }
+  return true;
+}
+
+fanout_subscriber_t *fanout_subscribe(void) {
+  if (!capture_task) {
+    return NULL;
+  }
+  fanout_subscriber_t *sub = NULL;
+  portENTER_CRITICAL(&fanout_mux);
+  for (size_t i = 0; i < FANOUT_MAX_SUBSCRIBERS; i++) {
+    if (!subscribers[i].used) {
+      sub = &subscribers[i];
+      sub->used = true;
+      sub->pending = NULL;
+      sub->dropped = 0;
+      subscriber_count++;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&fanout_mux);
+  if (sub) {
+    xTaskNotifyGive(capture_task);
+  }
+  return sub;
+}
+
+void fanout_unsubscribe(fanout_subscriber_t *sub) {
+  if (!sub) {
+    return;
+  }
+  portENTER_CRITICAL(&fanout_mux);
+  fanout_frame_t *frame = sub->pending;
+  sub->pending = NULL;
+  sub->used = false;
+  subscriber_count--;
+  portEXIT_CRITICAL(&fanout_mux);
+  fanout_release(frame);
+}
+
+static fanout_frame_t *fanout_take(fanout_subscriber_t *sub) {
+  portENTER_CRITICAL(&fanout_mux);
+  fanout_frame_t *frame = sub->pending;
+  sub->pending = NULL;
+  portEXIT_CRITICAL(&fanout_mux);
+  return frame;
+}
+
+fanout_frame_t *fanout_next(fanout_subscriber_t *sub, TickType_t timeout) {
+  // the semaphore may be given for a frame already taken, so that it is only waited for without a frame
+  fanout_frame_t *frame = fanout_take(sub);
+  if (frame || xSemaphoreTake(sub->ready, timeout) != pdTRUE) {
+    return frame;
+  }
+  return fanout_take(sub);
+}
+
+uint32_t fanout_dropped(fanout_subscriber_t *sub) {
+  return sub->dropped;
+}
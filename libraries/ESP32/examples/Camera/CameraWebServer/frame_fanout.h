@@ -0,0 +1,68 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/time.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_camera.h"
+
+/*
+ * Fan-out of the camera frames to several subscribers.
+ *
+ * A capture task gets the frames from the camera, converts them to JPEG when needed, once for all the
+ * subscribers, and gives each subscriber a reference to the latest frame. A subscriber still sending
+ * the previous frame gets the latest one when it is done, the frames in between being dropped for it,
+ * so that slow subscribers never stall the capture nor the other subscribers.
+ *
+ * A JPEG frame is sent from the camera frame buffer, without copy, and the buffer is returned to the
+ * camera when the last subscriber releases it. Only when the subscribers hold all the frame buffers
+ * but the one the camera needs to capture the next frame, the frame is copied to release its buffer.
+ * With a single frame buffer, a single subscriber holds it while it sends the frame, and the next frame
+ * is captured when it is released. It is copied for several subscribers.
+ */
+
+typedef struct {
+  const uint8_t *buf;  // JPEG data
+  size_t len;
+  size_t width;
+  size_t height;
+  struct timeval timestamp;
+  camera_fb_t *fb;  // camera frame buffer holding buf, or NULL when buf was allocated
+  uint32_t refs;
+} fanout_frame_t;
+
+typedef struct fanout_subscriber_s fanout_subscriber_t;
+
+// Converts a frame buffer that is not JPEG, or processes it before it is sent. <buf> is set to fb->buf to send
+// the frame buffer itself, or to JPEG data allocated with malloc(), and then fb is returned to the camera.
+typedef bool (*fanout_encode_t)(camera_fb_t *fb, uint8_t **buf, size_t *len);
+
+// <fb_count> is the number of frame buffers of the camera. NULL <encode> sends the JPEG frame buffers as they
+// are, and converts the others with a quality of 80.
+bool fanout_begin(size_t fb_count, fanout_encode_t encode, UBaseType_t priority, uint32_t stack_size);
+
+// NULL when all the subscribers are used, or when fanout_begin() was not called
+fanout_subscriber_t *fanout_subscribe(void);
+void fanout_unsubscribe(fanout_subscriber_t *sub);
+
+// Waits up to <timeout> for a frame newer than the last one returned, to release with fanout_release()
+fanout_frame_t *fanout_next(fanout_subscriber_t *sub, TickType_t timeout);
+void fanout_release(fanout_frame_t *frame);
+
+// frames the subscriber did not get as it was still sending a previous one
+uint32_t fanout_dropped(fanout_subscriber_t *sub);
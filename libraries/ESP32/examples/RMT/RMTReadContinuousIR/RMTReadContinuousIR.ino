@@ -0,0 +1,65 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @brief This example demonstrates RMT Continuous Reading with the NEC IR decoder.
+ *
+ * Connect an IR receiver module (TSOP38238 or alike) output to IR_RX_PIN.
+ * The RMT channel keeps receiving frames into a ring of buffers, while the loop
+ * decodes them and prints each NEC code, including repeat codes.
+ */
+
+#define IR_RX_PIN      4
+#define RMT_FREQ_HZ    1000000  // 1us tick
+#define RMT_NUM_BUFS   4
+#define RMT_BUF_SYMBOL 64  // NEC frame has 34 RMT Symbols
+
+rmt_decoder_t nec_decoder;
+uint32_t last_overruns = 0;
+
+void setup() {
+  Serial.begin(115200);
+  if (!rmtInit(IR_RX_PIN, RMT_RX_MODE, RMT_MEM_NUM_BLOCKS_1, RMT_FREQ_HZ)) {
+    Serial.println("init receiver failed\n");
+  }
+  // the frame ends after 12ms idle - longer than the 9ms NEC leader
+  rmtSetRxMaxThreshold(IR_RX_PIN, 12000);
+  rmtSetRxMinThreshold(IR_RX_PIN, 200);  // filters glitches shorter than 200us
+  rmtDecoderInit(&nec_decoder, RMT_PROTOCOL_NEC, RMT_FREQ_HZ);
+  rmtReadContinuous(IR_RX_PIN, RMT_NUM_BUFS, RMT_BUF_SYMBOL);
+}
+
+void loop() {
+  rmt_data_t *data;
+  size_t num_symbols;
+  rmt_frame_t frame;
+
+  if (rmtReadContinuousFrame(IR_RX_PIN, &data, &num_symbols, RMT_WAIT_FOR_EVER)) {
+    for (size_t i = 0; i < num_symbols; i++) {
+      if (rmtDecoderFeed(&nec_decoder, data[i], &frame)) {
+        if (frame.repeat) {
+          Serial.printf("NEC repeat 0x%08lx\n", frame.data);
+        } else {
+          Serial.printf("NEC address 0x%04x command 0x%02x\n", frame.address, frame.command);
+        }
+      }
+    }
+    rmtReadContinuousRelease(IR_RX_PIN, data);
+  }
+  uint32_t overruns = rmtReadContinuousOverruns(IR_RX_PIN);
+  if (overruns != last_overruns) {
+    Serial.printf("%lu frames dropped\n", overruns - last_overruns);
+    last_overruns = overruns;
+  }
+}
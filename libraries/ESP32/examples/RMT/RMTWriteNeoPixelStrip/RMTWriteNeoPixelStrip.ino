@@ -0,0 +1,78 @@
+// Copyright 2024 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @brief This example demonstrates the NeoPixel Strip API, driving long WS2812 strips
+ * in parallel, each one in its own RMT channel.
+ *
+ * Pixels are stored as GRB bytes and encoded on the fly by the RMT Bytes Encoder, thus
+ * a 1000 LEDs strip uses 2 x 3000 bytes (double buffer) instead of 96KB of rmt_data_t.
+ * While a frame is sent, the next one is drawn in the back buffer.
+ *
+ * The Serial Monitor reports the frame rate, the CPU time spent drawing and the heap used.
+ * WS2812 sends 24 bits per LED at 800KHz (30us per LED), thus the expected maximum is
+ * about 33 FPS for 1000 LEDs and about 8 FPS for 4000 LEDs in a single strip. Splitting
+ * 4000 LEDs in 4 strips of 1000 LEDs keeps it at about 33 FPS.
+ */
+
+#define NR_OF_STRIPS     4
+#define LEDS_PER_STRIP   1000
+#define REPORT_PERIOD_MS 5000
+
+// change the GPIOs to match the board
+const uint8_t strip_pins[NR_OF_STRIPS] = {4, 5, 6, 7};
+
+uint32_t frames = 0;
+uint32_t draw_us = 0;
+uint32_t last_report = 0;
+uint16_t led_index = 0;
+
+void setup() {
+  Serial.begin(115200);
+  uint32_t heap_before = ESP.getFreeHeap();
+  for (int i = 0; i < NR_OF_STRIPS; i++) {
+    if (!neopixelStripBegin(strip_pins[i], LEDS_PER_STRIP, NEOPIXEL_STRIP_GRB)) {
+      Serial.printf("NeoPixel Strip init failed for GPIO %d\n", strip_pins[i]);
+    }
+  }
+  Serial.printf("%d strips x %d LEDs - heap used: %lu bytes\n", NR_OF_STRIPS, LEDS_PER_STRIP, heap_before - ESP.getFreeHeap());
+  last_report = millis();
+}
+
+void loop() {
+  uint32_t start = micros();
+  for (int i = 0; i < NR_OF_STRIPS; i++) {
+    // a dot running along each strip - the back buffer keeps the previous frame
+    neopixelStripSetPixel(strip_pins[i], led_index, 0, 0, 0, 0);
+    neopixelStripSetPixel(strip_pins[i], (led_index + 1) % LEDS_PER_STRIP, RGB_BRIGHTNESS, 0, RGB_BRIGHTNESS / 2, 0);
+  }
+  draw_us += micros() - start;
+  led_index = (led_index + 1) % LEDS_PER_STRIP;
+
+  // starts all strips at once, each show() only waits for its own previous frame
+  for (int i = 0; i < NR_OF_STRIPS; i++) {
+    neopixelStripShow(strip_pins[i], RMT_WAIT_FOR_EVER);
+  }
+  frames++;
+
+  uint32_t now = millis();
+  if (now - last_report >= REPORT_PERIOD_MS) {
+    Serial.printf(
+      "%.1f FPS - %d LEDs total - draw time %lu us/frame\n", frames * 1000.0 / (now - last_report), NR_OF_STRIPS * LEDS_PER_STRIP, draw_us / frames
+    );
+    frames = 0;
+    draw_us = 0;
+    last_report = now;
+  }
+}
@@ -0,0 +1,72 @@
+#include <SHA256Builder.h>
+#include <HMACBuilder.h>
+
+// SHA256Builder computes the SHA-256 of data, e.g. to check that a downloaded
+// image or asset is the expected one. It runs on the SHA peripheral of the chip.
+//
+// HMACBuilder turns any of the hash builders into a keyed hash (HMAC), e.g. to
+// check that a message was sent by someone knowing a shared secret key.
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+  Serial.println("\n\n\nStart.");
+
+  // echo -n "Hello World" | openssl sha256
+  {
+    String sha256_str = "a591a6d40bf420404a011733cfb7b190d62c65bf0bcda32b57b277d9ad9f146e";
+
+    SHA256Builder sha;
+
+    sha.begin();
+    sha.add("Hello World");
+    sha.calculate();
+
+    if (!sha256_str.equalsIgnoreCase(sha.toString())) {
+      Serial.println("Odd - failing SHA256 on String");
+    } else {
+      Serial.println("OK!");
+    }
+  }
+
+  // echo -n "Hello World" | openssl sha256 -hmac "secret key"
+  {
+    String hmac_str = "bf59af502ddd73b7d8ceaaab65a4f91ac42d7c48441f152d3d541287b15cb642";
+
+    SHA256Builder sha;
+    HMACBuilder hmac(sha);
+
+    hmac.setKey("secret key");
+    hmac.begin();
+    hmac.add("Hello World");
+    hmac.calculate();
+
+    if (!hmac_str.equalsIgnoreCase(hmac.toString())) {
+      Serial.println("Odd - failing HMAC-SHA256 on String");
+    } else {
+      Serial.println("OK!");
+    }
+  }
+
+  // The hash of a stream, e.g. a file or a network client: addStream() waits for
+  // all the bytes up to the stream timeout, and returns false if some are missing.
+  {
+    SHA256Builder sha;
+
+    Serial.println("Type 8 characters:");
+    Serial.setTimeout(30000);
+    sha.begin();
+    if (sha.addStream(Serial, 8)) {
+      sha.calculate();
+      Serial.println(sha.toString());
+    } else {
+      Serial.println("Timed out");
+    }
+  }
+
+  Serial.println("Done.");
+}
+
+void loop() {}
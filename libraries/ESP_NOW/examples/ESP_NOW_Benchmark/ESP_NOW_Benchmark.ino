@@ -0,0 +1,134 @@
+/*
+    ESP-NOW Benchmark
+
+    This sketch measures the frames received per second and the time spent in the Wi-Fi task for each frame.
+
+    Flash one device with SENDER set to 1: it broadcasts frames of ESP_NOW_MAX_DATA_LEN bytes as fast as they are sent.
+    Flash another device with SENDER set to 0: it registers the sender and 19 other peers, the most ESP-NOW allows,
+    and prints the statistics of the received frames every second.
+
+    With RX_QUEUE_FRAMES set to 0, the frames are handled in the Wi-Fi task. Otherwise they are copied to a queue and
+    handled by a separate task, leaving the Wi-Fi task free to receive the next frames sooner.
+*/
+
+#include "ESP32_NOW.h"
+#include "WiFi.h"
+
+#include <esp_mac.h>  // For the MAC2STR and MACSTR macros
+
+/* Definitions */
+
+#define ESPNOW_WIFI_CHANNEL 6
+#define SENDER              0
+#define RX_QUEUE_FRAMES     32
+#define OTHER_PEERS         (ESP_NOW_MAX_TOTAL_PEER_NUM - 1)
+
+/* Classes */
+
+class ESP_NOW_Benchmark_Peer : public ESP_NOW_Peer {
+public:
+  ESP_NOW_Benchmark_Peer(const uint8_t *mac_addr) : ESP_NOW_Peer(mac_addr, ESPNOW_WIFI_CHANNEL, WIFI_IF_STA, NULL) {}
+
+  ~ESP_NOW_Benchmark_Peer() {
+    remove();
+  }
+
+  bool begin() {
+    return add();
+  }
+
+  bool send_frame(const uint8_t *data, size_t len) {
+    return send(data, len) == len;
+  }
+
+  void onReceive(const uint8_t *data, size_t len, bool broadcast) {
+    received++;
+    bytes += len;
+  }
+
+  void onSent(bool success) {
+    xSemaphoreGive(sent);
+  }
+
+  volatile uint32_t received = 0;
+  volatile uint32_t bytes = 0;
+  SemaphoreHandle_t sent = xSemaphoreCreateBinary();
+};
+
+/* Global Variables */
+
+ESP_NOW_Benchmark_Peer *sender = NULL;
+ESP_NOW_Benchmark_Peer *others[OTHER_PEERS];
+uint8_t frame[ESP_NOW_MAX_DATA_LEN];
+
+/* Callbacks */
+
+void register_sender(const esp_now_recv_info_t *info, const uint8_t *data, int len, void *arg) {
+  if (sender == NULL) {
+    Serial.printf("Registering the sender " MACSTR "\n", MAC2STR(info->src_addr));
+    sender = new ESP_NOW_Benchmark_Peer(info->src_addr);
+    sender->begin();
+  }
+}
+
+/* Main */
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  WiFi.mode(WIFI_STA);
+  WiFi.setChannel(ESPNOW_WIFI_CHANNEL);
+  while (!WiFi.STA.started()) {
+    delay(100);
+  }
+
+  Serial.println("ESP-NOW Example - Benchmark");
+  Serial.println("  MAC Address: " + WiFi.macAddress());
+
+#if SENDER
+  static ESP_NOW_Benchmark_Peer broadcast_peer(ESP_NOW.BROADCAST_ADDR);
+  if (!ESP_NOW.begin() || !broadcast_peer.begin()) {
+    Serial.println("Failed to initialize ESP-NOW");
+    return;
+  }
+  Serial.println("Sending frames...");
+  for (uint32_t count = 0;; count++) {
+    memcpy(frame, &count, sizeof(count));
+    if (broadcast_peer.send_frame(frame, sizeof(frame))) {
+      xSemaphoreTake(broadcast_peer.sent, pdMS_TO_TICKS(100));
+    } else {
+      delay(1);
+    }
+  }
+#else
+  if (!ESP_NOW.setRxQueue(RX_QUEUE_FRAMES, 5) || !ESP_NOW.begin()) {
+    Serial.println("Failed to initialize ESP-NOW");
+    return;
+  }
+  // locally administered addresses that no device uses, to fill the table of peers
+  for (uint8_t i = 0; i < OTHER_PEERS; i++) {
+    uint8_t mac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, (uint8_t)(i + 1)};
+    others[i] = new ESP_NOW_Benchmark_Peer(mac);
+    others[i]->begin();
+  }
+  ESP_NOW.onNewPeer(register_sender, NULL);
+  Serial.printf("Receiving frames, %s\n", RX_QUEUE_FRAMES ? "queued" : "handled in the Wi-Fi task");
+#endif
+}
+
+void loop() {
+  delay(1000);
+  ESP_NOW_Class::rx_stats_t stats = ESP_NOW.getRxStats(true);
+  uint32_t received = 0;
+  if (sender != NULL) {
+    received = sender->received;
+    sender->received = 0;
+  }
+  Serial.printf(
+    "%lu frames/s, %lu handled, %lu dropped, %.2f us per frame in the Wi-Fi task\n", stats.frames, received, stats.dropped,
+    stats.frames ? (float)stats.cycles / stats.frames / getCpuFrequencyMhz() : 0.0f
+  );
+}
@@ -0,0 +1,94 @@
+/*
+    ESP-NOW Serial Benchmark
+
+    This sketch measures the throughput of ESP_NOW_Serial_Class between two devices.
+
+    Flash one device with SENDER set to 1: it writes a counting pattern to the peer as fast as the window allows.
+    Flash another device with SENDER set to 0: it reads the stream, checks the pattern, and prints the throughput.
+    Both print the statistics of the sliding window every second: frames sent, retransmissions and acks.
+
+    Set the peer MAC address of each device to the Station MAC address of the other one, printed at start.
+*/
+
+#include "ESP32_NOW_Serial.h"
+#include "MacAddress.h"
+#include "WiFi.h"
+
+/* Definitions */
+
+#define ESPNOW_WIFI_CHANNEL 1
+#define SENDER              0
+#define BUFFER_SIZE         4096
+
+// Set the MAC address of the other device
+// For example: F4:12:FA:40:64:4C
+const MacAddress peer_mac({0xF4, 0x12, 0xFA, 0x40, 0x64, 0x4C});
+
+/* Global Variables */
+
+ESP_NOW_Serial_Class NowSerial(peer_mac, ESPNOW_WIFI_CHANNEL, WIFI_IF_STA);
+uint8_t buffer[1024];
+uint32_t position = 0;
+uint32_t bytes = 0;
+uint32_t errors = 0;
+uint32_t last_print = 0;
+
+/* Main */
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  WiFi.mode(WIFI_STA);
+  WiFi.setChannel(ESPNOW_WIFI_CHANNEL);
+  while (!WiFi.STA.started()) {
+    delay(100);
+  }
+
+  Serial.println("ESP-NOW Example - Serial Benchmark");
+  Serial.println("  MAC Address: " + WiFi.macAddress());
+
+  NowSerial.setRxBufferSize(BUFFER_SIZE);
+  NowSerial.setTxBufferSize(BUFFER_SIZE);
+  if (!NowSerial.begin()) {
+    Serial.println("Failed to initialize ESP-NOW Serial");
+    return;
+  }
+  Serial.println(SENDER ? "Sending the stream..." : "Receiving the stream...");
+}
+
+void loop() {
+#if SENDER
+  for (size_t i = 0; i < sizeof(buffer); i++) {
+    buffer[i] = (uint8_t)(position + i);
+  }
+  size_t len = NowSerial.write(buffer, sizeof(buffer), 100);
+  position += len;
+  bytes += len;
+#else
+  size_t len = NowSerial.read(buffer, sizeof(buffer));
+  for (size_t i = 0; i < len; i++) {
+    if (buffer[i] != (uint8_t)(position + i)) {
+      errors++;
+      position = buffer[i] - i;  // follow the stream again
+    }
+  }
+  position += len;
+  bytes += len;
+  if (!len) {
+    delay(1);
+  }
+#endif
+
+  if (millis() - last_print >= 1000) {
+    last_print = millis();
+    ESP_NOW_Window::stats_t stats = NowSerial.getStats(true);
+    Serial.printf(
+      "%lu KB/s %s, %lu pattern errors | %lu frames sent, %lu retransmits, %lu acks, %lu received, %lu duplicates, %lu dropped\n", bytes / 1024,
+      SENDER ? "written" : "read", errors, stats.frames_sent, stats.retransmits, stats.acks_sent, stats.frames_received, stats.duplicates, stats.dropped
+    );
+    bytes = 0;
+  }
+}
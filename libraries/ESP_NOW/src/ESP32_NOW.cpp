@@ -3,11 +3,65 @@
 #include "esp_system.h"
 #include "esp32-hal.h"
 #include "esp_wifi.h"
+#include "esp_cpu.h"
+#include "freertos/ringbuf.h"
+
+// open addressing table of the indexes in _esp_now_peers (plus one, 0 being empty) hashed by MAC address
+#define ESP_NOW_PEER_HASH_BITS 6
+#define ESP_NOW_PEER_HASH_SIZE (1 << ESP_NOW_PEER_HASH_BITS)
+
+// received frame in the queue, followed by its data
+typedef struct {
+  uint8_t src_addr[ESP_NOW_ETH_ALEN];
+  uint8_t des_addr[ESP_NOW_ETH_ALEN];
+  wifi_pkt_rx_ctrl_t rx_ctrl;
+} esp_now_rx_frame_t;
 
 static void (*new_cb)(const esp_now_recv_info_t *info, const uint8_t *data, int len, void *arg) = NULL;
 static void *new_arg = NULL;  // * tx_arg = NULL, * rx_arg = NULL,
 static bool _esp_now_has_begun = false;
 static ESP_NOW_Peer *_esp_now_peers[ESP_NOW_MAX_TOTAL_PEER_NUM];
+static uint8_t _esp_now_peer_hash[ESP_NOW_PEER_HASH_SIZE];
+static portMUX_TYPE _esp_now_peers_mux = portMUX_INITIALIZER_UNLOCKED;
+static RingbufHandle_t _esp_now_rx_ring = NULL;
+static TaskHandle_t _esp_now_rx_task = NULL;
+static ESP_NOW_Class::rx_stats_t _esp_now_rx_stats;
+
+static inline uint32_t _esp_now_hash_mac(const uint8_t *mac_addr) {
+  // the last bytes of the addresses of the devices of a vendor differ the most
+  uint32_t h = ((uint32_t)mac_addr[2] << 24 | (uint32_t)mac_addr[3] << 16 | (uint32_t)mac_addr[4] << 8 | mac_addr[5]) ^ ((uint32_t)mac_addr[0] << 7 | mac_addr[1]);
+  return (h * 2654435761U) >> (32 - ESP_NOW_PEER_HASH_BITS);
+}
+
+// rebuild the table after a change of _esp_now_peers, with _esp_now_peers_mux taken
+static void _esp_now_hash_peers() {
+  memset(_esp_now_peer_hash, 0, sizeof(_esp_now_peer_hash));
+  for (uint8_t i = 0; i < ESP_NOW_MAX_TOTAL_PEER_NUM; i++) {
+    if (_esp_now_peers[i] != NULL) {
+      uint32_t h = _esp_now_hash_mac(_esp_now_peers[i]->addr());
+      while (_esp_now_peer_hash[h]) {
+        h = (h + 1) & (ESP_NOW_PEER_HASH_SIZE - 1);
+      }
+      _esp_now_peer_hash[h] = i + 1;
+    }
+  }
+}
+
+static ESP_NOW_Peer *_esp_now_find_peer(const uint8_t *mac_addr) {
+  ESP_NOW_Peer *peer = NULL;
+  uint32_t h = _esp_now_hash_mac(mac_addr);
+  portENTER_CRITICAL(&_esp_now_peers_mux);
+  while (_esp_now_peer_hash[h]) {
+    ESP_NOW_Peer *p = _esp_now_peers[_esp_now_peer_hash[h] - 1];
+    if (memcmp(mac_addr, p->addr(), ESP_NOW_ETH_ALEN) == 0) {
+      peer = p;
+      break;
+    }
+    h = (h + 1) & (ESP_NOW_PEER_HASH_SIZE - 1);
+  }
+  portEXIT_CRITICAL(&_esp_now_peers_mux);
+  return peer;
+}
 
 static esp_err_t _esp_now_add_peer(const uint8_t *mac_addr, uint8_t channel, wifi_interface_t iface, const uint8_t *lmk, ESP_NOW_Peer *_peer = NULL) {
   log_v(MACSTR, MAC2STR(mac_addr));
@@ -31,7 +85,10 @@ static esp_err_t _esp_now_add_peer(const uint8_t *mac_addr, uint8_t channel, wif
     if (_peer != NULL) {
       for (uint8_t i = 0; i < ESP_NOW_MAX_TOTAL_PEER_NUM; i++) {
         if (_esp_now_peers[i] == NULL) {
+          portENTER_CRITICAL(&_esp_now_peers_mux);
           _esp_now_peers[i] = _peer;
+          _esp_now_hash_peers();
+          portEXIT_CRITICAL(&_esp_now_peers_mux);
           return ESP_OK;
         }
       }
@@ -63,7 +120,10 @@ static esp_err_t _esp_now_del_peer(const uint8_t *mac_addr) {
 
   for (uint8_t i = 0; i < ESP_NOW_MAX_TOTAL_PEER_NUM; i++) {
     if (_esp_now_peers[i] != NULL && memcmp(mac_addr, _esp_now_peers[i]->addr(), ESP_NOW_ETH_ALEN) == 0) {
+      portENTER_CRITICAL(&_esp_now_peers_mux);
       _esp_now_peers[i] = NULL;
+      _esp_now_hash_peers();
+      portEXIT_CRITICAL(&_esp_now_peers_mux);
       break;
     }
   }
@@ -102,24 +162,58 @@ static esp_err_t _esp_now_modify_peer(const uint8_t *mac_addr, uint8_t channel,
   return result;
 }
 
-static void _esp_now_rx_cb(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+static void _esp_now_dispatch(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
   bool broadcast = memcmp(info->des_addr, ESP_NOW.BROADCAST_ADDR, ESP_NOW_ETH_ALEN) == 0;
   log_v("%s from " MACSTR ", data length : %u", broadcast ? "Broadcast" : "Unicast", MAC2STR(info->src_addr), len);
-  log_buf_v(data, len);
-  if (!esp_now_is_peer_exist(info->src_addr) && new_cb != NULL) {
+  //find the peer and call it's callback
+  ESP_NOW_Peer *peer = _esp_now_find_peer(info->src_addr);
+  if (peer != NULL) {
+    peer->onReceive(data, len, broadcast);
+  } else if (new_cb != NULL && !esp_now_is_peer_exist(info->src_addr)) {
     log_v("Calling new_cb, peer not found.");
     new_cb(info, data, len, new_arg);
-    return;
   }
-  //find the peer and call it's callback
-  for (uint8_t i = 0; i < ESP_NOW_MAX_TOTAL_PEER_NUM; i++) {
-    if (_esp_now_peers[i] != NULL) {
-      log_v("Checking peer " MACSTR, MAC2STR(_esp_now_peers[i]->addr()));
+}
+
+static void _esp_now_rx_cb(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+  uint32_t start = esp_cpu_get_cycle_count();
+  if (_esp_now_rx_ring != NULL) {
+    esp_now_rx_frame_t *frame = NULL;
+    if (xRingbufferSendAcquire(_esp_now_rx_ring, (void **)&frame, sizeof(esp_now_rx_frame_t) + len, 0) == pdTRUE) {
+      memcpy(frame->src_addr, info->src_addr, ESP_NOW_ETH_ALEN);
+      memcpy(frame->des_addr, info->des_addr, ESP_NOW_ETH_ALEN);
+      if (info->rx_ctrl != NULL) {
+        memcpy(&frame->rx_ctrl, info->rx_ctrl, sizeof(wifi_pkt_rx_ctrl_t));
+      } else {
+        memset(&frame->rx_ctrl, 0, sizeof(wifi_pkt_rx_ctrl_t));
+      }
+      memcpy(frame + 1, data, len);
+      xRingbufferSendComplete(_esp_now_rx_ring, frame);
+    } else {
+      _esp_now_rx_stats.dropped++;
     }
-    if (_esp_now_peers[i] != NULL && memcmp(info->src_addr, _esp_now_peers[i]->addr(), ESP_NOW_ETH_ALEN) == 0) {
-      log_v("Calling onReceive");
-      _esp_now_peers[i]->onReceive(data, len, broadcast);
-      return;
+  } else {
+    _esp_now_dispatch(info, data, len);
+  }
+  _esp_now_rx_stats.frames++;
+  _esp_now_rx_stats.cycles += esp_cpu_get_cycle_count() - start;
+}
+
+static void _esp_now_rx_task(void *arg) {
+  RingbufHandle_t ring = (RingbufHandle_t)arg;
+  for (;;) {
+    size_t size = 0;
+    esp_now_rx_frame_t *frame = (esp_now_rx_frame_t *)xRingbufferReceive(ring, &size, portMAX_DELAY);
+    // the frames queued meanwhile are handled before waiting again
+    while (frame != NULL) {
+      esp_now_recv_info_t info;
+      memset(&info, 0, sizeof(info));
+      info.src_addr = frame->src_addr;
+      info.des_addr = frame->des_addr;
+      info.rx_ctrl = &frame->rx_ctrl;
+      _esp_now_dispatch(&info, (const uint8_t *)(frame + 1), size - sizeof(esp_now_rx_frame_t));
+      vRingbufferReturnItem(ring, frame);
+      frame = (esp_now_rx_frame_t *)xRingbufferReceive(ring, &size, 0);
     }
   }
 }
@@ -127,11 +221,9 @@ static void _esp_now_rx_cb(const esp_now_recv_info_t *info, const uint8_t *data,
 static void _esp_now_tx_cb(const uint8_t *mac_addr, esp_now_send_status_t status) {
   log_v(MACSTR " : %s", MAC2STR(mac_addr), (status == ESP_NOW_SEND_SUCCESS) ? "SUCCESS" : "FAILED");
   //find the peer and call it's callback
-  for (uint8_t i = 0; i < ESP_NOW_MAX_TOTAL_PEER_NUM; i++) {
-    if (_esp_now_peers[i] != NULL && memcmp(mac_addr, _esp_now_peers[i]->addr(), ESP_NOW_ETH_ALEN) == 0) {
-      _esp_now_peers[i]->onSent(status == ESP_NOW_SEND_SUCCESS);
-      return;
-    }
+  ESP_NOW_Peer *peer = _esp_now_find_peer(mac_addr);
+  if (peer != NULL) {
+    peer->onSent(status == ESP_NOW_SEND_SUCCESS);
   }
 }
 
@@ -153,6 +245,7 @@ bool ESP_NOW_Class::begin(const uint8_t *pmk) {
   _esp_now_has_begun = true;
 
   memset(_esp_now_peers, 0, sizeof(ESP_NOW_Peer *) * ESP_NOW_MAX_TOTAL_PEER_NUM);
+  memset(_esp_now_peer_hash, 0, sizeof(_esp_now_peer_hash));
 
   err = esp_now_init();
   if (err != ESP_OK) {
@@ -198,6 +291,7 @@ bool ESP_NOW_Class::end() {
   }
   _esp_now_has_begun = false;
   memset(_esp_now_peers, 0, sizeof(ESP_NOW_Peer *) * ESP_NOW_MAX_TOTAL_PEER_NUM);
+  memset(_esp_now_peer_hash, 0, sizeof(_esp_now_peer_hash));
   return true;
 }
 
@@ -262,6 +356,48 @@ void ESP_NOW_Class::onNewPeer(void (*cb)(const esp_now_recv_info_t *info, const
   new_arg = arg;
 }
 
+bool ESP_NOW_Class::setRxQueue(size_t frames, UBaseType_t priority, BaseType_t core) {
+  if (_esp_now_has_begun) {
+    log_e("The receive queue can not be changed while ESP-NOW is running");
+    return false;
+  }
+  if (_esp_now_rx_task != NULL) {
+    vTaskDelete(_esp_now_rx_task);
+    _esp_now_rx_task = NULL;
+  }
+  if (_esp_now_rx_ring != NULL) {
+    vRingbufferDelete(_esp_now_rx_ring);
+    _esp_now_rx_ring = NULL;
+  }
+  if (!frames) {
+    return true;
+  }
+
+  // each item of a no split ring buffer has a header of 8 bytes and is rounded up to 4 bytes
+  size_t item_size = 8 + ((sizeof(esp_now_rx_frame_t) + ESP_NOW_MAX_DATA_LEN + 3) & ~3);
+  RingbufHandle_t ring = xRingbufferCreate(frames * item_size, RINGBUF_TYPE_NOSPLIT);
+  if (ring == NULL) {
+    log_e("Failed to allocate a receive queue of %u frames", frames);
+    return false;
+  }
+  if (xTaskCreateUniversal(_esp_now_rx_task, "espnow_rx", 4096, ring, priority, &_esp_now_rx_task, core) != pdPASS) {
+    log_e("Failed to start the receive task");
+    vRingbufferDelete(ring);
+    _esp_now_rx_task = NULL;
+    return false;
+  }
+  _esp_now_rx_ring = ring;
+  return true;
+}
+
+ESP_NOW_Class::rx_stats_t ESP_NOW_Class::getRxStats(bool reset) {
+  rx_stats_t stats = _esp_now_rx_stats;
+  if (reset) {
+    memset(&_esp_now_rx_stats, 0, sizeof(_esp_now_rx_stats));
+  }
+  return stats;
+}
+
 ESP_NOW_Class ESP_NOW;
 
 /*
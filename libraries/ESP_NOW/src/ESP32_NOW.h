@@ -5,6 +5,8 @@
 #include "esp_now.h"
 #include "esp32-hal-log.h"
 #include "esp_mac.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 class ESP_NOW_Peer {
 private:
@@ -69,6 +71,19 @@ public:
   }
 
   void onNewPeer(void (*cb)(const esp_now_recv_info_t *info, const uint8_t *data, int len, void *arg), void *arg);
+
+  // Copy the received frames into a queue of <frames> frames, and call onReceive() and the new peer callback from
+  // a task with <priority> instead of the WiFi task, handling all the frames queued at each wake up.
+  // 0 <frames> calls them from the WiFi task, as done by default. The queue is changed before begin() or after end().
+  bool setRxQueue(size_t frames, UBaseType_t priority = 5, BaseType_t core = tskNO_AFFINITY);
+
+  typedef struct {
+    uint32_t frames;   // frames received
+    uint32_t dropped;  // frames lost, the receive queue being full
+    uint64_t cycles;   // CPU cycles spent in the WiFi task for the frames
+  } rx_stats_t;
+
+  rx_stats_t getRxStats(bool reset = false);
 };
 
 extern ESP_NOW_Class ESP_NOW;
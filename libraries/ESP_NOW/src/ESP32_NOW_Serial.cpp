@@ -2,23 +2,31 @@
 #include <string.h>
 #include "esp_now.h"
 #include "esp_system.h"
+#include "esp_random.h"
 #include "esp32-hal.h"
 #include "esp_mac.h"
 
+#define ESP_NOW_SERIAL_FLUSH_TIMEOUT 10000  // ms, longer than the retransmissions before the peer is lost
+
 /*
  *
  *    Serial Port Implementation Class
  *
+ *    The data is sent and received by an ESP_NOW_Window, called under window_mux from the
+ *    application, the callbacks and the retransmission timer. pump() gives the frames it builds
+ *    to ESP-NOW, one caller at a time so that onSent() reports them in the order of the window.
+ *
 */
 
 ESP_NOW_Serial_Class::ESP_NOW_Serial_Class(const uint8_t *mac_addr, uint8_t channel, wifi_interface_t iface, const uint8_t *lmk)
   : ESP_NOW_Peer(mac_addr, channel, iface, lmk) {
-  tx_ring_buf = NULL;
-  rx_queue = NULL;
+  portMUX_INITIALIZE(&window_mux);
+  timer = NULL;
   tx_sem = NULL;
-  queued_size = 0;
-  queued_buff = NULL;
-  resend_count = 0;
+  rx_size = 4096;
+  tx_size = 4096;
+  pumping = false;
+  peer_lost = false;
 }
 
 ESP_NOW_Serial_Class::~ESP_NOW_Serial_Class() {
@@ -26,247 +34,227 @@ ESP_NOW_Serial_Class::~ESP_NOW_Serial_Class() {
 }
 
 size_t ESP_NOW_Serial_Class::setTxBufferSize(size_t tx_queue_len) {
-  if (tx_ring_buf) {
-    vRingbufferDelete(tx_ring_buf);
-    tx_ring_buf = NULL;
-  }
-  if (!tx_queue_len) {
-    return 0;
-  }
-  tx_ring_buf = xRingbufferCreate(tx_queue_len, RINGBUF_TYPE_BYTEBUF);
-  if (!tx_ring_buf) {
+  if (window) {
+    log_e("TX buffer size can not be changed after begin()");
     return 0;
   }
+  tx_size = tx_queue_len;
   return tx_queue_len;
 }
 
 size_t ESP_NOW_Serial_Class::setRxBufferSize(size_t rx_queue_len) {
-  if (rx_queue) {
-    vQueueDelete(rx_queue);
-    rx_queue = NULL;
-  }
-  if (!rx_queue_len) {
-    return 0;
-  }
-  rx_queue = xQueueCreate(rx_queue_len, sizeof(uint8_t));
-  if (!rx_queue) {
+  if (window) {
+    log_e("RX buffer size can not be changed after begin()");
     return 0;
   }
+  rx_size = rx_queue_len;
   return rx_queue_len;
 }
 
 bool ESP_NOW_Serial_Class::begin(unsigned long baud) {
-  if (!ESP_NOW.begin() || !add()) {
+  if (window) {
+    return true;
+  }
+  // a new session makes the peer drop what is left of the previous one
+  peer_lost = false;
+  if (!window.begin(rx_size, tx_size, esp_random())) {
+    log_e("Failed to allocate the buffers");
     return false;
   }
   if (tx_sem == NULL) {
     tx_sem = xSemaphoreCreateBinary();
-    //xSemaphoreTake(tx_sem, 0);
-    xSemaphoreGive(tx_sem);
   }
-  setRxBufferSize(1024);  //default if not preset
-  setTxBufferSize(1024);  //default if not preset
+  if (timer == NULL) {
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = onTimer;
+    timer_args.arg = this;
+    timer_args.dispatch_method = ESP_TIMER_TASK;
+    timer_args.name = "espnow_serial";
+    if (esp_timer_create(&timer_args, &timer) != ESP_OK) {
+      timer = NULL;
+    }
+  }
+  if (tx_sem == NULL || timer == NULL || !ESP_NOW.begin() || !add()) {
+    end();
+    return false;
+  }
   return true;
 }
 
 void ESP_NOW_Serial_Class::end() {
   remove();
-  setRxBufferSize(0);
-  setTxBufferSize(0);
+  if (timer != NULL) {
+    esp_timer_stop(timer);
+    esp_timer_delete(timer);
+    timer = NULL;
+  }
+  // no callback comes anymore, and the buffers can not be freed in a critical section
+  window.end();
   if (tx_sem != NULL) {
     vSemaphoreDelete(tx_sem);
     tx_sem = NULL;
   }
 }
 
+void ESP_NOW_Serial_Class::pump() {
+  uint8_t frame[ESP_NOW_MAX_DATA_LEN];
+  portENTER_CRITICAL(&window_mux);
+  // the caller sending already builds the frames made possible by this one
+  if (pumping || !added) {
+    portEXIT_CRITICAL(&window_mux);
+    return;
+  }
+  pumping = true;
+  size_t len;
+  while ((len = window.next(frame, millis())) > 0) {
+    portEXIT_CRITICAL(&window_mux);
+    bool ok = send(frame, len) == len;
+    portENTER_CRITICAL(&window_mux);
+    if (!ok) {
+      window.unsent();
+      break;
+    }
+  }
+  uint32_t wait = window.timeout(millis());
+  bool lost = window.peerLost() && !peer_lost;
+  peer_lost = window.peerLost();
+  pumping = false;
+  portEXIT_CRITICAL(&window_mux);
+  if (lost) {
+    log_e("Peer " MACSTR " lost, the data not acknowledged was dropped", MAC2STR(addr()));
+    // wake up the writer waiting for space, which can not come
+    if (tx_sem != NULL) {
+      xSemaphoreGive(tx_sem);
+    }
+  }
+  if (wait != ESP_NOW_Window::NO_TIMEOUT && timer != NULL) {
+    esp_timer_stop(timer);
+    esp_timer_start_once(timer, (wait ? wait : 1) * 1000ULL);
+  }
+}
+
+void ESP_NOW_Serial_Class::onTimer(void *arg) {
+  ((ESP_NOW_Serial_Class *)arg)->pump();
+}
+
 //Stream
 int ESP_NOW_Serial_Class::available(void) {
-  if (rx_queue == NULL) {
-    return 0;
-  }
-  return uxQueueMessagesWaiting(rx_queue);
+  portENTER_CRITICAL(&window_mux);
+  int count = window.available();
+  portEXIT_CRITICAL(&window_mux);
+  return count;
 }
 
 int ESP_NOW_Serial_Class::peek(void) {
-  if (rx_queue == NULL) {
-    return -1;
-  }
-  uint8_t c;
-  if (xQueuePeek(rx_queue, &c, 0)) {
-    return c;
-  }
-  return -1;
+  portENTER_CRITICAL(&window_mux);
+  int c = window.peek();
+  portEXIT_CRITICAL(&window_mux);
+  return c;
 }
 
 int ESP_NOW_Serial_Class::read(void) {
-  if (rx_queue == NULL) {
-    return -1;
-  }
   uint8_t c = 0;
-  if (xQueueReceive(rx_queue, &c, 0)) {
+  if (read(&c, 1)) {
     return c;
   }
   return -1;
 }
 
 size_t ESP_NOW_Serial_Class::read(uint8_t *buffer, size_t size) {
-  if (rx_queue == NULL) {
-    return -1;
-  }
-  uint8_t c = 0;
-  size_t count = 0;
-  while (count < size && xQueueReceive(rx_queue, &c, 0)) {
-    buffer[count++] = c;
+  portENTER_CRITICAL(&window_mux);
+  size_t count = window.read(buffer, size);
+  bool ack = window.ackPending();
+  portEXIT_CRITICAL(&window_mux);
+  // tell the peer waiting for space that there is some again
+  if (ack) {
+    pump();
   }
   return count;
 }
 
 void ESP_NOW_Serial_Class::flush() {
-  if (tx_ring_buf == NULL) {
+  if (!window) {
     return;
   }
-  UBaseType_t uxItemsWaiting = 0;
-  vRingbufferGetInfo(tx_ring_buf, NULL, NULL, NULL, NULL, &uxItemsWaiting);
-  if (uxItemsWaiting) {
-    // Now trigger the ISR to read data from the ring buffer.
-    if (xSemaphoreTake(tx_sem, 0) == pdTRUE) {
-      checkForTxData();
+  pump();
+  // the data is acknowledged, or dropped once the peer is lost
+  uint32_t start = millis();
+  while (window.pending()) {
+    if (millis() - start >= ESP_NOW_SERIAL_FLUSH_TIMEOUT) {
+      log_w("Flush timeout, %u bytes not acknowledged", window.pending());
+      break;
     }
-  }
-  while (uxItemsWaiting) {
     delay(5);
-    vRingbufferGetInfo(tx_ring_buf, NULL, NULL, NULL, NULL, &uxItemsWaiting);
   }
 }
 
 //RX callback
 void ESP_NOW_Serial_Class::onReceive(const uint8_t *data, size_t len, bool broadcast) {
-  if (rx_queue == NULL) {
+  if (broadcast) {
     return;
   }
-  for (uint32_t i = 0; i < len; i++) {
-    if (!xQueueSend(rx_queue, data + i, 0)) {
-      log_e("RX Overflow!");
-      return;
-    }
-  }
-  // Now trigger the ISR to read data from the ring buffer.
-  if (xSemaphoreTake(tx_sem, 0) == pdTRUE) {
-    checkForTxData();
+  portENTER_CRITICAL(&window_mux);
+  uint8_t events = window.receive(data, len, millis());
+  portEXIT_CRITICAL(&window_mux);
+  if ((events & ESP_NOW_Window::TX_SPACE) && tx_sem != NULL) {
+    xSemaphoreGive(tx_sem);
   }
+  pump();
 }
 
 //Print
 int ESP_NOW_Serial_Class::availableForWrite() {
-  //return ESP_NOW_MAX_DATA_LEN;
-  if (tx_ring_buf == NULL) {
-    return 0;
-  }
-  return xRingbufferGetCurFreeSize(tx_ring_buf);
-}
-
-size_t ESP_NOW_Serial_Class::tryToSend() {
-  //log_d(MACSTR ": %u", MAC2STR(addr()), queued_size);
-  size_t sent = send(queued_buff, queued_size);
-  if (!sent) {
-    //_onSent will not be called anymore
-    //the data is lost in this case
-    vRingbufferReturnItem(tx_ring_buf, queued_buff);
-    queued_buff = NULL;
-    xSemaphoreGive(tx_sem);
-    end();
-  }
-  return sent;
-}
-
-bool ESP_NOW_Serial_Class::checkForTxData() {
-  //do we have something that failed the last time?
-  resend_count = 0;
-  if (queued_buff == NULL) {
-    queued_buff = (uint8_t *)xRingbufferReceiveUpTo(tx_ring_buf, &queued_size, 0, ESP_NOW_MAX_DATA_LEN);
-  } else {
-    log_d(MACSTR " : PREVIOUS", MAC2STR(addr()));
-  }
-  if (queued_buff != NULL) {
-    return tryToSend() > 0;
-  }
-  //log_d(MACSTR ": EMPTY", MAC2STR(addr()));
-  xSemaphoreGive(tx_sem);
-  return false;
+  portENTER_CRITICAL(&window_mux);
+  int space = window.availableForWrite();
+  portEXIT_CRITICAL(&window_mux);
+  return space;
 }
 
 size_t ESP_NOW_Serial_Class::write(const uint8_t *buffer, size_t size, uint32_t timeout) {
   log_v(MACSTR ", size %u", MAC2STR(addr()), size);
-  if (tx_sem == NULL || tx_ring_buf == NULL || !added) {
+  if (tx_sem == NULL || !window || !added) {
     return 0;
   }
-  size_t space = availableForWrite();
-  size_t left = size;
-
-  if (space) {
-    if (left < space) {
-      space = left;
+  size_t written = 0;
+  uint32_t start = millis();
+  for (;;) {
+    portENTER_CRITICAL(&window_mux);
+    size_t len = window.write(buffer + written, size - written);
+    bool lost = window.peerLost();
+    portEXIT_CRITICAL(&window_mux);
+    if (lost) {
+      log_e("Peer " MACSTR " lost, %u bytes not written", MAC2STR(addr()), size - written);
+      break;
     }
-    if (xRingbufferSend(tx_ring_buf, (void *)(buffer), space, 0) == pdTRUE) {
-      buffer += space;
-      left -= space;
-      if (xSemaphoreTake(tx_sem, 0) == pdTRUE) {
-        if (checkForTxData()) {
-          if (!left) {
-            //we are done
-            return size;
-          }
-        } else {
-          //send failed
-          return 0;
-        }
-      }
-    } else {
-      log_e("RingbufferFastSend Failed");
-      return 0;
+    if (len) {
+      written += len;
+      pump();
+    }
+    if (written == size) {
+      break;
+    }
+    // wait for the peer to acknowledge data and free space
+    uint32_t elapsed = millis() - start;
+    if (elapsed >= timeout || xSemaphoreTake(tx_sem, pdMS_TO_TICKS(timeout - elapsed)) != pdTRUE) {
+      log_e("TX buffer full, %u bytes not written", size - written);
+      break;
     }
-  } else if (xSemaphoreTake(tx_sem, timeout) == pdTRUE) {
-    checkForTxData();
-  }
-  // Blocking method, Sending data to ringbuffer, and handle the data in ISR.
-  if (xRingbufferSend(tx_ring_buf, (void *)(buffer), left, timeout / portTICK_PERIOD_MS) != pdTRUE) {
-    log_e("RingbufferSend Failed");
-    return size - left;
-  }
-  // Now trigger the ISR to read data from the ring buffer.
-  if (xSemaphoreTake(tx_sem, 0) == pdTRUE) {
-    checkForTxData();
   }
+  return written;
+}
 
-  return size;
+ESP_NOW_Window::stats_t ESP_NOW_Serial_Class::getStats(bool reset) {
+  portENTER_CRITICAL(&window_mux);
+  ESP_NOW_Window::stats_t stats = window.stats(reset);
+  portEXIT_CRITICAL(&window_mux);
+  return stats;
 }
+
 //TX Done Callback
 void ESP_NOW_Serial_Class::onSent(bool success) {
   log_v(MACSTR " : %s", MAC2STR(addr()), success ? "OK" : "FAIL");
-  if (tx_sem == NULL || tx_ring_buf == NULL || !added) {
-    return;
-  }
-  if (success) {
-    vRingbufferReturnItem(tx_ring_buf, queued_buff);
-    queued_buff = NULL;
-    //send next packet?
-    //log_d(MACSTR ": NEXT", MAC2STR(addr()));
-    checkForTxData();
-  } else {
-    //send failed
-    //resend
-    if (resend_count < 5) {
-      resend_count++;
-      //log_d(MACSTR ": RE-SENDING[%u]", MAC2STR(addr()), resend_count);
-      tryToSend();
-    } else {
-      //resend limit reached
-      //the data is lost in this case
-      vRingbufferReturnItem(tx_ring_buf, queued_buff);
-      queued_buff = NULL;
-      xSemaphoreGive(tx_sem);
-      end();
-      log_e(MACSTR " : RE-SEND_MAX[%u]", MAC2STR(addr()), resend_count);
-    }
-  }
+  portENTER_CRITICAL(&window_mux);
+  window.sent(success);
+  portEXIT_CRITICAL(&window_mux);
+  pump();
 }
@@ -1,29 +1,32 @@
 #pragma once
 
 #include "esp_wifi_types.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h"
 #include "freertos/semphr.h"
-#include "freertos/ringbuf.h"
 #include "Stream.h"
 #include "ESP32_NOW.h"
+#include "ESP32_NOW_Window.h"
 
 class ESP_NOW_Serial_Class : public Stream, public ESP_NOW_Peer {
 private:
-  RingbufHandle_t tx_ring_buf;
-  QueueHandle_t rx_queue;
-  SemaphoreHandle_t tx_sem;
-  size_t queued_size;
-  uint8_t *queued_buff;
-  size_t resend_count;
+  ESP_NOW_Window window;
+  portMUX_TYPE window_mux;
+  esp_timer_handle_t timer;
+  SemaphoreHandle_t tx_sem;  // given when acknowledged data frees space in the TX buffer
+  size_t rx_size;
+  size_t tx_size;
+  bool pumping;
+  bool peer_lost;  // reported by the last pump()
 
-  bool checkForTxData();
-  size_t tryToSend();
+  void pump();
+  static void onTimer(void *arg);
 
 public:
   ESP_NOW_Serial_Class(const uint8_t *mac_addr, uint8_t channel, wifi_interface_t iface = WIFI_IF_AP, const uint8_t *lmk = NULL);
   ~ESP_NOW_Serial_Class();
+  // the sizes are rounded up to powers of 2 and are changed before begin() or after end()
   size_t setRxBufferSize(size_t);
   size_t setTxBufferSize(size_t);
   bool begin(unsigned long baud = 0);
@@ -43,6 +46,8 @@ public:
   size_t write(uint8_t data) {
     return write(&data, 1);
   }
+  // frames sent and received, retransmissions and acks
+  ESP_NOW_Window::stats_t getStats(bool reset = false);
   //ESP_NOW_Peer
   void onReceive(const uint8_t *data, size_t len, bool broadcast);
   void onSent(bool success);
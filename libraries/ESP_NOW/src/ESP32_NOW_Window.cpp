@@ -0,0 +1,465 @@
+#include "ESP32_NOW_Window.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAME_DATA 0xD5
+#define FRAME_ACK  0xA5
+
+#define ACK_EVERY      2     // in order frames acknowledged together
+#define ACK_DELAY      2     // ms before acknowledging fewer frames
+#define INITIAL_LIMIT  1024  // bytes sent before the first ack tells the free space of the peer
+#define INITIAL_RTO    50
+#define MIN_RTO        10
+#define MAX_RTO        1000
+#define MAX_BACKOFF    6
+
+// segment_t flags
+#define SEG_ACKED 0x01
+#define SEG_LOST  0x02  // to send again without waiting for its timeout
+#define SEG_RADIO 0x04  // given to the radio, not reported by sent() yet
+
+static void put16(uint8_t *p, uint16_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+  put16(p, v);
+  put16(p + 2, v >> 16);
+}
+
+static uint16_t get16(const uint8_t *p) {
+  return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p) {
+  return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static size_t round_pow2(size_t size) {
+  size_t pow2 = 1;
+  while (pow2 < size) {
+    pow2 <<= 1;
+  }
+  return pow2;
+}
+
+// copy between a linear buffer and a ring, wrapping at its end
+static void ring_put(uint8_t *ring, uint32_t mask, uint32_t pos, const uint8_t *data, size_t len) {
+  size_t index = pos & mask;
+  size_t first = mask + 1 - index;
+  if (first > len) {
+    first = len;
+  }
+  memcpy(ring + index, data, first);
+  memcpy(ring, data + first, len - first);
+}
+
+static void ring_get(const uint8_t *ring, uint32_t mask, uint32_t pos, uint8_t *data, size_t len) {
+  size_t index = pos & mask;
+  size_t first = mask + 1 - index;
+  if (first > len) {
+    first = len;
+  }
+  memcpy(data, ring + index, first);
+  memcpy(data + first, ring, len - first);
+}
+
+ESP_NOW_Window::ESP_NOW_Window() : rx_buf(NULL), tx_buf(NULL) {
+  end();
+}
+
+ESP_NOW_Window::~ESP_NOW_Window() {
+  end();
+}
+
+bool ESP_NOW_Window::begin(size_t rx_size, size_t tx_size, uint16_t session) {
+  end();
+  if (!rx_size || !tx_size) {
+    return false;
+  }
+  rx_size = round_pow2(rx_size);
+  tx_size = round_pow2(tx_size);
+  rx_buf = (uint8_t *)malloc(rx_size);
+  tx_buf = (uint8_t *)malloc(tx_size);
+  if (!rx_buf || !tx_buf) {
+    end();
+    return false;
+  }
+  rx_mask = rx_size - 1;
+  tx_mask = tx_size - 1;
+  tx_session = session;
+  return true;
+}
+
+void ESP_NOW_Window::end() {
+  free(rx_buf);
+  free(tx_buf);
+  rx_buf = NULL;
+  tx_buf = NULL;
+  rx_mask = tx_mask = 0;
+  rx_rd = rx_wr = rx_origin = rx_advertised = rx_bitmap = 0;
+  rx_expected = rx_session = 0;
+  rx_synced = false;
+  ack_due = ack_now = false;
+  ack_count = 0;
+  ack_deadline = 0;
+  tx_acked = tx_sent = tx_end = 0;
+  tx_limit = INITIAL_LIMIT;
+  tx_base = tx_next = tx_session = tx_stamp = 0;
+  tx_unanswered = 0;
+  tx_lost = false;
+  srtt = 0;
+  fifo_head = fifo_count = 0;
+  memset(&counters, 0, sizeof(counters));
+}
+
+size_t ESP_NOW_Window::write(const uint8_t *data, size_t len) {
+  size_t space = availableForWrite();
+  if (len > space) {
+    len = space;
+  }
+  if (len) {
+    ring_put(tx_buf, tx_mask, tx_end, data, len);
+    tx_end += len;
+  }
+  return len;
+}
+
+size_t ESP_NOW_Window::read(uint8_t *data, size_t len) {
+  if (len > available()) {
+    len = available();
+  }
+  if (!len) {
+    return 0;
+  }
+  ring_get(rx_buf, rx_mask, rx_rd, data, len);
+  rx_rd += len;
+  // the peer may be waiting for the space, tell it once a quarter of the buffer is free again
+  if (rx_synced && rx_rd + rx_mask + 1 - rx_origin - rx_advertised >= (rx_mask + 1) / 4) {
+    ack_due = ack_now = true;
+  }
+  return len;
+}
+
+int ESP_NOW_Window::peek() const {
+  if (!available()) {
+    return -1;
+  }
+  return rx_buf[rx_rd & rx_mask];
+}
+
+uint32_t ESP_NOW_Window::rto(uint8_t timeouts) const {
+  uint32_t ms = srtt ? (srtt >> 2) + MIN_RTO : INITIAL_RTO;  // twice the round trip time, plus a margin
+  ms <<= timeouts < MAX_BACKOFF ? timeouts : MAX_BACKOFF;
+  return ms < MAX_RTO ? ms : MAX_RTO;
+}
+
+void ESP_NOW_Window::losePeer() {
+  counters.peer_lost++;
+  counters.tx_dropped += tx_end - tx_acked;
+  tx_lost = true;
+  tx_unanswered = 0;
+  // the peer receives the data written next from the first frame of a new session, after the gap
+  tx_session++;
+  tx_acked = tx_sent = tx_end = 0;
+  tx_base = tx_next = 0;
+  tx_limit = INITIAL_LIMIT;
+}
+
+size_t ESP_NOW_Window::buildAck(uint8_t *frame) {
+  rx_advertised = rx_rd + rx_mask + 1 - rx_origin;
+  frame[0] = FRAME_ACK;
+  put16(frame + 1, rx_session);
+  put16(frame + 3, rx_expected);
+  put32(frame + 5, rx_bitmap >> 1);  // bit 0 is rx_expected, not received
+  put32(frame + 9, rx_advertised);
+  ack_due = ack_now = false;
+  ack_count = 0;
+  counters.acks_sent++;
+  fifo[(fifo_head + fifo_count++) % MAX_IN_FLIGHT] = -1;
+  return ACK_FRAME_LEN;
+}
+
+size_t ESP_NOW_Window::buildData(uint16_t seq, uint8_t *frame, uint32_t now) {
+  segment_t &seg = tx_segs[seq % WINDOW];
+  seg.sent_at = now;
+  seg.stamp = tx_stamp++;
+  seg.flags = (seg.flags & ~SEG_LOST) | SEG_RADIO;
+  frame[0] = FRAME_DATA;
+  put16(frame + 1, tx_session);
+  put16(frame + 3, seq);
+  put32(frame + 5, seg.offset);
+  ring_get(tx_buf, tx_mask, seg.offset, frame + DATA_HEADER_LEN, seg.len);
+  counters.frames_sent++;
+  fifo[(fifo_head + fifo_count++) % MAX_IN_FLIGHT] = seq;
+  return DATA_HEADER_LEN + seg.len;
+}
+
+size_t ESP_NOW_Window::next(uint8_t *frame, uint32_t now) {
+  if (!tx_buf || fifo_count >= MAX_IN_FLIGHT) {
+    return 0;
+  }
+  if (ack_due && (ack_now || (int32_t)(now - ack_deadline) >= 0)) {
+    return buildAck(frame);
+  }
+
+  // frames to send again, the oldest first
+  for (uint16_t seq = tx_base; seq != tx_next; seq++) {
+    segment_t &seg = tx_segs[seq % WINDOW];
+    if (seg.flags & (SEG_ACKED | SEG_RADIO)) {
+      continue;
+    }
+    if (!(seg.flags & SEG_LOST)) {
+      if (now - seg.sent_at < rto(seg.timeouts)) {
+        continue;
+      }
+      seg.timeouts += seg.timeouts < MAX_BACKOFF;
+    }
+    if (tx_unanswered >= MAX_RETRIES) {
+      losePeer();
+      return 0;
+    }
+    tx_unanswered++;
+    seg.retries += seg.retries < UINT8_MAX;
+    counters.retransmits++;
+    return buildData(seq, frame, now);
+  }
+
+  // new data, up to the free space of the peer
+  uint32_t len = tx_end - tx_sent;
+  if (!len || (uint16_t)(tx_next - tx_base) >= WINDOW) {
+    return 0;
+  }
+  if (len > MAX_PAYLOAD) {
+    len = MAX_PAYLOAD;
+  }
+  int32_t space = (int32_t)(tx_limit - tx_sent);
+  if (space <= 0) {
+    // probe the peer with a frame it may drop, its ack telling when there is space again
+    if (tx_next != tx_base) {
+      return 0;
+    }
+  } else if ((uint32_t)space < len) {
+    len = space;
+  }
+  segment_t &seg = tx_segs[tx_next % WINDOW];
+  seg.offset = tx_sent;
+  seg.len = len;
+  seg.retries = 0;
+  seg.timeouts = 0;
+  seg.flags = 0;
+  tx_sent += len;
+  return buildData(tx_next++, frame, now);
+}
+
+void ESP_NOW_Window::sent(bool success) {
+  if (!fifo_count) {
+    return;
+  }
+  int32_t entry = fifo[fifo_head];
+  fifo_head = (fifo_head + 1) % MAX_IN_FLIGHT;
+  fifo_count--;
+  if (entry < 0) {
+    if (!success) {
+      ack_due = ack_now = true;
+    }
+  } else if (inWindow(entry)) {
+    segment_t &seg = tx_segs[entry % WINDOW];
+    seg.flags &= ~SEG_RADIO;
+    if (!success && !(seg.flags & SEG_ACKED)) {
+      seg.flags |= SEG_LOST;
+    }
+  }
+}
+
+void ESP_NOW_Window::unsent() {
+  if (!fifo_count) {
+    return;
+  }
+  fifo_count--;
+  int32_t entry = fifo[(fifo_head + fifo_count) % MAX_IN_FLIGHT];
+  if (entry < 0) {
+    ack_due = ack_now = true;
+    counters.acks_sent--;
+  } else if (inWindow(entry)) {
+    segment_t &seg = tx_segs[entry % WINDOW];
+    seg.flags = (seg.flags & ~SEG_RADIO) | SEG_LOST;
+    counters.frames_sent--;
+  }
+}
+
+uint32_t ESP_NOW_Window::timeout(uint32_t now) const {
+  if (!tx_buf || fifo_count >= MAX_IN_FLIGHT) {
+    return NO_TIMEOUT;
+  }
+  uint32_t ms = NO_TIMEOUT;
+  if (ack_due) {
+    ms = ack_now || (int32_t)(now - ack_deadline) >= 0 ? 0 : ack_deadline - now;
+  }
+  for (uint16_t seq = tx_base; seq != tx_next && ms; seq++) {
+    const segment_t &seg = tx_segs[seq % WINDOW];
+    if (seg.flags & (SEG_ACKED | SEG_RADIO)) {
+      continue;
+    }
+    uint32_t elapsed = now - seg.sent_at;
+    uint32_t left = (seg.flags & SEG_LOST) || elapsed >= rto(seg.timeouts) ? 0 : rto(seg.timeouts) - elapsed;
+    if (left < ms) {
+      ms = left;
+    }
+  }
+  if (tx_end != tx_sent && (uint16_t)(tx_next - tx_base) < WINDOW && ((int32_t)(tx_limit - tx_sent) > 0 || tx_next == tx_base)) {
+    ms = 0;
+  }
+  return ms;
+}
+
+uint8_t ESP_NOW_Window::receive(const uint8_t *frame, size_t len, uint32_t now) {
+  if (!rx_buf || !len) {
+    return 0;
+  }
+  if (frame[0] == FRAME_DATA && len > DATA_HEADER_LEN) {
+    tx_lost = false;
+    return receiveData(frame, len, now);
+  }
+  if (frame[0] == FRAME_ACK && len == ACK_FRAME_LEN) {
+    tx_lost = false;
+    return receiveAck(frame, now);
+  }
+  counters.dropped++;
+  return 0;
+}
+
+uint8_t ESP_NOW_Window::receiveData(const uint8_t *frame, size_t len, uint32_t now) {
+  uint16_t session = get16(frame + 1);
+  uint16_t seq = get16(frame + 3);
+  uint32_t offset = get32(frame + 5);
+  len -= DATA_HEADER_LEN;
+  counters.frames_received++;
+
+  if (!rx_synced || session != rx_session) {
+    if (seq < WINDOW) {
+      // a new stream, received from its first frame even when the frames before this one were lost
+      rx_expected = 0;
+      rx_origin = rx_wr;
+    } else if (!rx_synced) {
+      // nothing received since begin(), follow the stream from this frame
+      rx_expected = seq;
+      rx_origin = rx_wr - offset;
+    } else {
+      counters.dropped++;
+      return 0;
+    }
+    rx_synced = true;
+    rx_session = session;
+    rx_bitmap = 0;
+    rx_advertised = rx_rd + rx_mask + 1 - rx_origin;
+  }
+
+  if (!ack_due) {
+    ack_due = true;
+    ack_deadline = now + ACK_DELAY;
+  }
+  uint16_t distance = seq - rx_expected;
+  uint32_t pos = rx_origin + offset;
+  if (distance >= 0x8000 || (distance < WINDOW && (rx_bitmap & (1UL << distance)))) {
+    // the ack was lost, send it again
+    counters.duplicates++;
+    ack_now = true;
+    return 0;
+  }
+  if (distance >= WINDOW || (int32_t)(pos - rx_wr) < 0 || pos + len - rx_rd > rx_mask + 1) {
+    counters.dropped++;
+    ack_now = true;
+    return 0;
+  }
+
+  ring_put(rx_buf, rx_mask, pos, frame + DATA_HEADER_LEN, len);
+  rx_bitmap |= 1UL << distance;
+  rx_lens[seq % WINDOW] = len;
+  if (distance) {
+    // tell the sender about the missing frames now
+    ack_now = true;
+  }
+  uint32_t wr = rx_wr;
+  while (rx_bitmap & 1) {
+    rx_wr += rx_lens[rx_expected++ % WINDOW];
+    rx_bitmap >>= 1;
+  }
+  if (rx_wr == wr) {
+    return 0;
+  }
+  if (++ack_count >= ACK_EVERY) {
+    ack_now = true;
+  }
+  return RX_DATA;
+}
+
+uint8_t ESP_NOW_Window::receiveAck(const uint8_t *frame, uint32_t now) {
+  uint16_t session = get16(frame + 1);
+  uint16_t ack = get16(frame + 3);
+  uint32_t bitmap = get32(frame + 5);
+  uint32_t limit = get32(frame + 9);
+  // acks of a previous stream, or of frames not sent yet
+  if (session != tx_session || (uint16_t)(ack - tx_base) > (uint16_t)(tx_next - tx_base)) {
+    counters.dropped++;
+    return 0;
+  }
+
+  tx_unanswered = 0;
+  uint32_t old_limit = tx_limit;
+  if ((int32_t)(limit - tx_limit) > 0) {
+    tx_limit = limit;
+  }
+
+  uint16_t last = ack;  // after the last frame received
+  for (uint16_t seq = tx_base; seq != tx_next; seq++) {
+    segment_t &seg = tx_segs[seq % WINDOW];
+    uint16_t distance = seq - ack;
+    bool received = distance >= 0x8000 || (distance && distance <= 32 && (bitmap & (1UL << (distance - 1))));
+    if (!received) {
+      // sent beyond the free space of the peer, which dropped it
+      if (tx_limit != old_limit && (int32_t)(seg.offset - old_limit) >= 0 && !(seg.flags & SEG_RADIO)) {
+        seg.flags |= SEG_LOST;
+      }
+      continue;
+    }
+    if (distance < 0x8000) {
+      last = seq + 1;
+    }
+    if (!(seg.flags & SEG_ACKED)) {
+      seg.flags |= SEG_ACKED;
+      // only the frames sent once give the round trip time
+      if (!seg.retries) {
+        uint32_t rtt = now - seg.sent_at;
+        srtt = srtt ? srtt + rtt - (srtt >> 3) : rtt << 3;
+      }
+    }
+  }
+
+  // the radio keeps the order of the frames, the ones sent before the last received are lost
+  if (last != ack) {
+    uint16_t stamp = tx_segs[(uint16_t)(last - 1) % WINDOW].stamp;
+    for (uint16_t seq = ack; seq != last; seq++) {
+      segment_t &seg = tx_segs[seq % WINDOW];
+      if (!(seg.flags & (SEG_ACKED | SEG_RADIO)) && (int16_t)(seg.stamp - stamp) < 0) {
+        seg.flags |= SEG_LOST;
+      }
+    }
+  }
+
+  uint32_t acked = tx_acked;
+  while (tx_base != tx_next && (tx_segs[tx_base % WINDOW].flags & SEG_ACKED)) {
+    tx_base++;
+  }
+  tx_acked = tx_base != tx_next ? tx_segs[tx_base % WINDOW].offset : tx_sent;
+  return tx_acked != acked ? TX_SPACE : 0;
+}
+
+ESP_NOW_Window::stats_t ESP_NOW_Window::stats(bool reset) {
+  stats_t copy = counters;
+  if (reset) {
+    memset(&counters, 0, sizeof(counters));
+  }
+  return copy;
+}
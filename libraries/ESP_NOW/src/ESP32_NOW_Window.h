@@ -0,0 +1,154 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Sliding window transport of a byte stream over ESP-NOW frames, used by ESP_NOW_Serial_Class.
+ *
+ * Up to WINDOW data frames are sent without waiting for their acknowledgment. Each one carries a
+ * sequence number and the offset of its data in the stream. The receiver writes the data at its
+ * place in the RX buffer, even out of order, and acknowledges the next frame it expects along with
+ * a bitmap of the frames received after it and the end of the free space of its RX buffer. The sender
+ * keeps the data in the TX buffer until it is acknowledged, and only sends again the frames missing
+ * in the bitmap, the frames the radio failed to send and the frames not acknowledged in time.
+ *
+ * Nothing here depends on the radio or on FreeRTOS, so that the protocol can be simulated: the caller
+ * serializes the calls, sends the frames built by next(), reports their results with sent(), in the
+ * order they were sent, and calls next() again when the time returned by timeout() has passed.
+ * Times are in milliseconds.
+ */
+class ESP_NOW_Window {
+public:
+  static const size_t MAX_FRAME_LEN = 250;  // ESP_NOW_MAX_DATA_LEN
+  static const size_t DATA_HEADER_LEN = 9;
+  static const size_t ACK_FRAME_LEN = 13;
+  static const size_t MAX_PAYLOAD = MAX_FRAME_LEN - DATA_HEADER_LEN;
+  static const uint16_t WINDOW = 32;       // data frames sent and not acknowledged, up to the bits of the ack bitmap
+  static const uint8_t MAX_IN_FLIGHT = 4;  // frames given to the radio and not reported by sent()
+  static const uint8_t MAX_RETRIES = 10;   // frames sent again without any ack of the peer before it is taken as lost
+  static const uint32_t NO_TIMEOUT = UINT32_MAX;
+
+  // events returned by receive()
+  static const uint8_t RX_DATA = 1;   // new data can be read
+  static const uint8_t TX_SPACE = 2;  // acknowledged data was removed from the TX buffer
+
+  typedef struct {
+    uint32_t frames_sent;
+    uint32_t retransmits;
+    uint32_t acks_sent;
+    uint32_t frames_received;
+    uint32_t duplicates;
+    uint32_t dropped;     // out of the window or of the RX buffer
+    uint32_t peer_lost;   // times the peer stopped acknowledging
+    uint32_t tx_dropped;  // bytes written and not acknowledged when the peer was lost
+  } stats_t;
+
+  ESP_NOW_Window();
+  ~ESP_NOW_Window();
+
+  // The buffer sizes are rounded up to powers of 2. <session> identifies the stream sent from now on,
+  // a new value making the peer drop what it was receiving of the previous one.
+  bool begin(size_t rx_size, size_t tx_size, uint16_t session);
+  void end();
+  operator bool() const {
+    return rx_buf != NULL;
+  }
+
+  // application side
+  size_t write(const uint8_t *data, size_t len);
+  size_t read(uint8_t *data, size_t len);
+  int peek() const;
+  size_t available() const {
+    return rx_wr - rx_rd;
+  }
+  size_t availableForWrite() const {
+    return tx_buf && !tx_lost ? tx_mask + 1 - (tx_end - tx_acked) : 0;
+  }
+  // written bytes not acknowledged yet
+  size_t pending() const {
+    return tx_end - tx_acked;
+  }
+  // The peer did not acknowledge MAX_RETRIES frames sent again: the data not acknowledged was dropped and
+  // nothing can be written until a frame of the peer is received, the next data starting a new session.
+  bool peerLost() const {
+    return tx_lost;
+  }
+  // an ack has to be sent without delay, as after reading enough to reopen the window of the peer
+  bool ackPending() const {
+    return ack_now;
+  }
+
+  // radio side
+  uint8_t receive(const uint8_t *frame, size_t len, uint32_t now);
+  size_t next(uint8_t *frame, uint32_t now);
+  void sent(bool success);
+  // the last frame built by next() could not be given to the radio
+  void unsent();
+  // milliseconds until next() has something to send, NO_TIMEOUT if it waits for sent() or receive()
+  uint32_t timeout(uint32_t now) const;
+
+  stats_t stats(bool reset = false);
+
+private:
+  typedef struct {
+    uint32_t offset;
+    uint32_t sent_at;
+    uint16_t stamp;  // order of the last transmission
+    uint8_t len;
+    uint8_t retries;
+    uint8_t timeouts;  // retries after a timeout, each one doubling the next timeout
+    uint8_t flags;
+  } segment_t;
+
+  // RX: positions of the local stream, the received data being at its offset plus rx_origin
+  uint8_t *rx_buf;
+  uint32_t rx_mask;
+  uint32_t rx_rd;          // read by the application
+  uint32_t rx_wr;          // received in order
+  uint32_t rx_origin;      // offset 0 of the stream of the peer
+  uint32_t rx_advertised;  // end of the free space in the last ack, as an offset of the stream of the peer
+  uint32_t rx_bitmap;      // bit n: frame rx_expected + n received
+  uint16_t rx_expected;
+  uint16_t rx_session;
+  bool rx_synced;
+  uint8_t rx_lens[WINDOW];
+
+  bool ack_due;
+  bool ack_now;
+  uint8_t ack_count;
+  uint32_t ack_deadline;
+
+  // TX: offsets of the stream sent to the peer
+  uint8_t *tx_buf;
+  uint32_t tx_mask;
+  uint32_t tx_acked;  // all the data before is acknowledged
+  uint32_t tx_sent;   // all the data before is in frames
+  uint32_t tx_end;    // written by the application
+  uint32_t tx_limit;  // end of the free space of the peer
+  uint16_t tx_base;   // oldest frame not acknowledged
+  uint16_t tx_next;
+  uint16_t tx_session;
+  uint16_t tx_stamp;
+  uint8_t tx_unanswered;  // frames sent again since the last ack
+  bool tx_lost;
+  uint32_t srtt;  // smoothed round trip time, times 8
+  segment_t tx_segs[WINDOW];
+
+  // frames given to the radio: sequence numbers or -1 for acks
+  int32_t fifo[MAX_IN_FLIGHT];
+  uint8_t fifo_head;
+  uint8_t fifo_count;
+
+  stats_t counters;
+
+  uint32_t rto(uint8_t timeouts) const;
+  void losePeer();
+  size_t buildAck(uint8_t *frame);
+  size_t buildData(uint16_t seq, uint8_t *frame, uint32_t now);
+  uint8_t receiveData(const uint8_t *frame, size_t len, uint32_t now);
+  uint8_t receiveAck(const uint8_t *frame, uint32_t now);
+  bool inWindow(uint16_t seq) const {
+    return (uint16_t)(seq - tx_base) < (uint16_t)(tx_next - tx_base);
+  }
+};
@@ -25,6 +25,10 @@ void ESP_SR_Class::onEvent(sr_cb event_cb) {
   cb = event_cb;
 }
 
+bool ESP_SR_Class::setConfig(const sr_config_t &config) {
+  return sr_set_config(&config) == ESP_OK;
+}
+
 bool ESP_SR_Class::begin(I2SClass &_i2s, const sr_cmd_t *sr_commands, size_t sr_commands_len, sr_channels_t rx_chan, sr_mode_t mode) {
   i2s = &_i2s;
   esp_err_t err = sr_start(on_sr_fill, this, rx_chan, mode, sr_commands, sr_commands_len, on_sr_event, this);
@@ -47,6 +51,10 @@ bool ESP_SR_Class::resume(void) {
   return sr_resume() == ESP_OK;
 }
 
+bool ESP_SR_Class::getStats(sr_stats_t &stats, bool reset) {
+  return sr_get_stats(&stats, reset) == ESP_OK;
+}
+
 void ESP_SR_Class::_sr_event(sr_event_t event, int command_id, int phrase_id) {
   if (cb) {
     cb(event, command_id, phrase_id);
@@ -23,11 +23,15 @@ public:
   ~ESP_SR_Class();
 
   void onEvent(sr_cb cb);
+  // task affinity, priorities and gain, set before begin()
+  bool setConfig(const sr_config_t &config);
   bool begin(I2SClass &i2s, const sr_cmd_t *sr_commands, size_t sr_commands_len, sr_channels_t rx_chan = SR_CHANNELS_STEREO, sr_mode_t mode = SR_MODE_WAKEWORD);
   bool end(void);
   bool setMode(sr_mode_t mode);
   bool pause(void);
   bool resume(void);
+  // time spent in each stage of the audio pipeline, and the chunks missed
+  bool getStats(sr_stats_t &stats, bool reset = false);
 
   void _sr_event(sr_event_t event, int command_id, int phrase_id);
   esp_err_t _fill(void *out, size_t len, size_t *bytes_read, uint32_t timeout_ms);
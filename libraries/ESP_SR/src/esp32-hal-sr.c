@@ -21,6 +21,7 @@
 #include "freertos/event_groups.h"
 #include "freertos/task.h"
 #include "esp_task_wdt.h"
+#include "esp_timer.h"
 #include "esp_check.h"
 #include "esp_err.h"
 #include "esp_log.h"
@@ -65,6 +66,10 @@
 #define RESUME_FEED    BIT5
 #define RESUME_DETECT  BIT6
 
+#define SR_SAMPLE_RATE 16000
+#define SR_GAIN_SHIFT  12
+#define SR_GAIN_UNITY  (1 << SR_GAIN_SHIFT)
+
 typedef struct {
   wakenet_state_t wakenet_mode;
   esp_mn_state_t state;
@@ -84,6 +89,9 @@ typedef struct {
   void *user_cb_arg;
   sr_fill_cb fill_cb;
   void *fill_cb_arg;
+  int32_t gain;
+  sr_stats_t stats;
+  portMUX_TYPE stats_mux;
   TaskHandle_t feed_task;
   TaskHandle_t detect_task;
   TaskHandle_t handle_task;
@@ -95,6 +103,7 @@ static int SR_CHANNEL_NUM = 3;
 
 static srmodel_list_t *models = NULL;
 static sr_data_t *g_sr_data = NULL;
+static sr_config_t sr_config = SR_CONFIG_DEFAULT();
 
 esp_err_t sr_set_mode(sr_mode_t mode);
 
@@ -136,9 +145,58 @@ void sr_handler_task(void *pvParam) {
   vTaskDelete(NULL);
 }
 
+static inline int16_t sr_apply_gain(int16_t sample, int32_t gain) {
+  int32_t out = (sample * gain) >> SR_GAIN_SHIFT;
+  if (out > INT16_MAX) {
+    return INT16_MAX;
+  }
+  if (out < INT16_MIN) {
+    return INT16_MIN;
+  }
+  return out;
+}
+
+/*
+ * Arranges the frames read at the start of the buffer as the AFE expects them, two microphones and an
+ * unused reference channel, applying the gain in the same pass. The frames are spread in place, from the
+ * last one, so that the samples are read from the I2S DMA buffers straight into the buffer fed to the AFE.
+ */
+static void sr_arrange_frames(int16_t *buffer, int frames, uint8_t rx_chan_num, int32_t gain) {
+  int16_t *out = buffer + frames * SR_CHANNEL_NUM;
+  if (rx_chan_num == 1) {
+    for (int i = frames - 1; i >= 0; i--) {
+      out -= SR_CHANNEL_NUM;
+      int16_t mic = buffer[i];
+      out[2] = 0;
+      out[1] = 0;
+      out[0] = (gain == SR_GAIN_UNITY) ? mic : sr_apply_gain(mic, gain);
+    }
+  } else if (gain == SR_GAIN_UNITY) {
+    for (int i = frames - 1; i >= 0; i--) {
+      out -= SR_CHANNEL_NUM;
+      uint32_t mics;
+      memcpy(&mics, &buffer[i * 2], sizeof(mics));  // both samples of the frame in one load
+      out[2] = 0;
+      out[1] = (int16_t)(mics >> 16);
+      out[0] = (int16_t)mics;
+    }
+  } else {
+    for (int i = frames - 1; i >= 0; i--) {
+      out -= SR_CHANNEL_NUM;
+      uint32_t mics;
+      memcpy(&mics, &buffer[i * 2], sizeof(mics));
+      out[2] = 0;
+      out[1] = sr_apply_gain((int16_t)(mics >> 16), gain);
+      out[0] = sr_apply_gain((int16_t)mics, gain);
+    }
+  }
+}
+
 static void audio_feed_task(void *arg) {
   size_t bytes_read = 0;
   int audio_chunksize = g_sr_data->afe_handle->get_feed_chunksize(g_sr_data->afe_data);
+  size_t chunk_bytes = audio_chunksize * g_sr_data->i2s_rx_chan_num * sizeof(int16_t);
+  int64_t chunk_us = (int64_t)audio_chunksize * 1000000 / SR_SAMPLE_RATE;
   log_i("audio_chunksize=%d, feed_channel=%d", audio_chunksize, SR_CHANNEL_NUM);
 
   /* Allocate audio buffer and check for result */
@@ -159,39 +217,47 @@ static void audio_feed_task(void *arg) {
     }
 
     /* Read audio data from I2S bus */
-    //ToDo: handle error
     if (g_sr_data->fill_cb == NULL) {
       vTaskDelay(100);
       continue;
     }
-    esp_err_t err = g_sr_data->fill_cb(
-      g_sr_data->fill_cb_arg, (char *)audio_buffer, audio_chunksize * g_sr_data->i2s_rx_chan_num * sizeof(int16_t), &bytes_read, portMAX_DELAY
-    );
-    if (err != ESP_OK) {
+    if (g_sr_data->i2s_rx_chan_num != 1 && g_sr_data->i2s_rx_chan_num != 2) {
       vTaskDelay(100);
       continue;
     }
-
-    /* Channel Adjust */
-    if (g_sr_data->i2s_rx_chan_num == 1) {
-      for (int i = audio_chunksize - 1; i >= 0; i--) {
-        audio_buffer[i * SR_CHANNEL_NUM + 2] = 0;
-        audio_buffer[i * SR_CHANNEL_NUM + 1] = 0;
-        audio_buffer[i * SR_CHANNEL_NUM + 0] = audio_buffer[i];
-      }
-    } else if (g_sr_data->i2s_rx_chan_num == 2) {
-      for (int i = audio_chunksize - 1; i >= 0; i--) {
-        audio_buffer[i * SR_CHANNEL_NUM + 2] = 0;
-        audio_buffer[i * SR_CHANNEL_NUM + 1] = audio_buffer[i * 2 + 1];
-        audio_buffer[i * SR_CHANNEL_NUM + 0] = audio_buffer[i * 2 + 0];
-      }
-    } else {
+    int64_t start = esp_timer_get_time();
+    bytes_read = 0;
+    esp_err_t err = g_sr_data->fill_cb(g_sr_data->fill_cb_arg, (char *)audio_buffer, chunk_bytes, &bytes_read, portMAX_DELAY);
+    int64_t read_end = esp_timer_get_time();
+    if (err != ESP_OK) {
+      portENTER_CRITICAL(&g_sr_data->stats_mux);
+      g_sr_data->stats.underruns++;
+      portEXIT_CRITICAL(&g_sr_data->stats_mux);
       vTaskDelay(100);
       continue;
     }
+    bool underrun = bytes_read < chunk_bytes;
+    if (underrun) {
+      // keep the AFE in time with silence
+      memset((uint8_t *)audio_buffer + bytes_read, 0, chunk_bytes - bytes_read);
+    }
+
+    /* Channel Adjust */
+    sr_arrange_frames(audio_buffer, audio_chunksize, g_sr_data->i2s_rx_chan_num, g_sr_data->gain);
+    int64_t arrange_end = esp_timer_get_time();
 
     /* Feed samples of an audio stream to the AFE_SR */
     g_sr_data->afe_handle->feed(g_sr_data->afe_data, audio_buffer);
+    int64_t feed_end = esp_timer_get_time();
+
+    portENTER_CRITICAL(&g_sr_data->stats_mux);
+    g_sr_data->stats.chunks++;
+    g_sr_data->stats.underruns += underrun;
+    g_sr_data->stats.overruns += (feed_end - read_end) > chunk_us;
+    g_sr_data->stats.read_us += read_end - start;
+    g_sr_data->stats.arrange_us += arrange_end - read_end;
+    g_sr_data->stats.feed_us += feed_end - arrange_end;
+    portEXIT_CRITICAL(&g_sr_data->stats_mux);
   }
   vTaskDelete(NULL);
 }
@@ -212,7 +278,13 @@ static void audio_detect_task(void *arg) {
       xEventGroupWaitBits(g_sr_data->event_group, PAUSE_DETECT | RESUME_DETECT, 1, 1, portMAX_DELAY);
     }
 
+    int64_t start = esp_timer_get_time();
     afe_fetch_result_t *res = g_sr_data->afe_handle->fetch(g_sr_data->afe_data);
+    int64_t fetch_end = esp_timer_get_time();
+    portENTER_CRITICAL(&g_sr_data->stats_mux);
+    g_sr_data->stats.fetches++;
+    g_sr_data->stats.fetch_us += fetch_end - start;
+    portEXIT_CRITICAL(&g_sr_data->stats_mux);
     if (!res || res->ret_value == ESP_FAIL) {
       continue;
     }
@@ -244,6 +316,10 @@ static void audio_detect_task(void *arg) {
 
       esp_mn_state_t mn_state = ESP_MN_STATE_DETECTING;
       mn_state = g_sr_data->multinet->detect(g_sr_data->model_data, res->data);
+      int64_t detect_end = esp_timer_get_time();
+      portENTER_CRITICAL(&g_sr_data->stats_mux);
+      g_sr_data->stats.detect_us += detect_end - fetch_end;
+      portEXIT_CRITICAL(&g_sr_data->stats_mux);
 
       if (ESP_MN_STATE_DETECTING == mn_state) {
         continue;
@@ -333,6 +409,8 @@ esp_err_t sr_start(
   g_sr_data->fill_cb_arg = fill_cb_arg;
   g_sr_data->i2s_rx_chan_num = rx_chan + 1;
   g_sr_data->mode = mode;
+  g_sr_data->gain = (int32_t)(sr_config.gain * SR_GAIN_UNITY + 0.5f);
+  portMUX_INITIALIZE(&g_sr_data->stats_mux);
 
   // Init Model
   log_d("init model");
@@ -371,13 +449,18 @@ esp_err_t sr_start(
 
   //Start tasks
   log_d("start tasks");
-  ret_val = xTaskCreatePinnedToCore(&audio_feed_task, "SR Feed Task", 4 * 1024, NULL, 5, &g_sr_data->feed_task, 0);
+  ret_val = xTaskCreatePinnedToCore(
+    &audio_feed_task, "SR Feed Task", sr_config.feed.stack_size, NULL, sr_config.feed.priority, &g_sr_data->feed_task, sr_config.feed.core
+  );
   ESP_GOTO_ON_FALSE(pdPASS == ret_val, ESP_FAIL, err, "Failed create audio feed task");
   vTaskDelay(10);
-  ret_val = xTaskCreatePinnedToCore(&audio_detect_task, "SR Detect Task", 8 * 1024, NULL, 5, &g_sr_data->detect_task, 1);
+  ret_val = xTaskCreatePinnedToCore(
+    &audio_detect_task, "SR Detect Task", sr_config.detect.stack_size, NULL, sr_config.detect.priority, &g_sr_data->detect_task, sr_config.detect.core
+  );
   ESP_GOTO_ON_FALSE(pdPASS == ret_val, ESP_FAIL, err, "Failed create audio detect task");
-  ret_val = xTaskCreatePinnedToCore(&sr_handler_task, "SR Handler Task", 6 * 1024, NULL, configMAX_PRIORITIES - 1, &g_sr_data->handle_task, 1);
-  //ret_val = xTaskCreatePinnedToCore(&sr_handler_task, "SR Handler Task", 6 * 1024, NULL, configMAX_PRIORITIES - 1, &g_sr_data->handle_task, 0);
+  ret_val = xTaskCreatePinnedToCore(
+    &sr_handler_task, "SR Handler Task", sr_config.handler.stack_size, NULL, sr_config.handler.priority, &g_sr_data->handle_task, sr_config.handler.core
+  );
   ESP_GOTO_ON_FALSE(pdPASS == ret_val, ESP_FAIL, err, "Failed create audio handler task");
 
   return ESP_OK;
@@ -424,6 +507,26 @@ esp_err_t sr_stop(void) {
   return ESP_OK;
 }
 
+esp_err_t sr_set_config(const sr_config_t *config) {
+  ESP_RETURN_ON_FALSE(NULL != config, ESP_ERR_INVALID_ARG, "Config is NULL");
+  ESP_RETURN_ON_FALSE(NULL == g_sr_data, ESP_ERR_INVALID_STATE, "SR already running");
+  ESP_RETURN_ON_FALSE(config->gain >= 0.0f && config->gain <= 16.0f, ESP_ERR_INVALID_ARG, "Gain must be between 0 and 16");
+  sr_config = *config;
+  return ESP_OK;
+}
+
+esp_err_t sr_get_stats(sr_stats_t *stats, bool reset) {
+  ESP_RETURN_ON_FALSE(NULL != stats, ESP_ERR_INVALID_ARG, "Stats is NULL");
+  ESP_RETURN_ON_FALSE(NULL != g_sr_data, ESP_ERR_INVALID_STATE, "SR is not running");
+  portENTER_CRITICAL(&g_sr_data->stats_mux);
+  *stats = g_sr_data->stats;
+  if (reset) {
+    memset(&g_sr_data->stats, 0, sizeof(sr_stats_t));
+  }
+  portEXIT_CRITICAL(&g_sr_data->stats_mux);
+  return ESP_OK;
+}
+
 esp_err_t sr_pause(void) {
   ESP_RETURN_ON_FALSE(NULL != g_sr_data, ESP_ERR_INVALID_STATE, "SR is not running");
   xEventGroupSetBits(g_sr_data->event_group, PAUSE_FEED | PAUSE_DETECT);
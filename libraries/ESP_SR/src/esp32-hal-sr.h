@@ -8,6 +8,8 @@
 #include "sdkconfig.h"
 #if CONFIG_IDF_TARGET_ESP32S3 && (CONFIG_USE_WAKENET || CONFIG_USE_MULTINET)
 
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
 #include "driver/i2s_types.h"
 #include "esp_err.h"
 
@@ -48,10 +50,46 @@ typedef enum {
 typedef void (*sr_event_cb)(void *arg, sr_event_t event, int command_id, int phrase_id);
 typedef esp_err_t (*sr_fill_cb)(void *arg, void *out, size_t len, size_t *bytes_read, uint32_t timeout_ms);
 
+typedef struct sr_task_config_t {
+  uint32_t stack_size;
+  UBaseType_t priority;
+  BaseType_t core;  //tskNO_AFFINITY lets the scheduler pick the core
+} sr_task_config_t;
+
+typedef struct sr_config_t {
+  sr_task_config_t feed;     //Reads the audio and feeds it to the AFE
+  sr_task_config_t detect;   //Fetches from the AFE and runs the command detection
+  sr_task_config_t handler;  //Calls the event callback
+  float gain;                //Applied to the samples while they are arranged for the AFE
+} sr_config_t;
+
+#define SR_CONFIG_DEFAULT()                                                               \
+  {                                                                                       \
+    .feed = {.stack_size = 4 * 1024, .priority = 5, .core = 0},                           \
+    .detect = {.stack_size = 8 * 1024, .priority = 5, .core = 1},                         \
+    .handler = {.stack_size = 6 * 1024, .priority = configMAX_PRIORITIES - 1, .core = 1}, \
+    .gain = 1.0f,                                                                         \
+  }
+
+typedef struct sr_stats_t {
+  uint32_t chunks;      //Chunks fed to the AFE
+  uint32_t underruns;   //Chunks the fill callback did not fill completely, padded with silence
+  uint32_t overruns;    //Chunks arranged and fed slower than they are played
+  uint32_t fetches;     //Chunks fetched from the AFE
+  uint64_t read_us;     //Time spent in the fill callback, including the wait for the I2S DMA
+  uint64_t arrange_us;  //Time spent arranging the channels and applying the gain
+  uint64_t feed_us;     //Time spent in the AFE feed
+  uint64_t fetch_us;    //Time spent in the AFE fetch
+  uint64_t detect_us;   //Time spent in the command detection
+} sr_stats_t;
+
 esp_err_t sr_start(
   sr_fill_cb fill_cb, void *fill_cb_arg, sr_channels_t rx_chan, sr_mode_t mode, const sr_cmd_t *sr_commands, size_t cmd_number, sr_event_cb cb, void *cb_arg
 );
 esp_err_t sr_stop(void);
+//Applies to the next sr_start()
+esp_err_t sr_set_config(const sr_config_t *config);
+esp_err_t sr_get_stats(sr_stats_t *stats, bool reset);
 esp_err_t sr_pause(void);
 esp_err_t sr_resume(void);
 esp_err_t sr_set_mode(sr_mode_t mode);
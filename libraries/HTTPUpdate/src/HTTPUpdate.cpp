@@ -121,6 +121,7 @@ String HTTPUpdate::getLastErrorString(void) {
     case HTTP_UE_BIN_VERIFY_HEADER_FAILED: return "Verify Bin Header Failed";
     case HTTP_UE_BIN_FOR_WRONG_FLASH:      return "New Binary Does Not Fit Flash Size";
     case HTTP_UE_NO_PARTITION:             return "Partition Could Not be Found";
+    case HTTP_UE_RESUME_FAILED:            return "Update Could Not be Resumed";
   }
 
   return String();
@@ -208,7 +209,21 @@ HTTPUpdateResult HTTPUpdate::handleUpdate(HTTPClient &http, const String &curren
     http.setAuthorization(_auth.c_str());
   }
 
-  const char *headerkeys[] = {"x-MD5"};
+  // continue an interrupted update from its last checkpoint
+  String resumeId;
+  size_t resumeOffset = 0;
+  if (_resume) {
+    resumeOffset = Update.resumeOffset(resumeId, spiffs ? U_SPIFFS : U_FLASH);
+  }
+  if (resumeOffset) {
+    http.addHeader("Range", "bytes=" + String(resumeOffset) + "-");
+    // with a strong ETag, a server with another image sends all of it
+    if (resumeId.startsWith("\"")) {
+      http.addHeader("If-Range", resumeId);
+    }
+  }
+
+  const char *headerkeys[] = {"x-MD5", "ETag", "Content-Range"};
   size_t headerkeyssize = sizeof(headerkeys) / sizeof(char *);
 
   // track these headers
@@ -238,6 +253,8 @@ HTTPUpdateResult HTTPUpdate::handleUpdate(HTTPClient &http, const String &curren
   if (md5.length()) {
     log_d(" - MD5: %s\n", md5.c_str());
   }
+  String imageId = http.hasHeader("ETag") ? http.header("ETag") : md5;
+  uint32_t resumeFrom = 0;
 
   log_d("ESP32 info:\n");
   log_d(" - free Space: %d\n", ESP.getFreeSketchSpace());
@@ -248,6 +265,25 @@ HTTPUpdateResult HTTPUpdate::handleUpdate(HTTPClient &http, const String &curren
   }
 
   switch (code) {
+    case HTTP_CODE_PARTIAL_CONTENT:  ///< Partial Content (Resume Update)
+    {
+      // Content-Range: bytes <first>-<last>/<total>
+      String range = http.header("Content-Range");
+      int slash = range.indexOf('/');
+      uint32_t first = range.startsWith("bytes ") ? range.substring(6).toInt() : 0;
+      uint32_t total = (slash > 0) ? range.substring(slash + 1).toInt() : 0;
+      if (!resumeOffset || first != resumeOffset || len <= 0 || first + len != total || imageId != resumeId) {
+        // not the image being resumed, the next attempt starts over
+        log_e("Cannot resume from %u: %s\n", resumeOffset, range.c_str());
+        Update.clearResume();
+        _lastError = HTTP_UE_RESUME_FAILED;
+        ret = HTTP_UPDATE_FAILED;
+        break;
+      }
+      resumeFrom = first;
+      len = total;
+    }
+      // fall through
     case HTTP_CODE_OK:  ///< OK (Start Update)
       if (len > 0) {
         bool startUpdate = true;
@@ -301,7 +337,7 @@ HTTPUpdateResult HTTPUpdate::handleUpdate(HTTPClient &http, const String &curren
             log_d("runUpdate flash...\n");
           }
 
-          if (!spiffs) {
+          if (!spiffs && !resumeFrom) {
             /* To do
                     uint8_t buf[4];
                     if(tcp->peekBytes(&buf[0], 4) != 4) {
@@ -314,7 +350,9 @@ HTTPUpdateResult HTTPUpdate::handleUpdate(HTTPClient &http, const String &curren
 
             // check for valid first magic byte
             //                    if(buf[0] != 0xE9) {
-            if (tcp->peek() != 0xE9) {
+            // or gzip and delta images, see Update.setImageFormat()
+            int magic = tcp->peek();
+            if (magic != 0xE9 && magic != (UPDATE_GZIP_MAGIC & 0xff) && magic != (UPDATE_DELTA_MAGIC & 0xff)) {
               log_e("Magic header does not start with 0xE9\n");
               _lastError = HTTP_UE_BIN_VERIFY_HEADER_FAILED;
               http.end();
@@ -332,7 +370,7 @@ HTTPUpdateResult HTTPUpdate::handleUpdate(HTTPClient &http, const String &curren
                     }
 */
           }
-          if (runUpdate(*tcp, len, md5, command)) {
+          if (runUpdate(*tcp, len, md5, command, imageId, resumeFrom)) {
             ret = HTTP_UPDATE_OK;
             log_d("Update ok\n");
             http.end();
@@ -384,9 +422,11 @@ HTTPUpdateResult HTTPUpdate::handleUpdate(HTTPClient &http, const String &curren
  * @param in Stream&
  * @param size uint32_t
  * @param md5 String
+ * @param resumeId String id of the image for checkpoints
+ * @param resumeFrom uint32_t offset of the first byte of the stream
  * @return true if Update ok
  */
-bool HTTPUpdate::runUpdate(Stream &in, uint32_t size, String md5, int command) {
+bool HTTPUpdate::runUpdate(Stream &in, uint32_t size, String md5, int command, const String &resumeId, uint32_t resumeFrom) {
 
   StreamString error;
 
@@ -394,6 +434,12 @@ bool HTTPUpdate::runUpdate(Stream &in, uint32_t size, String md5, int command) {
     Update.onProgress(_cbProgress);
   }
 
+  // keep reading the stream while the flash is erased and programmed
+  Update.setPipeline();
+  if (_resume && !resumeFrom) {
+    Update.clearResume();  // the server sent the whole image
+  }
+  Update.setResume((_resume && resumeId.length()) ? resumeId.c_str() : NULL);
   if (!Update.begin(size, command, _ledPin, _ledOn)) {
     _lastError = Update.getError();
     Update.printError(error);
@@ -402,8 +448,16 @@ bool HTTPUpdate::runUpdate(Stream &in, uint32_t size, String md5, int command) {
     return false;
   }
 
+  if (Update.progress() != resumeFrom) {
+    // the written data did not verify, the checkpoint is gone
+    Update.abort();
+    _lastError = HTTP_UE_RESUME_FAILED;
+    log_e("Update could not be resumed from %u\n", resumeFrom);
+    return false;
+  }
+
   if (_cbProgress) {
-    _cbProgress(0, size);
+    _cbProgress(resumeFrom, size);
   }
 
   if (md5.length()) {
@@ -416,7 +470,7 @@ bool HTTPUpdate::runUpdate(Stream &in, uint32_t size, String md5, int command) {
 
   // To do: the SHA256 could be checked if the server sends it
 
-  if (Update.writeStream(in) != size) {
+  if (Update.writeStream(in) != size - resumeFrom) {
     _lastError = Update.getError();
     Update.printError(error);
     error.trim();  // remove line ending
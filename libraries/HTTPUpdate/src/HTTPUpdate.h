@@ -41,6 +41,7 @@
 #define HTTP_UE_BIN_VERIFY_HEADER_FAILED (-106)
 #define HTTP_UE_BIN_FOR_WRONG_FLASH      (-107)
 #define HTTP_UE_NO_PARTITION             (-108)
+#define HTTP_UE_RESUME_FAILED            (-109)
 
 enum HTTPUpdateResult {
   HTTP_UPDATE_FAILED,
@@ -79,6 +80,15 @@ public:
     _ledOn = ledOn;
   }
 
+  /**
+      * resume interrupted updates with a Range request, see Update.setResume()
+      * the image is identified by its ETag, or its x-MD5 header
+      * @param resume
+      */
+  void setResume(bool resume) {
+    _resume = resume;
+  }
+
   void setMD5sum(const String &md5Sum) {
     _md5Sum = md5Sum;
   }
@@ -123,7 +133,7 @@ public:
 
 protected:
   t_httpUpdate_return handleUpdate(HTTPClient &http, const String &currentVersion, bool spiffs = false, HTTPUpdateRequestCB requestCB = NULL);
-  bool runUpdate(Stream &in, uint32_t size, String md5, int command = U_FLASH);
+  bool runUpdate(Stream &in, uint32_t size, String md5, int command = U_FLASH, const String &resumeId = String(), uint32_t resumeFrom = 0);
 
   // Set the error and potentially use a CB to notify the application
   void _setLastError(int err) {
@@ -134,6 +144,7 @@ protected:
   }
   int _lastError;
   bool _rebootOnUpdate = true;
+  bool _resume = false;
 
 private:
   int _httpClientTimeout;
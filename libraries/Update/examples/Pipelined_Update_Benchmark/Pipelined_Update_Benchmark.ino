@@ -0,0 +1,118 @@
+/*
+ Name:      Pipelined_Update_Benchmark.ino
+ Purpose:   Compare synchronous and pipelined Update writes
+
+ The image comes from a simulated link: data arrives at LINK_RATE bytes per second
+ and at most LINK_WINDOW bytes wait in the receive window. While the window is full
+ the sender stalls, as a TCP sender does when the device stops reading the socket.
+
+ The image is written to the next OTA partition and the update is aborted at the end,
+ so the running firmware is left untouched.
+*/
+
+#include <Update.h>
+#include "esp_image_format.h"
+
+#define IMAGE_SIZE  (512 * 1024)
+#define LINK_RATE   (400 * 1024)
+#define LINK_WINDOW 5744
+
+class SimulatedLink : public Stream {
+public:
+  void begin(size_t size) {
+    _size = size;
+    _sent = 0;
+    _window = 0;
+    _last = micros();
+  }
+
+  int available() override {
+    _refill();
+    return _window;
+  }
+
+  int read() override {
+    uint8_t c;
+    return readBytes(&c, 1) ? c : -1;
+  }
+
+  int peek() override {
+    return _byteAt(_sent);
+  }
+
+  size_t readBytes(uint8_t *buffer, size_t length) override {
+    _refill();
+    while (_window == 0) {
+      delay(1);
+      _refill();
+    }
+    size_t n = min(length, _window);
+    for (size_t i = 0; i < n; i++) {
+      buffer[i] = _byteAt(_sent + i);
+    }
+    _sent += n;
+    _window -= n;
+    return n;
+  }
+
+  size_t readBytes(char *buffer, size_t length) override {
+    return readBytes((uint8_t *)buffer, length);
+  }
+
+  size_t write(uint8_t) override {
+    return 0;
+  }
+
+private:
+  size_t _size, _sent, _window;
+  uint32_t _last;
+
+  uint8_t _byteAt(size_t pos) {
+    // non 0xFF data, so that no block is skipped as empty
+    return pos ? (uint8_t)(pos * 2654435761UL >> 24) & 0x7F : ESP_IMAGE_HEADER_MAGIC;
+  }
+
+  void _refill() {
+    uint32_t now = micros();
+    size_t arrived = (uint64_t)(now - _last) * LINK_RATE / 1000000;
+    if (arrived == 0) {
+      return;
+    }
+    _last = now;
+    // the sender stalls when the window is full, the time spent there is lost
+    _window = min(_window + arrived, min((size_t)LINK_WINDOW, _size - _sent));
+  }
+};
+
+SimulatedLink link;
+
+void runUpdate(uint8_t buffers) {
+  Update.setPipeline(buffers);
+  if (!Update.begin(IMAGE_SIZE)) {
+    Update.printError(Serial);
+    return;
+  }
+  link.begin(IMAGE_SIZE);
+  uint32_t start = millis();
+  size_t written = Update.writeStream(link);
+  uint32_t elapsed = millis() - start;
+  Update.abort();
+
+  Serial.printf("%s: %u bytes in %lu ms, %lu KB/s\n", buffers ? "pipelined" : "synchronous", written, elapsed, written / elapsed * 1000 / 1024);
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  Serial.printf("Simulated link: %u KB/s, %u bytes window\n", LINK_RATE / 1024, LINK_WINDOW);
+  runUpdate(0);
+  runUpdate(2);
+  runUpdate(3);
+}
+
+void loop() {
+  delay(1000);
+}
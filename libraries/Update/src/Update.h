@@ -11,6 +11,13 @@
 #include <MD5Builder.h>
 #include <functional>
 #include "esp_partition.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "UpdateGzip.h"
+#include "UpdateDelta.h"
+
+class UpdateCrypt;
 
 #define UPDATE_ERROR_OK           (0)
 #define UPDATE_ERROR_WRITE        (1)
@@ -26,6 +33,8 @@
 #define UPDATE_ERROR_BAD_ARGUMENT (11)
 #define UPDATE_ERROR_ABORT        (12)
 #define UPDATE_ERROR_DECRYPT      (13)
+#define UPDATE_ERROR_DECOMPRESS   (14)
+#define UPDATE_ERROR_DELTA        (15)
 
 #define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
 
@@ -33,6 +42,11 @@
 #define U_SPIFFS 100
 #define U_AUTH   200
 
+#define U_IMAGE_AUTO  0
+#define U_IMAGE_RAW   1
+#define U_IMAGE_GZIP  2
+#define U_IMAGE_DELTA 3
+
 #define ENCRYPTED_BLOCK_SIZE       16
 #define ENCRYPTED_TWEAK_BLOCK_SIZE 32
 #define ENCRYPTED_KEY_SIZE         32
@@ -46,6 +60,12 @@
 #define SPI_SECTORS_PER_BLOCK 16  // usually large erase block is 32k/64k
 #define SPI_FLASH_BLOCK_SIZE  (SPI_SECTORS_PER_BLOCK * SPI_FLASH_SEC_SIZE)
 
+#define UPDATE_PIPELINE_MAX_BUFFERS   4
+#define UPDATE_PIPELINE_TASK_STACK    4096
+#define UPDATE_PIPELINE_TASK_PRIORITY (tskIDLE_PRIORITY + 5)
+
+#define UPDATE_RESUME_ID_SIZE 65  // up to 64 chars
+
 class UpdateClass {
 public:
   typedef std::function<void(size_t, size_t)> THandlerFunction_Progress;
@@ -72,6 +92,49 @@ public:
     */
   bool setupCrypt(const uint8_t *cryptKey = 0, size_t cryptAddress = 0, uint8_t cryptConfig = 0xf, int cryptMode = U_AES_DECRYPT_AUTO);
 
+  /*
+      Enables the pipelined write mode for the next begin() only,
+      the updates after it write synchronously unless it is called again
+      Flash erase, program and MD5 run in a background task while the caller
+      keeps filling the next of <buffers> 4KB buffers (2 to 4), so the stream
+      is read while the flash is busy. Flash is erased one block ahead.
+      0 or 1 writes synchronously, as by default
+      Falls back to synchronous writes if the buffers or task can't be allocated
+    */
+  bool setPipeline(uint8_t buffers = 3);
+
+  /*
+      Selects the format of the images written from the next begin()
+      U_IMAGE_AUTO detects gzip and delta images (tools/gen_ota_image.py) by
+      their first byte, for U_FLASH without decryption only. U_IMAGE_GZIP forces
+      gzip, also for U_SPIFFS. A delta image, possibly gzipped, is applied to the
+      running application and needs U_FLASH
+      When decoding, size(), progress() and setMD5() refer to the transferred image
+    */
+  bool setImageFormat(uint8_t format);
+
+  /*
+      Resumable updates, for raw images
+      While the image identified by <id> (ETag, version or MD5 of the image) is written,
+      the progress and the MD5 of the data written so far are saved to NVS at every flash
+      block. A later begin() with the same id, size and command reads back and verifies
+      the written data, then continues from progress(): the sender must skip those bytes
+      The checkpoint is kept when the stream times out or on abort(), and is cleared by
+      end() and by other errors. NULL disables checkpoints
+    */
+  bool setResume(const char *id);
+
+  /*
+      Returns the offset a begin() with this command would continue from, and the id
+      of the image, 0 if there is no checkpoint
+    */
+  size_t resumeOffset(String &id, int command = U_FLASH);
+
+  /*
+      Discards the checkpoint, the next begin() starts from the first byte
+    */
+  void clearResume();
+
   /*
       Writes a buffer to the flash and increments the address
       Returns the amount written
@@ -168,16 +231,16 @@ public:
     return _size > 0;
   }
   bool isFinished() {
-    return _progress == _size;
+    return _decoding() ? _inProgress == _inSize : _progress == _size;
   }
   size_t size() {
-    return _size;
+    return _decoding() ? _inSize : _size;
   }
   size_t progress() {
-    return _progress;
+    return _decoding() ? _inProgress : _progress;
   }
   size_t remaining() {
-    return _size - _progress;
+    return size() - progress();
   }
 
   /*
@@ -193,6 +256,23 @@ public:
     }
 
     size_t available = data.available();
+    // until the format is known, and for compressed or delta images, go through write()
+    while (available && _format != U_IMAGE_RAW) {
+      uint8_t chunk[256];
+      size_t len = (available < sizeof(chunk)) ? available : sizeof(chunk);
+      if (len > remaining()) {
+        len = remaining();
+      }
+      data.read(chunk, len);
+      if (write(chunk, len) != len) {
+        return written;
+      }
+      written += len;
+      if (remaining() == 0) {
+        return written;
+      }
+      available = data.available();
+    }
     while (available) {
       if (_bufferLen + available > remaining()) {
         available = remaining() - _bufferLen;
@@ -235,17 +315,38 @@ public:
 private:
   void _reset();
   void _abort(uint8_t err);
-  void _cryptKeyTweak(size_t cryptAddress, uint8_t *tweaked_key);
   bool _decryptBuffer();
   bool _writeBuffer();
   bool _verifyHeader(uint8_t data);
   bool _verifyEnd();
   bool _enablePartition(const esp_partition_t *partition);
   bool _chkDataInBlock(const uint8_t *data, size_t len) const;  // check if block contains any data or is empty
+  size_t _writeRaw(const uint8_t *data, size_t len);
+
+  bool _decoding() const {
+    return _gzip || _delta;
+  }
+  bool _imageBegin(uint8_t first);
+  void _imageEnd();
+  bool _imageFinished() const;
+  bool _deltaBegin();
+  bool _deltaHeader(const esp_partition_t *running, const UpdateDelta &delta);
+  bool _writeInflated(const uint8_t *data, size_t len);
+  size_t _writeStreamDecoded(Stream &data);
+
+  bool _resumeBegin();
+  bool _resumeSave();
+
+  bool _pipelineBegin();
+  bool _pipelineDrain();
+  void _pipelineEnd();
+  bool _pipelineErase();
+  void _pipelineRun();
+  static void _pipelineTask(void *arg);
 
   uint8_t _error;
   uint8_t *_cryptKey;
-  uint8_t *_cryptBuffer;
+  UpdateCrypt *_crypt;
   uint8_t *_buffer;
   uint8_t *_skipBuffer;
   size_t _bufferLen;
@@ -265,6 +366,28 @@ private:
   uint8_t _cryptMode;
   size_t _cryptAddress;
   uint8_t _cryptCfg;
+
+  uint8_t _pipeBuffers;  // buffers requested by setPipeline(), 0 for synchronous writes
+  uint8_t *_pipeBuf[UPDATE_PIPELINE_MAX_BUFFERS];
+  TaskHandle_t _pipeTask;
+  QueueHandle_t _pipeFree;  // buffers the caller can fill
+  QueueHandle_t _pipeWork;  // buffers waiting for the flash
+  SemaphoreHandle_t _pipeDone;
+  volatile uint32_t _pipeQueued;  // end of the data sent to the flash task
+  volatile uint32_t _pipeErased;  // end of the erased area, owned by the flash task
+  volatile uint8_t _pipeError;
+  volatile bool _pipeAbort;
+
+  uint8_t _imageFormat;  // format requested by setImageFormat()
+  uint8_t _format;       // format of the running update, U_IMAGE_AUTO until the first byte
+  UpdateGzip *_gzip;
+  UpdateDelta *_delta;
+  bool _decoderBusy;  // decoders are freed once they return
+  size_t _inSize;     // transferred image, when decoding
+  uint32_t _inProgress;
+  MD5Builder _inMd5;
+
+  String _resumeId;  // empty without checkpoints
 };
 
 #if !defined(NO_GLOBAL_INSTANCES) && !defined(NO_GLOBAL_UPDATE)
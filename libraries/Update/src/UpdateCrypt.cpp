@@ -0,0 +1,134 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "UpdateCrypt.h"
+#include <string.h>
+
+// flash stores the blocks byte reversed
+static inline void _reverseBlock(const uint8_t *in, uint8_t *out) {
+  uint32_t w[4];
+  memcpy(w, in, sizeof(w));
+  uint32_t r[4] = {__builtin_bswap32(w[3]), __builtin_bswap32(w[2]), __builtin_bswap32(w[1]), __builtin_bswap32(w[0])};
+  memcpy(out, r, sizeof(r));
+}
+
+UpdateCrypt::UpdateCrypt(const uint8_t *key, uint8_t cfg) : _cfg(cfg & 0x0f), _loadedValid(false) {
+  memcpy(_key, key, UPDATE_CRYPT_KEY_SIZE);
+#if SOC_AES_SUPPORTED
+  esp_aes_init(&_ctx);
+#else
+  mbedtls_aes_init(&_ctx);
+#endif
+}
+
+UpdateCrypt::~UpdateCrypt() {
+#if SOC_AES_SUPPORTED
+  esp_aes_free(&_ctx);
+#else
+  mbedtls_aes_free(&_ctx);
+#endif
+}
+
+void UpdateCrypt::_tweakKey(size_t address, uint8_t *tweaked_key) const {
+  memcpy(tweaked_key, _key, UPDATE_CRYPT_KEY_SIZE);
+  if (_cfg == 0) {
+    return;  //no tweaking needed, use crypt key as-is
+  }
+
+  const uint8_t pattern[] = {23, 23, 23, 14, 23, 23, 23, 12, 23, 23, 23, 10, 23, 23, 23, 8};
+  int pattern_idx = 0;
+  int key_idx = 0;
+  int bit_len = 0;
+  uint32_t tweak = 0;
+  address &= 0x00ffffe0;  //bit 23-5
+  address <<= 8;          //bit23 shifted to bit31(MSB)
+  while (pattern_idx < sizeof(pattern)) {
+    tweak = address << (23 - pattern[pattern_idx]);  //bit shift for small patterns
+    // alternative to: tweak = rotl32(tweak,8 - bit_len);
+    tweak = (tweak << (8 - bit_len)) | (tweak >> (24 + bit_len));  //rotate to line up with end of previous tweak bits
+    bit_len += pattern[pattern_idx++] - 4;                         //add number of bits in next pattern(23-4 = 19bits = 23bit to 5bit)
+    while (bit_len > 7) {
+      tweaked_key[key_idx++] ^= tweak;  //XOR byte
+      // alternative to: tweak = rotl32(tweak, 8);
+      tweak = (tweak << 8) | (tweak >> 24);  //compiler should optimize to use rotate(fast)
+      bit_len -= 8;
+    }
+    tweaked_key[key_idx] ^= tweak;  //XOR remaining bits, will XOR zeros if no remaining bits
+  }
+  if (_cfg == 0xf) {
+    return;  //return with fully tweaked key
+  }
+
+  //some of tweaked key bits need to be restore back to crypt key bits
+  const uint8_t cfg_bits[] = {67, 65, 63, 61};
+  key_idx = 0;
+  pattern_idx = 0;
+  while (key_idx < UPDATE_CRYPT_KEY_SIZE) {
+    bit_len += cfg_bits[pattern_idx];
+    if ((_cfg & (1 << pattern_idx)) == 0) {  //restore crypt key bits
+      while (bit_len > 0) {
+        if (bit_len > 7 || ((_cfg & (2 << pattern_idx)) == 0)) {  //restore a crypt key byte
+          tweaked_key[key_idx] = _key[key_idx];
+        } else {  //MSBits restore crypt key bits, LSBits keep as tweaked bits
+          tweaked_key[key_idx] &= (0xff >> bit_len);
+          tweaked_key[key_idx] |= (_key[key_idx] & (~(0xff >> bit_len)));
+        }
+        key_idx++;
+        bit_len -= 8;
+      }
+    } else {  //keep tweaked key bits
+      while (bit_len > 0) {
+        if (bit_len < 8 && ((_cfg & (2 << pattern_idx)) == 0)) {  //MSBits keep as tweaked bits, LSBits restore crypt key bits
+          tweaked_key[key_idx] &= (~(0xff >> bit_len));
+          tweaked_key[key_idx] |= (_key[key_idx] & (0xff >> bit_len));
+        }
+        key_idx++;
+        bit_len -= 8;
+      }
+    }
+    pattern_idx++;
+  }
+}
+
+bool UpdateCrypt::_loadKey(size_t address) {
+  uint8_t tweaked_key[UPDATE_CRYPT_KEY_SIZE];
+  _tweakKey(address, tweaked_key);
+  if (_loadedValid && !memcmp(tweaked_key, _loaded, UPDATE_CRYPT_KEY_SIZE)) {
+    return true;  // same key schedule
+  }
+#if SOC_AES_SUPPORTED
+  _loadedValid = !esp_aes_setkey(&_ctx, tweaked_key, 256);
+#else
+  _loadedValid = !mbedtls_aes_setkey_enc(&_ctx, tweaked_key, 256);
+#endif
+  memcpy(_loaded, tweaked_key, UPDATE_CRYPT_KEY_SIZE);
+  return _loadedValid;
+}
+
+bool UpdateCrypt::decrypt(size_t address, uint8_t *data, size_t len) {
+  if (len % UPDATE_CRYPT_BLOCK_SIZE) {
+    return false;
+  }
+  uint8_t block[UPDATE_CRYPT_BLOCK_SIZE];
+  for (size_t done = 0; done < len; done += UPDATE_CRYPT_BLOCK_SIZE) {
+    if (!done || (address + done) % UPDATE_CRYPT_TWEAK_SIZE == 0) {
+      if (!_loadKey(address + done)) {
+        return false;
+      }
+    }
+    _reverseBlock(data + done, block);
+    // the flash decrypts with an AES encryption
+#if SOC_AES_SUPPORTED
+    if (esp_aes_crypt_ecb(&_ctx, ESP_AES_ENCRYPT, block, block)) {
+#else
+    if (mbedtls_aes_crypt_ecb(&_ctx, MBEDTLS_AES_ENCRYPT, block, block)) {
+#endif
+      return false;
+    }
+    _reverseBlock(block, data + done);
+  }
+  return true;
+}
@@ -0,0 +1,54 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ESP32UPDATECRYPT_H
+#define ESP32UPDATECRYPT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "soc/soc_caps.h"
+#if SOC_AES_SUPPORTED
+#include "aes/esp_aes.h"
+#else
+#include "mbedtls/aes.h"
+#endif
+
+#define UPDATE_CRYPT_BLOCK_SIZE 16
+#define UPDATE_CRYPT_TWEAK_SIZE 32  // bytes sharing a tweaked key
+#define UPDATE_CRYPT_KEY_SIZE   32
+
+/*
+    Decrypts images encrypted for the ESP32 flash encryption (espsecure.py encrypt_flash_data)
+    Each 32 bytes of flash use the AES-256 key tweaked with their address, under the control
+    of the flash crypt config. The key schedule is only reloaded when the tweaked key changes,
+    so with config 0 a single one serves the whole image. Uses the AES peripheral when present
+*/
+class UpdateCrypt {
+public:
+  UpdateCrypt(const uint8_t *key, uint8_t cfg);
+  ~UpdateCrypt();
+
+  /*
+      Decrypts <len> bytes in place, a multiple of 16, read from flash at <address>
+    */
+  bool decrypt(size_t address, uint8_t *data, size_t len);
+
+private:
+  void _tweakKey(size_t address, uint8_t *tweaked_key) const;
+  bool _loadKey(size_t address);
+
+  uint8_t _key[UPDATE_CRYPT_KEY_SIZE];
+  uint8_t _cfg;
+  uint8_t _loaded[UPDATE_CRYPT_KEY_SIZE];  // tweaked key of the current key schedule
+  bool _loadedValid;
+#if SOC_AES_SUPPORTED
+  esp_aes_context _ctx;
+#else
+  mbedtls_aes_context _ctx;
+#endif
+};
+
+#endif
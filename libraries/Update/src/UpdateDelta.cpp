@@ -0,0 +1,133 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "UpdateDelta.h"
+#include <string.h>
+
+static inline uint32_t _readLE32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+UpdateDelta::UpdateDelta(THandlerFunction_Read readOld, THandlerFunction_Write writeNew, THandlerFunction_Header onHeader)
+  : _state(STATE_HEADER), _readOld(readOld), _writeNew(writeNew), _onHeader(onHeader), _headerLen(0), _recordLen(0), _oldSize(0), _newSize(0), _oldPos(0),
+    _newPos(0), _diffLeft(0), _extraLeft(0), _seek(0) {}
+
+bool UpdateDelta::_fail() {
+  _state = STATE_ERROR;
+  return false;
+}
+
+bool UpdateDelta::_parseHeader() {
+  if (_readLE32(_header) != UPDATE_DELTA_MAGIC || _readLE32(_header + 4) != UPDATE_DELTA_VERSION) {
+    return false;
+  }
+  _oldSize = _readLE32(_header + 8);
+  _newSize = _readLE32(_header + 12);
+  return !_onHeader || _onHeader(*this);
+}
+
+bool UpdateDelta::_parseRecord() {
+  _diffLeft = _readLE32(_record);
+  _extraLeft = _readLE32(_record + 4);
+  _seek = (int32_t)_readLE32(_record + 8);
+  // the record must stay within both images
+  uint32_t left = _newSize - _newPos;
+  if (_diffLeft > left || _extraLeft > left - _diffLeft || _diffLeft > _oldSize - _oldPos) {
+    return false;
+  }
+  int64_t next = (int64_t)_oldPos + _diffLeft + _seek;
+  return next >= 0 && next <= _oldSize;
+}
+
+void UpdateDelta::_nextRecord() {
+  if (_diffLeft) {
+    _state = STATE_DIFF;
+  } else if (_extraLeft) {
+    _state = STATE_EXTRA;
+  } else {
+    _oldPos += _seek;
+    _recordLen = 0;
+    _state = (_newPos == _newSize) ? STATE_DONE : STATE_RECORD;
+  }
+}
+
+bool UpdateDelta::write(const uint8_t *data, size_t len) {
+  while (len) {
+    switch (_state) {
+      case STATE_HEADER:
+      {
+        size_t n = UPDATE_DELTA_HEADER_SIZE - _headerLen;
+        n = (n < len) ? n : len;
+        memcpy(_header + _headerLen, data, n);
+        _headerLen += n;
+        data += n;
+        len -= n;
+        if (_headerLen == UPDATE_DELTA_HEADER_SIZE) {
+          if (!_parseHeader()) {
+            return _fail();
+          }
+          _state = _newSize ? STATE_RECORD : STATE_DONE;
+        }
+        break;
+      }
+      case STATE_RECORD:
+      {
+        size_t n = UPDATE_DELTA_RECORD_SIZE - _recordLen;
+        n = (n < len) ? n : len;
+        memcpy(_record + _recordLen, data, n);
+        _recordLen += n;
+        data += n;
+        len -= n;
+        if (_recordLen == UPDATE_DELTA_RECORD_SIZE) {
+          if (!_parseRecord()) {
+            return _fail();
+          }
+          _nextRecord();
+        }
+        break;
+      }
+      case STATE_DIFF:
+      {
+        size_t n = (_diffLeft < len) ? _diffLeft : len;
+        n = (n < UPDATE_DELTA_CHUNK_SIZE) ? n : UPDATE_DELTA_CHUNK_SIZE;
+        if (!_readOld(_oldPos, _chunk, n)) {
+          return _fail();
+        }
+        for (size_t i = 0; i < n; i++) {
+          _chunk[i] += data[i];
+        }
+        if (!_writeNew(_chunk, n)) {
+          return _fail();
+        }
+        _oldPos += n;
+        _newPos += n;
+        _diffLeft -= n;
+        data += n;
+        len -= n;
+        _nextRecord();
+        break;
+      }
+      case STATE_EXTRA:
+      {
+        size_t n = (_extraLeft < len) ? _extraLeft : len;
+        if (!_writeNew(data, n)) {
+          return _fail();
+        }
+        _newPos += n;
+        _extraLeft -= n;
+        data += n;
+        len -= n;
+        _nextRecord();
+        break;
+      }
+      case STATE_DONE:
+        // trailing data after the end of the image
+        return _fail();
+      default: return false;
+    }
+  }
+  return true;
+}
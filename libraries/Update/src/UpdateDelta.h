@@ -0,0 +1,101 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ESP32UPDATEDELTA_H
+#define ESP32UPDATEDELTA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+
+/*
+    Delta image, as produced by tools/gen_ota_image.py (all values little endian)
+
+    Header:  "ESPD" | version (u32) | old size (u32) | new size (u32) | old MD5 (16) | new MD5 (16)
+    Records: diff length (u32) | extra length (u32) | seek (i32) | diff bytes | extra bytes
+
+    As in bsdiff, each record adds <diff length> bytes to the old image, starting at the
+    current old position, copies <extra length> bytes as they are, then moves the old
+    position by <seek>. The image ends when <new size> bytes have been produced.
+    Records are applied as they stream in, RAM use does not depend on the image size.
+*/
+
+#define UPDATE_DELTA_MAGIC       0x44505345  // "ESPD"
+#define UPDATE_DELTA_VERSION     1
+#define UPDATE_DELTA_HEADER_SIZE 48
+#define UPDATE_DELTA_RECORD_SIZE 12
+#define UPDATE_DELTA_CHUNK_SIZE  256
+
+class UpdateDelta {
+public:
+  // reads <len> bytes of the old image at <offset>
+  typedef std::function<bool(size_t offset, uint8_t *data, size_t len)> THandlerFunction_Read;
+  // receives the new image
+  typedef std::function<bool(const uint8_t *data, size_t len)> THandlerFunction_Write;
+  // called once the header is received, returning false aborts
+  typedef std::function<bool(const UpdateDelta &delta)> THandlerFunction_Header;
+
+  UpdateDelta(THandlerFunction_Read readOld, THandlerFunction_Write writeNew, THandlerFunction_Header onHeader = nullptr);
+
+  /*
+      Applies the next part of the delta image
+      Returns false on a malformed image or when a handler failed
+    */
+  bool write(const uint8_t *data, size_t len);
+
+  bool isFinished() const {
+    return _state == STATE_DONE;
+  }
+  bool hasError() const {
+    return _state == STATE_ERROR;
+  }
+  uint32_t oldSize() const {
+    return _oldSize;
+  }
+  uint32_t newSize() const {
+    return _newSize;
+  }
+  const uint8_t *oldMD5() const {
+    return _header + 16;
+  }
+  const uint8_t *newMD5() const {
+    return _header + 32;
+  }
+
+private:
+  enum {
+    STATE_HEADER,
+    STATE_RECORD,
+    STATE_DIFF,
+    STATE_EXTRA,
+    STATE_DONE,
+    STATE_ERROR,
+  } _state;
+
+  bool _fail();
+  bool _parseHeader();
+  bool _parseRecord();
+  void _nextRecord();
+
+  THandlerFunction_Read _readOld;
+  THandlerFunction_Write _writeNew;
+  THandlerFunction_Header _onHeader;
+
+  uint8_t _header[UPDATE_DELTA_HEADER_SIZE];
+  size_t _headerLen;
+  uint8_t _record[UPDATE_DELTA_RECORD_SIZE];
+  size_t _recordLen;
+  uint32_t _oldSize;
+  uint32_t _newSize;
+  uint32_t _oldPos;
+  uint32_t _newPos;
+  uint32_t _diffLeft;
+  uint32_t _extraLeft;
+  int32_t _seek;
+  uint8_t _chunk[UPDATE_DELTA_CHUNK_SIZE];
+};
+
+#endif
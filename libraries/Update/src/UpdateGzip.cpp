@@ -0,0 +1,186 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "UpdateGzip.h"
+#include <stdlib.h>
+#include "rom/miniz.h"
+#include "esp_rom_crc.h"
+
+#define GZIP_HEADER_SIZE  10
+#define GZIP_TRAILER_SIZE 8
+#define GZIP_METHOD_DEFL  8
+#define GZIP_FLAG_HCRC    0x02
+#define GZIP_FLAG_EXTRA   0x04
+#define GZIP_FLAG_NAME    0x08
+#define GZIP_FLAG_COMMENT 0x10
+
+UpdateGzip::UpdateGzip()
+  : _state(STATE_ERROR), _write(nullptr), _decomp(NULL), _window(NULL), _windowPos(0), _flags(0), _fieldLen(0), _extraLeft(0), _crc(0), _size(0) {}
+
+UpdateGzip::~UpdateGzip() {
+  end();
+}
+
+bool UpdateGzip::begin(THandlerFunction_Write write) {
+  end();
+  _decomp = malloc(sizeof(tinfl_decompressor));
+  _window = (uint8_t *)malloc(TINFL_LZ_DICT_SIZE);
+  if (!_decomp || !_window) {
+    end();
+    return false;
+  }
+  _write = write;
+  _state = STATE_HEADER;
+  _windowPos = 0;
+  _fieldLen = 0;
+  _crc = 0;
+  _size = 0;
+  return true;
+}
+
+void UpdateGzip::end() {
+  free(_decomp);
+  free(_window);
+  _decomp = NULL;
+  _window = NULL;
+  _state = STATE_ERROR;
+}
+
+bool UpdateGzip::_fail() {
+  _state = STATE_ERROR;
+  return false;
+}
+
+// moves to the next header field present in the stream
+bool UpdateGzip::_headerByte(uint8_t c) {
+  switch (_state) {
+    case STATE_HEADER:
+      _field[_fieldLen++] = c;
+      if (_fieldLen < GZIP_HEADER_SIZE) {
+        return true;
+      }
+      if ((_field[0] | (_field[1] << 8)) != UPDATE_GZIP_MAGIC || _field[2] != GZIP_METHOD_DEFL) {
+        return false;
+      }
+      _flags = _field[3];
+      _fieldLen = 0;
+      _state = STATE_EXTRA_LEN;
+      break;
+    case STATE_EXTRA_LEN:
+      _field[_fieldLen++] = c;
+      if (_fieldLen < 2) {
+        return true;
+      }
+      _extraLeft = _field[0] | (_field[1] << 8);
+      _state = STATE_EXTRA;
+      break;
+    case STATE_EXTRA:    _extraLeft--; break;
+    case STATE_NAME:     _state = c ? STATE_NAME : STATE_COMMENT; break;
+    case STATE_COMMENT:
+      if (!c) {
+        _state = STATE_HEADER_CRC;
+        _extraLeft = 2;
+      }
+      break;
+    case STATE_HEADER_CRC:
+      // header CRC is not checked, the data CRC covers the image
+      _extraLeft--;
+      break;
+    default: return false;
+  }
+  // skip the fields absent from this stream
+  if (_state == STATE_EXTRA_LEN && !(_flags & GZIP_FLAG_EXTRA)) {
+    _state = STATE_NAME;
+  }
+  if (_state == STATE_EXTRA && _extraLeft == 0) {
+    _state = STATE_NAME;
+  }
+  if (_state == STATE_NAME && !(_flags & GZIP_FLAG_NAME)) {
+    _state = STATE_COMMENT;
+  }
+  if (_state == STATE_COMMENT && !(_flags & GZIP_FLAG_COMMENT)) {
+    _state = STATE_HEADER_CRC;
+    _extraLeft = 2;
+  }
+  if (_state == STATE_HEADER_CRC && (!(_flags & GZIP_FLAG_HCRC) || _extraLeft == 0)) {
+    tinfl_init((tinfl_decompressor *)_decomp);
+    _state = STATE_INFLATE;
+  }
+  return true;
+}
+
+size_t UpdateGzip::_inflate(const uint8_t *data, size_t len) {
+  size_t used = 0;
+  for (;;) {
+    size_t in = len - used;
+    size_t out = TINFL_LZ_DICT_SIZE - _windowPos;
+    tinfl_status status =
+      tinfl_decompress((tinfl_decompressor *)_decomp, data + used, &in, _window, _window + _windowPos, &out, TINFL_FLAG_HAS_MORE_INPUT);
+    used += in;
+    if (out) {
+      _crc = esp_rom_crc32_le(_crc, _window + _windowPos, out);
+      _size += out;
+      if (!_write(_window + _windowPos, out)) {
+        _fail();
+        return used;
+      }
+      _windowPos = (_windowPos + out) & (TINFL_LZ_DICT_SIZE - 1);
+    }
+    if (status == TINFL_STATUS_DONE) {
+      // tinfl reads ahead without giving back what follows the deflate stream: the whole bytes left in its
+      // bit buffer, after the bits of the last byte of the stream, are the first bytes of the trailer
+      tinfl_decompressor *r = (tinfl_decompressor *)_decomp;
+      tinfl_bit_buf_t bits = r->m_bit_buf >> (r->m_num_bits & 7);
+      _fieldLen = 0;
+      for (uint32_t n = r->m_num_bits >> 3; n && _fieldLen < GZIP_TRAILER_SIZE; n--) {
+        _field[_fieldLen++] = (uint8_t)bits;
+        bits >>= 8;
+      }
+      _state = STATE_TRAILER;
+      return used;
+    }
+    if (status != TINFL_STATUS_HAS_MORE_OUTPUT) {
+      // all input consumed, or a corrupted stream
+      if (status < 0) {
+        _fail();
+      }
+      return used;
+    }
+  }
+}
+
+bool UpdateGzip::write(const uint8_t *data, size_t len) {
+  while (len) {
+    if (_state == STATE_INFLATE) {
+      size_t used = _inflate(data, len);
+      if (_state == STATE_ERROR || (_state == STATE_INFLATE && used < len)) {
+        return _fail();
+      }
+      data += used;
+      len -= used;
+    } else if (_state == STATE_TRAILER) {
+      _field[_fieldLen++] = *data++;
+      len--;
+      if (_fieldLen == GZIP_TRAILER_SIZE) {
+        uint32_t crc = _field[0] | (_field[1] << 8) | (_field[2] << 16) | ((uint32_t)_field[3] << 24);
+        uint32_t size = _field[4] | (_field[5] << 8) | (_field[6] << 16) | ((uint32_t)_field[7] << 24);
+        if (crc != _crc || size != _size) {
+          return _fail();
+        }
+        _state = STATE_DONE;
+      }
+    } else if (_state == STATE_DONE || _state == STATE_ERROR) {
+      // trailing data after the end of the stream
+      return _fail();
+    } else {
+      if (!_headerByte(*data++)) {
+        return _fail();
+      }
+      len--;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,77 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ESP32UPDATEGZIP_H
+#define ESP32UPDATEGZIP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+
+#define UPDATE_GZIP_MAGIC 0x8b1f
+
+/*
+    Streaming gzip decompressor, based on the inflate code of the ROM
+    Needs the 32KB deflate window plus about 11KB of decoder state, allocated by begin()
+*/
+class UpdateGzip {
+public:
+  // receives the decompressed data
+  typedef std::function<bool(const uint8_t *data, size_t len)> THandlerFunction_Write;
+
+  UpdateGzip();
+  ~UpdateGzip();
+
+  bool begin(THandlerFunction_Write write);
+  void end();
+
+  /*
+      Decompresses the next part of the gzip stream
+      Returns false on a malformed stream or when the write handler failed
+    */
+  bool write(const uint8_t *data, size_t len);
+
+  /*
+      true once the whole stream has been decompressed and its CRC32 and size checked
+    */
+  bool isFinished() const {
+    return _state == STATE_DONE;
+  }
+  bool hasError() const {
+    return _state == STATE_ERROR;
+  }
+
+private:
+  enum {
+    STATE_HEADER,
+    STATE_EXTRA_LEN,
+    STATE_EXTRA,
+    STATE_NAME,
+    STATE_COMMENT,
+    STATE_HEADER_CRC,
+    STATE_INFLATE,
+    STATE_TRAILER,
+    STATE_DONE,
+    STATE_ERROR,
+  } _state;
+
+  bool _fail();
+  bool _headerByte(uint8_t c);
+  size_t _inflate(const uint8_t *data, size_t len);
+
+  THandlerFunction_Write _write;
+  void *_decomp;     // tinfl_decompressor
+  uint8_t *_window;  // circular output buffer, also the deflate dictionary
+  size_t _windowPos;
+  uint8_t _flags;
+  uint8_t _field[10];  // header and trailer fields
+  size_t _fieldLen;
+  uint16_t _extraLeft;
+  uint32_t _crc;
+  uint32_t _size;
+};
+
+#endif
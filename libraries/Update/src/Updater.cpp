@@ -9,7 +9,22 @@
 #include "spi_flash_mmap.h"
 #include "esp_ota_ops.h"
 #include "esp_image_format.h"
-#include "mbedtls/aes.h"
+#include "UpdateCrypt.h"
+#include "nvs.h"
+
+#define UPDATE_RESUME_NAMESPACE "update"
+#define UPDATE_RESUME_KEY       "resume"
+
+typedef struct {
+  char id[UPDATE_RESUME_ID_SIZE];
+  uint32_t size;
+  uint32_t command;
+  uint32_t address;                    // of the partition
+  uint32_t progress;                   // at a flash block boundary
+  uint8_t md5[16];                     // of the image up to progress
+  uint8_t head[ENCRYPTED_BLOCK_SIZE];  // written by end(), see _skipBuffer
+  uint8_t cryptMode;
+} update_resume_t;
 
 static const char *_err2str(uint8_t _error) {
   if (_error == UPDATE_ERROR_OK) {
@@ -40,6 +55,10 @@ static const char *_err2str(uint8_t _error) {
     return ("Aborted");
   } else if (_error == UPDATE_ERROR_DECRYPT) {
     return ("Decryption error");
+  } else if (_error == UPDATE_ERROR_DECOMPRESS) {
+    return ("Decompression error");
+  } else if (_error == UPDATE_ERROR_DELTA) {
+    return ("Delta image error");
   }
   return ("UNKNOWN");
 }
@@ -59,6 +78,28 @@ static bool _partitionIsBootable(const esp_partition_t *partition) {
   return true;
 }
 
+static bool _resumeLoad(update_resume_t *cp) {
+  nvs_handle_t handle;
+  size_t len = sizeof(*cp);
+  if (nvs_open(UPDATE_RESUME_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+    return false;
+  }
+  esp_err_t err = nvs_get_blob(handle, UPDATE_RESUME_KEY, cp, &len);
+  nvs_close(handle);
+  return err == ESP_OK && len == sizeof(*cp) && memchr(cp->id, 0, sizeof(cp->id));
+}
+
+static void _resumeErase() {
+  nvs_handle_t handle;
+  if (nvs_open(UPDATE_RESUME_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+    return;
+  }
+  if (nvs_erase_key(handle, UPDATE_RESUME_KEY) == ESP_OK) {
+    nvs_commit(handle);
+  }
+  nvs_close(handle);
+}
+
 bool UpdateClass::_enablePartition(const esp_partition_t *partition) {
   if (!partition) {
     return false;
@@ -67,29 +108,49 @@ bool UpdateClass::_enablePartition(const esp_partition_t *partition) {
 }
 
 UpdateClass::UpdateClass()
-  : _error(0), _cryptKey(0), _cryptBuffer(0), _buffer(0), _skipBuffer(0), _bufferLen(0), _size(0), _progress_callback(NULL), _progress(0), _paroffset(0),
-    _command(U_FLASH), _partition(NULL), _cryptMode(U_AES_DECRYPT_AUTO), _cryptAddress(0), _cryptCfg(0xf) {}
+  : _error(0), _cryptKey(0), _crypt(nullptr), _buffer(0), _skipBuffer(0), _bufferLen(0), _size(0), _progress_callback(NULL), _progress(0), _paroffset(0),
+    _command(U_FLASH), _partition(NULL), _cryptMode(U_AES_DECRYPT_AUTO), _cryptAddress(0), _cryptCfg(0xf), _pipeBuffers(0), _pipeBuf{}, _pipeTask(NULL),
+    _pipeFree(NULL), _pipeWork(NULL), _pipeDone(NULL), _pipeQueued(0), _pipeErased(0), _pipeError(0), _pipeAbort(false), _imageFormat(U_IMAGE_AUTO),
+    _format(U_IMAGE_AUTO), _gzip(nullptr), _delta(nullptr), _decoderBusy(false), _inSize(0), _inProgress(0) {}
 
 UpdateClass &UpdateClass::onProgress(THandlerFunction_Progress fn) {
   _progress_callback = fn;
   return *this;
 }
 
+typedef struct {
+  uint8_t *data;    // NULL stops the flash task
+  uint32_t offset;  // offset in the partition
+  uint16_t len;
+  uint16_t skip;  // bytes not written yet, see _skipBuffer
+} update_pipe_item_t;
+
 void UpdateClass::_reset() {
+  if (_pipeTask) {
+    _pipelineEnd();  // frees _buffer too
+    _pipeBuffers = 0;
+  }
   if (_buffer) {
     delete[] _buffer;
   }
   if (_skipBuffer) {
     delete[] _skipBuffer;
   }
+  if (!_decoderBusy) {
+    _imageEnd();
+  }
 
-  _cryptBuffer = nullptr;
+  delete _crypt;  // key schedule of this image
+  _crypt = nullptr;
   _buffer = nullptr;
   _skipBuffer = nullptr;
   _bufferLen = 0;
   _progress = 0;
   _size = 0;
   _command = U_FLASH;
+  _format = U_IMAGE_AUTO;
+  _inSize = 0;
+  _inProgress = 0;
 
   if (_ledPin != -1) {
     digitalWrite(_ledPin, !_ledOn);  // off
@@ -125,6 +186,9 @@ bool UpdateClass::begin(size_t size, int command, int ledPin, uint8_t ledOn, con
   _error = 0;
   _target_md5 = emptyString;
   _md5 = MD5Builder();
+  // the pipeline applies to this update only, even when it fails to begin
+  uint8_t pipeBuffers = _pipeBuffers;
+  _pipeBuffers = 0;
 
   if (size == 0) {
     _error = UPDATE_ERROR_SIZE;
@@ -172,9 +236,397 @@ bool UpdateClass::begin(size_t size, int command, int ledPin, uint8_t ledOn, con
   _size = size;
   _command = command;
   _md5.begin();
+  // detecting the image by its first byte needs plain application images
+  _format = _imageFormat;
+  if (_format == U_IMAGE_AUTO && (command != U_FLASH || (_cryptKey && _cryptMode != U_AES_DECRYPT_NONE))) {
+    _format = U_IMAGE_RAW;
+  }
+  if (_resumeId.length()) {
+    _resumeBegin();
+  }
+  _pipeBuffers = pipeBuffers;
+  if (_pipeBuffers > 1 && !_pipelineBegin()) {
+    log_w("pipelined write unavailable, writing synchronously");
+    _pipeBuffers = 0;
+  }
+  return true;
+}
+
+bool UpdateClass::setPipeline(uint8_t buffers) {
+  if (buffers > UPDATE_PIPELINE_MAX_BUFFERS) {
+    log_e("too many buffers %u > %u", buffers, UPDATE_PIPELINE_MAX_BUFFERS);
+    return false;
+  }
+  _pipeBuffers = (buffers > 1) ? buffers : 0;
+  return true;
+}
+
+bool UpdateClass::setResume(const char *id) {
+  if (!id) {
+    _resumeId = emptyString;
+    return true;
+  }
+  if (!*id || strlen(id) >= UPDATE_RESUME_ID_SIZE) {
+    log_e("bad resume id");
+    return false;
+  }
+  _resumeId = id;
+  return true;
+}
+
+size_t UpdateClass::resumeOffset(String &id, int command) {
+  update_resume_t cp;
+  if (!_resumeLoad(&cp) || cp.command != (uint32_t)command) {
+    return 0;
+  }
+  id = cp.id;
+  return cp.progress;
+}
+
+void UpdateClass::clearResume() {
+  _resumeErase();
+}
+
+bool UpdateClass::_resumeBegin() {
+  update_resume_t cp;
+  if (!_resumeLoad(&cp)) {
+    return false;
+  }
+  if (_resumeId != cp.id || cp.size != _size || cp.command != _command || cp.address != _partition->address || cp.progress > _size
+      || cp.progress % SPI_FLASH_SEC_SIZE) {
+    log_d("checkpoint of another image");
+    _resumeErase();
+    return false;
+  }
+  // the written data must read back as it was hashed, the head is written by end()
+  for (uint32_t offset = 0; offset < cp.progress; offset += SPI_FLASH_SEC_SIZE) {
+    if (!ESP.partitionRead(_partition, offset, (uint32_t *)_buffer, SPI_FLASH_SEC_SIZE)) {
+      break;
+    }
+    if (!offset && _command == U_FLASH) {
+      memcpy(_buffer, cp.head, ENCRYPTED_BLOCK_SIZE);
+    }
+    _md5.add(_buffer, SPI_FLASH_SEC_SIZE);
+  }
+  MD5Builder md5 = _md5;  // _md5 goes on from here
+  uint8_t result[16];
+  md5.calculate();
+  md5.getBytes(result);
+  if (memcmp(result, cp.md5, sizeof(result))) {
+    log_w("written data does not match the checkpoint, restarting");
+    _md5.begin();
+    _resumeErase();
+    return false;
+  }
+  if (_command == U_FLASH) {
+    _skipBuffer = new (std::nothrow) uint8_t[ENCRYPTED_BLOCK_SIZE];
+    if (!_skipBuffer) {
+      log_e("_skipBuffer allocation failed");
+      _md5.begin();
+      return false;
+    }
+    memcpy(_skipBuffer, cp.head, ENCRYPTED_BLOCK_SIZE);
+  }
+  _cryptMode = cp.cryptMode;
+  _format = U_IMAGE_RAW;
+  _progress = cp.progress;
+  log_d("Resuming OTA at %u", _progress);
+  return true;
+}
+
+bool UpdateClass::_resumeSave() {
+  if (_resumeId.isEmpty() || _decoding() || (_partition->address + _progress) % SPI_FLASH_BLOCK_SIZE || _progress == _size) {
+    return true;
+  }
+  // the MD5 must cover all the data sent to the flash task
+  if (_pipeTask && !_pipelineDrain()) {
+    return false;
+  }
+  update_resume_t cp = {};
+  strncpy(cp.id, _resumeId.c_str(), sizeof(cp.id) - 1);
+  cp.size = _size;
+  cp.command = _command;
+  cp.address = _partition->address;
+  cp.progress = _progress;
+  MD5Builder md5 = _md5;
+  md5.calculate();
+  md5.getBytes(cp.md5);
+  if (_skipBuffer) {
+    memcpy(cp.head, _skipBuffer, ENCRYPTED_BLOCK_SIZE);
+  }
+  cp.cryptMode = _cryptMode;
+
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(UPDATE_RESUME_NAMESPACE, NVS_READWRITE, &handle);
+  if (err == ESP_OK) {
+    err = nvs_set_blob(handle, UPDATE_RESUME_KEY, &cp, sizeof(cp));
+    if (err == ESP_OK) {
+      err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+  }
+  if (err != ESP_OK) {
+    // the update goes on, it just can't be resumed from here
+    log_w("checkpoint not saved: %s", esp_err_to_name(err));
+  }
+  return true;
+}
+
+bool UpdateClass::setImageFormat(uint8_t format) {
+  if (format > U_IMAGE_DELTA) {
+    log_e("bad image format %u", format);
+    return false;
+  }
+  _imageFormat = format;
+  return true;
+}
+
+bool UpdateClass::_imageBegin(uint8_t first) {
+  if (_format == U_IMAGE_AUTO) {
+    if (first == (UPDATE_GZIP_MAGIC & 0xff)) {
+      _format = U_IMAGE_GZIP;
+    } else if (first == (UPDATE_DELTA_MAGIC & 0xff)) {
+      _format = U_IMAGE_DELTA;
+    } else {
+      _format = U_IMAGE_RAW;
+    }
+  }
+  if (_format == U_IMAGE_RAW) {
+    return true;
+  }
+  if (_resumeId.length()) {
+    log_w("checkpoints are for raw images only");
+  }
+  // from here, _size and _progress are the decoded image written to the partition
+  _inSize = _size;
+  _inProgress = 0;
+  _inMd5.begin();
+  _size = _partition->size;
+  if (_format == U_IMAGE_DELTA) {
+    return _deltaBegin();
+  }
+  _gzip = new (std::nothrow) UpdateGzip();
+  if (!_gzip || !_gzip->begin([this](const uint8_t *data, size_t len) {
+        return _writeInflated(data, len);
+      })) {
+    log_e("gzip decoder allocation failed");
+    _abort(UPDATE_ERROR_DECOMPRESS);
+    return false;
+  }
+  log_d("Decompressing OTA Image");
+  return true;
+}
+
+void UpdateClass::_imageEnd() {
+  delete _gzip;
+  delete _delta;
+  _gzip = nullptr;
+  _delta = nullptr;
+}
+
+bool UpdateClass::_imageFinished() const {
+  // the gzip trailer follows the end of a gzipped delta
+  return (!_gzip || _gzip->isFinished()) && (!_delta || _delta->isFinished());
+}
+
+bool UpdateClass::_deltaBegin() {
+  if (_command != U_FLASH) {
+    log_e("delta images are for U_FLASH only");
+    _abort(UPDATE_ERROR_DELTA);
+    return false;
+  }
+  const esp_partition_t *running = esp_ota_get_running_partition();
+  _delta = new (std::nothrow) UpdateDelta(
+    [running](size_t offset, uint8_t *data, size_t len) {
+      return esp_partition_read(running, offset, data, len) == ESP_OK;
+    },
+    [this](const uint8_t *data, size_t len) {
+      return _writeRaw(data, len) == len;
+    },
+    [this, running](const UpdateDelta &delta) {
+      return _deltaHeader(running, delta);
+    }
+  );
+  if (!_delta) {
+    log_e("delta decoder allocation failed");
+    _abort(UPDATE_ERROR_DELTA);
+    return false;
+  }
+  log_d("Applying OTA delta to %s", running->label);
+  return true;
+}
+
+bool UpdateClass::_deltaHeader(const esp_partition_t *running, const UpdateDelta &delta) {
+  if (!delta.newSize() || delta.newSize() > _partition->size) {
+    log_e("bad new image size %u", delta.newSize());
+    _abort(UPDATE_ERROR_SIZE);
+    return false;
+  }
+  if (delta.oldSize() > running->size) {
+    log_e("delta image was made for another firmware");
+    return false;
+  }
+  // the delta only applies to the image it was made against
+  MD5Builder md5;
+  uint8_t buf[UPDATE_DELTA_CHUNK_SIZE];
+  md5.begin();
+  for (size_t offset = 0; offset < delta.oldSize(); offset += sizeof(buf)) {
+    size_t len = (delta.oldSize() - offset < sizeof(buf)) ? delta.oldSize() - offset : sizeof(buf);
+    if (esp_partition_read(running, offset, buf, len) != ESP_OK) {
+      _abort(UPDATE_ERROR_READ);
+      return false;
+    }
+    md5.add(buf, len);
+  }
+  md5.calculate();
+  md5.getBytes(buf);
+  if (memcmp(buf, delta.oldMD5(), 16)) {
+    log_e("delta image was made for another firmware");
+    return false;
+  }
+  _size = delta.newSize();
+  return true;
+}
+
+bool UpdateClass::_writeInflated(const uint8_t *data, size_t len) {
+  // a gzipped delta image
+  if (!_delta && !_progress && !_bufferLen && _command == U_FLASH && data[0] == (UPDATE_DELTA_MAGIC & 0xff) && !_deltaBegin()) {
+    return false;
+  }
+  if (_delta) {
+    return _delta->write(data, len);
+  }
+  return _writeRaw(data, len) == len;
+}
+
+bool UpdateClass::_pipelineBegin() {
+  _pipeBuf[0] = _buffer;
+  for (uint8_t i = 1; i < _pipeBuffers; i++) {
+    _pipeBuf[i] = new (std::nothrow) uint8_t[SPI_FLASH_SEC_SIZE];
+  }
+  _pipeFree = xQueueCreate(_pipeBuffers, sizeof(uint8_t *));
+  _pipeWork = xQueueCreate(_pipeBuffers + 1, sizeof(update_pipe_item_t));
+  _pipeDone = xSemaphoreCreateBinary();
+  bool ok = _pipeFree && _pipeWork && _pipeDone;
+  for (uint8_t i = 1; ok && i < _pipeBuffers; i++) {
+    ok = _pipeBuf[i] && xQueueSend(_pipeFree, &_pipeBuf[i], 0) == pdTRUE;
+  }
+  _pipeQueued = _progress;
+  _pipeErased = _progress;
+  _pipeError = UPDATE_ERROR_OK;
+  _pipeAbort = false;
+  if (ok && xTaskCreate(_pipelineTask, "update_flash", UPDATE_PIPELINE_TASK_STACK, this, UPDATE_PIPELINE_TASK_PRIORITY, &_pipeTask) != pdPASS) {
+    _pipeTask = NULL;
+    ok = false;
+  }
+  if (!ok) {
+    // back to the synchronous mode, with _buffer only
+    for (uint8_t i = 1; i < _pipeBuffers; i++) {
+      delete[] _pipeBuf[i];
+      _pipeBuf[i] = nullptr;
+    }
+    _pipeBuf[0] = nullptr;
+    if (_pipeFree) {
+      vQueueDelete(_pipeFree);
+    }
+    if (_pipeWork) {
+      vQueueDelete(_pipeWork);
+    }
+    if (_pipeDone) {
+      vSemaphoreDelete(_pipeDone);
+    }
+    _pipeFree = _pipeWork = NULL;
+    _pipeDone = NULL;
+  }
+  return ok;
+}
+
+bool UpdateClass::_pipelineDrain() {
+  // all buffers but the one being filled come back to the free queue once written
+  uint8_t *buf[UPDATE_PIPELINE_MAX_BUFFERS];
+  for (uint8_t i = 0; i < _pipeBuffers - 1; i++) {
+    xQueueReceive(_pipeFree, &buf[i], portMAX_DELAY);
+  }
+  for (uint8_t i = 0; i < _pipeBuffers - 1; i++) {
+    xQueueSend(_pipeFree, &buf[i], 0);
+  }
+  if (_pipeError != UPDATE_ERROR_OK) {
+    _abort(_pipeError);
+    return false;
+  }
+  return true;
+}
+
+void UpdateClass::_pipelineEnd() {
+  update_pipe_item_t item = {NULL, 0, 0, 0};
+  _pipeAbort = true;
+  xQueueSend(_pipeWork, &item, portMAX_DELAY);
+  xSemaphoreTake(_pipeDone, portMAX_DELAY);
+  _pipeTask = NULL;
+  vQueueDelete(_pipeFree);
+  vQueueDelete(_pipeWork);
+  vSemaphoreDelete(_pipeDone);
+  _pipeFree = _pipeWork = NULL;
+  _pipeDone = NULL;
+  for (uint8_t i = 0; i < _pipeBuffers; i++) {
+    delete[] _pipeBuf[i];
+    _pipeBuf[i] = nullptr;
+  }
+  _buffer = nullptr;
+}
+
+bool UpdateClass::_pipelineErase() {
+  size_t offset = _partition->address + _pipeErased;
+  // whole blocks when aligned, sectors in the unaligned head and tail of the partition
+  size_t len = (offset % SPI_FLASH_BLOCK_SIZE == 0 && _size - _pipeErased >= SPI_FLASH_BLOCK_SIZE) ? SPI_FLASH_BLOCK_SIZE : SPI_FLASH_SEC_SIZE;
+  if (!ESP.partitionEraseRange(_partition, _pipeErased, len)) {
+    return false;
+  }
+  _pipeErased += len;
   return true;
 }
 
+void UpdateClass::_pipelineRun() {
+  update_pipe_item_t item;
+  for (;;) {
+    // while no buffer is waiting, erase the block following the data received so far
+    bool erase_ahead = _pipeError == UPDATE_ERROR_OK && !_pipeAbort && _pipeErased < _size && _pipeErased < _pipeQueued + SPI_FLASH_BLOCK_SIZE;
+    if (xQueueReceive(_pipeWork, &item, erase_ahead ? 0 : portMAX_DELAY) != pdTRUE) {
+      if (!_pipelineErase()) {
+        _pipeError = UPDATE_ERROR_ERASE;
+      }
+      continue;
+    }
+    if (item.data == NULL) {
+      break;
+    }
+    if (_pipeError == UPDATE_ERROR_OK && !_pipeAbort) {
+      while (_pipeErased < item.offset + item.len) {
+        if (!_pipelineErase()) {
+          _pipeError = UPDATE_ERROR_ERASE;
+          break;
+        }
+      }
+    }
+    if (_pipeError == UPDATE_ERROR_OK && !_pipeAbort) {
+      // try to skip empty blocks on unecrypted partitions
+      if ((_partition->encrypted || _chkDataInBlock(item.data + item.skip, item.len - item.skip))
+          && !ESP.partitionWrite(_partition, item.offset + item.skip, (uint32_t *)(item.data + item.skip), item.len - item.skip)) {
+        _pipeError = UPDATE_ERROR_WRITE;
+      } else {
+        _md5.add(item.data, item.len);
+      }
+    }
+    xQueueSend(_pipeFree, &item.data, portMAX_DELAY);
+  }
+  xSemaphoreGive(_pipeDone);
+}
+
+void UpdateClass::_pipelineTask(void *arg) {
+  ((UpdateClass *)arg)->_pipelineRun();
+  vTaskDelete(NULL);
+}
+
 bool UpdateClass::setupCrypt(const uint8_t *cryptKey, size_t cryptAddress, uint8_t cryptConfig, int cryptMode) {
   if (setCryptKey(cryptKey)) {
     if (setCryptMode(cryptMode)) {
@@ -220,73 +672,16 @@ bool UpdateClass::setCryptMode(const int cryptMode) {
 void UpdateClass::_abort(uint8_t err) {
   _reset();
   _error = err;
+  // only an interrupted transfer can be resumed
+  if (_resumeId.length() && err != UPDATE_ERROR_STREAM && err != UPDATE_ERROR_ABORT) {
+    _resumeErase();
+  }
 }
 
 void UpdateClass::abort() {
   _abort(UPDATE_ERROR_ABORT);
 }
 
-void UpdateClass::_cryptKeyTweak(size_t cryptAddress, uint8_t *tweaked_key) {
-  memcpy(tweaked_key, _cryptKey, ENCRYPTED_KEY_SIZE);
-  if (_cryptCfg == 0) {
-    return;  //no tweaking needed, use crypt key as-is
-  }
-
-  const uint8_t pattern[] = {23, 23, 23, 14, 23, 23, 23, 12, 23, 23, 23, 10, 23, 23, 23, 8};
-  int pattern_idx = 0;
-  int key_idx = 0;
-  int bit_len = 0;
-  uint32_t tweak = 0;
-  cryptAddress &= 0x00ffffe0;  //bit 23-5
-  cryptAddress <<= 8;          //bit23 shifted to bit31(MSB)
-  while (pattern_idx < sizeof(pattern)) {
-    tweak = cryptAddress << (23 - pattern[pattern_idx]);  //bit shift for small patterns
-    // alternative to: tweak = rotl32(tweak,8 - bit_len);
-    tweak = (tweak << (8 - bit_len)) | (tweak >> (24 + bit_len));  //rotate to line up with end of previous tweak bits
-    bit_len += pattern[pattern_idx++] - 4;                         //add number of bits in next pattern(23-4 = 19bits = 23bit to 5bit)
-    while (bit_len > 7) {
-      tweaked_key[key_idx++] ^= tweak;  //XOR byte
-      // alternative to: tweak = rotl32(tweak, 8);
-      tweak = (tweak << 8) | (tweak >> 24);  //compiler should optimize to use rotate(fast)
-      bit_len -= 8;
-    }
-    tweaked_key[key_idx] ^= tweak;  //XOR remaining bits, will XOR zeros if no remaining bits
-  }
-  if (_cryptCfg == 0xf) {
-    return;  //return with fully tweaked key
-  }
-
-  //some of tweaked key bits need to be restore back to crypt key bits
-  const uint8_t cfg_bits[] = {67, 65, 63, 61};
-  key_idx = 0;
-  pattern_idx = 0;
-  while (key_idx < ENCRYPTED_KEY_SIZE) {
-    bit_len += cfg_bits[pattern_idx];
-    if ((_cryptCfg & (1 << pattern_idx)) == 0) {  //restore crypt key bits
-      while (bit_len > 0) {
-        if (bit_len > 7 || ((_cryptCfg & (2 << pattern_idx)) == 0)) {  //restore a crypt key byte
-          tweaked_key[key_idx] = _cryptKey[key_idx];
-        } else {  //MSBits restore crypt key bits, LSBits keep as tweaked bits
-          tweaked_key[key_idx] &= (0xff >> bit_len);
-          tweaked_key[key_idx] |= (_cryptKey[key_idx] & (~(0xff >> bit_len)));
-        }
-        key_idx++;
-        bit_len -= 8;
-      }
-    } else {  //keep tweaked key bits
-      while (bit_len > 0) {
-        if (bit_len < 8 && ((_cryptCfg & (2 << pattern_idx)) == 0)) {  //MSBits keep as tweaked bits, LSBits restore crypt key bits
-          tweaked_key[key_idx] &= (~(0xff >> bit_len));
-          tweaked_key[key_idx] |= (_cryptKey[key_idx] & (0xff >> bit_len));
-        }
-        key_idx++;
-        bit_len -= 8;
-      }
-    }
-    pattern_idx++;
-  }
-}
-
 bool UpdateClass::_decryptBuffer() {
   if (!_cryptKey) {
     log_w("AES key not set");
@@ -296,47 +691,14 @@ bool UpdateClass::_decryptBuffer() {
     log_e("buffer size error");
     return false;
   }
-  if (!_cryptBuffer) {
-    _cryptBuffer = new (std::nothrow) uint8_t[ENCRYPTED_BLOCK_SIZE];
+  if (!_crypt) {
+    _crypt = new (std::nothrow) UpdateCrypt(_cryptKey, _cryptCfg);
   }
-  if (!_cryptBuffer) {
+  if (!_crypt) {
     log_e("new failed");
     return false;
   }
-  uint8_t tweaked_key[ENCRYPTED_KEY_SIZE];  //tweaked crypt key
-  int done = 0;
-
-  /*
-        Mbedtls functions will be replaced with esp_aes functions when hardware acceleration is available
-
-        To Do:
-        Replace mbedtls for the cases where there's no hardware acceleration
-     */
-
-  mbedtls_aes_context ctx;  //initialize AES
-  mbedtls_aes_init(&ctx);
-  while ((_bufferLen - done) >= ENCRYPTED_BLOCK_SIZE) {
-    for (int i = 0; i < ENCRYPTED_BLOCK_SIZE; i++) {
-      _cryptBuffer[(ENCRYPTED_BLOCK_SIZE - 1) - i] = _buffer[i + done];  //reverse order 16 bytes to decrypt
-    }
-    if (((_cryptAddress + _progress + done) % ENCRYPTED_TWEAK_BLOCK_SIZE) == 0 || done == 0) {
-      _cryptKeyTweak(_cryptAddress + _progress + done, tweaked_key);  //update tweaked crypt key
-      if (mbedtls_aes_setkey_enc(&ctx, tweaked_key, 256)) {
-        return false;
-      }
-      if (mbedtls_aes_setkey_dec(&ctx, tweaked_key, 256)) {
-        return false;
-      }
-    }
-    if (mbedtls_aes_crypt_ecb(&ctx, MBEDTLS_AES_ENCRYPT, _cryptBuffer, _cryptBuffer)) {  //use MBEDTLS_AES_ENCRYPT to decrypt flash code
-      return false;
-    }
-    for (int i = 0; i < ENCRYPTED_BLOCK_SIZE; i++) {
-      _buffer[i + done] = _cryptBuffer[(ENCRYPTED_BLOCK_SIZE - 1) - i];  //reverse order 16 bytes from decrypt
-    }
-    done += ENCRYPTED_BLOCK_SIZE;
-  }
-  return true;
+  return _crypt->decrypt(_cryptAddress + _progress, _buffer, _bufferLen);
 }
 
 bool UpdateClass::_writeBuffer() {
@@ -376,7 +738,27 @@ bool UpdateClass::_writeBuffer() {
     memcpy(_skipBuffer, _buffer, skip);
   }
   if (!_progress && _progress_callback) {
-    _progress_callback(0, _size);
+    _progress_callback(0, size());
+  }
+  if (_pipeTask) {
+    // hand the buffer over to the flash task and go on with the next free one
+    if (_pipeError != UPDATE_ERROR_OK) {
+      _abort(_pipeError);
+      return false;
+    }
+    update_pipe_item_t item = {_buffer, _progress, (uint16_t)_bufferLen, skip};
+    _pipeQueued = _progress + _bufferLen;
+    xQueueSend(_pipeWork, &item, portMAX_DELAY);
+    xQueueReceive(_pipeFree, &_buffer, portMAX_DELAY);
+    _progress += _bufferLen;
+    _bufferLen = 0;
+    if (!_resumeSave()) {
+      return false;
+    }
+    if (_progress_callback) {
+      _progress_callback(progress(), size());
+    }
+    return true;
   }
   size_t offset = _partition->address + _progress;
   bool block_erase =
@@ -407,8 +789,9 @@ bool UpdateClass::_writeBuffer() {
   _md5.add(_buffer, _bufferLen);
   _progress += _bufferLen;
   _bufferLen = 0;
+  _resumeSave();
   if (_progress_callback) {
-    _progress_callback(_progress, _size);
+    _progress_callback(progress(), size());
   }
   return true;
 }
@@ -466,21 +849,50 @@ bool UpdateClass::end(bool evenIfRemaining) {
     return false;
   }
 
-  if (evenIfRemaining) {
+  bool decoding = _decoding();
+  if (decoding) {
+    if (!_imageFinished()) {
+      log_e("truncated image");
+      _abort(_delta ? UPDATE_ERROR_DELTA : UPDATE_ERROR_DECOMPRESS);
+      return false;
+    }
+    // the decoded size is known only now
+    if (_bufferLen > 0 && !_writeBuffer()) {
+      return false;
+    }
+    _size = _progress;
+  } else if (evenIfRemaining) {
     if (_bufferLen > 0) {
       _writeBuffer();
     }
     _size = progress();
   }
 
+  if (_pipeTask && !_pipelineDrain()) {
+    return false;
+  }
+
   _md5.calculate();
+  if (decoding) {
+    uint8_t md5[16];
+    _md5.getBytes(md5);
+    if (_delta && memcmp(md5, _delta->newMD5(), sizeof(md5))) {
+      log_e("patched image MD5 mismatch");
+      _abort(UPDATE_ERROR_DELTA);
+      return false;
+    }
+    _inMd5.calculate();
+  }
   if (_target_md5.length()) {
-    if (_target_md5 != _md5.toString()) {
+    if (_target_md5 != (decoding ? _inMd5.toString() : _md5.toString())) {
       _abort(UPDATE_ERROR_MD5);
       return false;
     }
   }
 
+  if (_resumeId.length()) {
+    _resumeErase();
+  }
   return _verifyEnd();
 }
 
@@ -489,11 +901,40 @@ size_t UpdateClass::write(uint8_t *data, size_t len) {
     return 0;
   }
 
+  if (len && _format != U_IMAGE_RAW && !_decoding() && !_imageBegin(data[0])) {
+    return 0;
+  }
+
   if (len > remaining()) {
     _abort(UPDATE_ERROR_SPACE);
     return 0;
   }
 
+  if (!_decoding()) {
+    return _writeRaw(data, len);
+  }
+
+  _inMd5.add(data, len);
+  _inProgress += len;
+  _decoderBusy = true;
+  bool ok = _gzip ? _gzip->write(data, len) : _delta->write(data, len);
+  _decoderBusy = false;
+  if (!ok) {
+    if (!hasError()) {
+      _abort((_delta && _delta->hasError()) ? UPDATE_ERROR_DELTA : UPDATE_ERROR_DECOMPRESS);
+    }
+    _imageEnd();  // aborted by a decoder handler
+    return 0;
+  }
+  return len;
+}
+
+size_t UpdateClass::_writeRaw(const uint8_t *data, size_t len) {
+  if (len > _size - _progress) {
+    _abort(UPDATE_ERROR_SPACE);
+    return 0;
+  }
+
   size_t left = len;
 
   while ((_bufferLen + left) > SPI_FLASH_SEC_SIZE) {
@@ -507,7 +948,7 @@ size_t UpdateClass::write(uint8_t *data, size_t len) {
   }
   memcpy(_buffer + _bufferLen, data + (len - left), left);
   _bufferLen += left;
-  if (_bufferLen == remaining()) {
+  if (_bufferLen == _size - _progress) {
     if (!_writeBuffer()) {
       return len - left;
     }
@@ -524,7 +965,15 @@ size_t UpdateClass::writeStream(Stream &data) {
     return 0;
   }
 
-  if (!_verifyHeader(data.peek())) {
+  if (_format != U_IMAGE_RAW && !_decoding() && !_imageBegin(data.peek())) {
+    return 0;
+  }
+  if (_decoding()) {
+    return _writeStreamDecoded(data);
+  }
+
+  // a resumed update continues in the middle of the image
+  if (!_progress && !_bufferLen && !_verifyHeader(data.peek())) {
     _reset();
     return 0;
   }
@@ -576,6 +1025,46 @@ size_t UpdateClass::writeStream(Stream &data) {
   return written;
 }
 
+size_t UpdateClass::_writeStreamDecoded(Stream &data) {
+  uint8_t chunk[512];
+  size_t written = 0;
+  int timeout_failures = 0;
+
+  if (_ledPin != -1) {
+    pinMode(_ledPin, OUTPUT);
+  }
+  // a compressed image ends by itself, before remaining() when the size was unknown
+  while (remaining() && !_imageFinished()) {
+    if (_ledPin != -1) {
+      digitalWrite(_ledPin, _ledOn);  // Switch LED on
+    }
+    size_t toRead = (remaining() < sizeof(chunk)) ? remaining() : sizeof(chunk);
+    toRead = data.readBytes(chunk, toRead);
+    if (_ledPin != -1) {
+      digitalWrite(_ledPin, !_ledOn);  // Switch LED off
+    }
+    if (toRead == 0) {
+      // same 30 sec timeout as writeStream()
+      if (++timeout_failures >= 300) {
+        _abort(UPDATE_ERROR_STREAM);
+        return written;
+      }
+      delay(100);
+      continue;
+    }
+    timeout_failures = 0;
+    if (write(chunk, toRead) != toRead) {
+      return written;
+    }
+    written += toRead;
+
+#if CONFIG_FREERTOS_UNICORE
+    delay(1);  // Fix solo WDT
+#endif
+  }
+  return written;
+}
+
 void UpdateClass::printError(Print &out) {
   out.println(_err2str(_error));
 }
@@ -22,8 +22,6 @@
 
 #include <Arduino.h>
 #include <esp32-hal-log.h>
-#include <libb64/cdecode.h>
-#include <libb64/cencode.h>
 #include "esp_random.h"
 #include "NetworkServer.h"
 #include "NetworkClient.h"
@@ -164,13 +162,16 @@ bool WebServer::authenticate(THandlerFunctionAuthCheck fn) {
     authReq.trim();
 
     /* base64 encoded string is always shorter (or equal) in length */
-    char *decoded = (authReq.length() < HTTP_MAX_BASIC_AUTH_LEN) ? new char[authReq.length()] : NULL;
+    char *decoded = (authReq.length() < HTTP_MAX_BASIC_AUTH_LEN) ? new char[authReq.length() + 1] : NULL;
     if (decoded) {
       char *p;
-      if (base64_decode_chars(authReq.c_str(), authReq.length(), decoded) && (p = index(decoded, ':')) && p) {
+      int len = base64::decode(authReq.c_str(), authReq.length(), (uint8_t *)decoded, authReq.length());
+      if (len > 0) {
+        decoded[len] = '\0';
+      }
+      if (len > 0 && (p = index(decoded, ':')) && p) {
         authReq = "";
         /* Note: rfc7617 guarantees that there will not be an escaped colon in the username itself.
-         * Note:  base64_decode_chars() guarantees a terminating \0
          */
         *p = '\0';
         char *_username = decoded, *_password = p + 1;
@@ -193,7 +193,11 @@ public:
     calcMD5.getBytes(md5_buf);
     f.close();
     // create a minimal-length eTag using base64 byte[]->text encoding.
-    result = "\"" + base64::encode(md5_buf, 16) + "\"";
+    char etag[24 + 3] = "\"";
+    size_t len = base64::encode(md5_buf, 16, etag + 1, sizeof(etag) - 2);
+    etag[len + 1] = '\"';
+    etag[len + 2] = '\0';
+    result = etag;
     return (result);
   }  // calcETag
 
@@ -0,0 +1,193 @@
+/* base64 test
+ *
+ * Checks the base64 codec against the RFC 4648 test vectors and libb64, in both
+ * alphabets, through caller buffers, String, Print and the streaming classes,
+ * and prints its throughput next to the one of libb64.
+ */
+
+#include <unity.h>
+#include <StreamString.h>
+#include <base64.h>
+extern "C" {
+#include "libb64/cdecode.h"
+#include "libb64/cencode.h"
+}
+
+#define MAX_LEN    200
+#define BENCH_SIZE 3072  // multiple of 3 and 4
+#define BENCH_RUNS 100
+
+static const char *rfc_plain[] = {"", "f", "fo", "foo", "foob", "fooba", "foobar"};
+static const char *rfc_base64[] = {"", "Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy"};
+static const char *rfc_base64url[] = {"", "Zg", "Zm8", "Zm9v", "Zm9vYg", "Zm9vYmE", "Zm9vYmFy"};
+
+static uint8_t data[MAX_LEN];
+static char encoded[MAX_LEN * 2];
+static uint8_t decoded[MAX_LEN];
+
+static size_t libb64_encode(const uint8_t *in, size_t len, char *out) {
+  base64_encodestate state;
+  base64_init_encodestate(&state);
+  int n = base64_encode_block((const char *)in, len, out, &state);
+  n += base64_encode_blockend(out + n, &state);
+  out[n] = '\0';
+  return n;
+}
+
+void setUp(void) {
+  for (size_t i = 0; i < MAX_LEN; i++) {
+    data[i] = i * 151 + 7;
+  }
+}
+
+void tearDown(void) {}
+
+void test_rfc_vectors(void) {
+  for (size_t i = 0; i < sizeof(rfc_plain) / sizeof(rfc_plain[0]); i++) {
+    size_t len = strlen(rfc_plain[i]);
+    TEST_ASSERT_EQUAL_STRING(rfc_base64[i], base64::encode(String(rfc_plain[i])).c_str());
+    TEST_ASSERT_EQUAL_STRING(rfc_base64url[i], base64::encode(String(rfc_plain[i]), base64::URL).c_str());
+    TEST_ASSERT_EQUAL(strlen(rfc_base64[i]), base64::encodedLength(len));
+    TEST_ASSERT_EQUAL(strlen(rfc_base64url[i]), base64::encodedLength(len, base64::URL));
+
+    TEST_ASSERT_EQUAL(len, base64::decode(rfc_base64[i], strlen(rfc_base64[i]), decoded, sizeof(decoded)));
+    TEST_ASSERT_EQUAL_MEMORY(rfc_plain[i], decoded, len);
+    TEST_ASSERT_EQUAL(len, base64::decode(rfc_base64url[i], strlen(rfc_base64url[i]), decoded, sizeof(decoded)));
+    TEST_ASSERT_EQUAL_MEMORY(rfc_plain[i], decoded, len);
+  }
+
+  const uint8_t url_bytes[] = {0xfb, 0xff, 0xbf};
+  TEST_ASSERT_EQUAL_STRING("-_-_", base64::encode(url_bytes, sizeof(url_bytes), base64::URL).c_str());
+  TEST_ASSERT_EQUAL_STRING("+/+/", base64::encode(url_bytes, sizeof(url_bytes)).c_str());
+}
+
+void test_libb64(void) {
+  char expected[MAX_LEN * 2];
+  for (size_t len = 0; len <= MAX_LEN; len++) {
+    size_t n = libb64_encode(data, len, expected);
+    TEST_ASSERT_EQUAL(n, base64::encode(data, len, encoded, sizeof(encoded)));
+    TEST_ASSERT_EQUAL_STRING(expected, encoded);
+    TEST_ASSERT_EQUAL_STRING(expected, base64::encode(data, len).c_str());
+
+    StreamString printed;
+    TEST_ASSERT_TRUE(base64::encode(data, len, printed));
+    TEST_ASSERT_EQUAL_STRING(expected, printed.c_str());
+
+    memset(decoded, 0, sizeof(decoded));
+    TEST_ASSERT_EQUAL(len, base64::decode(encoded, n, decoded, len));
+    TEST_ASSERT_EQUAL_MEMORY(data, decoded, len);
+
+    n = base64::encode(data, len, encoded, sizeof(encoded), base64::URL);
+    TEST_ASSERT_EQUAL(len, base64::decode(encoded, n, decoded, len));
+    TEST_ASSERT_EQUAL_MEMORY(data, decoded, len);
+  }
+}
+
+void test_errors(void) {
+  TEST_ASSERT_EQUAL(0, base64::encode(data, 3, encoded, 4));  // no room for the '\0'
+  TEST_ASSERT_EQUAL(4, base64::encode(data, 3, encoded, 5));
+  TEST_ASSERT_EQUAL(-1, base64::decode("Zm9v", 4, decoded, 2));
+  TEST_ASSERT_EQUAL(-1, base64::decode("Zm9vY", 5, decoded, sizeof(decoded)));
+  TEST_ASSERT_EQUAL(-1, base64::decode("Zm9v*mFy", 8, decoded, sizeof(decoded)));
+  TEST_ASSERT_EQUAL(-1, base64::decode("Zg==Zm9v", 8, decoded, sizeof(decoded)));
+  TEST_ASSERT_EQUAL(-1, base64::decode("Zm9v\nYmF", 8, decoded, sizeof(decoded)));
+
+  StreamString out;
+  base64::Decoder decoder(out);
+  decoder.write("Zg==Zg");
+  TEST_ASSERT_TRUE(decoder.hasError());
+  TEST_ASSERT_FALSE(decoder.end());
+  decoder.write("Z");
+  TEST_ASSERT_FALSE(decoder.end());
+}
+
+void test_streaming(void) {
+  for (base64::alphabet_t alphabet : {base64::STANDARD, base64::URL}) {
+    for (size_t len = 0; len <= MAX_LEN; len += 13) {
+      size_t n = base64::encode(data, len, encoded, sizeof(encoded), alphabet);
+      for (size_t step = 1; step <= 17; step += 4) {
+        StreamString out;
+        base64::Encoder encoder(out, alphabet);
+        for (size_t i = 0; i < len; i += step) {
+          encoder.write(data + i, min(step, len - i));
+          encoder.print("");  // nothing to encode, with a tail pending
+        }
+        TEST_ASSERT_TRUE(encoder.end());
+        TEST_ASSERT_EQUAL_STRING(encoded, out.c_str());
+
+        // line breaks every 76 characters, as in MIME
+        String wrapped;
+        for (size_t i = 0; i < n; i += 76) {
+          wrapped += String(encoded).substring(i, i + 76) + "\r\n";
+        }
+        StreamString plain;
+        base64::Decoder decoder(plain);
+        for (size_t i = 0; i < wrapped.length(); i += step) {
+          decoder.write((const uint8_t *)wrapped.c_str() + i, min(step, wrapped.length() - i));
+        }
+        TEST_ASSERT_TRUE(decoder.end());
+        TEST_ASSERT_EQUAL(len, plain.length());
+        TEST_ASSERT_EQUAL_MEMORY(data, plain.c_str(), len);
+      }
+    }
+  }
+}
+
+void test_throughput(void) {
+  uint8_t *in = (uint8_t *)malloc(BENCH_SIZE + 1);  // libb64 ends the decoded data with a NUL
+  char *text = (char *)malloc(BENCH_SIZE * 2);
+  TEST_ASSERT_NOT_NULL(in);
+  TEST_ASSERT_NOT_NULL(text);
+  for (size_t i = 0; i < BENCH_SIZE; i++) {
+    in[i] = i * 151 + 7;
+  }
+
+  uint32_t start = micros();
+  for (int i = 0; i < BENCH_RUNS; i++) {
+    base64_encode_chars((const char *)in, BENCH_SIZE, text);
+  }
+  uint32_t libb64_encode_us = micros() - start;
+
+  start = micros();
+  for (int i = 0; i < BENCH_RUNS; i++) {
+    base64::encode(in, BENCH_SIZE, text, BENCH_SIZE * 2);
+  }
+  uint32_t encode_us = micros() - start;
+
+  size_t text_len = strlen(text);
+  start = micros();
+  for (int i = 0; i < BENCH_RUNS; i++) {
+    base64_decode_chars(text, text_len, (char *)in);
+  }
+  uint32_t libb64_decode_us = micros() - start;
+
+  start = micros();
+  for (int i = 0; i < BENCH_RUNS; i++) {
+    base64::decode(text, text_len, in, BENCH_SIZE);
+  }
+  uint32_t decode_us = micros() - start;
+
+  float bytes = (float)BENCH_SIZE * BENCH_RUNS;
+  Serial.printf("encode: libb64 %.2f MB/s, base64 %.2f MB/s\n", bytes / libb64_encode_us, bytes / encode_us);
+  Serial.printf("decode: libb64 %.2f MB/s, base64 %.2f MB/s\n", bytes / libb64_decode_us, bytes / decode_us);
+  TEST_ASSERT_EQUAL(BENCH_SIZE, base64::decode(text, text_len, in, BENCH_SIZE));
+  free(in);
+  free(text);
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(test_rfc_vectors);
+  RUN_TEST(test_libb64);
+  RUN_TEST(test_errors);
+  RUN_TEST(test_streaming);
+  RUN_TEST(test_throughput);
+  UNITY_END();
+}
+
+void loop() {}
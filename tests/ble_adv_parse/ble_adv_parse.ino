@@ -0,0 +1,203 @@
+/* BLE advertisement parsing test
+ *
+ * Checks BLEAdvertisementView and the fields BLEAdvertisedDevice decodes from
+ * it over captured advertising payloads: an iBeacon, an Eddystone URL beacon
+ * and a named device with its scan response, plus padded and truncated
+ * payloads. Then prints how many payloads per second are indexed by the view
+ * and turned into a BLEAdvertisedDevice.
+ */
+
+#include <unity.h>
+#include "soc/soc_caps.h"
+#include "sdkconfig.h"
+
+#if SOC_BLE_SUPPORTED && defined(CONFIG_BLUEDROID_ENABLED)
+#include <BLEScanReport.h>
+#include <BLEAdvertisedDevice.h>
+
+#define BENCH_PAYLOADS 30000
+
+static const uint8_t address[ESP_BD_ADDR_LEN] = {0xC0, 0x01, 0x02, 0x03, 0x04, 0x05};
+
+static const uint8_t ibeacon[] = {0x02, 0x01, 0x06, 0x1A, 0xFF, 0x4C, 0x00, 0x02, 0x15, 0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7,
+                                  0xE8, 0xE9, 0xEA, 0xEB, 0xEC, 0xED, 0xEE, 0xEF, 0xF0, 0xF1, 0x00, 0x01, 0x00, 0x02, 0xC5};
+
+static const uint8_t eddystone_url[] = {0x02, 0x01, 0x06, 0x03, 0x03, 0xAA, 0xFE, 0x0D, 0x16, 0xAA, 0xFE,
+                                        0x10, 0xEB, 0x03, 0x67, 0x6F, 0x6F, 0x67, 0x6C, 0x65, 0x07};
+
+// advertising data with a 128 bit service UUID, scan response with the name, TX power and appearance
+static const uint8_t named[] = {0x02, 0x01, 0x06, 0x11, 0x07, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D,
+                                0x0E, 0x0F, 0x09, 0x09, 0x45, 0x53, 0x50, 0x33, 0x32, 0x2D, 0x42, 0x4C, 0x02, 0x0A, 0xF4, 0x03, 0x19, 0xC1, 0x03};
+
+static BLEAdvertisedDevice makeDevice(const uint8_t *payload, size_t length) {
+  return BLEScanReport(address, BLE_ADDR_TYPE_PUBLIC, -60, 0, payload, length, 0).toAdvertisedDevice();
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_view(void) {
+  BLEAdvertisementView view(ibeacon, sizeof(ibeacon));
+  TEST_ASSERT_EQUAL(2, view.getCount());
+  TEST_ASSERT_EQUAL(ESP_BLE_AD_TYPE_FLAG, view.getType(0));
+  TEST_ASSERT_EQUAL(ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE, view.getType(1));
+  TEST_ASSERT_EQUAL(1, view.find(ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE));
+  TEST_ASSERT_EQUAL(-1, view.find(ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE, 2));
+  TEST_ASSERT_EQUAL(-1, view.find(ESP_BLE_AD_TYPE_NAME_CMPL));
+
+  size_t length;
+  const uint8_t *data = view.findData(ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE, &length);
+  TEST_ASSERT_EQUAL_PTR(ibeacon + 5, data);  // no copy
+  TEST_ASSERT_EQUAL(25, length);
+  TEST_ASSERT_NULL(view.findData(ESP_BLE_AD_TYPE_NAME_CMPL, &length));
+  TEST_ASSERT_EQUAL(0, length);
+}
+
+void test_service_uuids(void) {
+  BLEAdvertisementView view(named, sizeof(named));
+  TEST_ASSERT_EQUAL(5, view.getCount());
+  TEST_ASSERT_EQUAL(1, view.getServiceUUIDCount());
+  size_t size;
+  TEST_ASSERT_EQUAL_PTR(named + 5, view.getServiceUUID(0, &size));
+  TEST_ASSERT_EQUAL(16, size);
+  TEST_ASSERT_NULL(view.getServiceUUID(1, &size));
+
+  size_t uuidSize;
+  BLEAdvertisementView eddystone(eddystone_url, sizeof(eddystone_url));
+  TEST_ASSERT_EQUAL(1, eddystone.getServiceDataCount());
+  const uint8_t *data = eddystone.getServiceData(0, &uuidSize, &size);
+  TEST_ASSERT_EQUAL_PTR(eddystone_url + 9, data);
+  TEST_ASSERT_EQUAL(2, uuidSize);
+  TEST_ASSERT_EQUAL(10, size);
+}
+
+void test_padding_truncated(void) {
+  // zero length padding between the structures, and a last structure longer than the payload
+  static const uint8_t payload[] = {0x00, 0x02, 0x01, 0x06, 0x00, 0x00, 0x03, 0x09, 'a', 'b', 0x05, 0xFF, 0x01};
+  BLEAdvertisementView view(payload, sizeof(payload));
+  TEST_ASSERT_EQUAL(2, view.getCount());
+  size_t length;
+  const uint8_t *name = view.findData(ESP_BLE_AD_TYPE_NAME_CMPL, &length);
+  TEST_ASSERT_EQUAL(2, length);
+  TEST_ASSERT_EQUAL_MEMORY("ab", name, 2);
+  TEST_ASSERT_EQUAL(-1, view.find(ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE));
+
+  BLEAdvertisementView empty(payload, 0);
+  TEST_ASSERT_EQUAL(0, empty.getCount());
+}
+
+void test_device_fields(void) {
+  BLEAdvertisedDevice device = makeDevice(named, sizeof(named));
+  TEST_ASSERT_TRUE(device.haveName());
+  TEST_ASSERT_EQUAL_STRING("ESP32-BL", device.getName().c_str());
+  TEST_ASSERT_TRUE(device.haveTXPower());
+  TEST_ASSERT_EQUAL(-12, device.getTXPower());
+  TEST_ASSERT_TRUE(device.haveAppearance());
+  TEST_ASSERT_EQUAL(0x03C1, device.getAppearance());
+  TEST_ASSERT_TRUE(device.haveServiceUUID());
+  TEST_ASSERT_EQUAL(1, device.getServiceUUIDCount());
+  TEST_ASSERT_EQUAL_STRING("0f0e0d0c-0b0a-0908-0706-050403020100", device.getServiceUUID().toString().c_str());
+  TEST_ASSERT_TRUE(device.isAdvertisingService(BLEUUID("0f0e0d0c-0b0a-0908-0706-050403020100")));
+  TEST_ASSERT_FALSE(device.haveManufacturerData());
+  TEST_ASSERT_FALSE(device.haveServiceData());
+  TEST_ASSERT_EQUAL(BLE_UNKNOWN_FRAME, device.getFrameType());
+
+  device = makeDevice(ibeacon, sizeof(ibeacon));
+  TEST_ASSERT_FALSE(device.haveName());
+  TEST_ASSERT_EQUAL_STRING("", device.getName().c_str());
+  TEST_ASSERT_TRUE(device.haveManufacturerData());
+  String manufacturerData = device.getManufacturerData();
+  TEST_ASSERT_EQUAL(25, manufacturerData.length());
+  TEST_ASSERT_EQUAL_MEMORY(ibeacon + 5, manufacturerData.c_str(), 25);
+
+  device = makeDevice(eddystone_url, sizeof(eddystone_url));
+  TEST_ASSERT_EQUAL(BLE_EDDYSTONE_URL_FRAME, device.getFrameType());
+  TEST_ASSERT_EQUAL(1, device.getServiceUUIDCount());
+  TEST_ASSERT_EQUAL_STRING("0000feaa-0000-1000-8000-00805f9b34fb", device.getServiceUUID().toString().c_str());
+  TEST_ASSERT_EQUAL(1, device.getServiceDataCount());
+  TEST_ASSERT_EQUAL_STRING("0000feaa-0000-1000-8000-00805f9b34fb", device.getServiceDataUUID().toString().c_str());
+  TEST_ASSERT_EQUAL(10, device.getServiceData().length());
+}
+
+void test_device_owns_payload(void) {
+  uint8_t payload[sizeof(named)];
+  memcpy(payload, named, sizeof(named));
+  BLEAdvertisedDevice device = makeDevice(payload, sizeof(payload));
+  memset(payload, 0, sizeof(payload));  // like the GAP event data after the callback
+  BLEAdvertisedDevice copy = device;
+  TEST_ASSERT_EQUAL_STRING("ESP32-BL", copy.getName().c_str());
+  TEST_ASSERT_EQUAL(sizeof(named), copy.getPayloadLength());
+}
+
+void test_benchmark(void) {
+  static const uint8_t *payloads[] = {ibeacon, eddystone_url, named};
+  static const size_t lengths[] = {sizeof(ibeacon), sizeof(eddystone_url), sizeof(named)};
+  size_t found = 0;
+
+  uint32_t start = micros();
+  for (uint32_t i = 0; i < BENCH_PAYLOADS; i++) {
+    BLEAdvertisementView view(payloads[i % 3], lengths[i % 3]);
+    size_t length;
+    if (view.findData(ESP_BLE_AD_TYPE_NAME_CMPL, &length)) {
+      found++;
+    }
+  }
+  uint32_t us = micros() - start;
+  Serial.printf("view:   %.0f payloads/s\n", BENCH_PAYLOADS * 1e6f / us);
+  TEST_ASSERT_EQUAL(BENCH_PAYLOADS / 3, found);
+
+  found = 0;
+  start = micros();
+  for (uint32_t i = 0; i < BENCH_PAYLOADS; i++) {
+    BLEAdvertisedDevice device = makeDevice(payloads[i % 3], lengths[i % 3]);
+    if (device.haveName()) {
+      found++;
+    }
+  }
+  us = micros() - start;
+  Serial.printf("device: %.0f payloads/s\n", BENCH_PAYLOADS * 1e6f / us);
+  TEST_ASSERT_EQUAL(BENCH_PAYLOADS / 3, found);
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(test_view);
+  RUN_TEST(test_service_uuids);
+  RUN_TEST(test_padding_truncated);
+  RUN_TEST(test_device_fields);
+  RUN_TEST(test_device_owns_payload);
+  RUN_TEST(test_benchmark);
+  UNITY_END();
+}
+
+#else
+//PASS TEST for UNSUPPORTED CHIPS
+
+void test_pass(void) {
+  TEST_ASSERT_EQUAL(1, 1);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(test_pass);
+  UNITY_END();
+}
+
+#endif
+
+void loop() {}
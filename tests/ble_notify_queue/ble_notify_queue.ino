@@ -0,0 +1,232 @@
+/* BLE notify queue test
+ *
+ * Checks BLENotifyQueue, the queue behind BLECharacteristic::notifyAsync():
+ * the ring buffer against a reference queue of random messages and
+ * notification lengths, the messages pushed while a notification is being
+ * sent, and the pacing of the sending by credits and congestion.
+ */
+
+#include <unity.h>
+#include "soc/soc_caps.h"
+#include "sdkconfig.h"
+
+#if SOC_BLE_SUPPORTED && defined(CONFIG_BLUEDROID_ENABLED)
+#include <deque>
+#include <vector>
+#include <BLENotifyQueue.h>
+
+#define ROUNDS     50
+#define OPERATIONS 2000
+
+static uint8_t notification[600];
+
+void setUp(void) {
+  srand(1);
+}
+
+void tearDown(void) {}
+
+// the next notification of a reference queue, as BLENotifyQueue gathers it
+static size_t takeReference(std::deque<std::vector<uint8_t>> &messages, size_t *offset, size_t maxLength, std::vector<uint8_t> &out) {
+  out.clear();
+  while (!messages.empty()) {
+    std::vector<uint8_t> &message = messages.front();
+    size_t left = message.size() - *offset;
+    if (left <= maxLength - out.size()) {
+      out.insert(out.end(), message.begin() + *offset, message.end());
+      messages.pop_front();
+      *offset = 0;
+    } else {
+      if (out.empty()) {  // longer than a notification
+        out.insert(out.end(), message.begin() + *offset, message.begin() + *offset + maxLength);
+        *offset += maxLength;
+      }
+      break;
+    }
+  }
+  return out.size();
+}
+
+void test_ring(void) {
+  for (int round = 0; round < ROUNDS; round++) {
+    BLENotifyQueue queue(0, 64 + rand() % 3000);
+    std::deque<std::vector<uint8_t>> messages;
+    std::vector<uint8_t> expected;
+    size_t offset = 0;
+    uint32_t queued = 0, dropped = 0, pending = 0;
+    uint8_t counter = 0;
+
+    for (int i = 0; i < OPERATIONS; i++) {
+      if (rand() % 2) {
+        // mostly short messages, some longer than a notification
+        std::vector<uint8_t> message(1 + rand() % (rand() % 4 ? 40 : 700));
+        for (uint8_t &byte : message) {
+          byte = counter++;
+        }
+        if (queue.push(message.data(), message.size())) {
+          messages.push_back(message);
+          queued++;
+          pending += message.size();
+        } else {
+          dropped++;
+        }
+      } else {
+        size_t maxLength = 20 + rand() % (sizeof(notification) - 20);
+        size_t length = queue.peek(notification, maxLength);
+        TEST_ASSERT_EQUAL(takeReference(messages, &offset, maxLength, expected), length);
+        if (length) {
+          TEST_ASSERT_EQUAL_MEMORY(expected.data(), notification, length);
+        }
+        TEST_ASSERT_EQUAL(length, queue.peek(notification, maxLength));
+        queue.consume(length);
+        pending -= length;
+      }
+      TEST_ASSERT_EQUAL(pending, queue.getPending());
+    }
+
+    ble_notify_stats_t stats;
+    queue.getStats(&stats);
+    TEST_ASSERT_EQUAL(queued, stats.queued);
+    TEST_ASSERT_EQUAL(dropped, stats.dropped);
+  }
+}
+
+void test_push_while_sending(void) {
+  BLENotifyQueue queue(0, 256);
+  TEST_ASSERT_TRUE(queue.push((const uint8_t *)"first", 5));
+  TEST_ASSERT_EQUAL(5, queue.peek(notification, 20));
+  // pushed while the notification is handed to the stack, it would fit in the same one
+  TEST_ASSERT_TRUE(queue.push((const uint8_t *)"second", 6));
+  queue.consume(5);
+  TEST_ASSERT_EQUAL(6, queue.getPending());
+  TEST_ASSERT_EQUAL(6, queue.peek(notification, 20));
+  TEST_ASSERT_EQUAL_MEMORY("second", notification, 6);
+
+  // the rest of a message longer than a notification
+  uint8_t message[50];
+  for (size_t i = 0; i < sizeof(message); i++) {
+    message[i] = i;
+  }
+  queue.consume(6);
+  TEST_ASSERT_TRUE(queue.push(message, sizeof(message)));
+  TEST_ASSERT_EQUAL(20, queue.peek(notification, 20));
+  queue.consume(20);
+  TEST_ASSERT_EQUAL(20, queue.peek(notification, 20));
+  queue.consume(20);
+  TEST_ASSERT_EQUAL(10, queue.peek(notification, 20));
+  TEST_ASSERT_TRUE(queue.push(message, 5));
+  queue.consume(10);
+  TEST_ASSERT_EQUAL(5, queue.getPending());
+  TEST_ASSERT_EQUAL(5, queue.peek(notification, 20));
+  TEST_ASSERT_EQUAL_MEMORY(message, notification, 5);
+}
+
+void test_credits(void) {
+  BLENotifyQueue queue(0, 256, 2);
+  ble_notify_stats_t stats;
+  TEST_ASSERT_FALSE(queue.canSend());  // empty
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_TRUE(queue.push((const uint8_t *)"0123456789", 10));
+  }
+
+  // one credit per notification handed to the stack
+  for (int i = 0; i < 2; i++) {
+    TEST_ASSERT_TRUE(queue.canSend());
+    queue.onSent(queue.peek(notification, 10));
+    queue.consume(10);
+  }
+  TEST_ASSERT_FALSE(queue.canSend());
+
+  // a notification refused by the stack gives its credit back at once
+  queue.onConfirm(true);
+  TEST_ASSERT_TRUE(queue.canSend());
+  queue.onSent(queue.peek(notification, 10));
+  TEST_ASSERT_FALSE(queue.canSend());
+  queue.onSendFailed(10);
+  TEST_ASSERT_TRUE(queue.canSend());
+  queue.getStats(&stats);
+  TEST_ASSERT_EQUAL(2, stats.sent);
+  TEST_ASSERT_EQUAL(20, stats.sentBytes);
+  TEST_ASSERT_EQUAL(20, stats.pending);
+
+  // the credits do not grow past their number
+  queue.onConfirm(false);
+  queue.onConfirm(true);
+  queue.onConfirm(true);
+  for (int i = 0; i < 2; i++) {
+    TEST_ASSERT_TRUE(queue.canSend());
+    queue.onSent(queue.peek(notification, 10));
+    queue.consume(10);
+  }
+  TEST_ASSERT_EQUAL(0, queue.getPending());
+  TEST_ASSERT_TRUE(queue.push((const uint8_t *)"0123456789", 10));
+  TEST_ASSERT_FALSE(queue.canSend());
+  queue.getStats(&stats);
+  TEST_ASSERT_EQUAL(4, stats.sent);
+  TEST_ASSERT_EQUAL(1, stats.failed);
+
+  // nothing is sent while the connection is congested
+  queue.onConfirm(true);
+  queue.setCongested(true);
+  queue.setCongested(true);
+  TEST_ASSERT_FALSE(queue.canSend());
+  queue.setCongested(false);
+  TEST_ASSERT_TRUE(queue.canSend());
+  queue.getStats(&stats);
+  TEST_ASSERT_EQUAL(1, stats.congestions);
+}
+
+void test_full(void) {
+  BLENotifyQueue queue(0, 64);
+  uint8_t message[40] = {0};
+  TEST_ASSERT_TRUE(queue.push(message, 40));
+  TEST_ASSERT_FALSE(queue.push(message, 40));  // 2 bytes of header per message
+  TEST_ASSERT_TRUE(queue.push(message, 20));
+  TEST_ASSERT_FALSE(queue.push(message, 1));
+  TEST_ASSERT_TRUE(queue.push(message, 0));  // nothing to queue
+  ble_notify_stats_t stats;
+  queue.getStats(&stats);
+  TEST_ASSERT_EQUAL(2, stats.queued);
+  TEST_ASSERT_EQUAL(2, stats.dropped);
+  TEST_ASSERT_EQUAL(60, stats.pending);
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(test_ring);
+  RUN_TEST(test_push_while_sending);
+  RUN_TEST(test_credits);
+  RUN_TEST(test_full);
+  UNITY_END();
+}
+
+#else
+//PASS TEST for UNSUPPORTED CHIPS
+
+void test_pass(void) {
+  TEST_ASSERT_EQUAL(1, 1);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(test_pass);
+  UNITY_END();
+}
+
+#endif
+
+void loop() {}
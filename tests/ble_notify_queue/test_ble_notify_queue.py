@@ -0,0 +1,2 @@
+def test_ble_notify_queue(dut):
+    dut.expect_unity_test_output(timeout=120)
@@ -0,0 +1,221 @@
+/* BLE scan store test
+ *
+ * Checks BLEScanStore with synthetic reports of more devices than a dense
+ * environment has: insertion, in place updates, erasure and the eviction of
+ * the least recently seen device. Then prints the reports per second and the
+ * heap used, against the String keyed map of BLEAdvertisedDevice the scan
+ * results were previously kept in.
+ */
+
+#include <unity.h>
+#include "soc/soc_caps.h"
+#include "sdkconfig.h"
+
+#if SOC_BLE_SUPPORTED && defined(CONFIG_BLUEDROID_ENABLED)
+#include <map>
+#include <BLEScanStore.h>
+#include <BLEAdvertisedDevice.h>
+
+#define DEVICES       600
+#define BENCH_REPORTS 20000
+
+static uint8_t payload[] = {0x02, 0x01, 0x06, 0x05, 0x09, 'b', 'e', 'a', 'c'};
+
+// a distinct address for each device number
+static void makeAddress(uint32_t n, uint8_t *address) {
+  address[0] = 0xC0 | (n >> 24);
+  address[1] = n >> 16;
+  address[2] = n >> 8;
+  address[3] = n;
+  address[4] = n * 7;
+  address[5] = n * 13;
+}
+
+static BLEScanStore::result_t report(BLEScanStore &store, uint32_t n, int rssi, uint32_t time) {
+  uint8_t address[ESP_BD_ADDR_LEN];
+  makeAddress(n, address);
+  return store.update(BLEScanReport(address, BLE_ADDR_TYPE_RANDOM, rssi, 0, payload, sizeof(payload), time));
+}
+
+static const ble_scan_entry_t *find(BLEScanStore &store, uint32_t n) {
+  uint8_t address[ESP_BD_ADDR_LEN];
+  makeAddress(n, address);
+  return store.find(address);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_insert_update(void) {
+  BLEScanStore store;
+  for (uint32_t n = 0; n < DEVICES; n++) {
+    TEST_ASSERT_EQUAL(BLEScanStore::STORE_NEW, report(store, n, -40, n));
+  }
+  TEST_ASSERT_EQUAL(DEVICES, store.count());
+  for (uint32_t n = 0; n < DEVICES; n++) {
+    TEST_ASSERT_EQUAL(BLEScanStore::STORE_UPDATED, report(store, n, -80, 1000 + n));
+  }
+  TEST_ASSERT_EQUAL(DEVICES, store.count());
+  for (uint32_t n = 0; n < DEVICES; n++) {
+    const ble_scan_entry_t *entry = find(store, n);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL(-80, entry->rssi);
+    TEST_ASSERT_EQUAL(1000 + n, entry->lastSeen);
+    TEST_ASSERT_EQUAL(sizeof(payload), entry->payloadLength);
+    TEST_ASSERT_EQUAL_MEMORY(payload, entry->payload, sizeof(payload));
+  }
+  TEST_ASSERT_NULL(find(store, DEVICES));
+
+  size_t length;
+  const uint8_t *name = store.report(0).findField(ESP_BLE_AD_TYPE_NAME_CMPL, &length);
+  TEST_ASSERT_EQUAL(4, length);
+  TEST_ASSERT_EQUAL_MEMORY("beac", name, 4);
+}
+
+void test_erase(void) {
+  BLEScanStore store;
+  for (uint32_t n = 0; n < DEVICES; n++) {
+    report(store, n, -40, n);
+  }
+  uint8_t address[ESP_BD_ADDR_LEN];
+  for (uint32_t n = 0; n < DEVICES; n += 2) {
+    makeAddress(n, address);
+    TEST_ASSERT_TRUE(store.erase(address));
+    TEST_ASSERT_FALSE(store.erase(address));
+  }
+  TEST_ASSERT_EQUAL(DEVICES / 2, store.count());
+  for (uint32_t n = 0; n < DEVICES; n++) {
+    TEST_ASSERT_EQUAL(n & 1, find(store, n) != nullptr);
+  }
+  // the remaining entries are dense
+  for (size_t i = 0; i < store.count(); i++) {
+    TEST_ASSERT_EQUAL_PTR(store.at(i), store.find(store.at(i)->address));
+  }
+  store.clear();
+  TEST_ASSERT_EQUAL(0, store.count());
+  TEST_ASSERT_NULL(find(store, 1));
+}
+
+void test_full(void) {
+  BLEScanStore store;
+  TEST_ASSERT_TRUE(store.setCapacity(100, false));
+  for (uint32_t n = 0; n < DEVICES; n++) {
+    report(store, n, -40, n);
+  }
+  TEST_ASSERT_EQUAL(100, store.count());
+  TEST_ASSERT_EQUAL(100, store.capacity());
+  TEST_ASSERT_EQUAL(DEVICES - 100, store.dropped());
+  TEST_ASSERT_NOT_NULL(find(store, 99));
+  TEST_ASSERT_NULL(find(store, 100));
+}
+
+void test_evict_oldest(void) {
+  BLEScanStore store;
+  TEST_ASSERT_TRUE(store.setCapacity(100, true));
+  for (uint32_t n = 0; n < 100; n++) {
+    report(store, n, -40, n);
+  }
+  // device 0 is seen again, so device 1 is now the oldest
+  TEST_ASSERT_EQUAL(BLEScanStore::STORE_UPDATED, report(store, 0, -40, 100));
+  TEST_ASSERT_EQUAL(BLEScanStore::STORE_NEW, report(store, 100, -40, 101));
+  TEST_ASSERT_EQUAL(100, store.count());
+  TEST_ASSERT_NOT_NULL(find(store, 0));
+  TEST_ASSERT_NULL(find(store, 1));
+  TEST_ASSERT_NOT_NULL(find(store, 100));
+
+  // only the most recent devices remain
+  for (uint32_t n = 101; n < DEVICES; n++) {
+    report(store, n, -40, n + 1);
+  }
+  TEST_ASSERT_EQUAL(100, store.count());
+  TEST_ASSERT_EQUAL(0, store.dropped());
+  for (uint32_t n = DEVICES - 100; n < DEVICES; n++) {
+    TEST_ASSERT_NOT_NULL(find(store, n));
+  }
+}
+
+void test_benchmark(void) {
+  uint8_t address[ESP_BD_ADDR_LEN];
+
+  uint32_t heap = ESP.getFreeHeap();
+  uint32_t start = micros();
+  {
+    std::map<String, BLEAdvertisedDevice *> devices;
+    for (uint32_t i = 0; i < BENCH_REPORTS; i++) {
+      makeAddress(i % DEVICES, address);
+      BLEAddress bleAddress(address);
+      if (devices.count(bleAddress.toString()) != 0) {
+        continue;
+      }
+      BLEScanReport report(address, BLE_ADDR_TYPE_RANDOM, -40, 0, payload, sizeof(payload), i);
+      BLEAdvertisedDevice *device = new BLEAdvertisedDevice(report.toAdvertisedDevice(false));
+      devices.insert(std::pair<String, BLEAdvertisedDevice *>(bleAddress.toString(), device));
+      if (i == DEVICES - 1) {
+        Serial.printf("map:   %u bytes for %u devices\n", heap - ESP.getFreeHeap(), DEVICES);
+      }
+    }
+    uint32_t us = micros() - start;
+    Serial.printf("map:   %.0f reports/s\n", BENCH_REPORTS * 1e6f / us);
+    for (auto device : devices) {
+      delete device.second;
+    }
+  }
+
+  heap = ESP.getFreeHeap();
+  start = micros();
+  {
+    BLEScanStore store;
+    for (uint32_t i = 0; i < BENCH_REPORTS; i++) {
+      makeAddress(i % DEVICES, address);
+      store.update(BLEScanReport(address, BLE_ADDR_TYPE_RANDOM, -40, 0, payload, sizeof(payload), i));
+      if (i == DEVICES - 1) {
+        Serial.printf("store: %u bytes for %u devices\n", heap - ESP.getFreeHeap(), DEVICES);
+      }
+    }
+    uint32_t us = micros() - start;
+    Serial.printf("store: %.0f reports/s\n", BENCH_REPORTS * 1e6f / us);
+    TEST_ASSERT_EQUAL(DEVICES, store.count());
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(test_insert_update);
+  RUN_TEST(test_erase);
+  RUN_TEST(test_full);
+  RUN_TEST(test_evict_oldest);
+  RUN_TEST(test_benchmark);
+  UNITY_END();
+}
+
+#else
+//PASS TEST for UNSUPPORTED CHIPS
+
+void test_pass(void) {
+  TEST_ASSERT_EQUAL(1, 1);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(test_pass);
+  UNITY_END();
+}
+
+#endif
+
+void loop() {}
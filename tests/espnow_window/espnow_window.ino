@@ -0,0 +1,321 @@
+/* ESP-NOW Serial sliding window test
+ *
+ * Two ESP_NOW_Window endpoints exchange streams over a simulated radio instead of ESP-NOW:
+ * a channel shared by both directions, sending one frame at a time in (300 + 8 * length) us like at
+ * 1 Mbps, and losing frames at a given rate. A lost frame is reported as failed by sent(), unless
+ * only its MAC ack is lost (delivered but failed, sent again) or the loss is not seen by the MAC
+ * (lost but successful, recovered by the timeouts). The time is simulated, so that each test takes
+ * the same path on every run.
+ */
+
+#include <unity.h>
+#include "ESP32_NOW_Window.h"
+
+#define STREAM_LEN    (200 * 1024)
+#define MAX_SIM_TIME  (60 * 1000000ULL)  // us
+#define BUFFER_SIZE   4096
+
+typedef struct {
+  ESP_NOW_Window window;
+  uint8_t frames[ESP_NOW_Window::MAX_IN_FLIGHT][ESP_NOW_Window::MAX_FRAME_LEN];
+  size_t lens[ESP_NOW_Window::MAX_IN_FLIGHT];
+  uint8_t head, count;
+  uint8_t seed;             // of the pattern of the stream sent
+  uint32_t written, read;   // positions in the streams sent and received
+  uint32_t to_write;        // length of the stream to send
+  uint32_t read_per_ms;     // 0 reads everything available
+  uint32_t last_read_ms;
+  bool corrupted;
+} endpoint_t;
+
+static endpoint_t ends[2];
+static uint64_t now_us;
+static uint32_t rng_state;
+static uint32_t loss_permille;
+static uint32_t drop_first;  // frames lost at the start of the stream of ends[0]
+static bool peer_gone;       // the frames of ends[0] fail, as when its peer is out of range
+
+static uint32_t rng() {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+static uint8_t pattern(uint8_t seed, uint32_t pos) {
+  return (uint8_t)(seed + pos + (pos >> 8) * 31);
+}
+
+static uint32_t now_ms() {
+  return now_us / 1000;
+}
+
+// the application side: write the stream of the endpoint, read and check the one of the peer
+static void app(endpoint_t &e) {
+  uint8_t buf[512];
+  while (e.written < e.to_write) {
+    size_t len = e.to_write - e.written < sizeof(buf) ? e.to_write - e.written : sizeof(buf);
+    for (size_t i = 0; i < len; i++) {
+      buf[i] = pattern(e.seed, e.written + i);
+    }
+    len = e.window.write(buf, len);
+    if (!len) {
+      break;
+    }
+    e.written += len;
+  }
+  size_t max = sizeof(buf);
+  if (e.read_per_ms) {
+    uint32_t ms = now_ms() - e.last_read_ms;
+    if (!ms) {
+      return;
+    }
+    e.last_read_ms = now_ms();
+    max = ms * e.read_per_ms < max ? ms * e.read_per_ms : max;
+  }
+  size_t len;
+  while ((len = e.window.read(buf, max)) > 0) {
+    for (size_t i = 0; i < len; i++) {
+      if (buf[i] != pattern(e.seed ^ 0xFF, e.read + i)) {
+        e.corrupted = true;
+      }
+    }
+    e.read += len;
+    if (e.read_per_ms) {
+      break;
+    }
+  }
+}
+
+// hand the frames to the radio, as ESP_NOW_Serial_Class does
+static void pump(endpoint_t &e) {
+  app(e);
+  while (e.count < ESP_NOW_Window::MAX_IN_FLIGHT) {
+    uint8_t slot = (e.head + e.count) % ESP_NOW_Window::MAX_IN_FLIGHT;
+    size_t len = e.window.next(e.frames[slot], now_ms());
+    if (!len) {
+      break;
+    }
+    e.lens[slot] = len;
+    e.count++;
+  }
+}
+
+static void setup_endpoint(endpoint_t &e, uint8_t seed, uint32_t to_write, size_t rx_size) {
+  e.window.end();
+  TEST_ASSERT_TRUE(e.window.begin(rx_size, BUFFER_SIZE, 0x1000 + seed));
+  e.head = e.count = 0;
+  e.seed = seed;
+  e.written = e.read = 0;
+  e.to_write = to_write;
+  e.read_per_ms = 0;
+  e.last_read_ms = 0;
+  e.corrupted = false;
+}
+
+static bool done() {
+  return ends[0].read == ends[1].to_write && ends[1].read == ends[0].to_write && !ends[0].window.pending() && !ends[1].window.pending();
+}
+
+// run the simulation until both streams are received and acknowledged, returns false on a stall
+static bool simulate() {
+  uint8_t turn = 0;
+  uint64_t limit = now_us + MAX_SIM_TIME;
+  while (now_us < limit) {
+    pump(ends[0]);
+    pump(ends[1]);
+    if (done()) {
+      return true;
+    }
+    uint8_t from = ends[turn].count ? turn : 1 - turn;
+    endpoint_t &tx = ends[from];
+    if (!tx.count) {
+      // nothing to send, wait for the timeouts
+      uint32_t wait = ESP_NOW_Window::NO_TIMEOUT;
+      for (uint8_t i = 0; i < 2; i++) {
+        uint32_t ms = ends[i].window.timeout(now_ms());
+        wait = ms < wait ? ms : wait;
+      }
+      if (wait == ESP_NOW_Window::NO_TIMEOUT && !ends[0].read_per_ms && !ends[1].read_per_ms) {
+        return false;
+      }
+      now_us = (now_ms() + (wait && wait != ESP_NOW_Window::NO_TIMEOUT ? wait : 1)) * 1000ULL;
+      continue;
+    }
+    turn = 1 - from;
+    endpoint_t &rx = ends[turn];
+    uint8_t *frame = tx.frames[tx.head];
+    size_t len = tx.lens[tx.head];
+    tx.head = (tx.head + 1) % ESP_NOW_Window::MAX_IN_FLIGHT;
+    tx.count--;
+    now_us += 300 + 8 * len;
+
+    bool delivered = true, success = true;
+    if (from == 0 && peer_gone) {
+      delivered = success = false;
+    } else if (from == 0 && drop_first) {
+      drop_first--;
+      delivered = false;  // the MAC does not notice, only the acks of the peer tell
+    } else if (rng() % 1000 < loss_permille) {
+      switch (rng() % 4) {
+        case 0:  delivered = false; break;  // lost without the MAC noticing
+        case 1:  success = false; break;    // MAC ack lost
+        default: delivered = success = false; break;
+      }
+    }
+    if (delivered) {
+      rx.window.receive(frame, len, now_ms());
+    }
+    tx.window.sent(success);
+  }
+  return false;
+}
+
+static uint32_t run(uint32_t loss, uint32_t a_to_b, uint32_t b_to_a, size_t rx_size = BUFFER_SIZE) {
+  loss_permille = loss;
+  setup_endpoint(ends[0], 0x11, a_to_b, rx_size);
+  setup_endpoint(ends[1], 0xEE, b_to_a, rx_size);
+  uint64_t start = now_us;
+  TEST_ASSERT_TRUE_MESSAGE(simulate(), "stalled");
+  TEST_ASSERT_FALSE(ends[0].corrupted);
+  TEST_ASSERT_FALSE(ends[1].corrupted);
+  TEST_ASSERT_EQUAL(0, ends[0].window.stats().peer_lost);
+  uint32_t kbps = (uint64_t)(a_to_b + b_to_a) * 1000 / (now_us - start);  // KB/s, bytes per ms
+  ESP_NOW_Window::stats_t stats = ends[0].window.stats();
+  printf(
+    "loss %lu/1000: %lu KB/s, %lu frames sent, %lu retransmits, %lu acks, %lu duplicates received by the peer\n", loss, kbps, stats.frames_sent,
+    stats.retransmits, ends[1].window.stats().acks_sent, ends[1].window.stats().duplicates
+  );
+  return kbps;
+}
+
+void setUp(void) {
+  rng_state = 0x2545F491;
+  now_us = 0;
+  drop_first = 0;
+  peer_gone = false;
+}
+
+void tearDown(void) {
+  ends[0].window.end();
+  ends[1].window.end();
+}
+
+void test_no_loss(void) {
+  // a frame of 241 bytes every 2.3 ms is about 105 KB/s, less the acks
+  uint32_t kbps = run(0, STREAM_LEN, 0);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(90, kbps);
+  TEST_ASSERT_EQUAL(0, ends[0].window.stats().retransmits);
+}
+
+void test_loss(void) {
+  uint32_t kbps = run(20, STREAM_LEN, 0);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(80, kbps);
+  TEST_ASSERT_NOT_EQUAL(0, ends[0].window.stats().retransmits);
+  kbps = run(100, STREAM_LEN, 0);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(60, kbps);
+  kbps = run(300, STREAM_LEN / 4, 0);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(40, kbps);
+}
+
+void test_both_directions(void) {
+  run(50, STREAM_LEN / 2, STREAM_LEN / 2);
+}
+
+void test_flow_control(void) {
+  // a reader slower than the radio, with a small buffer: the sender waits for the space
+  loss_permille = 20;
+  setup_endpoint(ends[0], 0x11, STREAM_LEN / 8, BUFFER_SIZE);
+  setup_endpoint(ends[1], 0xEE, 0, 1024);
+  ends[1].read_per_ms = 10;
+  TEST_ASSERT_TRUE_MESSAGE(simulate(), "stalled");
+  TEST_ASSERT_FALSE(ends[1].corrupted);
+  // 10 KB/s
+  TEST_ASSERT_UINT32_WITHIN(300, STREAM_LEN / 8 / 10, now_us / 1000);
+  TEST_ASSERT_LESS_THAN_UINT32(ends[0].window.stats().frames_sent / 10, ends[1].window.stats().dropped);
+  // a peer acknowledging without space is not lost
+  TEST_ASSERT_EQUAL(0, ends[0].window.stats().peer_lost);
+}
+
+void test_restart(void) {
+  run(50, STREAM_LEN / 8, 0);
+
+  // the receiver restarts, and follows the stream from the first frame it gets
+  TEST_ASSERT_TRUE(ends[1].window.begin(BUFFER_SIZE, BUFFER_SIZE, 0x3000));
+  ends[0].to_write += STREAM_LEN / 8;
+  TEST_ASSERT_TRUE_MESSAGE(simulate(), "stalled");
+  TEST_ASSERT_FALSE(ends[1].corrupted);
+  TEST_ASSERT_EQUAL(ends[0].to_write, ends[1].read);
+
+  // the sender restarts with a new session, its stream continuing where the receiver is
+  TEST_ASSERT_TRUE(ends[0].window.begin(BUFFER_SIZE, BUFFER_SIZE, 0x4000));
+  ends[0].to_write += STREAM_LEN / 8;
+  TEST_ASSERT_TRUE_MESSAGE(simulate(), "stalled");
+  TEST_ASSERT_FALSE(ends[1].corrupted);
+  TEST_ASSERT_EQUAL(ends[0].to_write, ends[1].read);
+}
+
+void test_first_frame_lost(void) {
+  // the receiver gets the following frames first, and waits for the first one to be sent again
+  for (uint32_t lost = 1; lost <= 3; lost++) {
+    drop_first = lost;
+    run(0, STREAM_LEN / 8, 0);
+    TEST_ASSERT_EQUAL(STREAM_LEN / 8, ends[1].read);
+    TEST_ASSERT_NOT_EQUAL(0, ends[0].window.stats().retransmits);
+  }
+
+  // and so does a receiver following a previous stream, when the sender restarts
+  drop_first = 1;
+  TEST_ASSERT_TRUE(ends[0].window.begin(BUFFER_SIZE, BUFFER_SIZE, 0x5000));
+  ends[0].written = 0;
+  ends[1].read = 0;
+  TEST_ASSERT_TRUE_MESSAGE(simulate(), "stalled");
+  TEST_ASSERT_FALSE(ends[1].corrupted);
+  TEST_ASSERT_EQUAL(ends[0].to_write, ends[1].read);
+}
+
+void test_peer_lost(void) {
+  // the sender gives up on a peer that acknowledges nothing, dropping what it could not send
+  peer_gone = true;
+  setup_endpoint(ends[0], 0x11, STREAM_LEN / 8, BUFFER_SIZE);
+  setup_endpoint(ends[1], 0xEE, 0, BUFFER_SIZE);
+  TEST_ASSERT_FALSE(simulate());
+  TEST_ASSERT_LESS_THAN_UINT32(1000, now_ms());
+  TEST_ASSERT_TRUE(ends[0].window.peerLost());
+  TEST_ASSERT_EQUAL(0, ends[0].window.pending());
+  TEST_ASSERT_EQUAL(0, ends[0].window.availableForWrite());
+  TEST_ASSERT_EQUAL(0, ends[0].window.write((const uint8_t *)"x", 1));
+  ESP_NOW_Window::stats_t stats = ends[0].window.stats();
+  TEST_ASSERT_EQUAL(1, stats.peer_lost);
+  TEST_ASSERT_EQUAL(ends[0].written, stats.tx_dropped);
+  TEST_ASSERT_EQUAL(ESP_NOW_Window::MAX_RETRIES, stats.retransmits);
+
+  // a frame of the peer back in range lets it write again, the peer receiving the new session from its start
+  peer_gone = false;
+  ends[0].written = 0;
+  ends[1].to_write = 1000;
+  TEST_ASSERT_TRUE_MESSAGE(simulate(), "stalled");
+  TEST_ASSERT_FALSE(ends[0].window.peerLost());
+  TEST_ASSERT_FALSE(ends[0].corrupted);
+  TEST_ASSERT_FALSE(ends[1].corrupted);
+  TEST_ASSERT_EQUAL(ends[0].to_write, ends[1].read);
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(test_no_loss);
+  RUN_TEST(test_loss);
+  RUN_TEST(test_both_directions);
+  RUN_TEST(test_flow_control);
+  RUN_TEST(test_restart);
+  RUN_TEST(test_first_frame_lost);
+  RUN_TEST(test_peer_lost);
+  UNITY_END();
+}
+
+void loop() {}
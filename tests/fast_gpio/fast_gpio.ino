@@ -0,0 +1,192 @@
+/* Fast GPIO test
+ *
+ * The pins are set as OUTPUT, which keeps their input enabled, so that the levels written with
+ * FastGPIO and PinGroup are read back without external connections. The last test measures the
+ * toggle rate of digitalWrite(), FastGPIO and PinGroup.
+ */
+
+#include <unity.h>
+#include "FastGPIO.h"
+
+#if CONFIG_IDF_TARGET_ESP32
+static const uint8_t CONSECUTIVE_PINS[] = {25, 26, 27};
+static const uint8_t SCATTERED_PINS[] = {23, 4, 22, 5, 21, 13, 19, 14};
+static const uint8_t CROSS_BANK_PINS[] = {33, 4, 32, 5};
+#elif CONFIG_IDF_TARGET_ESP32S2 || CONFIG_IDF_TARGET_ESP32S3
+static const uint8_t CONSECUTIVE_PINS[] = {4, 5, 6, 7};
+static const uint8_t SCATTERED_PINS[] = {14, 2, 12, 4, 10, 6, 8, 13};
+static const uint8_t CROSS_BANK_PINS[] = {38, 4, 39, 5};
+#elif CONFIG_IDF_TARGET_ESP32H2
+static const uint8_t CONSECUTIVE_PINS[] = {0, 1, 2, 3};
+static const uint8_t SCATTERED_PINS[] = {11, 0, 10, 1, 5, 2, 4, 3};
+#else
+static const uint8_t CONSECUTIVE_PINS[] = {4, 5, 6, 7};
+static const uint8_t SCATTERED_PINS[] = {10, 0, 7, 1, 6, 3, 5, 4};
+#endif
+
+#define TOGGLES 10000
+
+static uint64_t pinsMask(const uint8_t *pins, size_t count) {
+  uint64_t mask = 0;
+  for (size_t i = 0; i < count; i++) {
+    mask |= 1ULL << pins[i];
+  }
+  return mask;
+}
+
+static void pinsMode(const uint8_t *pins, size_t count, uint8_t mode) {
+  for (size_t i = 0; i < count; i++) {
+    pinMode(pins[i], mode);
+  }
+}
+
+void setUp(void) {
+  pinsMode(SCATTERED_PINS, sizeof(SCATTERED_PINS), OUTPUT);
+  FastGPIO::clear(pinsMask(SCATTERED_PINS, sizeof(SCATTERED_PINS)));
+}
+
+void tearDown(void) {}
+
+void test_mask(void) {
+  static_assert(FastGPIO::mask() == 0, "empty mask");
+  static_assert(FastGPIO::mask(0, 3) == 0x9, "mask of GPIO0 and GPIO3");
+  static_assert(FastGPIO::mask(31, 32, 63) == 0x8000000180000000ULL, "mask across the banks");
+  TEST_ASSERT_EQUAL_UINT64(pinsMask(SCATTERED_PINS, 2), FastGPIO::mask(SCATTERED_PINS[0], SCATTERED_PINS[1]));
+}
+
+void test_set_clear(void) {
+  uint64_t mask = pinsMask(SCATTERED_PINS, sizeof(SCATTERED_PINS));
+  FastGPIO::set(mask);
+  TEST_ASSERT_EQUAL_UINT64(mask, FastGPIO::read(mask));
+  TEST_ASSERT_EQUAL_UINT64(mask, FastGPIO::outputs(mask));
+  for (size_t i = 0; i < sizeof(SCATTERED_PINS); i++) {
+    TEST_ASSERT_EQUAL(HIGH, digitalRead(SCATTERED_PINS[i]));
+  }
+  FastGPIO::clear(mask);
+  TEST_ASSERT_EQUAL_UINT64(0, FastGPIO::read(mask));
+}
+
+void test_write_keeps_other_pins(void) {
+  uint8_t kept = SCATTERED_PINS[0];
+  uint64_t mask = pinsMask(SCATTERED_PINS + 1, sizeof(SCATTERED_PINS) - 1);
+  digitalWrite(kept, HIGH);
+  FastGPIO::write(mask, ~0ULL);
+  TEST_ASSERT_EQUAL_UINT64(mask, FastGPIO::read(mask));
+  FastGPIO::write(mask, 0);
+  TEST_ASSERT_EQUAL_UINT64(0, FastGPIO::read(mask));
+  TEST_ASSERT_EQUAL(HIGH, digitalRead(kept));
+  FastGPIO::toggle(FastGPIO::mask(kept));
+  TEST_ASSERT_EQUAL(LOW, digitalRead(kept));
+  FastGPIO::toggle(mask);
+  TEST_ASSERT_EQUAL_UINT64(mask, FastGPIO::read(mask));
+  TEST_ASSERT_EQUAL(LOW, digitalRead(kept));
+}
+
+static void check_group(PinGroup &group, size_t count) {
+  TEST_ASSERT_TRUE(group.begin());
+  TEST_ASSERT_TRUE(group);
+  TEST_ASSERT_EQUAL(count, group.size());
+  for (uint32_t value = 0; value < (1UL << count); value++) {
+    group.write(value);
+    TEST_ASSERT_EQUAL_HEX32(value, group.read());
+  }
+  // bits above the group are ignored
+  group.write(0xFFFFFFFF);
+  TEST_ASSERT_EQUAL_HEX32((1UL << count) - 1, group.read());
+  TEST_ASSERT_EQUAL_UINT64(group.mask(), FastGPIO::read(group.mask()));
+  group.end();
+  TEST_ASSERT_FALSE(group);
+}
+
+void test_group_consecutive(void) {
+  PinGroup group(CONSECUTIVE_PINS);
+  check_group(group, sizeof(CONSECUTIVE_PINS));
+}
+
+void test_group_scattered(void) {
+  PinGroup group(SCATTERED_PINS);
+  check_group(group, sizeof(SCATTERED_PINS));
+}
+
+#if SOC_GPIO_PIN_COUNT > 32
+void test_group_cross_bank(void) {
+  PinGroup group(CROSS_BANK_PINS);
+  check_group(group, sizeof(CROSS_BANK_PINS));
+}
+#endif
+
+void test_group_invalid(void) {
+  const uint8_t invalid[] = {SCATTERED_PINS[0], SOC_GPIO_PIN_COUNT};
+  const uint8_t twice[] = {SCATTERED_PINS[0], SCATTERED_PINS[1], SCATTERED_PINS[0]};
+  PinGroup group_invalid(invalid);
+  PinGroup group_twice(twice);
+  PinGroup group_empty(SCATTERED_PINS, 0);
+  TEST_ASSERT_FALSE(group_invalid.begin());
+  TEST_ASSERT_FALSE(group_twice.begin());
+  TEST_ASSERT_FALSE(group_empty.begin());
+  TEST_ASSERT_FALSE(group_empty);
+  // writing a group that failed to begin does nothing
+  group_twice.write(0xFF);
+  TEST_ASSERT_EQUAL_UINT64(0, FastGPIO::read(pinsMask(SCATTERED_PINS, sizeof(SCATTERED_PINS))));
+}
+
+static float toggles_per_us(uint32_t cycles) {
+  return (float)TOGGLES * getCpuFrequencyMhz() / cycles;
+}
+
+void test_toggle_rate(void) {
+  uint8_t pin = SCATTERED_PINS[0];
+  const uint64_t mask = FastGPIO::mask(SCATTERED_PINS[0]);
+  PinGroup group(SCATTERED_PINS);
+  TEST_ASSERT_TRUE(group.begin());
+
+  uint32_t start = ESP.getCycleCount();
+  for (uint32_t i = 0; i < TOGGLES / 2; i++) {
+    digitalWrite(pin, HIGH);
+    digitalWrite(pin, LOW);
+  }
+  uint32_t digital_cycles = ESP.getCycleCount() - start;
+
+  start = ESP.getCycleCount();
+  for (uint32_t i = 0; i < TOGGLES / 2; i++) {
+    FastGPIO::set(mask);
+    FastGPIO::clear(mask);
+  }
+  uint32_t fast_cycles = ESP.getCycleCount() - start;
+
+  start = ESP.getCycleCount();
+  for (uint32_t i = 0; i < TOGGLES / 2; i++) {
+    group.write(0xFF);
+    group.write(0x00);
+  }
+  uint32_t group_cycles = ESP.getCycleCount() - start;
+
+  printf("digitalWrite: %lu cycles per toggle, %.2f toggles/us\n", digital_cycles / TOGGLES, toggles_per_us(digital_cycles));
+  printf("FastGPIO:     %lu cycles per toggle, %.2f toggles/us\n", fast_cycles / TOGGLES, toggles_per_us(fast_cycles));
+  printf("PinGroup(%u): %lu cycles per toggle, %.2f toggles/us\n", group.size(), group_cycles / TOGGLES, toggles_per_us(group_cycles));
+
+  TEST_ASSERT_LESS_THAN_UINT32(digital_cycles / 2, fast_cycles);
+  TEST_ASSERT_LESS_THAN_UINT32(digital_cycles, group_cycles);
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(test_mask);
+  RUN_TEST(test_set_clear);
+  RUN_TEST(test_write_keeps_other_pins);
+  RUN_TEST(test_group_consecutive);
+  RUN_TEST(test_group_scattered);
+#if SOC_GPIO_PIN_COUNT > 32
+  RUN_TEST(test_group_cross_bank);
+#endif
+  RUN_TEST(test_group_invalid);
+  RUN_TEST(test_toggle_rate);
+  UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,167 @@
+/* Hash builders test
+ *
+ * Checks MD5Builder, SHA1Builder, SHA256Builder and HMACBuilder against the
+ * FIPS 180 and RFC 2202 / RFC 4231 test vectors, addStream() on a stream that
+ * delivers its data with gaps, and prints the throughput of each hash.
+ */
+
+#include <unity.h>
+#include <MD5Builder.h>
+#include <SHA1Builder.h>
+#include <SHA256Builder.h>
+#include <HMACBuilder.h>
+
+#define STREAM_SIZE 100000
+#define BENCH_SIZE  (256 * 1024)
+#define CHUNK_SIZE  4096
+
+static const char *hmac_key = "Jefe";
+static const char *hmac_data = "what do ya want for nothing?";
+
+// STREAM_SIZE bytes of 'a', with no data on one read out of three
+class GappedStream : public Stream {
+public:
+  size_t left = STREAM_SIZE;
+  uint32_t calls = 0;
+
+  int available() override {
+    return (++calls % 3 && left) ? 1 : 0;
+  }
+  int read() override {
+    if (!available()) {
+      return -1;
+    }
+    left--;
+    return 'a';
+  }
+  int peek() override {
+    return left ? 'a' : -1;
+  }
+  size_t write(uint8_t) override {
+    return 0;
+  }
+};
+
+static void check_hash(HashBuilder &hash, const char *data, const char *expected) {
+  hash.begin();
+  hash.add(data);
+  hash.calculate();
+  TEST_ASSERT_EQUAL_STRING(expected, hash.toString().c_str());
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_md5(void) {
+  MD5Builder md5;
+  check_hash(md5, "abc", "900150983cd24fb0d6963f7d28e17f72");
+  TEST_ASSERT_EQUAL(16, md5.getHashSize());
+}
+
+void test_sha1(void) {
+  SHA1Builder sha1;
+  check_hash(sha1, "abc", "a9993e364706816aba3e25717850c26c9cd0d89d");
+  TEST_ASSERT_EQUAL(20, sha1.getHashSize());
+}
+
+void test_sha256(void) {
+  SHA256Builder sha256;
+  check_hash(sha256, "abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  check_hash(sha256, "", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  TEST_ASSERT_EQUAL(32, sha256.getHashSize());
+
+  // a hash begun again without being calculated
+  sha256.begin();
+  sha256.add("unused");
+  check_hash(sha256, "abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+}
+
+void test_hmac(void) {
+  MD5Builder md5;
+  SHA1Builder sha1;
+  SHA256Builder sha256;
+  HMACBuilder hmac_md5(md5, (const uint8_t *)hmac_key, strlen(hmac_key));
+  HMACBuilder hmac_sha1(sha1, (const uint8_t *)hmac_key, strlen(hmac_key));
+  HMACBuilder hmac_sha256(sha256);
+  hmac_sha256.setKey(hmac_key);
+
+  check_hash(hmac_md5, hmac_data, "750c783e6ab0b503eaa86e310a5db738");
+  check_hash(hmac_sha1, hmac_data, "effcdf6ae5eb2fa2d27416d5f184df9c259a7c79");
+  check_hash(hmac_sha256, hmac_data, "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+
+  // key longer than the block size
+  uint8_t long_key[131];
+  memset(long_key, 0xaa, sizeof(long_key));
+  hmac_sha256.setKey(long_key, sizeof(long_key));
+  check_hash(hmac_sha256, "Test Using Larger Than Block-Size Key - Hash Key First", "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+}
+
+void test_add_stream(void) {
+  SHA256Builder sha256;
+  GappedStream stream;
+  stream.setTimeout(100);
+  sha256.begin();
+  TEST_ASSERT_TRUE(sha256.addStream(stream, STREAM_SIZE));
+  sha256.calculate();
+  TEST_ASSERT_EQUAL_STRING("6d1cf22d7cc09b085dfc25ee1a1f3ae0265804c607bc2074ad253bcc82fd81ee", sha256.toString().c_str());
+  TEST_ASSERT_EQUAL(0, stream.left);
+
+  // caller buffer, and a stream ending before maxLen
+  uint8_t buf[64];
+  MD5Builder md5;
+  GappedStream short_stream;
+  short_stream.setTimeout(10);
+  md5.begin();
+  TEST_ASSERT_FALSE(md5.addStream(short_stream, STREAM_SIZE + 1, buf, sizeof(buf)));
+  TEST_ASSERT_EQUAL(0, short_stream.left);
+  md5.calculate();
+  TEST_ASSERT_EQUAL_STRING("1af6d6f2f682f76f80e606aeaaee1680", md5.toString().c_str());
+}
+
+static void bench(const char *name, HashBuilder &hash, const uint8_t *data) {
+  uint32_t start = micros();
+  hash.begin();
+  for (size_t done = 0; done < BENCH_SIZE; done += CHUNK_SIZE) {
+    hash.add(data, CHUNK_SIZE);
+  }
+  hash.calculate();
+  uint32_t us = micros() - start;
+  Serial.printf("%-14s %.2f MB/s\n", name, (float)BENCH_SIZE / us);
+  TEST_ASSERT_GREATER_THAN(0, us);
+}
+
+void test_throughput(void) {
+  uint8_t *data = (uint8_t *)malloc(CHUNK_SIZE);
+  TEST_ASSERT_NOT_NULL(data);
+  for (size_t i = 0; i < CHUNK_SIZE; i++) {
+    data[i] = i * 7;
+  }
+  MD5Builder md5;
+  SHA1Builder sha1;
+  SHA256Builder sha256;
+  HMACBuilder hmac_sha256(sha256, (const uint8_t *)hmac_key, strlen(hmac_key));
+  bench("MD5", md5, data);
+  bench("SHA-1", sha1, data);
+  bench("SHA-256", sha256, data);
+  bench("HMAC-SHA-256", hmac_sha256, data);
+  free(data);
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(test_md5);
+  RUN_TEST(test_sha1);
+  RUN_TEST(test_sha256);
+  RUN_TEST(test_hmac);
+  RUN_TEST(test_add_stream);
+  RUN_TEST(test_throughput);
+  UNITY_END();
+}
+
+void loop() {}
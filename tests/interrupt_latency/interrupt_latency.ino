@@ -0,0 +1,218 @@
+/* Functional interrupt test
+ *
+ * The pins are set as OUTPUT, which keeps their input enabled, so that writing them triggers
+ * their own interrupts. The dispatcher task runs on the core of the test, which is also the core
+ * of the GPIO interrupts, so that the cycle counter measures the latency from the write to the
+ * call of the interrupt function, printed as histograms by the last test.
+ */
+
+#include <unity.h>
+#include "FunctionalInterrupt.h"
+#include "FastGPIO.h"
+
+#define PIN_A 4
+#define PIN_B 5
+
+#define QUEUE_LEN     8
+#define EDGES         1000
+#define HISTOGRAM_LEN 16
+#define WAIT_CYCLES   (getCpuFrequencyMhz() * 1000)  // 1 ms
+
+static volatile uint32_t counts[2];
+static volatile uint32_t fired_at;
+static volatile bool fired;
+
+static InterruptEvent events[64];
+static volatile uint32_t event_count;
+
+static void ARDUINO_ISR_ATTR record_isr() {
+  fired_at = ESP.getCycleCount();
+  fired = true;
+}
+
+static void record_event(const InterruptEvent &event) {
+  fired_at = ESP.getCycleCount();
+  fired = true;
+  if (event_count < sizeof(events) / sizeof(events[0])) {
+    events[event_count] = event;
+  }
+  event_count = event_count + 1;
+}
+
+// Make a rising edge and return the cycles until the interrupt function is called, 0 if not called
+static uint32_t rising_edge(uint8_t pin) {
+  FastGPIO::clear(FastGPIO::mask(pin));
+  delayMicroseconds(20);
+  fired = false;
+  uint32_t start = ESP.getCycleCount();
+  FastGPIO::set(FastGPIO::mask(pin));
+  while (!fired && ESP.getCycleCount() - start < WAIT_CYCLES) {}
+  return fired ? fired_at - start : 0;
+}
+
+void setUp(void) {
+  counts[0] = counts[1] = 0;
+  event_count = 0;
+  pinMode(PIN_A, OUTPUT);
+  pinMode(PIN_B, OUTPUT);
+  digitalWrite(PIN_A, LOW);
+  digitalWrite(PIN_B, LOW);
+}
+
+void tearDown(void) {
+  detachInterrupt(PIN_A);
+  detachInterrupt(PIN_B);
+}
+
+void test_inline_function(void) {
+  volatile uint32_t *count = &counts[0];
+  auto isr = [count]() {
+    *count = *count + 1;
+    fired = true;
+  };
+  static_assert(InterruptFunction<>::fits<decltype(isr)>(), "lambda kept in an InterruptFunction");
+  // what can not be called goes to the other overloads of attachInterrupt()
+  static_assert(!InterruptFunction<>::fits<std::nullptr_t>(), "nullptr is not an InterruptFunction");
+  static_assert(!InterruptFunction<>::fits<long>(), "an integer is not an InterruptFunction");
+  static_assert(!DeferredInterruptFunction::fits<decltype(isr)>(), "called without the event");
+  attachInterrupt(PIN_A, isr, RISING);
+  for (uint32_t i = 0; i < 100; i++) {
+    TEST_ASSERT_NOT_EQUAL(0, rising_edge(PIN_A));
+  }
+  TEST_ASSERT_EQUAL(100, counts[0]);
+}
+
+void test_reattach(void) {
+  attachInterrupt(PIN_A, [] { counts[0] = counts[0] + 1; }, RISING);
+  rising_edge(PIN_A);
+  attachInterrupt(PIN_A, [] { counts[1] = counts[1] + 1; }, RISING);
+  rising_edge(PIN_A);
+  rising_edge(PIN_A);
+  TEST_ASSERT_EQUAL(1, counts[0]);
+  TEST_ASSERT_EQUAL(2, counts[1]);
+
+  // a std::function replacing an InterruptFunction, and the reverse
+  attachInterrupt(PIN_A, std::function<void(void)>([] { counts[0] = counts[0] + 1; }), RISING);
+  rising_edge(PIN_A);
+  attachInterrupt(PIN_A, [] { counts[1] = counts[1] + 1; }, RISING);
+  rising_edge(PIN_A);
+  TEST_ASSERT_EQUAL(2, counts[0]);
+  TEST_ASSERT_EQUAL(3, counts[1]);
+
+  detachInterrupt(PIN_A);
+  rising_edge(PIN_A);
+  TEST_ASSERT_EQUAL(2, counts[0]);
+  TEST_ASSERT_EQUAL(3, counts[1]);
+}
+
+void test_deferred_events(void) {
+  attachInterruptDeferred(PIN_A, record_event, CHANGE);
+  attachInterruptDeferred(PIN_B, [](const InterruptEvent &event) { record_event(event); }, RISING);
+  for (uint32_t i = 0; i < 4; i++) {
+    digitalWrite(PIN_A, HIGH);
+    delay(1);
+    digitalWrite(PIN_A, LOW);
+    delay(1);
+  }
+  rising_edge(PIN_B);
+  delay(1);
+
+  TEST_ASSERT_EQUAL(9, event_count);
+  for (uint32_t i = 0; i < 8; i++) {
+    TEST_ASSERT_EQUAL(PIN_A, events[i].pin);
+    TEST_ASSERT_EQUAL(i % 2 ? LOW : HIGH, events[i].level);
+    if (i) {
+      TEST_ASSERT_GREATER_OR_EQUAL_UINT32(900, events[i].time - events[i - 1].time);
+    }
+  }
+  TEST_ASSERT_EQUAL(PIN_B, events[8].pin);
+  TEST_ASSERT_EQUAL(HIGH, events[8].level);
+  TEST_ASSERT_EQUAL(0, interruptDispatcherDropped());
+}
+
+void test_deferred_overflow(void) {
+  attachInterruptDeferred(PIN_A, record_event, RISING);
+  // the dispatcher cannot run on this core while the priority of the test is higher
+  UBaseType_t priority = uxTaskPriorityGet(NULL);
+  vTaskPrioritySet(NULL, 3);
+  for (uint32_t i = 0; i < QUEUE_LEN + 4; i++) {
+    FastGPIO::set(FastGPIO::mask(PIN_A));
+    delayMicroseconds(50);
+    FastGPIO::clear(FastGPIO::mask(PIN_A));
+    delayMicroseconds(50);
+  }
+  TEST_ASSERT_EQUAL(0, event_count);
+  vTaskPrioritySet(NULL, priority);
+  delay(1);
+  TEST_ASSERT_EQUAL(QUEUE_LEN, event_count);
+  TEST_ASSERT_EQUAL(4, interruptDispatcherDropped());
+}
+
+static void print_histogram(const char *name, uint32_t *cycles, uint32_t count, uint32_t bin_ns) {
+  uint32_t bins[HISTOGRAM_LEN + 1] = {0};
+  uint32_t min = UINT32_MAX, max = 0;
+  uint64_t sum = 0;
+  uint32_t mhz = getCpuFrequencyMhz();
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t ns = cycles[i] * 1000 / mhz;
+    bins[ns / bin_ns < HISTOGRAM_LEN ? ns / bin_ns : HISTOGRAM_LEN]++;
+    min = ns < min ? ns : min;
+    max = ns > max ? ns : max;
+    sum += ns;
+  }
+  printf("%s: min %lu ns, mean %lu ns, max %lu ns\n", name, min, (uint32_t)(sum / count), max);
+  for (uint32_t i = 0; i <= HISTOGRAM_LEN; i++) {
+    if (bins[i]) {
+      if (i < HISTOGRAM_LEN) {
+        printf("  %6lu - %6lu ns: %lu\n", i * bin_ns, (i + 1) * bin_ns, bins[i]);
+      } else {
+        printf("  %6lu ns and more: %lu\n", i * bin_ns, bins[i]);
+      }
+    }
+  }
+}
+
+static void measure(const char *name, uint32_t *cycles, uint32_t bin_ns) {
+  for (uint32_t i = 0; i < EDGES; i++) {
+    cycles[i] = rising_edge(PIN_A);
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(0, cycles[i], name);
+  }
+  print_histogram(name, cycles, EDGES, bin_ns);
+}
+
+void test_latency_histogram(void) {
+  static uint32_t cycles[EDGES];
+
+  attachInterrupt(PIN_A, record_isr, RISING);
+  measure("function pointer", cycles, 250);
+
+  attachInterrupt(PIN_A, std::function<void(void)>(record_isr), RISING);
+  measure("std::function", cycles, 250);
+
+  attachInterrupt(PIN_A, [] { record_isr(); }, RISING);
+  measure("InterruptFunction", cycles, 250);
+
+  attachInterruptDeferred(PIN_A, record_event, RISING);
+  measure("deferred", cycles, 2000);
+  TEST_ASSERT_EQUAL(4, interruptDispatcherDropped());
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  // above the priority of the test, on its core
+  interruptDispatcherBegin(QUEUE_LEN, 2, xPortGetCoreID());
+
+  UNITY_BEGIN();
+  RUN_TEST(test_inline_function);
+  RUN_TEST(test_reattach);
+  RUN_TEST(test_deferred_events);
+  RUN_TEST(test_deferred_overflow);
+  RUN_TEST(test_latency_histogram);
+  UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,2 @@
+def test_interrupt_latency(dut):
+    dut.expect_unity_test_output(timeout=120)
@@ -0,0 +1,160 @@
+/* Deferred logging test
+ *
+ * The record ring is checked against vsnprintf() with a local ring, then deferred logging is
+ * started and the benchmark compares the time spent in log_printf() by the caller in both modes.
+ */
+
+#include <unity.h>
+#include "esp32-hal-log-ring.h"
+#include "esp_memory_utils.h"
+
+#define BENCH_MESSAGES 200
+
+static uint8_t ring_buf[512];
+static log_ring_t ring;
+static char out[256];
+static size_t out_len;
+
+static void collect(const char *data, size_t len, void *arg) {
+  memcpy(out + out_len, data, len);
+  out_len += len;
+}
+
+static bool in_flash(const void *ptr) {
+  return esp_ptr_in_drom(ptr);
+}
+
+static size_t encode(uint8_t *rec, uint32_t stamp, const char *format, ...) {
+  va_list arg;
+  va_start(arg, format);
+  size_t len = logRingEncode(rec, stamp, format, arg, in_flash);
+  va_end(arg);
+  return len;
+}
+
+static void check_format(const char *format, ...) {
+  char expected[256];
+  uint8_t rec[LOG_RING_RECORD_MAX];
+  va_list arg;
+  va_start(arg, format);
+  size_t len = logRingEncode(rec, 0, format, arg, in_flash);
+  va_end(arg);
+  va_start(arg, format);
+  vsnprintf(expected, sizeof(expected), format, arg);
+  va_end(arg);
+
+  TEST_ASSERT_TRUE(logRingWrite(&ring, rec, len));
+  out_len = 0;
+  TEST_ASSERT_TRUE(logRingRead(&ring, collect, NULL));
+  out[out_len] = 0;
+  TEST_ASSERT_EQUAL_STRING(expected, out);
+}
+
+void setUp(void) {
+  logRingInit(&ring, ring_buf, sizeof(ring_buf), in_flash);
+}
+
+void tearDown(void) {}
+
+void test_formats(void) {
+  char stack_str[16];
+  strcpy(stack_str, "on the stack");
+  check_format("plain\r\n");
+  check_format("[%6u][D][%s:%u] %s(): %d\r\n", 1234, "file.cpp", 42, "func", -7);
+  check_format("%ld %lld %zu %hhd %c %% %p", -1L, -1234567890123LL, (size_t)77, 300, 'x', (void *)0x3FFB0000);
+  check_format("%.3f %e %-8s|%8s|", 3.14159, 1e10, "left", stack_str);
+  check_format("%*d %.*s %-*.*f", 6, 42, 3, stack_str, 9, 2, 2.5);
+  check_format(stack_str);
+  TEST_ASSERT_EQUAL(0, logRingUsed(&ring));
+}
+
+void test_copied_strings(void) {
+  char stack_str[16];
+  strcpy(stack_str, "before");
+  uint8_t rec[LOG_RING_RECORD_MAX];
+  // the string is copied in the record, changing it afterwards does not change the message
+  size_t len = encode(rec, 0, "%s", stack_str);
+  TEST_ASSERT_TRUE(logRingWrite(&ring, rec, len));
+  strcpy(stack_str, "after");
+  out_len = 0;
+  TEST_ASSERT_TRUE(logRingRead(&ring, collect, NULL));
+  out[out_len] = 0;
+  TEST_ASSERT_EQUAL_STRING("before", out);
+
+  // only the characters within the precision are read, the array has no terminating zero
+  char chars[4] = {'a', 'b', 'c', 'd'};
+  char empty[1] = {0};
+  size_t header = encode(rec, 0, "%s", empty);
+  TEST_ASSERT_EQUAL(header + 3, encode(rec, 0, "%.*s", 3, chars) - sizeof(int));
+  TEST_ASSERT_EQUAL(header + 4, encode(rec, 0, "%.4s", chars));
+  check_format("[%.*s] [%.4s] [%*.*s]", 3, chars, chars, 5, 2, chars);
+}
+
+void test_full_ring(void) {
+  uint8_t rec[LOG_RING_RECORD_MAX];
+  uint32_t written = 0;
+  // fill the ring, then read and write one by one across its end
+  while (logRingWrite(&ring, rec, encode(rec, written, "message %u\n", written))) {
+    written++;
+  }
+  TEST_ASSERT_GREATER_THAN(10, written);
+  TEST_ASSERT_EQUAL(1, ring.dropped);
+  uint32_t stamp;
+  for (uint32_t i = 0; i < 100; i++) {
+    TEST_ASSERT_TRUE(logRingPeek(&ring, &stamp));
+    TEST_ASSERT_EQUAL(i, stamp);
+    out_len = 0;
+    TEST_ASSERT_TRUE(logRingRead(&ring, collect, NULL));
+    TEST_ASSERT_TRUE(logRingWrite(&ring, rec, encode(rec, written, "message %u\n", written)));
+    written++;
+  }
+}
+
+static uint32_t bench(void) {
+  uint32_t start = micros();
+  for (uint32_t i = 0; i < BENCH_MESSAGES; i++) {
+    log_printf("[%6u][D][%s:%u] %s(): value %d\r\n", millis(), "log_deferred.ino", __LINE__, __FUNCTION__, i);
+  }
+  return micros() - start;
+}
+
+void test_deferred(void) {
+  uint32_t direct = bench();
+  // rings large enough for the whole benchmark
+  TEST_ASSERT_TRUE(log_deferred_begin(16384, 1));
+  TEST_ASSERT_TRUE(log_deferred_active());
+  uint32_t deferred = bench();
+  TEST_ASSERT_TRUE(log_deferred_flush(5000));
+
+  log_deferred_stats_t stats;
+  log_deferred_stats(&stats);
+  log_deferred_end();
+  TEST_ASSERT_FALSE(log_deferred_active());
+
+  // the task stops between two writes and can be started again
+  TEST_ASSERT_TRUE(log_deferred_begin(0, 1));
+  bench();
+  log_deferred_end();
+  TEST_ASSERT_FALSE(log_deferred_active());
+  TEST_ASSERT_GREATER_OR_EQUAL(BENCH_MESSAGES, stats.queued);
+  TEST_ASSERT_EQUAL(0, stats.dropped);
+  TEST_ASSERT_GREATER_THAN(BENCH_MESSAGES * 40, stats.written);
+  Serial.printf("log_printf(): %lu us per message direct, %lu us deferred\n", direct / BENCH_MESSAGES, deferred / BENCH_MESSAGES);
+  TEST_ASSERT_LESS_THAN(direct, deferred);
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(test_formats);
+  RUN_TEST(test_copied_strings);
+  RUN_TEST(test_full_ring);
+  RUN_TEST(test_deferred);
+  UNITY_END();
+}
+
+void loop() {}
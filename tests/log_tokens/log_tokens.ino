@@ -0,0 +1,138 @@
+/* Tokenized logging test
+ *
+ * Frames are checked byte by byte against the wire format decoded by tools/log_decoder.py, then the
+ * benchmark compares the bytes and the CPU cycles per message of text and tokenized logs.
+ */
+
+#include <unity.h>
+#include "esp32-hal-log-token.h"
+#include "esp_memory_utils.h"
+#include "esp_cpu.h"
+
+#define BENCH_MESSAGES 200
+
+static const char *flash_str = "in flash";
+
+static bool in_flash(const void *ptr) {
+  return esp_ptr_in_drom(ptr);
+}
+
+static size_t encode_token(uint8_t *frame, uint32_t token, const char *format, ...) {
+  va_list arg;
+  va_start(arg, format);
+  size_t len = logTokenEncode(frame, token, format, arg, in_flash);
+  va_end(arg);
+  return len;
+}
+
+#define encode(frame, format, ...) encode_token(frame, logTokenHash(format), format, ##__VA_ARGS__)
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_hash(void) {
+  // FNV-1a reference values
+  TEST_ASSERT_EQUAL_HEX32(0x811C9DC5, logTokenHash(""));
+  TEST_ASSERT_EQUAL_HEX32(0xE40C292C, logTokenHash("a"));
+  TEST_ASSERT_EQUAL_HEX32(0xBF9CF968, logTokenHash("foobar"));
+}
+
+void test_frames(void) {
+  uint8_t frame[LOG_TOKEN_FRAME_MAX];
+  char stack_str[4];
+  strcpy(stack_str, "ab");
+  uint32_t token = logTokenHash("%d %u %s");
+  // strings out of flash are copied, after their length shifted left
+  size_t len = encode(frame, "%d %u %s", -3, 300, stack_str);
+  const uint8_t expected[] = {
+    LOG_TOKEN_SYNC, 10, (uint8_t)token, (uint8_t)(token >> 8), (uint8_t)(token >> 16), (uint8_t)(token >> 24), 0x05, 0xAC, 0x02, 0x04
+  };
+  TEST_ASSERT_EQUAL(sizeof(expected) + 2, len);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, frame, sizeof(expected));
+  TEST_ASSERT_EQUAL_MEMORY("ab", frame + sizeof(expected), 2);
+
+  // strings in flash are sent as their address, with the lowest bit set
+  len = encode(frame, "%s", flash_str);
+  TEST_ASSERT_TRUE(in_flash(flash_str));
+  TEST_ASSERT_EQUAL(6 + 5, len);
+  uint64_t v = 0;
+  for (int i = 0; i < 5; i++) {
+    v |= (uint64_t)(frame[6 + i] & 0x7F) << (7 * i);
+  }
+  TEST_ASSERT_EQUAL_HEX32((uint32_t)flash_str, v >> 1);
+  TEST_ASSERT_EQUAL(1, v & 1);
+
+  // %% and %n take nothing, stars and doubles are packed
+  int count;
+  len = encode(frame, "%%%n %*.*f", &count, -4, 2, 1.0);
+  TEST_ASSERT_EQUAL(6 + 2 + 8, len);
+  TEST_ASSERT_EQUAL_HEX8(0x07, frame[6]);
+  TEST_ASSERT_EQUAL_HEX8(0x04, frame[7]);
+  double d;
+  memcpy(&d, frame + 8, 8);
+  TEST_ASSERT_EQUAL_DOUBLE(1.0, d);
+}
+
+void test_truncated(void) {
+  char big[400];
+  memset(big, 'a', sizeof(big) - 1);
+  big[sizeof(big) - 1] = 0;
+  uint8_t frame[LOG_TOKEN_FRAME_MAX];
+  // the string is cut to what fits, the arguments after it are left out
+  size_t len = encode(frame, "%s %d", big, 1);
+  TEST_ASSERT_LESS_OR_EQUAL(LOG_TOKEN_FRAME_MAX, len);
+  TEST_ASSERT_EQUAL(len - 2, frame[1]);
+
+  // only the characters within the precision are read, the array has no terminating zero
+  char chars[4] = {'a', 'b', 'c', 'd'};
+  len = encode(frame, "%.*s", 3, chars);
+  TEST_ASSERT_EQUAL(6 + 1 + 1 + 3, len);
+  TEST_ASSERT_EQUAL_HEX8(0x06, frame[6]);
+  TEST_ASSERT_EQUAL_HEX8(3 << 1, frame[7]);
+  TEST_ASSERT_EQUAL_MEMORY("abc", frame + 8, 3);
+  len = encode(frame, "%.4s", chars);
+  TEST_ASSERT_EQUAL(6 + 1 + 4, len);
+  TEST_ASSERT_EQUAL_MEMORY("abcd", frame + 7, 4);
+}
+
+void test_bench(void) {
+  static const char *format = "[%6u][I][" __FILE__ ":" "123" "] %s(): connected to %s, rssi %d dBm\r\n";
+  char text[256];
+  uint8_t frame[LOG_TOKEN_FRAME_MAX];
+  uint32_t textBytes = 0, tokenBytes = 0;
+  uint32_t start = esp_cpu_get_cycle_count();
+  for (uint32_t i = 0; i < BENCH_MESSAGES; i++) {
+    textBytes += snprintf(text, sizeof(text), format, millis(), __FUNCTION__, "home-network", -60 - (int)(i % 20));
+  }
+  uint32_t textCycles = esp_cpu_get_cycle_count() - start;
+  uint32_t token = logTokenHash(format);
+  start = esp_cpu_get_cycle_count();
+  for (uint32_t i = 0; i < BENCH_MESSAGES; i++) {
+    tokenBytes += encode_token(frame, token, format, millis(), __FUNCTION__, "home-network", -60 - (int)(i % 20));
+  }
+  uint32_t tokenCycles = esp_cpu_get_cycle_count() - start;
+
+  Serial.printf(
+    "per message: text %lu bytes %lu cycles, tokenized %lu bytes %lu cycles\n", textBytes / BENCH_MESSAGES, textCycles / BENCH_MESSAGES,
+    tokenBytes / BENCH_MESSAGES, tokenCycles / BENCH_MESSAGES
+  );
+  TEST_ASSERT_LESS_THAN(textBytes / 2, tokenBytes);
+  TEST_ASSERT_LESS_THAN(textCycles, tokenCycles);
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(test_hash);
+  RUN_TEST(test_frames);
+  RUN_TEST(test_truncated);
+  RUN_TEST(test_bench);
+  UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,197 @@
+/* USB MSC block cache test
+ *
+ * The cache is driven the way TinyUSB calls the READ10 and WRITE10 callbacks, in 512 bytes chunks,
+ * on top of a RAM disk that counts the medium accesses and adds the latency of an SD card to each.
+ */
+
+#include <unity.h>
+#include "USBMSCCache.h"
+
+#define BLOCK_SIZE      512
+#define BLOCK_COUNT     64
+#define MEDIUM_LATENCY  300  // us per call to the medium
+#define FAT_BLOCK       1
+
+static uint8_t disk[BLOCK_COUNT * BLOCK_SIZE];
+static uint8_t model[BLOCK_COUNT * BLOCK_SIZE];
+static uint8_t host[BLOCK_COUNT * BLOCK_SIZE];
+static uint32_t medium_reads, medium_writes;
+static bool medium_failing;
+static USBMSCCache cache;
+
+static int32_t disk_read(uint32_t lba, uint32_t offset, void *buffer, uint32_t bufsize) {
+  medium_reads++;
+  delayMicroseconds(MEDIUM_LATENCY);
+  memcpy(buffer, disk + lba * BLOCK_SIZE + offset, bufsize);
+  return bufsize;
+}
+
+static int32_t disk_write(uint32_t lba, uint32_t offset, uint8_t *buffer, uint32_t bufsize) {
+  medium_writes++;
+  delayMicroseconds(MEDIUM_LATENCY);
+  if (medium_failing) {
+    return -1;
+  }
+  memcpy(disk + lba * BLOCK_SIZE + offset, buffer, bufsize);
+  return bufsize;
+}
+
+// a host transfer of <blocks> blocks, split in chunks like TinyUSB does
+static bool host_read(uint32_t lba, uint32_t blocks, uint8_t *buffer) {
+  for (uint32_t offset = 0; offset < blocks * BLOCK_SIZE; offset += BLOCK_SIZE) {
+    if (cache.read(lba, offset, buffer + offset, BLOCK_SIZE) != BLOCK_SIZE) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool host_write(uint32_t lba, uint32_t blocks, const uint8_t *buffer) {
+  for (uint32_t offset = 0; offset < blocks * BLOCK_SIZE; offset += BLOCK_SIZE) {
+    if (cache.write(lba, offset, buffer + offset, BLOCK_SIZE) != BLOCK_SIZE) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void setUp(void) {
+  for (size_t i = 0; i < sizeof(disk); i++) {
+    disk[i] = model[i] = (uint8_t)esp_random();
+  }
+  medium_reads = medium_writes = 0;
+  medium_failing = false;
+}
+
+void tearDown(void) {
+  cache.end();
+}
+
+void test_read_ahead(void) {
+  TEST_ASSERT_TRUE(cache.begin(BLOCK_COUNT, BLOCK_SIZE, 32, 8, false, disk_read, disk_write));
+  TEST_ASSERT_TRUE(host_read(0, BLOCK_COUNT, host));
+  TEST_ASSERT_EQUAL_MEMORY(model, host, sizeof(host));
+  // one medium access per window of 8 blocks
+  TEST_ASSERT_EQUAL(BLOCK_COUNT / 8, medium_reads);
+  TEST_ASSERT_EQUAL(BLOCK_COUNT - BLOCK_COUNT / 8, cache.stats().hits);
+}
+
+void test_write_back(void) {
+  uint8_t buf[16 * BLOCK_SIZE];
+  TEST_ASSERT_TRUE(cache.begin(BLOCK_COUNT, BLOCK_SIZE, 32, 8, true, disk_read, disk_write));
+  for (size_t i = 0; i < sizeof(buf); i++) {
+    buf[i] = (uint8_t)i;
+  }
+  memcpy(model + 40 * BLOCK_SIZE, buf, sizeof(buf));
+  TEST_ASSERT_TRUE(host_write(40, 16, buf));
+  TEST_ASSERT_EQUAL(0, medium_writes);
+  TEST_ASSERT_EQUAL(0, medium_reads);
+  // 16 blocks in 2 windows (40-47 and 48-55), combined in one call per window
+  TEST_ASSERT_TRUE(cache.flush());
+  TEST_ASSERT_EQUAL(2, medium_writes);
+  TEST_ASSERT_EQUAL_MEMORY(model, disk, sizeof(disk));
+
+  // a part of a block reads the rest of it first
+  const uint8_t part[] = "partial";
+  memcpy(model + 60 * BLOCK_SIZE + 100, part, sizeof(part));
+  TEST_ASSERT_EQUAL(sizeof(part), cache.write(60, 100, part, sizeof(part)));
+  TEST_ASSERT_EQUAL(1, medium_reads);
+  TEST_ASSERT_TRUE(cache.flush());
+  TEST_ASSERT_EQUAL_MEMORY(model, disk, sizeof(disk));
+}
+
+void test_write_through(void) {
+  uint8_t buf[BLOCK_SIZE];
+  TEST_ASSERT_TRUE(cache.begin(BLOCK_COUNT, BLOCK_SIZE, 32, 8, false, disk_read, disk_write));
+  TEST_ASSERT_TRUE(host_read(8, 8, host));
+  uint32_t reads = medium_reads;
+
+  // the cached copy is updated with the medium
+  memset(buf, 0x55, sizeof(buf));
+  memcpy(model + 10 * BLOCK_SIZE, buf, sizeof(buf));
+  TEST_ASSERT_TRUE(host_write(10, 1, buf));
+  TEST_ASSERT_EQUAL(1, medium_writes);
+  TEST_ASSERT_EQUAL_MEMORY(model, disk, sizeof(disk));
+
+  // a failed write leaves the cache as the medium, the blocks are read from it again
+  memset(buf, 0xAA, sizeof(buf));
+  medium_failing = true;
+  TEST_ASSERT_FALSE(host_write(12, 1, buf));
+  medium_failing = false;
+  TEST_ASSERT_TRUE(host_read(8, 8, host));
+  TEST_ASSERT_EQUAL_MEMORY(model + 8 * BLOCK_SIZE, host, 8 * BLOCK_SIZE);
+  TEST_ASSERT_EQUAL(reads + 1, medium_reads);
+}
+
+void test_eviction(void) {
+  uint8_t buf[BLOCK_SIZE];
+  // 2 windows only, dirty blocks of evicted windows are written first
+  TEST_ASSERT_TRUE(cache.begin(BLOCK_COUNT, BLOCK_SIZE, 16, 8, true, disk_read, disk_write));
+  for (uint32_t lba = 0; lba < BLOCK_COUNT; lba += 4) {
+    memset(buf, lba, sizeof(buf));
+    memcpy(model + lba * BLOCK_SIZE, buf, sizeof(buf));
+    TEST_ASSERT_TRUE(host_write(lba, 1, buf));
+  }
+  TEST_ASSERT_GREATER_THAN(0, medium_writes);
+  TEST_ASSERT_TRUE(cache.flush());
+  TEST_ASSERT_EQUAL_MEMORY(model, disk, sizeof(disk));
+}
+
+void test_hot_blocks(void) {
+  uint8_t buf[BLOCK_SIZE];
+  TEST_ASSERT_TRUE(cache.begin(BLOCK_COUNT, BLOCK_SIZE, 32, 8, false, disk_read, disk_write));
+  // the FAT is read again between the reads of a file, which makes its window hot
+  TEST_ASSERT_TRUE(host_read(FAT_BLOCK, 1, buf));
+  TEST_ASSERT_TRUE(host_read(40, 1, buf));
+  TEST_ASSERT_TRUE(host_read(FAT_BLOCK, 1, buf));
+  // streaming a file through the cache evicts the cold windows only
+  uint8_t file[8 * BLOCK_SIZE];
+  for (uint32_t lba = 16; lba < BLOCK_COUNT; lba += 8) {
+    TEST_ASSERT_TRUE(host_read(lba, 8, file));
+  }
+  uint32_t reads = medium_reads;
+  TEST_ASSERT_TRUE(host_read(FAT_BLOCK, 1, buf));
+  TEST_ASSERT_EQUAL(reads, medium_reads);
+  TEST_ASSERT_EQUAL_MEMORY(model + FAT_BLOCK * BLOCK_SIZE, buf, BLOCK_SIZE);
+}
+
+static uint32_t bench(uint16_t cache_blocks, uint8_t read_ahead, bool write_back) {
+  // without cache_blocks, calls go straight to the medium
+  TEST_ASSERT_TRUE(cache.begin(BLOCK_COUNT, BLOCK_SIZE, cache_blocks, read_ahead, write_back, disk_read, disk_write));
+  uint32_t start = micros();
+  TEST_ASSERT_TRUE(host_write(0, BLOCK_COUNT, host));
+  TEST_ASSERT_TRUE(cache.flush());
+  TEST_ASSERT_TRUE(host_read(0, BLOCK_COUNT, host));
+  uint32_t elapsed = micros() - start;
+  cache.end();
+  return elapsed;
+}
+
+void test_bench(void) {
+  uint32_t direct = bench(0, 1, false);
+  uint32_t cached = bench(32, 8, true);
+  uint32_t cached32 = bench(64, 32, true);
+  Serial.printf(
+    "write + read of %u kB: direct %lu kB/s, cache 32/8 %lu kB/s, cache 64/32 %lu kB/s\n", sizeof(disk) / 1024, 2 * sizeof(disk) * 1000 / direct,
+    2 * sizeof(disk) * 1000 / cached, 2 * sizeof(disk) * 1000 / cached32
+  );
+  TEST_ASSERT_LESS_THAN(direct / 2, cached);
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(test_read_ahead);
+  RUN_TEST(test_write_back);
+  RUN_TEST(test_write_through);
+  RUN_TEST(test_eviction);
+  RUN_TEST(test_hot_blocks);
+  RUN_TEST(test_bench);
+  UNITY_END();
+}
+
+void loop() {}
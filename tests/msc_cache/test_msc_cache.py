@@ -0,0 +1,2 @@
+def test_msc_cache(dut):
+    dut.expect_unity_test_output(timeout=120)
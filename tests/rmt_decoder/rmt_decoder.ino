@@ -0,0 +1,185 @@
+/* RMT Symbol decoders test
+ *
+ * The decoders are fed with RMT Symbol traces recorded with rmtRead() from an IR receiver
+ * (1MHz RMT tick) and from a WS2812 data line (10MHz RMT tick). No wiring is needed.
+ */
+
+#include <unity.h>
+
+#define RMT_SYM(d0, l0, d1, l1) {{d0, l0, d1, l1}}
+
+// NEC - address 0x04, command 0x08, followed by a repeat code frame
+static const rmt_data_t nec_trace[] = {
+  RMT_SYM(9036, 0, 4474, 1), RMT_SYM(578, 0, 552, 1),  RMT_SYM(573, 0, 548, 1),  RMT_SYM(577, 0, 1681, 1), RMT_SYM(571, 0, 553, 1),
+  RMT_SYM(575, 0, 551, 1),   RMT_SYM(569, 0, 557, 1),  RMT_SYM(574, 0, 552, 1),  RMT_SYM(576, 0, 549, 1),  RMT_SYM(570, 0, 1685, 1),
+  RMT_SYM(572, 0, 1683, 1),  RMT_SYM(575, 0, 554, 1),  RMT_SYM(571, 0, 1686, 1), RMT_SYM(577, 0, 1679, 1), RMT_SYM(568, 0, 1690, 1),
+  RMT_SYM(574, 0, 1682, 1),  RMT_SYM(570, 0, 1688, 1), RMT_SYM(576, 0, 550, 1),  RMT_SYM(573, 0, 552, 1),  RMT_SYM(571, 0, 555, 1),
+  RMT_SYM(569, 0, 1687, 1),  RMT_SYM(577, 0, 549, 1),  RMT_SYM(570, 0, 556, 1),  RMT_SYM(574, 0, 551, 1),  RMT_SYM(572, 0, 553, 1),
+  RMT_SYM(575, 0, 1682, 1),  RMT_SYM(571, 0, 1686, 1), RMT_SYM(573, 0, 1684, 1), RMT_SYM(569, 0, 553, 1),  RMT_SYM(578, 0, 1678, 1),
+  RMT_SYM(570, 0, 1689, 1),  RMT_SYM(574, 0, 1683, 1), RMT_SYM(572, 0, 1685, 1), RMT_SYM(571, 0, 0, 1),
+  // repeat code - sent in a new RMT frame
+  RMT_SYM(9021, 0, 2238, 1), RMT_SYM(569, 0, 0, 1),
+};
+
+// RC5 - toggle 1, address 5, command 0x2A - 14 bits: 1 1 1 00101 101010
+static const rmt_data_t rc5_trace[] = {
+  RMT_SYM(885, 0, 893, 1),  RMT_SYM(881, 0, 891, 1),  RMT_SYM(1770, 0, 895, 1),  RMT_SYM(887, 0, 1783, 1), RMT_SYM(1772, 0, 1780, 1),
+  RMT_SYM(879, 0, 896, 1),  RMT_SYM(1768, 0, 1781, 1), RMT_SYM(1774, 0, 1779, 1), RMT_SYM(1777, 0, 0, 1),
+};
+
+// WS2812 echo - two pixels 0x123456 and 0xABCDEF (GRB), 10MHz tick
+static const uint32_t ws28xx_pixels[] = {0x123456, 0xABCDEF};
+
+static rmt_data_t ws28xx_trace[48];
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_nec(void) {
+  rmt_decoder_t decoder;
+  rmt_frame_t frames[4];
+  size_t consumed = 0;
+
+  TEST_ASSERT_TRUE(rmtDecoderInit(&decoder, RMT_PROTOCOL_NEC, 1000000));
+  size_t num_frames = rmtDecode(&decoder, nec_trace, RMT_SYMBOLS_OF(nec_trace), frames, 4, &consumed);
+  TEST_ASSERT_EQUAL(2, num_frames);
+  TEST_ASSERT_EQUAL(RMT_SYMBOLS_OF(nec_trace), consumed);
+  TEST_ASSERT_EQUAL(RMT_PROTOCOL_NEC, frames[0].protocol);
+  TEST_ASSERT_EQUAL(32, frames[0].num_bits);
+  TEST_ASSERT_FALSE(frames[0].repeat);
+  TEST_ASSERT_EQUAL_HEX16(0x04, frames[0].address);
+  TEST_ASSERT_EQUAL_HEX16(0x08, frames[0].command);
+  TEST_ASSERT_TRUE(frames[1].repeat);
+  TEST_ASSERT_EQUAL_HEX32(frames[0].data, frames[1].data);
+}
+
+void test_nec_split_buffers(void) {
+  rmt_decoder_t decoder;
+  rmt_frame_t frame;
+  size_t num_frames = 0;
+
+  // frames split across small buffers, as with rmtReadContinuousFrame(), decoded one frame at a time
+  TEST_ASSERT_TRUE(rmtDecoderInit(&decoder, RMT_PROTOCOL_NEC, 1000000));
+  for (size_t i = 0; i < RMT_SYMBOLS_OF(nec_trace); i += 5) {
+    size_t len = min((size_t)5, RMT_SYMBOLS_OF(nec_trace) - i);
+    size_t consumed = 0;
+    while (consumed < len) {
+      size_t used = 0;
+      if (rmtDecode(&decoder, nec_trace + i + consumed, len - consumed, &frame, 1, &used) == 1) {
+        num_frames++;
+        TEST_ASSERT_EQUAL_HEX16(0x08, frame.command);
+        TEST_ASSERT_EQUAL(num_frames == 2, frame.repeat);
+      }
+      consumed += used;
+    }
+  }
+  TEST_ASSERT_EQUAL(2, num_frames);
+}
+
+void test_nec_bad_timing(void) {
+  rmt_decoder_t decoder;
+  rmt_frame_t frames[2];
+  rmt_data_t trace[RMT_SYMBOLS_OF(nec_trace)];
+
+  memcpy(trace, nec_trace, sizeof(trace));
+  trace[10].duration1 = 1200;  // neither a "0" nor a "1" space
+  TEST_ASSERT_TRUE(rmtDecoderInit(&decoder, RMT_PROTOCOL_NEC, 1000000));
+  size_t num_frames = rmtDecode(&decoder, trace, 34, frames, 2, NULL);
+  TEST_ASSERT_EQUAL(0, num_frames);
+  // the repeat code has no valid code to repeat
+  num_frames = rmtDecode(&decoder, trace + 34, 2, frames, 2, NULL);
+  TEST_ASSERT_EQUAL(1, num_frames);
+  TEST_ASSERT_TRUE(frames[0].repeat);
+  TEST_ASSERT_EQUAL(0, frames[0].num_bits);
+}
+
+void test_rc5(void) {
+  rmt_decoder_t decoder;
+  rmt_frame_t frames[2];
+
+  TEST_ASSERT_TRUE(rmtDecoderInit(&decoder, RMT_PROTOCOL_RC5, 1000000));
+  size_t num_frames = rmtDecode(&decoder, rc5_trace, RMT_SYMBOLS_OF(rc5_trace), frames, 2, NULL);
+  TEST_ASSERT_EQUAL(1, num_frames);
+  TEST_ASSERT_EQUAL(14, frames[0].num_bits);
+  TEST_ASSERT_TRUE(frames[0].repeat);
+  TEST_ASSERT_EQUAL(5, frames[0].address);
+  TEST_ASSERT_EQUAL_HEX16(0x2A, frames[0].command);
+}
+
+void test_ws28xx(void) {
+  rmt_decoder_t decoder;
+  rmt_frame_t frames[4];
+  int i = 0;
+
+  for (int px = 0; px < 2; px++) {
+    for (int bit = 23; bit >= 0; bit--) {
+      bool one = (ws28xx_pixels[px] >> bit) & 1;
+      ws28xx_trace[i].level0 = 1;
+      ws28xx_trace[i].duration0 = one ? 8 : 4;
+      ws28xx_trace[i].level1 = 0;
+      ws28xx_trace[i].duration1 = one ? 4 : 8;
+      i++;
+    }
+  }
+  ws28xx_trace[i - 1].duration1 = 0;  // end of the RMT frame
+
+  TEST_ASSERT_TRUE(rmtDecoderInit(&decoder, RMT_PROTOCOL_WS28XX, 10000000));
+  size_t num_frames = rmtDecode(&decoder, ws28xx_trace, RMT_SYMBOLS_OF(ws28xx_trace), frames, 4, NULL);
+  TEST_ASSERT_EQUAL(2, num_frames);
+  TEST_ASSERT_EQUAL_HEX32(ws28xx_pixels[0], frames[0].data);
+  TEST_ASSERT_EQUAL_HEX32(ws28xx_pixels[1], frames[1].data);
+}
+
+void test_pulse(void) {
+  rmt_decoder_t decoder;
+  rmt_frame_t frame;
+  rmt_data_t symbol = RMT_SYM(100, 0, 30, 1);
+
+  TEST_ASSERT_TRUE(rmtDecoderInit(&decoder, RMT_PROTOCOL_PULSE, 1000000));
+  TEST_ASSERT_TRUE(rmtDecoderFeed(&decoder, symbol, &frame));
+  TEST_ASSERT_EQUAL(30000, frame.high_ns);
+  TEST_ASSERT_EQUAL(100000, frame.low_ns);
+}
+
+static bool count_long_pulses(rmt_decoder_t *decoder, rmt_data_t symbol, rmt_frame_t *frame) {
+  if (rmtDecoderMatch(decoder, symbol.duration0, 5000000)) {
+    frame->protocol = RMT_PROTOCOL_CUSTOM;
+    frame->data = ++decoder->bits;
+    return true;
+  }
+  return false;
+}
+
+void test_custom(void) {
+  rmt_decoder_t decoder;
+  rmt_frame_t frames[4];
+
+  TEST_ASSERT_TRUE(rmtDecoderInitCustom(&decoder, count_long_pulses, 1000000, NULL));
+  size_t num_frames = rmtDecode(&decoder, nec_trace, RMT_SYMBOLS_OF(nec_trace), frames, 4, NULL);
+  TEST_ASSERT_EQUAL(0, num_frames);
+  num_frames = rmtDecode(&decoder, rc5_trace, RMT_SYMBOLS_OF(rc5_trace), frames, 4, NULL);
+  TEST_ASSERT_EQUAL(0, num_frames);
+  rmt_data_t symbol = RMT_SYM(5010, 1, 500, 0);
+  TEST_ASSERT_TRUE(rmtDecoderFeed(&decoder, symbol, &frames[0]));
+  TEST_ASSERT_EQUAL(1, frames[0].data);
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(test_nec);
+  RUN_TEST(test_nec_split_buffers);
+  RUN_TEST(test_nec_bad_timing);
+  RUN_TEST(test_rc5);
+  RUN_TEST(test_ws28xx);
+  RUN_TEST(test_pulse);
+  RUN_TEST(test_custom);
+  UNITY_END();
+}
+
+void loop() {}
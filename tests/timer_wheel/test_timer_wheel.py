@@ -0,0 +1,2 @@
+def test_timer_wheel(dut):
+    dut.expect_unity_test_output(timeout=240)
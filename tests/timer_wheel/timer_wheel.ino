@@ -0,0 +1,198 @@
+/* Timer Wheel test
+ *
+ * The wheel logic is driven with a virtual tick, then the benchmark measures the cost of
+ * adding, expiring and cancelling up to 10000 timers. The last test runs the wheel on a GPTimer.
+ */
+
+#include <unity.h>
+
+#define BENCH_TIMERS 10000
+
+static timer_wheel_t wheel;
+static uint64_t fired_at[8];
+static uint32_t fired_count[8];
+
+static void record_cb(timer_wheel_timer_t *timer, void *arg) {
+  uint32_t i = (uintptr_t)arg;
+  fired_at[i] = wheel.now;
+  fired_count[i]++;
+}
+
+void setUp(void) {
+  memset(fired_at, 0, sizeof(fired_at));
+  memset(fired_count, 0, sizeof(fired_count));
+}
+
+void tearDown(void) {}
+
+void test_one_shot(void) {
+  // delays around the span of each level, starting close to a wheel wrap around
+  const uint32_t delays[] = {0, 1, 63, 64, 4095, 4096, 16777215, 16777216};
+  timer_wheel_timer_t timers[8];
+  timerWheelInit(&wheel, 0xFFFFFFF0ULL);
+  for (uint32_t i = 0; i < 8; i++) {
+    timerWheelTimerInit(&timers[i], record_cb, (void *)(uintptr_t)i);
+    timerWheelAdd(&wheel, &timers[i], delays[i], 0);
+  }
+  TEST_ASSERT_EQUAL(8, wheel.count);
+
+  // turn the wheel with irregular steps
+  uint64_t now = 0xFFFFFFF0ULL;
+  while (wheel.count) {
+    now += 1 + (now % 1000);
+    timerWheelAdvance(&wheel, now);
+  }
+  for (uint32_t i = 0; i < 8; i++) {
+    TEST_ASSERT_EQUAL(1, fired_count[i]);
+    TEST_ASSERT_EQUAL_UINT64(0xFFFFFFF0ULL + (delays[i] ? delays[i] : 1), fired_at[i]);
+    TEST_ASSERT_FALSE(timerWheelActive(&timers[i]));
+  }
+}
+
+void test_beyond_span(void) {
+  timer_wheel_timer_t timer;
+  timerWheelInit(&wheel, 0);
+  timerWheelTimerInit(&timer, record_cb, (void *)0);
+  timerWheelAdd(&wheel, &timer, 20000000, 0);
+  timerWheelAdvance(&wheel, 19999999);
+  TEST_ASSERT_EQUAL(0, fired_count[0]);
+  timerWheelAdvance(&wheel, 20000000);
+  TEST_ASSERT_EQUAL(1, fired_count[0]);
+}
+
+void test_periodic(void) {
+  timer_wheel_timer_t timer;
+  timerWheelInit(&wheel, 0);
+  timerWheelTimerInit(&timer, record_cb, (void *)0);
+  timerWheelAdd(&wheel, &timer, 10, 100);
+  TEST_ASSERT_EQUAL(10, timerWheelAdvance(&wheel, 910));
+  TEST_ASSERT_EQUAL_UINT64(910, fired_at[0]);
+  TEST_ASSERT_TRUE(timerWheelActive(&timer));
+  TEST_ASSERT_TRUE(timerWheelCancel(&wheel, &timer));
+  TEST_ASSERT_FALSE(timerWheelCancel(&wheel, &timer));
+  TEST_ASSERT_EQUAL(0, timerWheelAdvance(&wheel, 2000));
+  TEST_ASSERT_EQUAL(0, wheel.count);
+}
+
+static timer_wheel_timer_t chain[2];
+
+static void cancel_other_cb(timer_wheel_timer_t *timer, void *arg) {
+  record_cb(timer, arg);
+  // stops itself and the other timer, which expires at the same tick
+  timerWheelCancel(&wheel, timer);
+  timerWheelCancel(&wheel, &chain[1]);
+}
+
+static void restart_cb(timer_wheel_timer_t *timer, void *arg) {
+  record_cb(timer, arg);
+  if (fired_count[(uintptr_t)arg] < 3) {
+    timerWheelAdd(&wheel, timer, 5, 0);
+  }
+}
+
+void test_callback_changes(void) {
+  timerWheelInit(&wheel, 0);
+  timerWheelTimerInit(&chain[0], cancel_other_cb, (void *)0);
+  timerWheelTimerInit(&chain[1], record_cb, (void *)1);
+  timerWheelAdd(&wheel, &chain[0], 20, 20);
+  timerWheelAdd(&wheel, &chain[1], 20, 0);
+  timerWheelAdvance(&wheel, 100);
+  TEST_ASSERT_EQUAL(1, fired_count[0]);
+  TEST_ASSERT_EQUAL(0, fired_count[1]);
+  TEST_ASSERT_EQUAL(0, wheel.count);
+
+  timerWheelTimerInit(&chain[0], restart_cb, (void *)2);
+  timerWheelAdd(&wheel, &chain[0], 5, 0);
+  timerWheelAdvance(&wheel, 1000);
+  TEST_ASSERT_EQUAL(3, fired_count[2]);
+  TEST_ASSERT_EQUAL_UINT64(115, fired_at[2]);
+}
+
+static void count_cb(timer_wheel_timer_t *timer, void *arg) {
+  (*(uint32_t *)arg)++;
+}
+
+void test_benchmark(void) {
+  size_t num_timers = BENCH_TIMERS;
+  timer_wheel_timer_t *timers = NULL;
+  while (num_timers && (timers = (timer_wheel_timer_t *)malloc(num_timers * sizeof(timer_wheel_timer_t))) == NULL) {
+    num_timers /= 2;
+  }
+  TEST_ASSERT_NOT_NULL(timers);
+
+  uint32_t fired = 0;
+  timerWheelInit(&wheel, 0);
+  for (size_t i = 0; i < num_timers; i++) {
+    timerWheelTimerInit(&timers[i], count_cb, &fired);
+  }
+
+  uint32_t start = micros();
+  for (size_t i = 0; i < num_timers; i++) {
+    // one timer out of two is periodic, delays spread over the first three levels
+    timerWheelAdd(&wheel, &timers[i], 1 + (i * 7919) % 100000, (i & 1) ? 1000 + (i % 1000) : 0);
+  }
+  uint32_t add_us = micros() - start;
+
+  start = micros();
+  for (uint64_t tick = 1; tick <= 100000; tick++) {
+    timerWheelAdvance(&wheel, tick);
+  }
+  uint32_t run_us = micros() - start;
+
+  start = micros();
+  for (size_t i = 0; i < num_timers; i++) {
+    timerWheelCancel(&wheel, &timers[i]);
+  }
+  uint32_t cancel_us = micros() - start;
+
+  Serial.printf("%u timers, %lu callbacks over 100000 ticks\n", num_timers, fired);
+  Serial.printf("add:    %.3f us per timer\n", (float)add_us / num_timers);
+  Serial.printf("cancel: %.3f us per timer\n", (float)cancel_us / num_timers);
+  Serial.printf("run:    %.3f us per tick, %.3f us per callback\n", (float)run_us / 100000, (float)run_us / fired);
+
+  TEST_ASSERT_EQUAL(0, wheel.count);
+  TEST_ASSERT_GREATER_THAN(num_timers, fired);
+  free(timers);
+}
+
+static volatile uint32_t hw_count[2];
+
+static void hw_cb(timer_wheel_timer_t *timer, void *arg) {
+  hw_count[(uintptr_t)arg]++;
+}
+
+void test_gptimer(void) {
+  for (int dispatch = TIMER_WHEEL_DISPATCH_ISR; dispatch <= TIMER_WHEEL_DISPATCH_TASK; dispatch++) {
+    timer_wheel_timer_t periodic, once;
+    hw_count[0] = hw_count[1] = 0;
+    TEST_ASSERT_TRUE(timerWheelBegin(1000, (timer_wheel_dispatch_t)dispatch));
+    timerWheelTimerInit(&periodic, hw_cb, (void *)0);
+    timerWheelTimerInit(&once, hw_cb, (void *)1);
+    TEST_ASSERT_TRUE(timerWheelStart(&periodic, 10000, 10000));
+    TEST_ASSERT_TRUE(timerWheelStart(&once, 50000, 0));
+    delay(1005);
+    TEST_ASSERT_TRUE(timerWheelStop(&periodic));
+    TEST_ASSERT_FALSE(timerWheelStop(&once));
+    timerWheelEnd();
+    TEST_ASSERT_UINT32_WITHIN(1, 100, hw_count[0]);
+    TEST_ASSERT_EQUAL(1, hw_count[1]);
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(test_one_shot);
+  RUN_TEST(test_beyond_span);
+  RUN_TEST(test_periodic);
+  RUN_TEST(test_callback_changes);
+  RUN_TEST(test_benchmark);
+  RUN_TEST(test_gptimer);
+  UNITY_END();
+}
+
+void loop() {}
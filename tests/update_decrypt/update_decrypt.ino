@@ -0,0 +1,199 @@
+/* Update decrypt test
+ *
+ * Checks the decryption of flash encrypted OTA images against the block by block
+ * implementation Update used before, for all the flash crypt configs, and prints
+ * the throughput of both.
+ */
+
+#include <unity.h>
+#include "mbedtls/aes.h"
+#include "UpdateCrypt.h"
+
+#define KEY_SIZE    32
+#define BLOCK_SIZE  16
+#define BUFFER_SIZE 4096
+#define BENCH_SIZE  (64 * 1024)
+
+static uint8_t key[KEY_SIZE];
+static uint8_t *plain;
+static uint8_t *expected;
+static uint8_t *actual;
+static uint32_t seed;
+
+static uint32_t next_random() {
+  seed = seed * 1664525 + 1013904223;
+  return seed >> 8;
+}
+
+static void fill_random(uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    data[i] = next_random();
+  }
+}
+
+static void reference_key_tweak(size_t address, uint8_t cfg, uint8_t *tweaked_key) {
+  memcpy(tweaked_key, key, KEY_SIZE);
+  if (cfg == 0) {
+    return;
+  }
+  const uint8_t pattern[] = {23, 23, 23, 14, 23, 23, 23, 12, 23, 23, 23, 10, 23, 23, 23, 8};
+  int pattern_idx = 0;
+  int key_idx = 0;
+  int bit_len = 0;
+  uint32_t tweak = 0;
+  address &= 0x00ffffe0;
+  address <<= 8;
+  while (pattern_idx < sizeof(pattern)) {
+    tweak = address << (23 - pattern[pattern_idx]);
+    tweak = (tweak << (8 - bit_len)) | (tweak >> (24 + bit_len));
+    bit_len += pattern[pattern_idx++] - 4;
+    while (bit_len > 7) {
+      tweaked_key[key_idx++] ^= tweak;
+      tweak = (tweak << 8) | (tweak >> 24);
+      bit_len -= 8;
+    }
+    tweaked_key[key_idx] ^= tweak;
+  }
+  if (cfg == 0xf) {
+    return;
+  }
+  const uint8_t cfg_bits[] = {67, 65, 63, 61};
+  key_idx = 0;
+  pattern_idx = 0;
+  while (key_idx < KEY_SIZE) {
+    bit_len += cfg_bits[pattern_idx];
+    if ((cfg & (1 << pattern_idx)) == 0) {
+      while (bit_len > 0) {
+        if (bit_len > 7 || ((cfg & (2 << pattern_idx)) == 0)) {
+          tweaked_key[key_idx] = key[key_idx];
+        } else {
+          tweaked_key[key_idx] &= (0xff >> bit_len);
+          tweaked_key[key_idx] |= (key[key_idx] & (~(0xff >> bit_len)));
+        }
+        key_idx++;
+        bit_len -= 8;
+      }
+    } else {
+      while (bit_len > 0) {
+        if (bit_len < 8 && ((cfg & (2 << pattern_idx)) == 0)) {
+          tweaked_key[key_idx] &= (~(0xff >> bit_len));
+          tweaked_key[key_idx] |= (key[key_idx] & (0xff >> bit_len));
+        }
+        key_idx++;
+        bit_len -= 8;
+      }
+    }
+    pattern_idx++;
+  }
+}
+
+// one key schedule and one byte reversal per 16 bytes block
+static bool reference_decrypt(size_t address, uint8_t cfg, uint8_t *data, size_t len) {
+  uint8_t block[BLOCK_SIZE];
+  uint8_t tweaked_key[KEY_SIZE];
+  mbedtls_aes_context ctx;
+  mbedtls_aes_init(&ctx);
+  bool ok = true;
+  for (size_t done = 0; ok && done < len; done += BLOCK_SIZE) {
+    for (int i = 0; i < BLOCK_SIZE; i++) {
+      block[(BLOCK_SIZE - 1) - i] = data[i + done];
+    }
+    if (((address + done) % 32) == 0 || done == 0) {
+      reference_key_tweak(address + done, cfg, tweaked_key);
+      ok = !mbedtls_aes_setkey_enc(&ctx, tweaked_key, 256);
+    }
+    ok = ok && !mbedtls_aes_crypt_ecb(&ctx, MBEDTLS_AES_ENCRYPT, block, block);
+    for (int i = 0; i < BLOCK_SIZE; i++) {
+      data[i + done] = block[(BLOCK_SIZE - 1) - i];
+    }
+  }
+  mbedtls_aes_free(&ctx);
+  return ok;
+}
+
+void setUp(void) {
+  seed = 0x5eed;
+  fill_random(key, KEY_SIZE);
+}
+
+void tearDown(void) {}
+
+void test_decrypt_configs(void) {
+  const size_t addresses[] = {0x10000, 0x10010, 0x1234560, 0x3ffff0};
+  const size_t sizes[] = {16, 32, 48, 1040, BUFFER_SIZE};
+  for (uint8_t cfg = 0; cfg <= 0xf; cfg++) {
+    UpdateCrypt crypt(key, cfg);
+    for (size_t address : addresses) {
+      for (size_t len : sizes) {
+        fill_random(plain, len);
+        memcpy(expected, plain, len);
+        memcpy(actual, plain, len);
+        TEST_ASSERT_TRUE(reference_decrypt(address, cfg, expected, len));
+        TEST_ASSERT_TRUE(crypt.decrypt(address, actual, len));
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, actual, len);
+      }
+    }
+  }
+}
+
+// the buffers of an image are decrypted one after the other by the same engine
+void test_decrypt_split(void) {
+  for (uint8_t cfg : {0x0, 0x5, 0xf}) {
+    UpdateCrypt crypt(key, cfg);
+    fill_random(plain, BUFFER_SIZE);
+    memcpy(expected, plain, BUFFER_SIZE);
+    memcpy(actual, plain, BUFFER_SIZE);
+    TEST_ASSERT_TRUE(reference_decrypt(0x20000, cfg, expected, BUFFER_SIZE));
+    for (size_t done = 0; done < BUFFER_SIZE; done += 16 * (1 + done % 7)) {
+      size_t len = min((size_t)16 * (1 + done % 7), BUFFER_SIZE - done);
+      TEST_ASSERT_TRUE(crypt.decrypt(0x20000 + done, actual + done, len));
+    }
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, actual, BUFFER_SIZE);
+  }
+}
+
+void test_decrypt_length(void) {
+  UpdateCrypt crypt(key, 0xf);
+  TEST_ASSERT_FALSE(crypt.decrypt(0x10000, actual, BLOCK_SIZE + 1));
+  TEST_ASSERT_TRUE(crypt.decrypt(0x10000, actual, 0));
+}
+
+void test_decrypt_throughput(void) {
+  fill_random(plain, BUFFER_SIZE);
+  for (uint8_t cfg : {0x0, 0xf}) {
+    UpdateCrypt crypt(key, cfg);
+    uint32_t start = micros();
+    for (size_t done = 0; done < BENCH_SIZE; done += BUFFER_SIZE) {
+      reference_decrypt(0x10000 + done, cfg, plain, BUFFER_SIZE);
+    }
+    uint32_t reference_us = micros() - start;
+
+    start = micros();
+    for (size_t done = 0; done < BENCH_SIZE; done += BUFFER_SIZE) {
+      crypt.decrypt(0x10000 + done, plain, BUFFER_SIZE);
+    }
+    uint32_t crypt_us = micros() - start;
+
+    Serial.printf("config 0x%x: reference %.2f MB/s, UpdateCrypt %.2f MB/s\n", cfg, (float)BENCH_SIZE / reference_us, (float)BENCH_SIZE / crypt_us);
+    TEST_ASSERT_GREATER_THAN(0, crypt_us);
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  plain = (uint8_t *)malloc(BUFFER_SIZE);
+  expected = (uint8_t *)malloc(BUFFER_SIZE);
+  actual = (uint8_t *)malloc(BUFFER_SIZE);
+  UNITY_BEGIN();
+  RUN_TEST(test_decrypt_configs);
+  RUN_TEST(test_decrypt_split);
+  RUN_TEST(test_decrypt_length);
+  RUN_TEST(test_decrypt_throughput);
+  UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,2 @@
+def test_update_image(dut):
+    dut.expect_unity_test_output(timeout=120)
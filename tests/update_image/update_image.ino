@@ -0,0 +1,263 @@
+/* Update image test
+ *
+ * Decodes gzip and gzipped delta images made by tools/gen_ota_image.py into RAM,
+ * with the decoders used by Update for compressed and delta OTA images.
+ * The old and new images are generated here, the same way as when the arrays were made:
+ *   gen_ota_image.py gzip new.bin -o new.gz
+ *   gen_ota_image.py delta old.bin new.bin --gzip -o delta.gz
+ */
+
+#include <unity.h>
+#include <MD5Builder.h>
+#include "UpdateGzip.h"
+#include "UpdateDelta.h"
+
+#define OLD_SIZE    1024
+#define INSERT_AT   500
+#define INSERT_SIZE 64
+#define NEW_SIZE    (OLD_SIZE + INSERT_SIZE)
+
+static const uint8_t new_gz[] = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x15, 0x54, 0x2d, 0xe8, 0x40, 0x45,
+  0x0c, 0x17, 0x0c, 0x82, 0x41, 0x30, 0x08, 0x06, 0xc1, 0x20, 0x18, 0x04, 0xe1, 0xb6, 0xdd, 0x76,
+  0x1b, 0x06, 0xc1, 0x20, 0x18, 0x04, 0x8b, 0x18, 0x04, 0xe1, 0xf6, 0x05, 0x82, 0x41, 0x30, 0x08,
+  0x06, 0xc1, 0x20, 0x18, 0x04, 0x83, 0x60, 0x10, 0x0c, 0x82, 0x41, 0x30, 0x08, 0x06, 0xc1, 0x60,
+  0xb3, 0xd9, 0x6c, 0x36, 0x9b, 0xcd, 0x66, 0x33, 0xb8, 0x7f, 0x7b, 0x77, 0xef, 0xdd, 0xed, 0xf7,
+  0xf9, 0xd8, 0x30, 0xda, 0xd2, 0x7c, 0x2d, 0xc2, 0x7b, 0xa2, 0xb2, 0xaa, 0x8c, 0x11, 0xcf, 0xf6,
+  0x5d, 0x5d, 0xc5, 0x15, 0x74, 0x4d, 0x9c, 0x0e, 0xc0, 0x49, 0x2f, 0x39, 0x8a, 0x65, 0x5b, 0x1b,
+  0x95, 0xce, 0xd6, 0x8d, 0x0e, 0x44, 0x45, 0x97, 0x16, 0x04, 0x2f, 0x17, 0xbb, 0x70, 0x6f, 0x6b,
+  0x12, 0x67, 0x43, 0x9d, 0x72, 0x2e, 0x40, 0xa8, 0x02, 0xb8, 0x05, 0x91, 0xd6, 0x48, 0x22, 0xdd,
+  0x3e, 0xc7, 0xa0, 0x33, 0xc0, 0x4b, 0x09, 0xec, 0xc4, 0xa1, 0x62, 0xf7, 0xd0, 0x40, 0x9b, 0x87,
+  0x5c, 0x27, 0x72, 0x3f, 0x1c, 0xbd, 0x7c, 0x07, 0x80, 0x6f, 0xda, 0x0e, 0xa8, 0x67, 0x51, 0xe2,
+  0xc6, 0x20, 0x08, 0x08, 0x94, 0x92, 0x8e, 0x0d, 0xcc, 0x57, 0xc5, 0xe8, 0x96, 0x5d, 0x73, 0x8a,
+  0x8d, 0x7b, 0xed, 0xcd, 0x71, 0x25, 0x2e, 0xef, 0x99, 0xb5, 0xea, 0xa4, 0x21, 0x60, 0x6d, 0x85,
+  0x75, 0xf7, 0x0e, 0xab, 0xa5, 0x14, 0x2b, 0xfb, 0x66, 0x0c, 0x07, 0x2b, 0xe1, 0x01, 0x8c, 0x60,
+  0xaa, 0x20, 0x5a, 0xe1, 0x60, 0x71, 0x77, 0x93, 0x5d, 0xb5, 0xd5, 0x87, 0x9b, 0x17, 0xc2, 0x32,
+  0x5d, 0xdd, 0x3d, 0x44, 0x34, 0x73, 0x16, 0xaa, 0x72, 0xd6, 0x30, 0x46, 0x6d, 0xd9, 0x56, 0x87,
+  0x9a, 0x61, 0xc5, 0x09, 0xee, 0xf0, 0x38, 0xda, 0x83, 0x41, 0xc9, 0x61, 0xd7, 0xcd, 0xce, 0xa4,
+  0x35, 0x1c, 0x2d, 0x01, 0x91, 0xd7, 0xa8, 0x9a, 0xc6, 0x62, 0x79, 0xd5, 0x0f, 0x04, 0x15, 0x2e,
+  0x9b, 0x01, 0x54, 0x5b, 0x48, 0x38, 0xa3, 0x29, 0x70, 0xa8, 0x3a, 0xc0, 0x8e, 0x7b, 0xc1, 0x0d,
+  0xd8, 0xcc, 0x47, 0xc2, 0x15, 0xa8, 0x63, 0xcd, 0x16, 0x54, 0x77, 0x92, 0x35, 0xc6, 0xc1, 0x68,
+  0x5a, 0x62, 0x36, 0x6e, 0x2d, 0xcf, 0x78, 0x80, 0xb4, 0xd3, 0xa5, 0x48, 0x72, 0xbb, 0x19, 0x85,
+  0x9a, 0xb2, 0x34, 0xf7, 0x8d, 0xec, 0xb9, 0xb8, 0x08, 0xe5, 0x91, 0xc7, 0x9e, 0x78, 0xea, 0x99,
+  0xe7, 0x5e, 0x00, 0x7d, 0xf9, 0xd5, 0xd7, 0xdf, 0x7c, 0xdb, 0xdf, 0x7d, 0xff, 0xc3, 0x8f, 0x3f,
+  0xfd, 0xfc, 0xcb, 0xaf, 0xbf, 0xfd, 0xfe, 0xc7, 0x9f, 0x7f, 0xfd, 0xed, 0xf7, 0x3f, 0xfe, 0xfc,
+  0xeb, 0xef, 0x7f, 0xfe, 0xfd, 0xef, 0xd1, 0xc7, 0x9f, 0x7c, 0xfa, 0xd9, 0xe7, 0x5f, 0xdc, 0x2f,
+  0xbd, 0xf2, 0xda, 0x1b, 0x6f, 0xbd, 0x53, 0xef, 0x7d, 0xf0, 0xd1, 0x27, 0x9f, 0x7d, 0xf1, 0xd5,
+  0x37, 0xdf, 0xfd, 0xf0, 0xd3, 0x2f, 0xdc, 0x9b, 0xe6, 0x6e, 0xe7, 0x51, 0x26, 0x73, 0x92, 0xb3,
+  0xf6, 0xb9, 0x02, 0xf4, 0x20, 0x9d, 0xc9, 0x0c, 0xd1, 0x92, 0x3c, 0x1d, 0x80, 0x21, 0x59, 0x18,
+  0xea, 0x1a, 0x81, 0x9d, 0xd2, 0x32, 0xce, 0x15, 0xa7, 0x8d, 0xe7, 0xee, 0xc3, 0xd8, 0xcf, 0xd9,
+  0x76, 0xc0, 0xa4, 0x26, 0x57, 0x78, 0x2e, 0x8b, 0xa7, 0x2d, 0x8f, 0xe1, 0xb6, 0xe7, 0xd0, 0x69,
+  0xa9, 0x33, 0x26, 0xcb, 0xd5, 0xb9, 0x8b, 0x89, 0x88, 0x59, 0x4d, 0x50, 0x76, 0x9b, 0xe6, 0xe2,
+  0x20, 0xe4, 0xb1, 0xc7, 0x35, 0x67, 0x9b, 0x36, 0xf2, 0xd9, 0x87, 0x6b, 0x9d, 0x5d, 0x30, 0x46,
+  0xce, 0x5b, 0x5c, 0xb7, 0x26, 0xae, 0xe5, 0x95, 0x22, 0xda, 0x21, 0xeb, 0x12, 0x8d, 0x8f, 0x32,
+  0x78, 0xc6, 0xaa, 0xcb, 0xe1, 0x43, 0x61, 0xaf, 0x81, 0xa9, 0xa5, 0x5b, 0xb8, 0x69, 0x2c, 0xba,
+  0xf7, 0xb8, 0x2f, 0x51, 0x3d, 0x18, 0xc1, 0xce, 0x09, 0x0f, 0xca, 0xfa, 0xee, 0x09, 0x15, 0x97,
+  0x55, 0x14, 0x54, 0x6a, 0x53, 0x37, 0xe6, 0x44, 0xef, 0xce, 0x42, 0xea, 0xc6, 0xf5, 0xe3, 0x09,
+  0x79, 0xa6, 0x29, 0x93, 0xfc, 0x3c, 0xe7, 0x9e, 0x03, 0x5a, 0x8e, 0x16, 0x3a, 0xaa, 0x0b, 0xf1,
+  0x9c, 0x5f, 0x00, 0x79, 0x69, 0x72, 0x7d, 0xaa, 0x70, 0x62, 0x8b, 0x77, 0x8b, 0xc4, 0x99, 0x1c,
+  0x24, 0x8d, 0xf1, 0x6b, 0xc2, 0x77, 0x57, 0x48, 0x2c, 0x3c, 0x0b, 0xc7, 0xb6, 0xe2, 0x06, 0x79,
+  0x68, 0xc7, 0x40, 0xae, 0x46, 0xec, 0xb5, 0xc2, 0x7a, 0x3e, 0x26, 0xab, 0xcd, 0x70, 0x04, 0x47,
+  0x93, 0x29, 0xd8, 0x44, 0x59, 0x67, 0xba, 0x8c, 0x18, 0x17, 0x94, 0x27, 0x55, 0x71, 0x44, 0x83,
+  0x72, 0x62, 0xc9, 0x27, 0x3b, 0x68, 0x0a, 0x3e, 0x60, 0xd7, 0xe5, 0x09, 0xa4, 0xf3, 0x82, 0xdc,
+  0xd3, 0xdf, 0x09, 0x4c, 0x1b, 0xae, 0x29, 0x5c, 0xb3, 0x3e, 0x38, 0xe0, 0x67, 0xf3, 0x14, 0x85,
+  0x0c, 0xaf, 0xdb, 0x6c, 0xa5, 0xdb, 0x34, 0x2d, 0xc2, 0xa6, 0xad, 0x36, 0x7f, 0x85, 0x75, 0x13,
+  0xa6, 0x47, 0x76, 0xd6, 0x4e, 0x99, 0x22, 0xfe, 0x0f, 0x26, 0x28, 0x84, 0x67, 0x40, 0x04, 0x00,
+  0x00,
+};
+
+// a final block with fixed Huffman codes, whose end of block code is decoded with the input read ahead,
+// made with zlib.compressobj(9, zlib.DEFLATED, 31, 9, zlib.Z_FIXED)
+static const char fixed_text[] = "Sphinx of black quartz, judge my vow. The five boxing wizards jump quickly. Pack my box with five dozen liquor jugs. "
+                                 "How vexingly quick daft zebras jump!";
+static const uint8_t fixed_gz[] = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x0b, 0x2e, 0xc8, 0xc8, 0xcc, 0xab,
+  0x50, 0xc8, 0x4f, 0x53, 0x48, 0xca, 0x49, 0x4c, 0xce, 0x56, 0x28, 0x2c, 0x4d, 0x2c, 0x2a, 0xa9,
+  0xd2, 0x51, 0xc8, 0x2a, 0x4d, 0x49, 0x4f, 0x55, 0xc8, 0xad, 0x54, 0x28, 0xcb, 0x2f, 0xd7, 0x53,
+  0x08, 0xc9, 0x48, 0x55, 0x48, 0xcb, 0x2c, 0x4b, 0x55, 0x48, 0xca, 0xaf, 0xc8, 0xcc, 0x4b, 0x57,
+  0x28, 0xcf, 0xac, 0x4a, 0x2c, 0x4a, 0x29, 0x06, 0xaa, 0xca, 0x2d, 0x00, 0x6a, 0xc9, 0x4c, 0xce,
+  0xce, 0xa9, 0xd4, 0x53, 0x08, 0x00, 0x19, 0x00, 0xd4, 0x02, 0x54, 0x04, 0x54, 0x51, 0x92, 0x01,
+  0xd1, 0x92, 0x92, 0x5f, 0x95, 0x9a, 0xa7, 0x90, 0x93, 0x59, 0x58, 0x9a, 0x5f, 0x04, 0xd4, 0x90,
+  0x5e, 0xac, 0xa7, 0xe0, 0x91, 0x5f, 0xae, 0x50, 0x96, 0x0a, 0x32, 0x29, 0xa7, 0x12, 0xa2, 0x5d,
+  0x21, 0x25, 0x31, 0xad, 0x44, 0xa1, 0x2a, 0x35, 0xa9, 0x28, 0x11, 0x62, 0xaa, 0x22, 0x00, 0xb3,
+  0x00, 0x4f, 0x2f, 0x99, 0x00, 0x00, 0x00,
+};
+
+static const uint8_t delta_gz[] = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x73, 0x0d, 0x0e, 0x70, 0x61, 0x64,
+  0x00, 0x02, 0x16, 0x06, 0x06, 0x07, 0x20, 0x2e, 0xde, 0x6d, 0xb6, 0x44, 0x7b, 0xfb, 0xc9, 0x03,
+  0xe5, 0xdf, 0x26, 0xec, 0x79, 0xc2, 0x15, 0xb9, 0x35, 0xac, 0xe3, 0x4b, 0xa1, 0x1e, 0xc3, 0x41,
+  0x59, 0x57, 0x87, 0x53, 0x35, 0xfb, 0xd8, 0xb3, 0xda, 0x40, 0x4a, 0x19, 0xa1, 0xd8, 0xf4, 0x3f,
+  0x12, 0x67, 0x84, 0x83, 0xe4, 0xcf, 0x40, 0xc2, 0x61, 0x04, 0x07, 0x00, 0x3b, 0x9f, 0xa8, 0x8c,
+  0xb2, 0x96, 0xa1, 0x85, 0xbd, 0x9b, 0x6f, 0x68, 0x74, 0x52, 0x66, 0x41, 0x79, 0x5d, 0x6b, 0xcf,
+  0xe4, 0x59, 0x0b, 0x57, 0xac, 0xdf, 0xb6, 0xf7, 0xc8, 0xe9, 0x4b, 0x37, 0x1f, 0x3c, 0x7f, 0xf7,
+  0xf5, 0x0f, 0x33, 0x97, 0xa0, 0x84, 0xbc, 0x9a, 0xae, 0x89, 0xb5, 0x93, 0x67, 0x40, 0x78, 0x5c,
+  0x6a, 0x4e, 0x71, 0x55, 0x63, 0x47, 0xff, 0xb4, 0xb9, 0x4b, 0x56, 0x6f, 0xda, 0x79, 0x66, 0x98,
+  0x26, 0xa5, 0xa4, 0xd1, 0x3c, 0x02, 0x07, 0x66, 0xf6, 0xd4, 0x33, 0x0b, 0x00, 0x84, 0x0f, 0x59,
+  0x26, 0xb8, 0x04, 0x00, 0x00,
+};
+
+static uint8_t old_image[OLD_SIZE];
+static uint8_t new_image[NEW_SIZE];
+static uint8_t out[NEW_SIZE];
+static size_t out_len;
+
+static void make_images() {
+  uint32_t x = 1;
+  for (int i = 0; i < OLD_SIZE; i++) {
+    x = x * 1103515245 + 12345;
+    old_image[i] = "0123456789abcdef"[x >> 28];
+  }
+  memcpy(new_image, old_image, INSERT_AT);
+  for (int i = 0; i < INSERT_SIZE; i++) {
+    new_image[INSERT_AT + i] = i * 7;
+  }
+  memcpy(new_image + INSERT_AT + INSERT_SIZE, old_image + INSERT_AT, OLD_SIZE - INSERT_AT);
+  for (int i = 0; i < NEW_SIZE; i += 256) {
+    new_image[i]++;
+  }
+}
+
+static bool write_out(const uint8_t *data, size_t len) {
+  if (out_len + len > sizeof(out)) {
+    return false;
+  }
+  memcpy(out + out_len, data, len);
+  out_len += len;
+  return true;
+}
+
+static bool read_old(size_t offset, uint8_t *data, size_t len) {
+  if (offset + len > OLD_SIZE) {
+    return false;
+  }
+  memcpy(data, old_image + offset, len);
+  return true;
+}
+
+static bool check_old(const UpdateDelta &delta) {
+  MD5Builder md5;
+  uint8_t result[16];
+  md5.begin();
+  md5.add(old_image, delta.oldSize());
+  md5.calculate();
+  md5.getBytes(result);
+  return delta.oldSize() == OLD_SIZE && !memcmp(result, delta.oldMD5(), 16);
+}
+
+static bool write_chunks(UpdateGzip &gzip, const uint8_t *data, size_t len, size_t chunk) {
+  for (size_t i = 0; i < len; i += chunk) {
+    if (!gzip.write(data + i, (len - i < chunk) ? len - i : chunk)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void setUp(void) {
+  memset(out, 0, sizeof(out));
+  out_len = 0;
+}
+
+void tearDown(void) {}
+
+void test_gzip(void) {
+  const size_t chunks[] = {1, 13, 256, sizeof(new_gz)};
+  for (size_t chunk : chunks) {
+    UpdateGzip gzip;
+    setUp();
+    TEST_ASSERT_TRUE(gzip.begin(write_out));
+    TEST_ASSERT_TRUE(write_chunks(gzip, new_gz, sizeof(new_gz), chunk));
+    TEST_ASSERT_TRUE(gzip.isFinished());
+    TEST_ASSERT_EQUAL(NEW_SIZE, out_len);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(new_image, out, NEW_SIZE);
+  }
+}
+
+void test_gzip_read_ahead(void) {
+  // in one chunk, tinfl reads the first bytes of the trailer with the end of the deflate stream
+  const size_t chunks[] = {sizeof(fixed_gz), 100, 1};
+  for (size_t chunk : chunks) {
+    UpdateGzip gzip;
+    setUp();
+    TEST_ASSERT_TRUE(gzip.begin(write_out));
+    TEST_ASSERT_TRUE(write_chunks(gzip, fixed_gz, sizeof(fixed_gz), chunk));
+    TEST_ASSERT_TRUE(gzip.isFinished());
+    TEST_ASSERT_EQUAL(sizeof(fixed_text) - 1, out_len);
+    TEST_ASSERT_EQUAL_MEMORY(fixed_text, out, out_len);
+  }
+}
+
+void test_gzip_corrupted(void) {
+  static uint8_t image[sizeof(new_gz)];
+  UpdateGzip gzip;
+
+  // damaged data is caught by the CRC32 of the trailer at the latest
+  memcpy(image, new_gz, sizeof(image));
+  image[sizeof(image) / 2] ^= 0x10;
+  TEST_ASSERT_TRUE(gzip.begin(write_out));
+  gzip.write(image, sizeof(image));
+  TEST_ASSERT_FALSE(gzip.isFinished());
+
+  // truncated
+  setUp();
+  TEST_ASSERT_TRUE(gzip.begin(write_out));
+  TEST_ASSERT_TRUE(gzip.write(new_gz, sizeof(new_gz) - 1));
+  TEST_ASSERT_FALSE(gzip.isFinished());
+
+  // trailing data
+  setUp();
+  TEST_ASSERT_TRUE(gzip.begin(write_out));
+  TEST_ASSERT_TRUE(gzip.write(new_gz, sizeof(new_gz)));
+  TEST_ASSERT_FALSE(gzip.write(new_gz, 1));
+  TEST_ASSERT_TRUE(gzip.hasError());
+}
+
+void test_delta(void) {
+  const size_t chunks[] = {1, 13, 256, sizeof(delta_gz)};
+  for (size_t chunk : chunks) {
+    UpdateDelta delta(read_old, write_out, check_old);
+    UpdateGzip gzip;
+    setUp();
+    TEST_ASSERT_TRUE(gzip.begin([&delta](const uint8_t *data, size_t len) {
+      return delta.write(data, len);
+    }));
+    TEST_ASSERT_TRUE(write_chunks(gzip, delta_gz, sizeof(delta_gz), chunk));
+    TEST_ASSERT_TRUE(gzip.isFinished());
+    TEST_ASSERT_TRUE(delta.isFinished());
+    TEST_ASSERT_EQUAL(NEW_SIZE, delta.newSize());
+    TEST_ASSERT_EQUAL(NEW_SIZE, out_len);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(new_image, out, NEW_SIZE);
+  }
+}
+
+void test_delta_other_base(void) {
+  UpdateDelta delta(read_old, write_out, check_old);
+  UpdateGzip gzip;
+  old_image[OLD_SIZE - 1]++;
+  TEST_ASSERT_TRUE(gzip.begin([&delta](const uint8_t *data, size_t len) {
+    return delta.write(data, len);
+  }));
+  TEST_ASSERT_FALSE(gzip.write(delta_gz, sizeof(delta_gz)));
+  TEST_ASSERT_TRUE(delta.hasError());
+  TEST_ASSERT_EQUAL(0, out_len);
+  old_image[OLD_SIZE - 1]--;
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  make_images();
+  UNITY_BEGIN();
+  RUN_TEST(test_gzip);
+  RUN_TEST(test_gzip_read_ahead);
+  RUN_TEST(test_gzip_corrupted);
+  RUN_TEST(test_delta);
+  RUN_TEST(test_delta_other_base);
+  UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,225 @@
+/* Update resume test
+ *
+ * HTTPUpdate downloads the running application from an HTTP server stand-in that breaks
+ * the connection at given offsets. The update must go on from the last checkpoint with
+ * a Range request and end with a copy of the running application.
+ */
+
+#include <unity.h>
+#include <HTTPUpdate.h>
+#include "esp_ota_ops.h"
+
+#define MAX_REQUESTS 8
+#define NO_RANGE     (-1)
+
+// Serves the running application, without any socket
+class HTTPStandIn : public NetworkClient {
+public:
+  const esp_partition_t *image;
+  uint32_t image_size;
+  uint32_t drops[MAX_REQUESTS];  // offset at which each connection breaks
+  int32_t ranges[MAX_REQUESTS];  // Range asked by each request
+  int requests;
+
+  void reset() {
+    image = esp_ota_get_running_partition();
+    image_size = ESP.getSketchSize();
+    for (int i = 0; i < MAX_REQUESTS; i++) {
+      drops[i] = image_size;
+      ranges[i] = NO_RANGE;
+    }
+    requests = 0;
+    _open = false;
+  }
+
+  int connect(IPAddress ip, uint16_t port) {
+    return open();
+  }
+  int connect(IPAddress ip, uint16_t port, int32_t timeout) {
+    return open();
+  }
+  int connect(const char *host, uint16_t port) {
+    return open();
+  }
+  int connect(const char *host, uint16_t port, int32_t timeout) {
+    return open();
+  }
+
+  size_t write(uint8_t c) {
+    return write(&c, 1);
+  }
+  size_t write(const uint8_t *buf, size_t size) {
+    if (!_open) {
+      return 0;
+    }
+    _request.concat(buf, size);
+    if (_request.endsWith("\r\n\r\n")) {
+      respond();
+    }
+    return size;
+  }
+
+  int available() {
+    return _open ? (_header.length() - _headerPos) + (_end - _pos) : 0;
+  }
+  int read() {
+    uint8_t c;
+    return (read(&c, 1) == 1) ? c : -1;
+  }
+  int read(uint8_t *buf, size_t size) {
+    size_t n = 0;
+    while (n < size && _open && _headerPos < _header.length()) {
+      buf[n++] = _header[_headerPos++];
+    }
+    if (n < size && _open && _pos < _end) {
+      size_t len = (size - n < _end - _pos) ? size - n : _end - _pos;
+      if (esp_partition_read(image, _pos, buf + n, len) != ESP_OK) {
+        return -1;
+      }
+      _pos += len;
+      n += len;
+    }
+    if (_headerPos == _header.length() && _pos == _end && _end < image_size) {
+      _open = false;  // connection lost
+    }
+    return n ? n : -1;
+  }
+  size_t readBytes(char *buf, size_t size) {
+    int n = read((uint8_t *)buf, size);  // no waiting for data that will never come
+    return (n > 0) ? n : 0;
+  }
+  int peek() {
+    uint8_t c;
+    if (!_open) {
+      return -1;
+    }
+    if (_headerPos < _header.length()) {
+      return _header[_headerPos];
+    }
+    return (_pos < _end && esp_partition_read(image, _pos, &c, 1) == ESP_OK) ? c : -1;
+  }
+  void flush() {}
+  void stop() {
+    _open = false;
+  }
+  uint8_t connected() {
+    return _open;
+  }
+
+private:
+  bool _open;
+  String _request;
+  String _header;
+  size_t _headerPos;
+  uint32_t _pos;
+  uint32_t _end;
+
+  int open() {
+    _open = requests < MAX_REQUESTS;
+    _request = "";
+    _header = "";
+    _headerPos = 0;
+    _pos = _end = 0;
+    return _open;
+  }
+
+  void respond() {
+    int range = _request.indexOf("Range: bytes=");
+    _pos = (range >= 0) ? _request.substring(range + 13).toInt() : 0;
+    _end = drops[requests];
+    ranges[requests++] = (range >= 0) ? _pos : NO_RANGE;
+    if (range >= 0) {
+      _header = "HTTP/1.0 206 Partial Content\r\nContent-Range: bytes " + String(_pos) + "-" + String(image_size - 1) + "/" + String(image_size) + "\r\n";
+    } else {
+      _header = "HTTP/1.0 200 OK\r\n";
+    }
+    _header += "Content-Length: " + String(image_size - _pos) + "\r\nETag: \"test-image\"\r\n\r\n";
+  }
+};
+
+static HTTPStandIn server;
+static HTTPUpdate updater(1000);
+
+static HTTPUpdateResult run_update() {
+  return updater.update(server, "http://update.local/firmware.bin");
+}
+
+static void check_written_image() {
+  uint8_t running[32], written[32];
+  TEST_ASSERT_EQUAL(ESP_OK, esp_partition_get_sha256(esp_ota_get_running_partition(), running));
+  TEST_ASSERT_EQUAL(ESP_OK, esp_partition_get_sha256(esp_ota_get_next_update_partition(NULL), written));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(running, written, sizeof(running));
+  // keep booting the tested application
+  TEST_ASSERT_EQUAL(ESP_OK, esp_ota_set_boot_partition(esp_ota_get_running_partition()));
+}
+
+void setUp(void) {
+  server.reset();
+  Update.clearResume();
+}
+
+void tearDown(void) {}
+
+void test_disconnects(void) {
+  server.drops[0] = 100000;
+  server.drops[1] = 300000;
+  TEST_ASSERT_GREATER_THAN(300000, server.image_size);
+
+  TEST_ASSERT_EQUAL(HTTP_UPDATE_FAILED, run_update());
+  TEST_ASSERT_EQUAL(UPDATE_ERROR_STREAM, updater.getLastError());
+  TEST_ASSERT_EQUAL(HTTP_UPDATE_FAILED, run_update());
+  TEST_ASSERT_EQUAL(UPDATE_ERROR_STREAM, updater.getLastError());
+  TEST_ASSERT_EQUAL(HTTP_UPDATE_OK, run_update());
+  TEST_ASSERT_EQUAL(3, server.requests);
+
+  // each attempt goes on from the last flash block written before the drop
+  TEST_ASSERT_EQUAL(NO_RANGE, server.ranges[0]);
+  for (int i = 1; i < 3; i++) {
+    TEST_ASSERT_GREATER_THAN(0, server.ranges[i]);
+    TEST_ASSERT_LESS_OR_EQUAL(server.drops[i - 1], server.ranges[i]);
+    TEST_ASSERT_GREATER_THAN(server.drops[i - 1] - SPI_FLASH_BLOCK_SIZE, server.ranges[i]);
+  }
+  check_written_image();
+
+  // the checkpoint is gone with the finished update
+  String id;
+  TEST_ASSERT_EQUAL(0, Update.resumeOffset(id));
+}
+
+void test_damaged_data(void) {
+  const esp_partition_t *partition = esp_ota_get_next_update_partition(NULL);
+  uint8_t zero = 0;
+  server.drops[0] = 200000;
+
+  TEST_ASSERT_EQUAL(HTTP_UPDATE_FAILED, run_update());
+  String id;
+  TEST_ASSERT_GREATER_THAN(0, Update.resumeOffset(id));
+  TEST_ASSERT_EQUAL_STRING("\"test-image\"", id.c_str());
+
+  // the written data no longer matches the checkpoint
+  TEST_ASSERT_EQUAL(ESP_OK, esp_partition_write(partition, 70000, &zero, 1));
+  TEST_ASSERT_EQUAL(HTTP_UPDATE_FAILED, run_update());
+  TEST_ASSERT_EQUAL(HTTP_UE_RESUME_FAILED, updater.getLastError());
+  TEST_ASSERT_EQUAL(0, Update.resumeOffset(id));
+
+  // so the next attempt downloads it all
+  TEST_ASSERT_EQUAL(HTTP_UPDATE_OK, run_update());
+  TEST_ASSERT_EQUAL(NO_RANGE, server.ranges[2]);
+  check_written_image();
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  updater.rebootOnUpdate(false);
+  updater.setResume(true);
+  UNITY_BEGIN();
+  RUN_TEST(test_disconnects);
+  RUN_TEST(test_damaged_data);
+  UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,51 @@
+import logging
+import threading
+import time
+
+import serial
+from serial.tools import list_ports
+
+LOOPBACK_BYTES = 1024 * 1024  # as in usb_cdc.ino
+CHUNK = 4096
+ESPRESSIF_VID = 0x303A
+
+
+def find_cdc_port(exclude):
+    for port in list_ports.comports():
+        if port.vid == ESPRESSIF_VID and port.device != exclude:
+            return port.device
+    return None
+
+
+def test_usb_cdc(dut):
+    dut.expect_exact("Waiting for the host")
+
+    port = None
+    deadline = time.time() + 30
+    while not port and time.time() < deadline:
+        port = find_cdc_port(dut.serial.port)
+        time.sleep(0.5)
+    assert port, "USB CDC port of the board not found"
+
+    data = bytes((i * 7 + (i >> 12)) & 0xFF for i in range(LOOPBACK_BYTES))
+    received = bytearray()
+    with serial.Serial(port, 115200, timeout=5) as cdc:
+
+        def reader():
+            while len(received) < LOOPBACK_BYTES:
+                chunk = cdc.read(min(CHUNK, LOOPBACK_BYTES - len(received)))
+                if not chunk:
+                    return
+                received.extend(chunk)
+
+        thread = threading.Thread(target=reader)
+        start = time.time()
+        thread.start()
+        for i in range(0, LOOPBACK_BYTES, CHUNK):
+            cdc.write(data[i : i + CHUNK])
+        thread.join(60)
+        elapsed = time.time() - start
+
+    logging.info("USB CDC loopback: %u bytes in %.2f s, %.1f kB/s each way", len(received), elapsed, len(received) / elapsed / 1024)
+    assert received == data
+    dut.expect_unity_test_output(timeout=120)
@@ -0,0 +1,80 @@
+/* USB CDC loopback test
+ *
+ * test_usb_cdc.py opens the USB CDC port of the board and streams LOOPBACK_BYTES through it, the
+ * sketch echoes them with zero-copy reads from the RX ring. Results are reported on the UART.
+ */
+
+#include <unity.h>
+#include "USB.h"
+
+#if !ARDUINO_USB_CDC_ON_BOOT
+USBCDC USBSerial;
+#endif
+
+#define LOOPBACK_BYTES (1024 * 1024)  // sent by test_usb_cdc.py
+#define IDLE_TIMEOUT   30000          // ms without data before giving up
+
+static volatile uint32_t dropped = 0;
+
+static void onOverflow(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
+  dropped += ((arduino_usb_cdc_event_data_t *)event_data)->rx_overflow.dropped_bytes;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_loopback(void) {
+  uint32_t echoed = 0;
+  uint32_t start = 0;
+  uint32_t last = millis();
+  Serial.println("Waiting for the host");
+  while (echoed < LOOPBACK_BYTES && millis() - last < IDLE_TIMEOUT) {
+    const uint8_t *data;
+    size_t len = USBSerial.readSpan(&data, 4096);
+    if (!len) {
+      delay(1);
+      continue;
+    }
+    if (!echoed) {
+      start = micros();
+    }
+    size_t sent = USBSerial.write(data, len);
+    USBSerial.releaseRx(data);
+    TEST_ASSERT_EQUAL(len, sent);
+    echoed += len;
+    last = millis();
+  }
+  uint32_t elapsed = micros() - start;
+  TEST_ASSERT_EQUAL(LOOPBACK_BYTES, echoed);
+  TEST_ASSERT_EQUAL(0, dropped);
+  Serial.printf("USB CDC loopback: %lu bytes in %lu ms, %lu kB/s\n", echoed, elapsed / 1000, echoed / (elapsed / 1000 + 1));
+}
+
+void test_resize(void) {
+  // shrinking the drained ring drops nothing
+  TEST_ASSERT_EQUAL(1024, USBSerial.setRxBufferSize(1024));
+  TEST_ASSERT_EQUAL(0, USBSerial.available());
+  TEST_ASSERT_EQUAL(-1, USBSerial.peek());
+  TEST_ASSERT_EQUAL(0, dropped);
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {
+    delay(10);
+  }
+
+  USBSerial.onEvent(ARDUINO_USB_CDC_RX_OVERFLOW_EVENT, onOverflow);
+  // set before begin(), to absorb the bursts of the host
+  USBSerial.setRxBufferSize(8192);
+  USBSerial.begin();
+  USB.begin();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_loopback);
+  RUN_TEST(test_resize);
+  UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,214 @@
+#!/usr/bin/env python
+#
+# ESP32 OTA image generation tool
+#
+# Produces the compressed and delta images accepted by the Update library:
+#   gen_ota_image.py gzip new.bin -o new.bin.gz
+#   gen_ota_image.py delta old.bin new.bin -o new.delta [--gzip]
+# and applies them to a simulated partition, the way the device does:
+#   gen_ota_image.py apply new.delta --old old.bin -o out.bin
+#
+# SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+
+from __future__ import division, print_function, unicode_literals
+
+import argparse
+import gzip
+import hashlib
+import struct
+import sys
+
+DELTA_MAGIC = b"ESPD"
+DELTA_VERSION = 1
+DELTA_HEADER = struct.Struct("<4sIII16s16s")
+DELTA_RECORD = struct.Struct("<IIi")
+
+BLOCK_SIZE = 16  # old image is indexed by aligned blocks of this size
+MIN_MATCH = 32  # shorter matches are sent as extra bytes
+PARTITION_ERASED = b"\xff"
+
+quiet = False
+
+
+def status(msg):
+    if not quiet:
+        print(msg, file=sys.stderr)
+
+
+def gzip_image(data):
+    return gzip.compress(data, compresslevel=9, mtime=0)
+
+
+def _match_length(a, a_pos, b, b_pos):
+    """Length of the exact match of a[a_pos:] and b[b_pos:]"""
+    n = 0
+    limit = min(len(a) - a_pos, len(b) - b_pos)
+    step = 64
+    while n + step <= limit and a[a_pos + n : a_pos + n + step] == b[b_pos + n : b_pos + n + step]:
+        n += step
+    while n < limit and a[a_pos + n] == b[b_pos + n]:
+        n += 1
+    return n
+
+
+def _forward_length(old, old_pos, new, new_pos, limit):
+    """bsdiff forward extension: longest prefix where more than half of the bytes match"""
+    limit = min(limit, len(old) - old_pos)
+    score = best_score = best_len = 0
+    for i in range(limit):
+        if old[old_pos + i] == new[new_pos + i]:
+            score += 1
+        if score * 2 - (i + 1) > best_score * 2 - best_len:
+            best_score = score
+            best_len = i + 1
+    return best_len
+
+
+def delta_image(old, new):
+    index = {}
+    for pos in range(0, len(old) - BLOCK_SIZE + 1, BLOCK_SIZE):
+        index.setdefault(old[pos : pos + BLOCK_SIZE], pos)
+
+    records = []
+    last_new = last_old = 0
+    scan = 0
+    while scan <= len(new) - BLOCK_SIZE:
+        old_pos = index.get(new[scan : scan + BLOCK_SIZE])
+        if old_pos is None:
+            scan += 1
+            continue
+        length = _match_length(new, scan, old, old_pos)
+        back = 0
+        while back < scan - last_new and back < old_pos and new[scan - back - 1] == old[old_pos - back - 1]:
+            back += 1
+        if length + back < MIN_MATCH:
+            scan += 1
+            continue
+        match_new = scan - back
+        match_old = old_pos - back
+        forward = _forward_length(old, last_old, new, last_new, match_new - last_new)
+        records.append((last_new, last_old, forward, match_new, match_old - (last_old + forward)))
+        last_new = match_new
+        last_old = match_old
+        scan += length
+    forward = _forward_length(old, last_old, new, last_new, len(new) - last_new)
+    records.append((last_new, last_old, forward, len(new), 0))
+
+    out = bytearray(DELTA_HEADER.pack(DELTA_MAGIC, DELTA_VERSION, len(old), len(new), hashlib.md5(old).digest(), hashlib.md5(new).digest()))
+    extra_total = 0
+    for new_pos, old_pos, diff_len, extra_end, seek in records:
+        extra_len = extra_end - new_pos - diff_len
+        extra_total += extra_len
+        out += DELTA_RECORD.pack(diff_len, extra_len, seek)
+        out += bytes((new[new_pos + i] - old[old_pos + i]) & 0xFF for i in range(diff_len))
+        out += new[new_pos + diff_len : extra_end]
+    status("%u records, %u extra bytes" % (len(records), extra_total))
+    return bytes(out)
+
+
+def apply_delta(partition, old, delta):
+    """Applies a delta image against the old image, writing the result to the partition"""
+    magic, version, old_size, new_size, old_md5, new_md5 = DELTA_HEADER.unpack_from(delta, 0)
+    if magic != DELTA_MAGIC or version != DELTA_VERSION:
+        raise ValueError("not a delta image")
+    if hashlib.md5(old[:old_size]).digest() != old_md5:
+        raise ValueError("delta image was made against another old image")
+    if new_size > len(partition):
+        raise ValueError("new image does not fit in the partition")
+    pos = DELTA_HEADER.size
+    old_pos = new_pos = 0
+    while new_pos < new_size:
+        diff_len, extra_len, seek = DELTA_RECORD.unpack_from(delta, pos)
+        pos += DELTA_RECORD.size
+        for i in range(diff_len):
+            partition[new_pos + i] = (old[old_pos + i] + delta[pos + i]) & 0xFF
+        pos += diff_len
+        old_pos += diff_len
+        new_pos += diff_len
+        partition[new_pos : new_pos + extra_len] = delta[pos : pos + extra_len]
+        pos += extra_len
+        new_pos += extra_len
+        old_pos += seek
+    if pos != len(delta):
+        raise ValueError("trailing data after the delta image")
+    if hashlib.md5(partition[:new_size]).digest() != new_md5:
+        raise ValueError("MD5 of the patched image does not match")
+    return new_size
+
+
+def apply_image(image, old, partition_size):
+    """Decodes an image the way Update does, into a simulated partition"""
+    partition = bytearray(PARTITION_ERASED * partition_size)
+    if image[:2] == b"\x1f\x8b":
+        image = gzip.decompress(image)
+    if image[:4] == DELTA_MAGIC:
+        if old is None:
+            raise ValueError("delta image needs the old image")
+        size = apply_delta(partition, old, image)
+    else:
+        if len(image) > partition_size:
+            raise ValueError("image does not fit in the partition")
+        partition[: len(image)] = image
+        size = len(image)
+    return bytes(partition[:size])
+
+
+def main():
+    global quiet
+    parser = argparse.ArgumentParser(description="ESP32 compressed and delta OTA image utility")
+    parser.add_argument("--quiet", "-q", help="Don't print status messages to stderr", action="store_true")
+    subparsers = parser.add_subparsers(dest="command")
+
+    p = subparsers.add_parser("gzip", help="Compress an image")
+    p.add_argument("new", help="New application or data image", type=argparse.FileType("rb"))
+    p.add_argument("-o", "--output", help="Output image", type=argparse.FileType("wb"), required=True)
+
+    p = subparsers.add_parser("delta", help="Make a delta image against the running application image")
+    p.add_argument("old", help="Application image running on the device", type=argparse.FileType("rb"))
+    p.add_argument("new", help="New application image", type=argparse.FileType("rb"))
+    p.add_argument("-o", "--output", help="Output image", type=argparse.FileType("wb"), required=True)
+    p.add_argument("--gzip", help="Compress the delta image", action="store_true")
+
+    p = subparsers.add_parser("apply", help="Apply an image to a simulated partition")
+    p.add_argument("image", help="Raw, compressed or delta image", type=argparse.FileType("rb"))
+    p.add_argument("--old", help="Old application image, for delta images", type=argparse.FileType("rb"))
+    p.add_argument("--partition-size", help="Size of the simulated partition", type=lambda x: int(x, 0), default=0x140000)
+    p.add_argument("--expect", help="Image the result must be equal to", type=argparse.FileType("rb"))
+    p.add_argument("-o", "--output", help="Decoded image", type=argparse.FileType("wb"))
+
+    args = parser.parse_args()
+    quiet = args.quiet
+
+    if args.command == "gzip":
+        new = args.new.read()
+        out = gzip_image(new)
+    elif args.command == "delta":
+        old = args.old.read()
+        new = args.new.read()
+        out = delta_image(old, new)
+        if args.gzip:
+            out = gzip_image(out)
+    elif args.command == "apply":
+        old = args.old.read() if args.old else None
+        out = apply_image(args.image.read(), old, args.partition_size)
+        if args.expect and args.expect.read() != out:
+            raise SystemExit("Decoded image differs from the expected one")
+        status("Decoded %u bytes, MD5 %s" % (len(out), hashlib.md5(out).hexdigest()))
+        if args.output:
+            args.output.write(out)
+        return
+    else:
+        parser.print_help()
+        return
+
+    status("%u bytes -> %u bytes (%.1f%%)" % (len(new), len(out), 100.0 * len(out) / max(len(new), 1)))
+    args.output.write(out)
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except ValueError as e:
+        print(e, file=sys.stderr)
+        sys.exit(2)
@@ -0,0 +1,300 @@
+#!/usr/bin/env python
+#
+# ESP32 tokenized log decoder
+#
+# Prints back the binary log frames sent when the application is built with ARDUHAL_LOG_TOKENIZED,
+# using the formats and the strings found in the ELF file of the application:
+#   log_decoder.py decode app.elf log.bin
+#   log_decoder.py decode app.elf --port /dev/ttyUSB0 [--baud 115200]
+# or in a table generated from it, for hosts without the ELF file:
+#   log_decoder.py table app.elf -o app.tokens.json
+#   log_decoder.py decode app.tokens.json log.bin
+# Bytes outside of frames, like the boot messages, are printed as they are.
+#
+# SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+
+from __future__ import division, print_function, unicode_literals
+
+import argparse
+import bisect
+import codecs
+import json
+import re
+import struct
+import sys
+
+FRAME_SYNC = 0x1F
+SHT_PROGBITS = 1
+SHF_ALLOC = 0x2
+SHF_EXECINSTR = 0x4
+
+# same conversions as logRingSpec() in cores/esp32/esp32-hal-log-ring.c
+SPEC_RE = re.compile(r"%([-+ #0']*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|q|z|j|t|L)?([diouxXcsfFeEgGaApn])")
+PATH_RE = re.compile(r"\[[^\[\]]*[/\\]([^/\\\[\]]+:\d+\])")
+
+
+def fnv1a(data):
+    h = 2166136261
+    for b in bytearray(data):
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h or 1
+
+
+def is_text(data):
+    return all(b >= 0x20 or b in (0x09, 0x0A, 0x0D, 0x1B) for b in bytearray(data))
+
+
+def elf_strings(data):
+    """Yield the address and the bytes of the strings in the allocated, not executable sections."""
+    if data[:4] != b"\x7fELF" or bytearray(data)[4] != 1:
+        raise ValueError("Not an ELF32 file")
+    (shoff,) = struct.unpack_from("<I", data, 0x20)
+    shentsize, shnum = struct.unpack_from("<HH", data, 0x2E)
+    for i in range(shnum):
+        _, sh_type, flags, addr, offset, size = struct.unpack_from("<IIIIII", data, shoff + i * shentsize)
+        if sh_type != SHT_PROGBITS or not flags & SHF_ALLOC or flags & SHF_EXECINSTR:
+            continue
+        section = data[offset : offset + size]
+        start = 0
+        for chunk in section.split(b"\0"):
+            if chunk and is_text(chunk):
+                yield addr + start, chunk
+            start += len(chunk) + 1
+
+
+class Strings(object):
+    def __init__(self, formats, strings):
+        self.formats = formats  # token -> format
+        self.strings = strings  # address -> string
+        self.starts = sorted(strings)
+
+    @classmethod
+    def from_elf(cls, data):
+        formats = {}
+        strings = {}
+        for addr, chunk in elf_strings(data):
+            s = chunk.decode("utf-8", "replace")
+            strings[addr] = s
+            if "%" in s:
+                formats[fnv1a(chunk)] = PATH_RE.sub(r"[\1", s)
+        return cls(formats, strings)
+
+    @classmethod
+    def from_table(cls, table):
+        formats = dict((int(k, 16), v) for k, v in table["formats"].items())
+        strings = dict((int(k, 16), v) for k, v in table["strings"].items())
+        return cls(formats, strings)
+
+    def table(self):
+        return {
+            "formats": dict(("%08x" % k, v) for k, v in self.formats.items()),
+            "strings": dict(("%08x" % k, v) for k, v in self.strings.items()),
+        }
+
+    def string_at(self, addr):
+        if addr in self.strings:
+            return self.strings[addr]
+        # a pointer into a string, like pathToFileName() results
+        i = bisect.bisect_right(self.starts, addr) - 1
+        if i >= 0 and addr < self.starts[i] + len(self.strings[self.starts[i]]):
+            return self.strings[self.starts[i]][addr - self.starts[i] :]
+        return "<0x%08x>" % addr
+
+
+class Truncated(Exception):
+    pass
+
+
+class Args(object):
+    def __init__(self, data):
+        self.data = bytearray(data)
+        self.pos = 0
+
+    def take(self, n):
+        if self.pos + n > len(self.data):
+            raise Truncated()
+        out = self.data[self.pos : self.pos + n]
+        self.pos += n
+        return bytes(out)
+
+    def varint(self):
+        v = 0
+        shift = 0
+        while True:
+            (b,) = bytearray(self.take(1))
+            v |= (b & 0x7F) << shift
+            shift += 7
+            if b < 0x80:
+                return v
+
+    def zigzag(self):
+        v = self.varint()
+        return (v >> 1) ^ -(v & 1)
+
+
+def cast(v, length, signed):
+    bits = {"hh": 8, "h": 16}.get(length)
+    if bits:
+        v &= (1 << bits) - 1
+        if signed and v >> (bits - 1):
+            v -= 1 << bits
+    return v
+
+
+def format_message(fmt, args, strings):
+    out = []
+    pos = 0
+    while True:
+        i = fmt.find("%", pos)
+        if i < 0:
+            out.append(fmt[pos:])
+            return "".join(out)
+        out.append(fmt[pos:i])
+        if fmt.startswith("%%", i):
+            out.append("%")
+            pos = i + 2
+            continue
+        m = SPEC_RE.match(fmt, i)
+        if not m:
+            # unknown conversion, printed as it is
+            out.append("%")
+            pos = i + 1
+            continue
+        pos = m.end()
+        flags, width, prec, length, conv = m.groups()
+        flags = flags.replace("'", "")
+        try:
+            if width == "*":
+                w = args.zigzag()
+                if w < 0:
+                    flags += "-"
+                width = str(abs(w))
+            if prec == "*":
+                p = args.zigzag()
+                prec = str(p) if p >= 0 else None
+            spec = "%" + flags + (width or "") + ("." + prec if prec is not None else "")
+            if conv in "di":
+                out.append((spec + "d") % cast(args.zigzag(), length, True))
+            elif conv in "uoxX":
+                text = (spec + ("d" if conv == "u" else conv)) % cast(args.varint(), length, False)
+                out.append(text.replace("0o", "0", 1) if conv == "o" else text)
+            elif conv == "c":
+                out.append((spec + "c") % (args.varint() & 0xFF))
+            elif conv in "fFeEgG":
+                out.append((spec + conv) % struct.unpack("<d", args.take(8))[0])
+            elif conv in "aA":
+                text = float.hex(struct.unpack("<d", args.take(8))[0])
+                if prec is None:
+                    text = re.sub(r"\.?0+p", "p", text)  # shortest form, like printf()
+                out.append(("%" + flags.replace("0", "") + (width or "") + "s") % (text.upper() if conv == "A" else text))
+            elif conv == "p":
+                out.append(("%" + flags + (width or "") + "#x") % struct.unpack("<I", args.take(4))[0])
+            elif conv == "s":
+                v = args.varint()
+                s = strings.string_at(v >> 1) if v & 1 else args.take(v >> 1).decode("utf-8", "replace")
+                out.append((spec + "s") % s)
+        except Truncated:
+            out.append("<?>")
+
+
+class Decoder(object):
+    def __init__(self, strings):
+        self.strings = strings
+        self.buf = bytearray()
+        self.text = codecs.getincrementaldecoder("utf-8")("replace")
+
+    def frame(self, data):
+        """Decode the frame at the start of data, None if it is not a known frame."""
+        size = data[1]
+        if size < 4:
+            return None
+        (token,) = struct.unpack_from("<I", bytes(data[2:6]))
+        fmt = self.strings.formats.get(token)
+        if fmt is None:
+            return None
+        return format_message(fmt, Args(data[6 : 2 + size]), self.strings)
+
+    def feed(self, data):
+        self.buf += data
+        out = []
+        while self.buf:
+            i = self.buf.find(FRAME_SYNC)
+            if i < 0:
+                i = len(self.buf)
+            if i:
+                out.append(self.text.decode(bytes(self.buf[:i])))
+                del self.buf[:i]
+                continue
+            if len(self.buf) < 2 or len(self.buf) < 2 + self.buf[1]:
+                break  # wait for the rest of the frame
+            msg = self.frame(self.buf)
+            if msg is None:
+                # not a frame, the byte is part of the text
+                out.append(self.text.decode(bytes(self.buf[:1])))
+                del self.buf[:1]
+            else:
+                out.append(msg)
+                del self.buf[: 2 + self.buf[1]]
+        return "".join(out)
+
+
+def load_strings(f):
+    data = f.read()
+    if data[:4] == b"\x7fELF":
+        return Strings.from_elf(data)
+    return Strings.from_table(json.loads(data.decode("utf-8")))
+
+
+def chunks(args):
+    if args.port:
+        import serial  # pyserial, only needed to read from a port
+
+        port = serial.Serial(args.port, args.baud, timeout=0.1)
+        while True:
+            data = port.read(4096)
+            if data:
+                yield data
+    stream = args.input if args.input else getattr(sys.stdin, "buffer", sys.stdin)
+    while True:
+        data = stream.read1(4096) if hasattr(stream, "read1") else stream.read(4096)
+        if not data:
+            return
+        yield data
+
+
+def main():
+    parser = argparse.ArgumentParser(description="ESP32 tokenized log decoder")
+    subparsers = parser.add_subparsers(dest="command")
+
+    p = subparsers.add_parser("table", help="Extract the formats and the strings of an application")
+    p.add_argument("elf", help="ELF file of the application", type=argparse.FileType("rb"))
+    p.add_argument("-o", "--output", help="Table of formats and strings", type=argparse.FileType("w"), required=True)
+
+    p = subparsers.add_parser("decode", help="Print tokenized logs as text")
+    p.add_argument("strings", help="ELF file of the application, or table made from it", type=argparse.FileType("rb"))
+    p.add_argument("input", help="Log to decode, standard input by default", type=argparse.FileType("rb"), nargs="?")
+    p.add_argument("--port", "-p", help="Serial port to read the log from")
+    p.add_argument("--baud", "-b", help="Baud rate of the serial port", type=int, default=115200)
+
+    args = parser.parse_args()
+
+    if args.command == "table":
+        strings = Strings.from_elf(args.elf.read())
+        json.dump(strings.table(), args.output, indent=1, sort_keys=True)
+        print("%u formats, %u strings" % (len(strings.formats), len(strings.strings)), file=sys.stderr)
+    elif args.command == "decode":
+        decoder = Decoder(load_strings(args.strings))
+        for data in chunks(args):
+            sys.stdout.write(decoder.feed(data))
+            sys.stdout.flush()
+    else:
+        parser.print_help()
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except (ValueError, KeyboardInterrupt) as e:
+        print(e, file=sys.stderr)
+        sys.exit(2)